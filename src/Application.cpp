@@ -315,10 +315,12 @@ void RigidBodyApplication::update()
 
             updateObjects(Duration);
 
+            _query.update();
+
             generateContacts();
 
             //Here we resolve all contacts.
-            _resolver.resolveContact(_collData.contactArray, _collData.contactCount, Duration);
+            _resolver.resolveContact(_collData.contactArray, _collData.contactCount, _joints.data(), _joints.size(), Duration);
         }
         else if (_autoPausePhysics)
         {
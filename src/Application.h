@@ -21,6 +21,7 @@
 #include "Physics/CollisionSystem/contact.h"
 #include "Physics/CollisionSystem/collision_broad.h"
 #include "Physics/CollisionSystem/collision_narrow.h"
+#include "Physics/CollisionSystem/collision_query.h"
 
 #include "Timer.h"
 
@@ -143,6 +144,12 @@ protected:
     //Here we have the structure that holds the collision resolver.
     wind::ContactResolver _resolver;
 
+    //These are the joints between the rigid bodies, they are solved by the resolver along with the contacts.
+    std::vector<wind::Joint*> _joints;
+
+    //This answers the game's ray casts and overlap tests, it is brought up to date after the objects move each step.
+    wind::CollisionQuery _query;
+
     //Here we have to 2 values for moving the camera, theta is the angle and alpha is the elevation.
     float _theta;
     float _alpha;
@@ -23,6 +23,8 @@ public:
 
     Vector3 getForward() const { return _forward; }
     Vector3 getUp() const { return _up; }
+    //The vertical field of view in radians.
+    real getFov() const { return _fov; }
 
     //These function returns a left and right vectors
     Vector3 getLeft();
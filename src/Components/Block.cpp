@@ -3,7 +3,6 @@
 Block::Block()
 {
 	wind::Box::body = new wind::RigidBody();
-	cube = new Mesh();
 	if(wind::Box::body == nullptr)
 	{
 		std::cerr << "Contact box primitive is null, check you assignment of new body" << std::endl;
@@ -12,7 +11,6 @@ Block::Block()
 
 Block::~Block()
 {
-	delete cube;
 }
 
 void Block::setState(const wind::Vector3& pos, const wind::Vector3& half)
@@ -43,9 +41,10 @@ void Block::setState(const wind::Vector3& pos, const wind::Vector3& half)
 	wind::Box::calculateInternals();
 }
 
-void Block::loadMesh(const std::string& filePath)
+void Block::loadMesh(wind::MeshManager& meshes, const std::string& filePath)
 {
-	cube->addMesh(filePath, halfSize);
+	//Blocks with the same size share the one mesh.
+	cube = meshes.loadAsync(filePath, halfSize);
 }
 
 void Block::gravityOff()
@@ -76,7 +75,10 @@ void Block::changePosition(wind::Vector3 pos)
 
 void Block::draw()
 {
-	cube->Draw();
+	if(cube)
+	{
+		cube->Draw();
+	}
 }
 
 wind::RigidBody* Block::getBody()
@@ -84,7 +86,7 @@ wind::RigidBody* Block::getBody()
 	return wind::Box::body;
 }
 
-Mesh* Block::getMesh()
+std::shared_ptr<Mesh> Block::getMesh()
 {
 	return cube;
 }
@@ -13,7 +13,7 @@ class Block : public wind::Box
 		Block();
 		~Block();
 		void setState(const wind::Vector3& pos, const wind::Vector3& half);
-		void loadMesh(const std::string& filePath);
+		void loadMesh(wind::MeshManager& meshes, const std::string& filePath);
 		void gravityOff();
 		void canSleep(const bool state);
 		void setSleep(const bool state);
@@ -21,9 +21,9 @@ class Block : public wind::Box
 		void changePosition(wind::Vector3 pos);
 		void draw();
 		wind::RigidBody* getBody();
-		Mesh* getMesh();
+		std::shared_ptr<Mesh> getMesh();
 	private:
-		Mesh* cube;
+		std::shared_ptr<Mesh> cube;
 };
 
 #endif
@@ -1,16 +1,16 @@
 #include "CompRegistration.h"
 
-MeshReg::~MeshReg()
+void MeshReg::add(const std::shared_ptr<Mesh>& m)
 {
 	for(unsigned int i = 0; i < Regy.size(); i++)
 	{
-		Regy[i].release();
+		if(Regy[i] == m)
+		{
+			return;
+		}
 	}
-}
 
-void MeshReg::add(Mesh *m)
-{
-	Regy.push_back(std::move(std::unique_ptr<Mesh>(m)));
+	Regy.push_back(m);
 }
 
 void MeshReg::remove(unsigned int unit)
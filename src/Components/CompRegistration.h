@@ -3,16 +3,17 @@
 
 #include <memory>
 #include "../Graphics/Mesh.h"
+#include "../Graphics/MeshManager.h"
 
+//Meshes are shared between objects now, so each mesh is only registered once however many objects use it.
 class MeshReg
 {
 	protected:
 	public:
-		~MeshReg();
-		void add(Mesh *m);
+		void add(const std::shared_ptr<Mesh>& m);
 		void remove(unsigned int unit = 0);
 		void draw();
-		std::vector<std::unique_ptr<Mesh>> Regy;
+		std::vector<std::shared_ptr<Mesh>> Regy;
 };
 
 #endif
\ No newline at end of file
@@ -5,12 +5,15 @@ LevelGeometry::LevelGeometry()
     mesh = new Mesh();
     body = new wind::RigidBody();
 
+    collider.body = body;
+    collider.mesh = &collision;
+
     once = true;
 }
 
 void LevelGeometry::loadMesh(const std::string filePath, wind::Vector3 size)
 {
-    mesh->addMesh(filePath, size, polygons);
+    mesh->addMesh(filePath, size, collision);
 }
 
 void LevelGeometry::setState(const wind::Vector3& pos)
@@ -40,14 +43,9 @@ void LevelGeometry::update(wind::real duration)
 {
     if(once)
     {
+        //The collision mesh stays in the body's space, anything tested against it is moved into that space instead.
         body->integrate(duration);
-
-        for(int i = 0; i < polygons.size(); i++)
-        {
-            polygons[i]->vertices[0] = body->getTransform() * polygons[i]->vertices[0];
-            polygons[i]->vertices[1] = body->getTransform() * polygons[i]->vertices[1];
-            polygons[i]->vertices[2] = body->getTransform() * polygons[i]->vertices[2];
-        }
+        collider.calculateInternals();
 
         once = false;
     }
@@ -58,6 +56,28 @@ void LevelGeometry::draw()
 	mesh->Draw();
 }
 
+void LevelGeometry::draw(const wind::Frustum& frustum)
+{
+    if(!mesh->isLoaded())
+    {
+        return;
+    }
+
+    float model[16];
+    body->getGLTransform(model);
+
+    mesh->bind();
+    for(unsigned int i = 0; i < mesh->getChunkCount(); i++)
+    {
+        const MeshChunk& chunk = mesh->getChunk(i);
+        if(frustum.testBox(wind::transformBounds(model, chunk.boundsMin, chunk.boundsMax)) != wind::CULL_OUTSIDE)
+        {
+            mesh->drawChunkBound(i);
+        }
+    }
+    Mesh::unbind();
+}
+
 wind::RigidBody* LevelGeometry::getBody()
 {
 	return body;
@@ -67,3 +87,13 @@ Mesh* LevelGeometry::getMesh()
 {
 	return mesh;
 }
+
+const wind::CollisionMesh& LevelGeometry::getCollisionMesh() const
+{
+	return collision;
+}
+
+const wind::TriangleMesh& LevelGeometry::getCollider() const
+{
+	return collider;
+}
@@ -2,7 +2,8 @@
 #define LEVELGEOMETRY_H_INCLUDED
 
 #include "../Physics/include/Body.h"
-#include "../Physics/include/Polygon.h"
+#include "../Physics/CollisionSystem/collision_narrow.h"
+#include "../Graphics/Frustum.h"
 #include "CompRegistration.h"
 
 class LevelGeometry
@@ -14,11 +15,18 @@ class LevelGeometry
         void update(wind::real duration);
 
         void draw();
+        //This only draws the chunks of the level the frustum can see, the shader's model matrix needs to be set already.
+        void draw(const wind::Frustum& frustum);
         wind::RigidBody* getBody();
         Mesh* getMesh();
+        //The level's triangles for the physics, they are in the body's space.
+        const wind::CollisionMesh& getCollisionMesh() const;
+        //This is what things collide with, see CollisionDetection::BoxAndTriangleMesh and the others.
+        const wind::TriangleMesh& getCollider() const;
 
     private:
-        std::vector<wind::Polygon *> polygons;
+        wind::CollisionMesh collision;
+        wind::TriangleMesh collider;
 
         Mesh* mesh;
         wind::RigidBody* body;
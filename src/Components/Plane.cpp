@@ -1,6 +1,6 @@
 #include "Plane.h"
 
-Wall::Wall() : mesh(std::make_unique<Mesh>())
+Wall::Wall()
 {
 	wind::Plane::body = new wind::RigidBody();
 }
@@ -35,9 +35,9 @@ void Wall::setState(const wind::Vector3& pos, wind::Vector3 dir)
 	wind::Plane::offset = pos * wind::Plane::direction;
 }
 
-void Wall::loadMesh(const std::string& filePath)
+void Wall::loadMesh(wind::MeshManager& meshes, const std::string& filePath)
 {
-	mesh->addMesh(filePath, wind::Vector3(1.0, 1.0, 1.0));
+	mesh = meshes.loadAsync(filePath, wind::Vector3(1.0, 1.0, 1.0));
 }
 
 void Wall::initRotation(const wind::Vector3& axis, const wind::Vector3& pos, const wind::real& angle)
@@ -56,7 +56,10 @@ void Wall::update(wind::real duration)
 
 void Wall::draw()
 {
-	mesh->Draw();
+	if(mesh)
+	{
+		mesh->Draw();
+	}
 }
 
 wind::RigidBody* Wall::getBody()
@@ -64,7 +67,7 @@ wind::RigidBody* Wall::getBody()
 	return body;
 }
 
-Mesh* Wall::getMesh()
+std::shared_ptr<Mesh> Wall::getMesh()
 {
-	return mesh.get();
+	return mesh;
 }
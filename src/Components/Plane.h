@@ -12,13 +12,13 @@ class Wall : public wind::Plane
 		~Wall();
 		void setState(const wind::Vector3& pos, wind::Vector3 dir);
 		void initRotation(const wind::Vector3& axis, const wind::Vector3& pos, const wind::real& angle);
-		void loadMesh(const std::string& filePath);
+		void loadMesh(wind::MeshManager& meshes, const std::string& filePath);
 		void update(wind::real duration);
 		void draw();
 		wind::RigidBody* getBody();
-		Mesh* getMesh();
+		std::shared_ptr<Mesh> getMesh();
 	private:
-		std::unique_ptr<Mesh> mesh;
+		std::shared_ptr<Mesh> mesh;
 		//Only in this primitive that needs a body build here this is so we can render it.
 		//This has nothing to do with the physics.
 		//wind::RigidBody* body;
@@ -5,7 +5,6 @@ Player::Player(wind::real mRatio) :
 {
 	wind::Box::body = new wind::RigidBody();
 
-	cube = new Mesh();
 	once = true;
 	if (wind::Box::body == nullptr)
 	{
@@ -15,7 +14,6 @@ Player::Player(wind::real mRatio) :
 
 Player::~Player()
 {
-	delete cube;
 }
 
 void Player::setState(const wind::Vector3& pos, const wind::Vector3& half)
@@ -47,9 +45,9 @@ void Player::setState(const wind::Vector3& pos, const wind::Vector3& half)
 	wind::Box::calculateInternals();
 }
 
-void Player::loadMesh(const std::string& filePath)
+void Player::loadMesh(wind::MeshManager& meshes, const std::string& filePath)
 {
-	cube->addMesh(filePath, halfSize);
+	cube = meshes.loadAsync(filePath, halfSize);
 }
 
 void Player::gravityOff()
@@ -94,7 +92,10 @@ void Player::changePosition(wind::Vector3 pos)
 
 void Player::draw()
 {
-	cube->Draw();
+	if(cube)
+	{
+		cube->Draw();
+	}
 }
 
 wind::RigidBody* Player::getBody()
@@ -102,7 +103,7 @@ wind::RigidBody* Player::getBody()
 	return wind::Box::body;
 }
 
-Mesh* Player::getMesh()
+std::shared_ptr<Mesh> Player::getMesh()
 {
 	return cube;
 }
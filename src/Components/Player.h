@@ -13,7 +13,7 @@ public:
 	Player(wind::real mRatio);
 	~Player();
 	void setState(const wind::Vector3& pos, const wind::Vector3& half);
-	void loadMesh(const std::string& filePath);
+	void loadMesh(wind::MeshManager& meshes, const std::string& filePath);
 
 	void gravityOff();
 
@@ -27,7 +27,7 @@ public:
 
 	void changePosition(wind::Vector3 pos);
 	void draw();
-	Mesh* getMesh();
+	std::shared_ptr<Mesh> getMesh();
 
 	wind::RigidBody* getBody();
 	wind::Camera getCamera();
@@ -36,7 +36,7 @@ private:
 	wind::real bspPlaneOffset;
 	wind::Vector3 offsetVector;
 
-	Mesh* cube;
+	std::shared_ptr<Mesh> cube;
 	wind::Camera cam;
 };
 #endif
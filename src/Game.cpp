@@ -41,6 +41,16 @@ Game::Game() : RigidBodyApplication("Cube Game", 800, 600),
 
     //Reset need to be called before meshes are created
     reset();
+
+    //The shapes are only added to the world query once, it reads where they are every step.
+    //Each block is a trigger that watches for the player, so it is told when it is picked up instead of asking every step.
+    for (unsigned int i = 0; i < objects.size(); i++)
+    {
+        _query.addTrigger(objects.at(i).get(), QUERY_GROUP_PLAYER, QUERY_GROUP_PICKUP);
+    }
+    _query.addBox(player1.get(), QUERY_GROUP_PLAYER);
+    _query.addHalfSpace(planes.at(0).get(), QUERY_GROUP_WORLD);
+
     loadPrograms();
     loadMedia();
     loadMeshes();
@@ -71,7 +81,7 @@ Game::~Game()
 void Game::loadPrograms()
 {
 
-    if (!fontProgram2D.loadProgram())
+    if (!fontProgram2D.loadProgram(shaderRegistry))
     {
         std::cerr << "Unable to load font rendering program!" << std::endl;
     }
@@ -89,7 +99,7 @@ void Game::loadPrograms()
 
     fontProgram2D.unbind();
 
-    if (!fontTimer2D.loadProgram())
+    if (!fontTimer2D.loadProgram(shaderRegistry))
     {
         std::cerr << "Unable to load font rendering program!" << std::endl;
     }
@@ -110,7 +120,7 @@ void Game::loadPrograms()
 
     fontTimer2D.unbind();
 
-    if (!scene.loadProgram())
+    if (!scene.loadProgram(shaderRegistry))
     {
         std::cerr << "Unable to load scene rendering program!" << std::endl;
     }
@@ -126,36 +136,48 @@ void Game::loadMeshes()
 {
     for (unsigned int i = 0; i < objects.size(); i++)
     {
-        objects.at(i)->loadMesh("res/cube3.obj");
+        objects.at(i)->loadMesh(meshes, "res/cube3.obj");
         reg.add(objects.at(i)->getMesh());
     }
 
     for (unsigned int i = 0; i < planes.size(); i++)
     {
-        planes.at(i)->loadMesh("res/plane.obj");
+        planes.at(i)->loadMesh(meshes, "res/plane.obj");
         reg.add(planes.at(i)->getMesh());
     }
 
-    player1->loadMesh("res/cube3.obj");
+    player1->loadMesh(meshes, "res/cube3.obj");
     reg.add(player1->getMesh());
 }
 
 void Game::loadMedia()
 {
-    if (!blockTexture.loadTextureFromFile32("res/bricks.jpg"))
+    //The textures draw as a placeholder until they have streamed in, they are cooked with their mips the first time they are loaded.
+    textures.loadCooked(blockTexture, "res/bricks.jpg", TEXTURE_FORMAT_BC1, [](Texture&, bool loaded)
     {
-        std::cerr << "Unable to load block Texture !" << std::endl;
-    }
+        if (!loaded)
+        {
+            std::cerr << "Unable to load block Texture !" << std::endl;
+        }
+    });
 
-    if (!texture.loadTextureFromFile32("res/ground.jpg"))
+    textures.loadCooked(texture, "res/ground.jpg", TEXTURE_FORMAT_BC1, [](Texture&, bool loaded)
     {
-        std::cerr << "Unable to load texture!" << std::endl;
-    }
+        if (!loaded)
+        {
+            std::cerr << "Unable to load texture!" << std::endl;
+        }
+    });
 
-    if (!font.loadImage("res/lazy_font.png"))
+    if (!font.loadImage("res/lazy_font.png", &hudAtlas))
     {
         std::cerr << "Unable to load font!" << std::endl;
     }
+
+    if (!hudAtlas.build(SPRITE_ORIGIN_TOP_LEFT))
+    {
+        std::cerr << "Unable to build HUD atlas!" << std::endl;
+    }
 }
 
 void Game::resetGame()
@@ -229,20 +251,6 @@ void Game::generateContacts()
 
             wind::CollisionDetection::BoxAndHalfSpace(*objects.at(i), *planes.at(0), _collData);
 
-            if (!gameOver)
-            {
-                if (wind::IntersectionTests::BoxAndBox(*player1, *objects.at(i)))
-                {
-                    //delete objects.at(i);
-                    //objects.erase(objects.begin() + i);
-                    //for(unsigned int i = 0; i < objects.size(); i++)
-                    //{
-                    objects.at(0)->setState(rand.RandomXZVector(50.0), wind::Vector3(2.0, 2.0, 2.0));
-                    //}
-
-                    blockCount++;
-                }
-            }
             //wind::PlayerGeometry::BoxAndBox(*player1, *objects.at(i), &collData);
             //wind::CollisionDetection::BoxAndHalfSpace(*player1, *planes.at(1), collData);
             //wind::CollisionDetection::BoxAndHalfSpace(*player1[0], *planes.at(1), collData);
@@ -251,6 +259,30 @@ void Game::generateContacts()
     }
 }
 
+void Game::handleTriggers()
+{
+    //The player picks up a block as soon as it goes into it, the block is moved somewhere else straight away.
+    const std::vector<wind::TriggerEvent>& events = _query.getTriggerEvents();
+    for (unsigned int e = 0; e < events.size(); e++)
+    {
+        if (gameOver || events.at(e).type != wind::TRIGGER_ENTER)
+        {
+            continue;
+        }
+
+        for (unsigned int i = 0; i < objects.size(); i++)
+        {
+            if (events.at(e).triggerPrimitive == objects.at(i).get())
+            {
+                objects.at(i)->setState(rand.RandomXZVector(50.0), wind::Vector3(2.0, 2.0, 2.0));
+                blockCount++;
+            }
+        }
+    }
+
+    _query.clearTriggerEvents();
+}
+
 void Game::updateObjects(wind::real duration)
 {
     for (unsigned int i = 0; i < objects.size(); i++)
@@ -437,6 +469,11 @@ void Game::handleEvents()
 void Game::update()
 {
     RigidBodyApplication::update();
+    handleTriggers();
+
+    //Any meshes that finished loading in the background get uploaded here, and the textures send up the next part of their pixels.
+    meshes.update();
+    textures.update();
 
     if (trans.empty())
     {
@@ -461,29 +498,34 @@ void Game::Display()
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     scene.bind();
     scene.disableBlend();
-    scene.setTextColor(levelColour);
-    scene.updateCamera(player1->getCamera());
-    blockTexture.bind(0);
-    scene.drawModels(objects);
-    scene.drawModel(player1);
-    blockTexture.unbind(0);
-    texture.bind(0);
-    scene.drawModels(planes);
-    texture.unbind(0);
+
+    renderQueue.begin(player1->getCamera().getBody().getPosition());
+    renderQueue.setFrameConstants(ShaderProgram3D::makeFrameConstants(player1->getCamera(), levelColour));
+    lodScale = getLodScale(player1->getCamera().getFov(), _height);
+    lodPosition = player1->getCamera().getBody().getPosition();
+    submitModels(objects, &blockTexture);
+    submitModel(player1, &blockTexture);
+    submitModels(planes, &texture);
+    //Only what the camera can see is sorted and drawn.
+    renderQueue.cull(Frustum(player1->getCamera().getVP()));
+    renderQueue.sort();
+    renderQueue.execute(renderBackend);
+
+    scene.endFrame();
     scene.unbind();
 
     fontProgram2D.bind();
     fontProgram2D.enableBlend();
     fontProgram2D.setTextColor(textColour);
 
-    font.renderText(&fontProgram2D, 0, 0, tester, &screenRect, textPosition);
+    messageText.render(&fontProgram2D, font, 0, 0, tester, &screenRect, textPosition);
     fontProgram2D.unbind();
 
     fontTimer2D.bind();
     fontTimer2D.setModelView(wind::Matrix4x4());
     fontTimer2D.updateModelView();
     fontTimer2D.setTextColor(textColour);
-    font.renderText(&fontTimer2D, 0, 0, TimerString.str(), &screenRect, FONT_TEXT_ALIGN_LEFT);
+    timerText.render(&fontTimer2D, font, 0, 0, TimerString.str(), &screenRect, FONT_TEXT_ALIGN_LEFT);
     fontTimer2D.unbind();
 
     SDL_GL_SwapWindow(_window);
@@ -6,10 +6,18 @@
 #include "Components/LevelGeometry.h"
 
 #include "Graphics/Font.h"
+#include "Graphics/GLRenderBackend.h"
 #include "Graphics/Mesh.h"
+#include "Graphics/MeshLod.h"
+#include "Graphics/MeshManager.h"
+#include "Graphics/RenderQueue.h"
 #include "Graphics/Texture.h"
+#include "Graphics/TextureStreamer.h"
 #include "Graphics/ShaderProgram2D.h"
+#include "Graphics/TextBatch.h"
+#include "Graphics/TextureAtlas.h"
 #include "Graphics/ShaderProgram3D.h"
+#include "Graphics/ShaderRegistry.h"
 #include "Graphics/include/ColourRGBA.h"
 #include "Graphics/include/FontRect.h"
 
@@ -27,6 +35,11 @@ namespace
     const unsigned int NUM_OF_COMPONENTS = 3;
 
     const int JOYSTICK_DEAD_ZONE = 3200;
+
+    //The groups the game's shapes are put in for the world query.
+    const unsigned int QUERY_GROUP_WORLD = 1;
+    const unsigned int QUERY_GROUP_PLAYER = 2;
+    const unsigned int QUERY_GROUP_PICKUP = 4;
 };
 
 namespace wind
@@ -46,24 +59,67 @@ private:
     void resetGame();
     void handleEvents();
     void update();
+    //This acts on what went in and out of the triggers during the physics step.
+    void handleTriggers();
     void Display();
 
+    //These put models into the render queue with the texture they are drawn with.
+    template<typename T>
+    void submitModel(const T& model, Texture* modelTexture)
+    {
+        Mesh* mesh = model->getMesh().get();
+        if (mesh == nullptr)
+        {
+            return;
+        }
+
+        //The mesh's box is moved into the world with the model so the queue can cull it.
+        GLfloat transform[16];
+        model->getBody()->getGLTransform(transform);
+        CullBounds bounds = transformBounds(transform, mesh->getBoundsMin(), mesh->getBoundsMax());
+
+        //The further the box is from the camera the simpler the level of detail can be.
+        float distance = getBoundsDistance(bounds.min, bounds.max, lodPosition);
+        renderQueue.submit(&scene, modelTexture, mesh, transform, bounds, mesh->selectLod(distance, lodScale));
+    }
+
+    template<typename T>
+    void submitModels(const T& models, Texture* modelTexture)
+    {
+        for (unsigned int i = 0; i < models.size(); i++)
+        {
+            submitModel(models.at(i), modelTexture);
+        }
+    }
+
     virtual void generateContacts() final;
     virtual void updateObjects(wind::real duration) final;
     virtual void reset() final;
 
+    //This loads every mesh file once and shares it between the objects that use it.
+    MeshManager meshes;
     //This is the mesh register for all the different meshes in the game.
     MeshReg reg;
     //These are the physical components of the games.
     std::vector<std::shared_ptr<Block>> objects;
     std::vector<std::shared_ptr<Wall>> planes;
     std::shared_ptr<Player> player1;
+    //Every program comes from here so each one is only compiled once, it has to come before the programs.
+    ShaderRegistry shaderRegistry;
     //The instance shader is for binding and passing everything to the shaders.
     ShaderProgram3D scene;
     //The texture handles the texture, can be binded to other objects.
     Texture texture;
     Texture blockTexture;
     Texture fontTexture;
+    //This streams the textures in the background, it has to come after the textures it loads into.
+    TextureStreamer textures;
+    //The render queue sorts the frame's draws so the state only changes when it has to.
+    RenderQueue renderQueue;
+    GLRenderBackend renderBackend;
+    //How many pixels a unit at a unit away covers this frame, the levels of detail are picked with it.
+    float lodScale;
+    Vector3 lodPosition;
 
     std::stringstream TimerString;
 
@@ -80,7 +136,11 @@ private:
     /*For rendering text**/
     ShaderProgram2D fontProgram2D;
     ShaderProgram2D fontTimer2D;
+    //The HUD's images live in one atlas, and each piece of text on screen keeps its layout in its own batch.
+    TextureAtlas hudAtlas;
     Font font;
+    TextBatch messageText;
+    TextBatch timerText;
     ColourRGBA textColour;
     ColourRGBA levelColour;
     FontRect screenRect;
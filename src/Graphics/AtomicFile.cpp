@@ -0,0 +1,106 @@
+#include "AtomicFile.h"
+
+#include <cstdio>
+
+namespace wind
+{
+
+/******************************************************************************/
+AtomicFile::AtomicFile()
+{
+}
+
+/******************************************************************************/
+AtomicFile::~AtomicFile()
+{
+    discard();
+}
+
+/******************************************************************************/
+bool AtomicFile::open(const std::string &filePath)
+{
+    discard();
+
+    _path = filePath;
+    _tempPath = filePath + ".tmp";
+    _file.clear();
+    _file.open(_tempPath.c_str(), std::ios::binary | std::ios::trunc);
+    if (!_file.is_open())
+    {
+        _path.clear();
+        _tempPath.clear();
+        return false;
+    }
+
+    return true;
+}
+
+/******************************************************************************/
+void AtomicFile::write(const void* data, size_t size)
+{
+    if (size > 0)
+    {
+        _file.write(static_cast<const char*>(data), size);
+    }
+}
+
+/******************************************************************************/
+void AtomicFile::writePadding(size_t size)
+{
+    char padding[64] = {};
+    while (size > 0)
+    {
+        size_t count = size < sizeof(padding) ? size : sizeof(padding);
+        _file.write(padding, count);
+        size -= count;
+    }
+}
+
+/******************************************************************************/
+bool AtomicFile::commit()
+{
+    if (!_file.is_open())
+    {
+        return false;
+    }
+
+    _file.close();
+    if (_file.fail())
+    {
+        discard();
+        return false;
+    }
+
+    //Rename won't replace a file on every platform so the old one goes first.
+    std::remove(_path.c_str());
+    bool renamed = std::rename(_tempPath.c_str(), _path.c_str()) == 0;
+    if (!renamed)
+    {
+        std::remove(_tempPath.c_str());
+    }
+
+    _path.clear();
+    _tempPath.clear();
+    return renamed;
+}
+
+/******************************************************************************/
+void AtomicFile::discard()
+{
+    if (_tempPath.empty())
+    {
+        return;
+    }
+
+    if (_file.is_open())
+    {
+        _file.close();
+    }
+    _file.clear();
+    std::remove(_tempPath.c_str());
+
+    _path.clear();
+    _tempPath.clear();
+}
+
+}; //wind
@@ -0,0 +1,43 @@
+#ifndef ATOMIC_FILE_H
+#define ATOMIC_FILE_H
+
+#include <string>
+#include <cstddef>
+#include <fstream>
+
+namespace wind
+{
+/**
+    This class writes a file through a temporary file next to it, and only swaps it in once everything has been written.
+    If anything goes wrong part way the old file is left as it was, so a half written file is never loaded.
+    Anything not committed is thrown away when the class goes out of scope.
+*/
+class AtomicFile
+{
+public:
+    AtomicFile();
+    ~AtomicFile();
+
+    //This function starts a new temporary file for the given path, anything already started is thrown away first.
+    bool open(const std::string &filePath);
+
+    void write(const void* data, size_t size);
+    //This writes size zero bytes, for the padding that lines sections up.
+    void writePadding(size_t size);
+
+    //This function closes the temporary file and swaps it in for the real one.
+    //It returns false, and the old file is left alone, if any write failed or the swap couldn't be done.
+    bool commit();
+    void discard();
+
+private:
+    AtomicFile(const AtomicFile&);
+    AtomicFile& operator=(const AtomicFile&);
+
+    std::string _path;
+    std::string _tempPath;
+    std::ofstream _file;
+};
+}; //wind
+
+#endif
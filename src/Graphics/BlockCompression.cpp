@@ -0,0 +1,625 @@
+#include "BlockCompression.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include "../Physics/include/parallel.h"
+
+namespace wind
+{
+
+namespace
+{
+    //A row of blocks is a lot of work, so a few rows is enough to be worth a thread.
+    const unsigned MIN_BLOCK_ROWS_PER_THREAD = 4;
+
+    //These are the weights BC7 uses between the two ends of a line with four bit indices, out of 64.
+    const unsigned BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    //This writes bits from the bottom of the block up, which is how BC7 lays them out.
+    struct BitWriter
+    {
+        std::uint8_t* out;
+        unsigned position;
+
+        void write(unsigned value, unsigned bits)
+        {
+            for (unsigned i = 0; i < bits; i++)
+            {
+                out[position >> 3] |= static_cast<std::uint8_t>(((value >> i) & 1) << (position & 7));
+                position++;
+            }
+        }
+    };
+
+    float clampColour(float value)
+    {
+        return value < 0.0f ? 0.0f : (value > 255.0f ? 255.0f : value);
+    }
+
+    /**
+        This finds the line through colour space that fits the pixels best, and gives back where the pixels start and end along it.
+        The line goes through the average along the direction the pixels spread out the most, which is found with a few rounds of
+        the power method on their covariance.
+    */
+    void fitLine(const std::uint8_t* pixels, unsigned channels, float* start, float* end)
+    {
+        float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        float low[4] = { 255.0f, 255.0f, 255.0f, 255.0f };
+        float high[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for (unsigned i = 0; i < 16; i++)
+        {
+            for (unsigned c = 0; c < channels; c++)
+            {
+                float value = pixels[i * 4 + c];
+                mean[c] += value;
+                low[c] = std::min(low[c], value);
+                high[c] = std::max(high[c], value);
+            }
+        }
+
+        for (unsigned c = 0; c < channels; c++)
+        {
+            mean[c] /= 16.0f;
+        }
+
+        float covariance[4][4] = {};
+        for (unsigned i = 0; i < 16; i++)
+        {
+            for (unsigned a = 0; a < channels; a++)
+            {
+                for (unsigned b = 0; b < channels; b++)
+                {
+                    covariance[a][b] += (pixels[i * 4 + a] - mean[a]) * (pixels[i * 4 + b] - mean[b]);
+                }
+            }
+        }
+
+        //We start from the box's diagonal, it's usually close already.
+        float axis[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for (unsigned c = 0; c < channels; c++)
+        {
+            axis[c] = high[c] - low[c];
+        }
+
+        for (unsigned iteration = 0; iteration < 8; iteration++)
+        {
+            float next[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            float length = 0.0f;
+            for (unsigned a = 0; a < channels; a++)
+            {
+                for (unsigned b = 0; b < channels; b++)
+                {
+                    next[a] += covariance[a][b] * axis[b];
+                }
+                length = std::max(length, std::fabs(next[a]));
+            }
+
+            //A flat block has no spread at all, so the box diagonal is as good as anything.
+            if (length <= 0.0f)
+            {
+                break;
+            }
+
+            for (unsigned c = 0; c < channels; c++)
+            {
+                axis[c] = next[c] / length;
+            }
+        }
+
+        float lengthSquared = 0.0f;
+        for (unsigned c = 0; c < channels; c++)
+        {
+            lengthSquared += axis[c] * axis[c];
+        }
+
+        if (lengthSquared <= 0.0f)
+        {
+            for (unsigned c = 0; c < channels; c++)
+            {
+                start[c] = end[c] = mean[c];
+            }
+            return;
+        }
+
+        float minimum = 0.0f;
+        float maximum = 0.0f;
+        for (unsigned i = 0; i < 16; i++)
+        {
+            float t = 0.0f;
+            for (unsigned c = 0; c < channels; c++)
+            {
+                t += (pixels[i * 4 + c] - mean[c]) * axis[c];
+            }
+            t /= lengthSquared;
+            minimum = std::min(minimum, t);
+            maximum = std::max(maximum, t);
+        }
+
+        for (unsigned c = 0; c < channels; c++)
+        {
+            start[c] = clampColour(mean[c] + axis[c] * minimum);
+            end[c] = clampColour(mean[c] + axis[c] * maximum);
+        }
+    }
+
+    /**
+        Once every pixel has picked a point on the line, the ends of the line can be moved to fit those picks better.
+        Each pixel is (1 - w) * start + w * end, so this is a least squares fit for start and end.
+    */
+    bool refineLine(const std::uint8_t* pixels, unsigned channels, const unsigned* indices, const float* weights,
+                    float* start, float* end)
+    {
+        float startStart = 0.0f, endEnd = 0.0f, startEnd = 0.0f;
+        float startPixel[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        float endPixel[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+        for (unsigned i = 0; i < 16; i++)
+        {
+            float w = weights[indices[i]];
+            startStart += (1.0f - w) * (1.0f - w);
+            endEnd += w * w;
+            startEnd += (1.0f - w) * w;
+
+            for (unsigned c = 0; c < channels; c++)
+            {
+                startPixel[c] += (1.0f - w) * pixels[i * 4 + c];
+                endPixel[c] += w * pixels[i * 4 + c];
+            }
+        }
+
+        float determinant = startStart * endEnd - startEnd * startEnd;
+        if (std::fabs(determinant) < 1e-6f)
+        {
+            return false;
+        }
+
+        for (unsigned c = 0; c < channels; c++)
+        {
+            start[c] = clampColour((startPixel[c] * endEnd - endPixel[c] * startEnd) / determinant);
+            end[c] = clampColour((endPixel[c] * startStart - startPixel[c] * startEnd) / determinant);
+        }
+
+        return true;
+    }
+
+    //This picks the closest palette entry for each pixel and returns the total squared error.
+    unsigned pickIndices(const std::uint8_t* pixels, unsigned channels, const unsigned (*palette)[4], unsigned paletteSize,
+                         unsigned* indices)
+    {
+        unsigned total = 0;
+        for (unsigned i = 0; i < 16; i++)
+        {
+            unsigned best = ~0u;
+            for (unsigned p = 0; p < paletteSize; p++)
+            {
+                unsigned error = 0;
+                for (unsigned c = 0; c < channels; c++)
+                {
+                    int difference = static_cast<int>(pixels[i * 4 + c]) - static_cast<int>(palette[p][c]);
+                    error += difference * difference;
+                }
+
+                if (error < best)
+                {
+                    best = error;
+                    indices[i] = p;
+                }
+            }
+            total += best;
+        }
+
+        return total;
+    }
+
+    std::uint16_t toColour565(const float* colour)
+    {
+        unsigned r = static_cast<unsigned>(colour[0] * 31.0f / 255.0f + 0.5f);
+        unsigned g = static_cast<unsigned>(colour[1] * 63.0f / 255.0f + 0.5f);
+        unsigned b = static_cast<unsigned>(colour[2] * 31.0f / 255.0f + 0.5f);
+        return static_cast<std::uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    void fromColour565(std::uint16_t colour, unsigned* out)
+    {
+        unsigned r = (colour >> 11) & 31;
+        unsigned g = (colour >> 5) & 63;
+        unsigned b = colour & 31;
+        out[0] = (r << 3) | (r >> 2);
+        out[1] = (g << 2) | (g >> 4);
+        out[2] = (b << 3) | (b >> 2);
+        out[3] = 255;
+    }
+
+    //This turns the two end colours into the four colour palette, the first colour has to be the bigger one.
+    void buildColourPalette(std::uint16_t colour0, std::uint16_t colour1, unsigned (*palette)[4])
+    {
+        fromColour565(colour0, palette[0]);
+        fromColour565(colour1, palette[1]);
+        for (unsigned c = 0; c < 4; c++)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+    }
+
+    unsigned encodeColourEnds(const std::uint8_t* pixels, const float* start, const float* end,
+                              std::uint16_t &colour0, std::uint16_t &colour1, unsigned* indices)
+    {
+        colour0 = toColour565(end);
+        colour1 = toColour565(start);
+        if (colour0 < colour1)
+        {
+            std::swap(colour0, colour1);
+        }
+
+        //If both ends are the same colour every pixel just uses the first one.
+        if (colour0 == colour1)
+        {
+            unsigned palette[1][4];
+            fromColour565(colour0, palette[0]);
+            return pickIndices(pixels, 3, palette, 1, indices);
+        }
+
+        unsigned palette[4][4];
+        buildColourPalette(colour0, colour1, palette);
+        return pickIndices(pixels, 3, palette, 4, indices);
+    }
+
+    //This is the colour half of BC1 and BC3, it always uses the four colour mode.
+    void compressColour(const std::uint8_t* pixels, std::uint8_t* out)
+    {
+        float start[4], end[4];
+        fitLine(pixels, 3, start, end);
+
+        std::uint16_t colour0, colour1;
+        unsigned indices[16];
+        unsigned error = encodeColourEnds(pixels, start, end, colour0, colour1, indices);
+
+        //One round of refining the ends is where most of the gain is.
+        if (colour0 != colour1)
+        {
+            //Index 0 is colour0, index 1 is colour1 and 2 and 3 are a third and two thirds of the way to colour1.
+            //The weights are towards colour0, which is the refined end.
+            const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+            float refinedStart[4], refinedEnd[4];
+            if (refineLine(pixels, 3, indices, weights, refinedStart, refinedEnd))
+            {
+                std::uint16_t refined0, refined1;
+                unsigned refinedIndices[16];
+                unsigned refinedError = encodeColourEnds(pixels, refinedStart, refinedEnd, refined0, refined1, refinedIndices);
+                if (refinedError < error)
+                {
+                    colour0 = refined0;
+                    colour1 = refined1;
+                    memcpy(indices, refinedIndices, sizeof(indices));
+                }
+            }
+        }
+
+        std::uint32_t packed = 0;
+        for (unsigned i = 0; i < 16; i++)
+        {
+            packed |= (colour0 == colour1 ? 0u : indices[i]) << (i * 2);
+        }
+
+        out[0] = static_cast<std::uint8_t>(colour0 & 0xff);
+        out[1] = static_cast<std::uint8_t>(colour0 >> 8);
+        out[2] = static_cast<std::uint8_t>(colour1 & 0xff);
+        out[3] = static_cast<std::uint8_t>(colour1 >> 8);
+        out[4] = static_cast<std::uint8_t>(packed & 0xff);
+        out[5] = static_cast<std::uint8_t>((packed >> 8) & 0xff);
+        out[6] = static_cast<std::uint8_t>((packed >> 16) & 0xff);
+        out[7] = static_cast<std::uint8_t>(packed >> 24);
+    }
+
+    //This is the alpha half of BC3, the two ends are the smallest and biggest alpha with six steps between them.
+    void compressAlpha(const std::uint8_t* pixels, std::uint8_t* out)
+    {
+        unsigned alpha0 = 0;
+        unsigned alpha1 = 255;
+        for (unsigned i = 0; i < 16; i++)
+        {
+            alpha0 = std::max(alpha0, static_cast<unsigned>(pixels[i * 4 + 3]));
+            alpha1 = std::min(alpha1, static_cast<unsigned>(pixels[i * 4 + 3]));
+        }
+
+        out[0] = static_cast<std::uint8_t>(alpha0);
+        out[1] = static_cast<std::uint8_t>(alpha1);
+
+        std::uint64_t packed = 0;
+        if (alpha0 != alpha1)
+        {
+            unsigned palette[8];
+            palette[0] = alpha0;
+            palette[1] = alpha1;
+            for (unsigned i = 1; i < 7; i++)
+            {
+                palette[i + 1] = ((7 - i) * alpha0 + i * alpha1) / 7;
+            }
+
+            for (unsigned i = 0; i < 16; i++)
+            {
+                unsigned alpha = pixels[i * 4 + 3];
+                unsigned best = 0;
+                unsigned bestError = ~0u;
+                for (unsigned p = 0; p < 8; p++)
+                {
+                    unsigned error = alpha > palette[p] ? alpha - palette[p] : palette[p] - alpha;
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        best = p;
+                    }
+                }
+
+                packed |= static_cast<std::uint64_t>(best) << (i * 3);
+            }
+        }
+
+        for (unsigned i = 0; i < 6; i++)
+        {
+            out[2 + i] = static_cast<std::uint8_t>((packed >> (i * 8)) & 0xff);
+        }
+    }
+
+    //BC7 mode 6 ends are seven bits a channel plus one shared bit for each end, this finds the closest we can get.
+    void quantiseBC7End(const float* colour, unsigned* quantised, unsigned &pBit)
+    {
+        float bestError = 0.0f;
+        for (unsigned p = 0; p < 2; p++)
+        {
+            unsigned candidate[4];
+            float error = 0.0f;
+            for (unsigned c = 0; c < 4; c++)
+            {
+                float value = std::floor((colour[c] - p) / 2.0f + 0.5f);
+                candidate[c] = static_cast<unsigned>(value < 0.0f ? 0.0f : (value > 127.0f ? 127.0f : value));
+
+                float difference = static_cast<float>(candidate[c] * 2 + p) - colour[c];
+                error += difference * difference;
+            }
+
+            if (p == 0 || error < bestError)
+            {
+                bestError = error;
+                pBit = p;
+                memcpy(quantised, candidate, sizeof(candidate));
+            }
+        }
+    }
+
+    unsigned encodeBC7Ends(const std::uint8_t* pixels, const float* start, const float* end,
+                           unsigned* quantised0, unsigned &pBit0, unsigned* quantised1, unsigned &pBit1, unsigned* indices)
+    {
+        quantiseBC7End(start, quantised0, pBit0);
+        quantiseBC7End(end, quantised1, pBit1);
+
+        unsigned palette[16][4];
+        for (unsigned c = 0; c < 4; c++)
+        {
+            unsigned end0 = (quantised0[c] << 1) | pBit0;
+            unsigned end1 = (quantised1[c] << 1) | pBit1;
+            for (unsigned i = 0; i < 16; i++)
+            {
+                palette[i][c] = ((64 - BC7_WEIGHTS[i]) * end0 + BC7_WEIGHTS[i] * end1 + 32) >> 6;
+            }
+        }
+
+        return pickIndices(pixels, 4, palette, 16, indices);
+    }
+}
+
+/******************************************************************************/
+unsigned getBlockSize(TextureFormat format)
+{
+    switch (format)
+    {
+    case TEXTURE_FORMAT_BC1:
+        return 8;
+    case TEXTURE_FORMAT_BC3:
+    case TEXTURE_FORMAT_BC7:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+/******************************************************************************/
+std::size_t getLevelSize(TextureFormat format, unsigned width, unsigned height)
+{
+    unsigned blockSize = getBlockSize(format);
+    if (blockSize == 0)
+    {
+        return static_cast<std::size_t>(width) * height * 4;
+    }
+
+    return static_cast<std::size_t>((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+}
+
+/******************************************************************************/
+void compressBlockBC1(const std::uint8_t* pixels, std::uint8_t* out)
+{
+    compressColour(pixels, out);
+}
+
+/******************************************************************************/
+void compressBlockBC3(const std::uint8_t* pixels, std::uint8_t* out)
+{
+    compressAlpha(pixels, out);
+    compressColour(pixels, out + 8);
+}
+
+/******************************************************************************/
+void compressBlockBC7(const std::uint8_t* pixels, std::uint8_t* out)
+{
+    //We only use mode 6, one line through RGBA with four bit indices. It's the simplest mode and still beats BC3 on most images.
+    float start[4], end[4];
+    fitLine(pixels, 4, start, end);
+
+    unsigned quantised0[4], quantised1[4], pBit0, pBit1;
+    unsigned indices[16];
+    unsigned error = encodeBC7Ends(pixels, start, end, quantised0, pBit0, quantised1, pBit1, indices);
+
+    float weights[16];
+    for (unsigned i = 0; i < 16; i++)
+    {
+        weights[i] = BC7_WEIGHTS[i] / 64.0f;
+    }
+
+    float refinedStart[4], refinedEnd[4];
+    if (refineLine(pixels, 4, indices, weights, refinedStart, refinedEnd))
+    {
+        unsigned refined0[4], refined1[4], refinedP0, refinedP1;
+        unsigned refinedIndices[16];
+        unsigned refinedError = encodeBC7Ends(pixels, refinedStart, refinedEnd, refined0, refinedP0, refined1, refinedP1, refinedIndices);
+        if (refinedError < error)
+        {
+            memcpy(quantised0, refined0, sizeof(quantised0));
+            memcpy(quantised1, refined1, sizeof(quantised1));
+            pBit0 = refinedP0;
+            pBit1 = refinedP1;
+            memcpy(indices, refinedIndices, sizeof(indices));
+        }
+    }
+
+    //The first index only gets three bits, its top bit is taken to be zero, so if it's set we swap the ends around.
+    if (indices[0] >= 8)
+    {
+        for (unsigned c = 0; c < 4; c++)
+        {
+            std::swap(quantised0[c], quantised1[c]);
+        }
+        std::swap(pBit0, pBit1);
+
+        for (unsigned i = 0; i < 16; i++)
+        {
+            indices[i] = 15 - indices[i];
+        }
+    }
+
+    memset(out, 0, 16);
+    BitWriter writer = { out, 0 };
+    writer.write(1 << 6, 7);
+    for (unsigned c = 0; c < 4; c++)
+    {
+        writer.write(quantised0[c], 7);
+        writer.write(quantised1[c], 7);
+    }
+    writer.write(pBit0, 1);
+    writer.write(pBit1, 1);
+
+    writer.write(indices[0], 3);
+    for (unsigned i = 1; i < 16; i++)
+    {
+        writer.write(indices[i], 4);
+    }
+}
+
+/******************************************************************************/
+void compressImage(TextureFormat format, const std::uint32_t* pixels, unsigned width, unsigned height, std::uint8_t* out)
+{
+    unsigned blockSize = getBlockSize(format);
+    if (blockSize == 0)
+    {
+        memcpy(out, pixels, getLevelSize(format, width, height));
+        return;
+    }
+
+    unsigned blocksWide = (width + 3) / 4;
+    unsigned blocksHigh = (height + 3) / 4;
+
+    parallelFor(blocksHigh, MIN_BLOCK_ROWS_PER_THREAD, [&](unsigned begin, unsigned end)
+    {
+        std::uint8_t block[64];
+        for (unsigned by = begin; by < end; by++)
+        {
+            for (unsigned bx = 0; bx < blocksWide; bx++)
+            {
+                //Pixels past the edge repeat the last row or column so they don't pull the colours off.
+                for (unsigned y = 0; y < 4; y++)
+                {
+                    unsigned sourceY = std::min(by * 4 + y, height - 1);
+                    for (unsigned x = 0; x < 4; x++)
+                    {
+                        unsigned sourceX = std::min(bx * 4 + x, width - 1);
+                        memcpy(&block[(y * 4 + x) * 4], &pixels[sourceY * width + sourceX], 4);
+                    }
+                }
+
+                std::uint8_t* destination = out + (static_cast<std::size_t>(by) * blocksWide + bx) * blockSize;
+                switch (format)
+                {
+                case TEXTURE_FORMAT_BC1:
+                    compressBlockBC1(block, destination);
+                    break;
+                case TEXTURE_FORMAT_BC3:
+                    compressBlockBC3(block, destination);
+                    break;
+                default:
+                    compressBlockBC7(block, destination);
+                    break;
+                }
+            }
+        }
+    });
+}
+
+/******************************************************************************/
+void buildMipLevel(const std::uint32_t* pixels, unsigned width, unsigned height, std::vector<std::uint32_t> &out,
+                   unsigned &outWidth, unsigned &outHeight)
+{
+    outWidth = width > 1 ? width / 2 : 1;
+    outHeight = height > 1 ? height / 2 : 1;
+
+    //The filter is done across and then down, each new pixel covers width / outWidth old ones which might not be a whole number.
+    std::vector<float> across(static_cast<std::size_t>(outWidth) * height * 4, 0.0f);
+    float scaleX = static_cast<float>(width) / outWidth;
+    for (unsigned x = 0; x < outWidth; x++)
+    {
+        float left = x * scaleX;
+        float right = left + scaleX;
+        for (unsigned source = static_cast<unsigned>(left); source < width && source < right; source++)
+        {
+            float weight = (std::min(right, source + 1.0f) - std::max(left, static_cast<float>(source))) / scaleX;
+            for (unsigned y = 0; y < height; y++)
+            {
+                const std::uint8_t* pixel = reinterpret_cast<const std::uint8_t*>(&pixels[y * width + source]);
+                float* destination = &across[(static_cast<std::size_t>(y) * outWidth + x) * 4];
+                for (unsigned c = 0; c < 4; c++)
+                {
+                    destination[c] += pixel[c] * weight;
+                }
+            }
+        }
+    }
+
+    std::vector<float> down(static_cast<std::size_t>(outWidth) * outHeight * 4, 0.0f);
+    float scaleY = static_cast<float>(height) / outHeight;
+    for (unsigned y = 0; y < outHeight; y++)
+    {
+        float top = y * scaleY;
+        float bottom = top + scaleY;
+        for (unsigned source = static_cast<unsigned>(top); source < height && source < bottom; source++)
+        {
+            float weight = (std::min(bottom, source + 1.0f) - std::max(top, static_cast<float>(source))) / scaleY;
+            for (unsigned x = 0; x < outWidth * 4; x++)
+            {
+                down[static_cast<std::size_t>(y) * outWidth * 4 + x] += across[static_cast<std::size_t>(source) * outWidth * 4 + x] * weight;
+            }
+        }
+    }
+
+    out.resize(static_cast<std::size_t>(outWidth) * outHeight);
+    for (std::size_t i = 0; i < out.size(); i++)
+    {
+        std::uint8_t pixel[4];
+        for (unsigned c = 0; c < 4; c++)
+        {
+            pixel[c] = static_cast<std::uint8_t>(clampColour(down[i * 4 + c] + 0.5f));
+        }
+        memcpy(&out[i], pixel, 4);
+    }
+}
+}; //wind
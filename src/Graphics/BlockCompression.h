@@ -0,0 +1,45 @@
+#ifndef BLOCK_COMPRESSION_H
+#define BLOCK_COMPRESSION_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace wind
+{
+//How a cooked texture's pixels are stored, the BC formats work on blocks of four by four pixels.
+enum TextureFormat
+{
+    //Plain 8 bit RGBA.
+    TEXTURE_FORMAT_RGBA8,
+    //Colour only at 4 bits a pixel.
+    TEXTURE_FORMAT_BC1,
+    //Colour and smooth alpha at 8 bits a pixel.
+    TEXTURE_FORMAT_BC3,
+    //Colour and alpha at 8 bits a pixel with a better quality than BC3.
+    TEXTURE_FORMAT_BC7,
+
+    NUM_TEXTURE_FORMATS
+};
+
+//This gives the bytes a block of four by four takes, or zero for RGBA8 which isn't made of blocks.
+unsigned getBlockSize(TextureFormat format);
+//This is how many bytes one mip level of the given size takes, the blocks at the edges are always whole.
+std::size_t getLevelSize(TextureFormat format, unsigned width, unsigned height);
+
+//These compress one block, the pixels are the 16 RGBA pixels of the block one row after another.
+void compressBlockBC1(const std::uint8_t* pixels, std::uint8_t* out);
+void compressBlockBC3(const std::uint8_t* pixels, std::uint8_t* out);
+void compressBlockBC7(const std::uint8_t* pixels, std::uint8_t* out);
+
+//This compresses a whole image, the blocks over the edge of an odd sized image repeat the edge pixels.
+//The rows of blocks are split over the cores. The out buffer needs getLevelSize bytes.
+void compressImage(TextureFormat format, const std::uint32_t* pixels, unsigned width, unsigned height, std::uint8_t* out);
+
+//This box filters an image down to the size of the next mip level, which is half the size rounded down but never below one.
+//Sizes that aren't a power of two are fine, each new pixel is the average of the part of the old image it covers.
+void buildMipLevel(const std::uint32_t* pixels, unsigned width, unsigned height, std::vector<std::uint32_t> &out,
+                   unsigned &outWidth, unsigned &outHeight);
+}; //wind
+
+#endif
@@ -0,0 +1,386 @@
+#include "CookedMesh.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "AtomicFile.h"
+
+namespace wind
+{
+
+namespace
+{
+    const char COOKED_MAGIC[4] = { 'W', 'M', 'S', 'H' };
+    const std::uint32_t COOKED_VERSION = 3;
+
+    //The vertex stream starts on a 16 byte boundary, the mapping itself always starts on a page.
+    const std::uint64_t COOKED_ALIGNMENT = 16;
+
+    std::uint64_t alignUp(std::uint64_t value)
+    {
+        return (value + COOKED_ALIGNMENT - 1) & ~(COOKED_ALIGNMENT - 1);
+    }
+
+    void toFloats(const Vector3 &vector, float* out)
+    {
+        out[0] = static_cast<float>(vector.x);
+        out[1] = static_cast<float>(vector.y);
+        out[2] = static_cast<float>(vector.z);
+    }
+
+    std::string getScaledPath(const std::string &objPath, const Vector3 &scale, const char* extension)
+    {
+        float scaleFloats[3];
+        toFloats(scale, scaleFloats);
+        std::uint64_t scaleHash = CookedMesh::hashData(reinterpret_cast<const char*>(scaleFloats), sizeof(scaleFloats));
+
+        char name[32];
+        snprintf(name, sizeof(name), ".%016llx%s", static_cast<unsigned long long>(scaleHash), extension);
+        return objPath + name;
+    }
+}
+
+/******************************************************************************/
+CookedMesh::CookedMesh() : _header(nullptr)
+{
+}
+
+/******************************************************************************/
+bool CookedMesh::load(const std::string &objPath, const Vector3 &scale)
+{
+    close();
+
+    std::string cookedPath = getCookedPath(objPath, scale);
+
+    MappedFile source;
+    if (!source.open(objPath))
+    {
+        //Without the OBJ whatever has been cooked is all we have.
+        if (loadFile(cookedPath, 0, scale))
+        {
+            return true;
+        }
+
+        std::cerr << "Unable to load mesh: " << objPath << std::endl;
+        return false;
+    }
+
+    std::uint64_t sourceHash = hashData(source.getData(), source.getSize());
+    if (loadFile(cookedPath, sourceHash, scale))
+    {
+        return true;
+    }
+
+    //The cooked file is missing or stale, so we parse the OBJ once and cook it for next time.
+    OBJModel model;
+    if (!model.parse(source.getData(), source.getSize(), false))
+    {
+        std::cerr << "Bad face index in mesh: " << objPath << std::endl;
+        return false;
+    }
+    source.close();
+
+    if (!cook(model.ToIndexedModel(scale), sourceHash, scale, cookedPath))
+    {
+        std::cerr << "Unable to write cooked mesh: " << cookedPath << std::endl;
+        return false;
+    }
+
+    return loadFile(cookedPath, sourceHash, scale);
+}
+
+/******************************************************************************/
+bool CookedMesh::loadFile(const std::string &cookedPath, std::uint64_t sourceHash, const Vector3 &scale)
+{
+    close();
+
+    if (!_file.open(cookedPath) || _file.getSize() < sizeof(CookedMeshHeader))
+    {
+        close();
+        return false;
+    }
+
+    const CookedMeshHeader* header = reinterpret_cast<const CookedMeshHeader*>(_file.getData());
+
+    float scaleFloats[3];
+    toFloats(scale, scaleFloats);
+
+    bool valid = memcmp(header->magic, COOKED_MAGIC, sizeof(COOKED_MAGIC)) == 0 &&
+                 header->version == COOKED_VERSION &&
+                 header->vertexStride == sizeof(CookedVertex) &&
+                 memcmp(header->scale, scaleFloats, sizeof(scaleFloats)) == 0 &&
+                 (sourceHash == 0 || header->sourceHash == sourceHash);
+
+    //We also make sure the streams really are inside the file before anyone reads them.
+    std::uint64_t fileSize = _file.getSize();
+    valid = valid &&
+            header->vertexOffset % COOKED_ALIGNMENT == 0 &&
+            header->indexOffset % sizeof(std::uint32_t) == 0 &&
+            header->vertexOffset <= fileSize &&
+            header->indexOffset <= fileSize &&
+            static_cast<std::uint64_t>(header->vertexCount) * sizeof(CookedVertex) <= fileSize - header->vertexOffset &&
+            static_cast<std::uint64_t>(header->indexCount) * sizeof(std::uint32_t) <= fileSize - header->indexOffset &&
+            header->lodCount >= 1 && header->lodCount <= MAX_MESH_LODS;
+
+    for (unsigned i = 0; valid && i < header->lodCount; i++)
+    {
+        valid = header->lods[i].indexCount % 3 == 0 &&
+                static_cast<std::uint64_t>(header->lods[i].firstIndex) + header->lods[i].indexCount <= header->indexCount;
+    }
+
+    //The indices go straight to the GPU and are used to read the vertices when the mesh is split up, so every one has to be in range.
+    if (valid)
+    {
+        const std::uint32_t* indices = reinterpret_cast<const std::uint32_t*>(_file.getData() + header->indexOffset);
+        for (std::uint32_t i = 0; valid && i < header->indexCount; i++)
+        {
+            valid = indices[i] < header->vertexCount;
+        }
+    }
+
+    if (!valid)
+    {
+        close();
+        return false;
+    }
+
+    _header = header;
+    return true;
+}
+
+/******************************************************************************/
+void CookedMesh::close()
+{
+    _file.close();
+    _header = nullptr;
+}
+
+/******************************************************************************/
+bool CookedMesh::cook(const IndexedModel &model, std::uint64_t sourceHash, const Vector3 &scale, const std::string &cookedPath)
+{
+    CookedMeshHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, COOKED_MAGIC, sizeof(COOKED_MAGIC));
+    header.version = COOKED_VERSION;
+    header.sourceHash = sourceHash;
+    toFloats(scale, header.scale);
+    header.vertexStride = sizeof(CookedVertex);
+    header.vertexCount = model.positions.size();
+    header.indexCount = model.indices.size();
+
+    //Here we interleave the vertices and find the bounds as we go.
+    std::vector<CookedVertex> vertices(header.vertexCount);
+    Vector3 boundsMin, boundsMax;
+    for (unsigned i = 0; i < vertices.size(); i++)
+    {
+        const Vector3 &position = model.positions[i];
+        toFloats(position, vertices[i].position);
+        vertices[i].texCoord[0] = static_cast<float>(model.texCoords[i].x);
+        vertices[i].texCoord[1] = static_cast<float>(model.texCoords[i].y);
+        toFloats(model.normals[i], vertices[i].normal);
+
+        if (i == 0)
+        {
+            boundsMin = position;
+            boundsMax = position;
+        }
+        else
+        {
+            boundsMin = Vector3(std::min(boundsMin.x, position.x), std::min(boundsMin.y, position.y), std::min(boundsMin.z, position.z));
+            boundsMax = Vector3(std::max(boundsMax.x, position.x), std::max(boundsMax.y, position.y), std::max(boundsMax.z, position.z));
+        }
+    }
+    toFloats(boundsMin, header.boundsMin);
+    toFloats(boundsMax, header.boundsMax);
+
+    //The levels of detail are simplified from the interleaved vertices, they all go after the full mesh in the index stream.
+    std::vector<std::uint32_t> indices;
+    std::vector<MeshLod> lods;
+    buildMeshLods(vertices.empty() ? nullptr : &vertices[0], vertices.size(),
+                  model.indices.empty() ? nullptr : &model.indices[0], model.indices.size(), indices, lods);
+
+    //Each level is ordered for the vertex cache on its own, then the vertices are put in the order the full mesh uses them.
+    header.sourceAcmr = getMeshAcmr(indices.empty() ? nullptr : &indices[0], lods.empty() ? 0 : lods[0].indexCount, vertices.size());
+    if (!indices.empty())
+    {
+        for (unsigned i = 0; i < lods.size(); i++)
+        {
+            optimizeVertexCache(&indices[lods[i].firstIndex], lods[i].indexCount, vertices.size());
+            optimizeOverdraw(&indices[lods[i].firstIndex], lods[i].indexCount, &vertices[0], vertices.size());
+        }
+        vertices.resize(optimizeVertexFetch(&vertices[0], vertices.size(), &indices[0], indices.size()));
+    }
+    header.acmr = getMeshAcmr(indices.empty() ? nullptr : &indices[0], lods.empty() ? 0 : lods[0].indexCount, vertices.size());
+
+    header.vertexCount = vertices.size();
+    header.indexCount = indices.size();
+    header.vertexOffset = alignUp(sizeof(CookedMeshHeader));
+    header.indexOffset = header.vertexOffset + static_cast<std::uint64_t>(header.vertexCount) * sizeof(CookedVertex);
+    header.lodCount = lods.size();
+    for (unsigned i = 0; i < lods.size(); i++)
+    {
+        header.lods[i] = lods[i];
+    }
+
+    AtomicFile file;
+    if (!file.open(cookedPath))
+    {
+        return false;
+    }
+
+    file.write(&header, sizeof(header));
+    file.writePadding(header.vertexOffset - sizeof(header));
+    if (!vertices.empty())
+    {
+        file.write(&vertices[0], vertices.size() * sizeof(CookedVertex));
+    }
+    if (!indices.empty())
+    {
+        file.write(&indices[0], indices.size() * sizeof(std::uint32_t));
+    }
+
+    if (!file.commit())
+    {
+        return false;
+    }
+
+    //A mesh is only cooked when its OBJ changes, so this is where we say how much the reordering saved.
+    std::cerr << "Cooked mesh: " << cookedPath << " ACMR " << header.sourceAcmr << " -> " << header.acmr << std::endl;
+    return true;
+}
+
+/******************************************************************************/
+bool CookedMesh::cookFile(const std::string &objPath, const Vector3 &scale)
+{
+    MappedFile source;
+    if (!source.open(objPath))
+    {
+        std::cerr << "Unable to load mesh: " << objPath << std::endl;
+        return false;
+    }
+
+    OBJModel model;
+    if (!model.parse(source.getData(), source.getSize(), false))
+    {
+        std::cerr << "Bad face index in mesh: " << objPath << std::endl;
+        return false;
+    }
+
+    return cook(model.ToIndexedModel(scale), hashData(source.getData(), source.getSize()), scale, getCookedPath(objPath, scale));
+}
+
+/******************************************************************************/
+std::string CookedMesh::getCookedPath(const std::string &objPath, const Vector3 &scale)
+{
+    return getScaledPath(objPath, scale, ".wmesh");
+}
+
+/******************************************************************************/
+std::string CookedMesh::getCollisionPath(const std::string &objPath, const Vector3 &scale)
+{
+    return getScaledPath(objPath, scale, ".wcol");
+}
+
+/******************************************************************************/
+std::uint64_t CookedMesh::hashData(const char* data, size_t size)
+{
+    //This is FNV-1a but eight bytes at a time, with an extra shift so the high bits feed back into the low ones.
+    const std::uint64_t prime = 0x100000001b3ULL;
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        std::uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * prime;
+        hash ^= hash >> 29;
+    }
+
+    for (; i < size; i++)
+    {
+        hash = (hash ^ static_cast<unsigned char>(data[i])) * prime;
+    }
+
+    hash ^= size;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+/******************************************************************************/
+const CookedVertex* CookedMesh::getVertices() const
+{
+    assert(_header);
+    return reinterpret_cast<const CookedVertex*>(_file.getData() + _header->vertexOffset);
+}
+
+/******************************************************************************/
+const std::uint32_t* CookedMesh::getIndices() const
+{
+    assert(_header);
+    return reinterpret_cast<const std::uint32_t*>(_file.getData() + _header->indexOffset);
+}
+
+/******************************************************************************/
+std::uint32_t CookedMesh::getVertexCount() const
+{
+    return _header ? _header->vertexCount : 0;
+}
+
+/******************************************************************************/
+std::uint32_t CookedMesh::getIndexCount() const
+{
+    return _header ? _header->indexCount : 0;
+}
+
+/******************************************************************************/
+std::uint32_t CookedMesh::getLodCount() const
+{
+    return _header ? _header->lodCount : 0;
+}
+
+/******************************************************************************/
+const MeshLod& CookedMesh::getLod(unsigned index) const
+{
+    assert(_header && index < _header->lodCount);
+    return _header->lods[index];
+}
+
+/******************************************************************************/
+float CookedMesh::getSourceAcmr() const
+{
+    return _header ? _header->sourceAcmr : 0.0f;
+}
+
+/******************************************************************************/
+float CookedMesh::getAcmr() const
+{
+    return _header ? _header->acmr : 0.0f;
+}
+
+/******************************************************************************/
+Vector3 CookedMesh::getBoundsMin() const
+{
+    assert(_header);
+    return Vector3(_header->boundsMin[0], _header->boundsMin[1], _header->boundsMin[2]);
+}
+
+/******************************************************************************/
+Vector3 CookedMesh::getBoundsMax() const
+{
+    assert(_header);
+    return Vector3(_header->boundsMax[0], _header->boundsMax[1], _header->boundsMax[2]);
+}
+
+/******************************************************************************/
+std::uint64_t CookedMesh::getSourceHash() const
+{
+    assert(_header);
+    return _header->sourceHash;
+}
+}; //wind
@@ -0,0 +1,102 @@
+#ifndef COOKED_MESH_H
+#define COOKED_MESH_H
+
+#include <string>
+#include <cstdint>
+
+#include "MappedFile.h"
+#include "OBJLoader.h"
+#include "MeshLod.h"
+#include "MeshOptimize.h"
+
+namespace wind
+{
+//One vertex in a cooked mesh, this is exactly what goes into the vertex buffer.
+struct CookedVertex
+{
+    float position[3];
+    float texCoord[2];
+    float normal[3];
+};
+
+//The start of every cooked mesh file. The vertex and index streams follow it at the given offsets.
+struct CookedMeshHeader
+{
+    char magic[4];
+    std::uint32_t version;
+    //A hash of the OBJ file it was cooked from, if the OBJ changes the hash won't match and we cook it again.
+    std::uint64_t sourceHash;
+    float scale[3];
+    std::uint32_t vertexStride;
+    std::uint32_t vertexCount;
+    std::uint32_t indexCount;
+    std::uint64_t vertexOffset;
+    std::uint64_t indexOffset;
+    float boundsMin[3];
+    float boundsMax[3];
+    //The levels of detail are runs of the index stream, level zero is the full mesh and comes first.
+    std::uint32_t lodCount;
+    MeshLod lods[MAX_MESH_LODS];
+    //The ACMR of the full mesh in the order the OBJ had it and in the order it was cooked in, see getMeshAcmr.
+    float sourceAcmr;
+    float acmr;
+};
+
+/**
+    This class loads a mesh that has already been parsed, deduped, scaled, simplified into its levels of detail and
+    reordered for the vertex cache.
+    The file is memory mapped and the vertex and index streams are used right out of the mapping, so they can go straight to glBufferData.
+    Cooked files sit next to the OBJ they come from and the scale is part of the name, so one OBJ can be cooked at many scales.
+    Note: The file is written in the byte order of the machine that cooked it.
+*/
+class CookedMesh
+{
+public:
+    CookedMesh();
+
+    //This function loads the cooked version of the OBJ, cooking it first if there is no cooked file or the OBJ has changed.
+    //If the OBJ is missing but a cooked file is there we use the cooked file as it is.
+    bool load(const std::string &objPath, const Vector3 &scale);
+
+    //This only loads a cooked file, the OBJ is never looked at.
+    //Pass zero as the source hash to skip the hash check.
+    bool loadFile(const std::string &cookedPath, std::uint64_t sourceHash, const Vector3 &scale);
+    void close();
+
+    //This function writes a cooked file, it can be used to cook meshes before the game ships.
+    static bool cook(const IndexedModel &model, std::uint64_t sourceHash, const Vector3 &scale, const std::string &cookedPath);
+    static bool cookFile(const std::string &objPath, const Vector3 &scale);
+
+    static std::string getCookedPath(const std::string &objPath, const Vector3 &scale);
+    //The physics' collision mesh for the same OBJ and scale is saved here, see CollisionMesh::save.
+    static std::string getCollisionPath(const std::string &objPath, const Vector3 &scale);
+    static std::uint64_t hashData(const char* data, size_t size);
+
+    const CookedVertex* getVertices() const;
+    const std::uint32_t* getIndices() const;
+    std::uint32_t getVertexCount() const;
+    //This is every index, all of the levels together.
+    std::uint32_t getIndexCount() const;
+
+    std::uint32_t getLodCount() const;
+    const MeshLod& getLod(unsigned index) const;
+
+    //These say how well the full mesh uses the vertex cache before and after cooking, lower is better.
+    float getSourceAcmr() const;
+    float getAcmr() const;
+
+    Vector3 getBoundsMin() const;
+    Vector3 getBoundsMax() const;
+    //The hash of the OBJ this was cooked from, anything else made from the OBJ can use it to tell if it is stale.
+    std::uint64_t getSourceHash() const;
+
+private:
+    CookedMesh(const CookedMesh&);
+    CookedMesh& operator=(const CookedMesh&);
+
+    MappedFile _file;
+    const CookedMeshHeader* _header;
+};
+}; //wind
+
+#endif
@@ -0,0 +1,265 @@
+#include "CookedTexture.h"
+
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "AtomicFile.h"
+#include "CookedMesh.h"
+#include "Texture.h"
+
+namespace wind
+{
+
+namespace
+{
+    const char COOKED_MAGIC[4] = { 'W', 'T', 'E', 'X' };
+    const std::uint32_t COOKED_VERSION = 1;
+
+    //Every level starts on a 16 byte boundary, which is a whole BC3 or BC7 block.
+    const std::uint64_t COOKED_ALIGNMENT = 16;
+
+    const char* FORMAT_NAMES[NUM_TEXTURE_FORMATS] = { "rgba8", "bc1", "bc3", "bc7" };
+
+    std::uint64_t alignUp(std::uint64_t value)
+    {
+        return (value + COOKED_ALIGNMENT - 1) & ~(COOKED_ALIGNMENT - 1);
+    }
+
+    bool cookSource(const MappedFile &source, const std::string &imagePath, TextureFormat format, std::uint64_t sourceHash)
+    {
+        std::vector<GLuint> pixels;
+        GLuint width, height;
+        if (!Texture::decodeImage32(imagePath, source.getData(), source.getSize(), pixels, width, height))
+        {
+            std::cerr << "Unable to load: " << imagePath << std::endl;
+            return false;
+        }
+
+        std::string cookedPath = CookedTexture::getCookedPath(imagePath, format);
+        if (!CookedTexture::cook(&pixels[0], width, height, format, sourceHash, cookedPath))
+        {
+            std::cerr << "Unable to write cooked texture: " << cookedPath << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+}
+
+/******************************************************************************/
+CookedTexture::CookedTexture() : _header(nullptr)
+{
+}
+
+/******************************************************************************/
+bool CookedTexture::load(const std::string &imagePath, TextureFormat format)
+{
+    close();
+
+    std::string cookedPath = getCookedPath(imagePath, format);
+
+    MappedFile source;
+    if (!source.open(imagePath))
+    {
+        //Without the image whatever has been cooked is all we have.
+        if (loadFile(cookedPath, 0, format))
+        {
+            return true;
+        }
+
+        std::cerr << "Unable to load: " << imagePath << std::endl;
+        return false;
+    }
+
+    std::uint64_t sourceHash = CookedMesh::hashData(source.getData(), source.getSize());
+    if (loadFile(cookedPath, sourceHash, format))
+    {
+        return true;
+    }
+
+    //The cooked file is missing or stale, so we decode the image once and cook it for next time.
+    if (!cookSource(source, imagePath, format, sourceHash))
+    {
+        return false;
+    }
+    source.close();
+
+    return loadFile(cookedPath, sourceHash, format);
+}
+
+/******************************************************************************/
+bool CookedTexture::loadFile(const std::string &cookedPath, std::uint64_t sourceHash, TextureFormat format)
+{
+    close();
+
+    if (!_file.open(cookedPath) || _file.getSize() < sizeof(CookedTextureHeader))
+    {
+        close();
+        return false;
+    }
+
+    const CookedTextureHeader* header = reinterpret_cast<const CookedTextureHeader*>(_file.getData());
+
+    bool valid = memcmp(header->magic, COOKED_MAGIC, sizeof(COOKED_MAGIC)) == 0 &&
+                 header->version == COOKED_VERSION &&
+                 header->format == static_cast<std::uint32_t>(format) &&
+                 header->levelCount > 0 && header->levelCount <= COOKED_TEXTURE_MAX_LEVELS &&
+                 (sourceHash == 0 || header->sourceHash == sourceHash);
+
+    //We also make sure every level really is inside the file and is the size it should be before anyone reads it.
+    std::uint64_t fileSize = _file.getSize();
+    for (unsigned i = 0; valid && i < header->levelCount; i++)
+    {
+        const CookedTextureLevel &level = header->levels[i];
+        valid = level.offset % COOKED_ALIGNMENT == 0 &&
+                level.offset <= fileSize &&
+                level.size <= fileSize - level.offset &&
+                level.size == getLevelSize(format, level.width, level.height);
+    }
+
+    if (!valid)
+    {
+        close();
+        return false;
+    }
+
+    _header = header;
+    return true;
+}
+
+/******************************************************************************/
+void CookedTexture::close()
+{
+    _file.close();
+    _header = nullptr;
+}
+
+/******************************************************************************/
+bool CookedTexture::cook(const std::uint32_t* pixels, unsigned width, unsigned height, TextureFormat format,
+                         std::uint64_t sourceHash, const std::string &cookedPath)
+{
+    if (width == 0 || height == 0 || format >= NUM_TEXTURE_FORMATS)
+    {
+        return false;
+    }
+
+    CookedTextureHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, COOKED_MAGIC, sizeof(COOKED_MAGIC));
+    header.version = COOKED_VERSION;
+    header.sourceHash = sourceHash;
+    header.format = format;
+    header.width = width;
+    header.height = height;
+
+    //Here we build the whole chain down to one pixel, compressing each level as we go.
+    std::vector<std::vector<std::uint8_t>> levels;
+    std::vector<std::uint32_t> current(pixels, pixels + static_cast<std::size_t>(width) * height);
+    std::vector<std::uint32_t> next;
+    std::uint64_t offset = alignUp(sizeof(CookedTextureHeader));
+    while (header.levelCount < COOKED_TEXTURE_MAX_LEVELS)
+    {
+        CookedTextureLevel &level = header.levels[header.levelCount++];
+        level.offset = offset;
+        level.size = getLevelSize(format, width, height);
+        level.width = width;
+        level.height = height;
+        offset = alignUp(offset + level.size);
+
+        levels.push_back(std::vector<std::uint8_t>(level.size));
+        compressImage(format, &current[0], width, height, &levels.back()[0]);
+
+        if (width == 1 && height == 1)
+        {
+            break;
+        }
+
+        buildMipLevel(&current[0], width, height, next, width, height);
+        current.swap(next);
+    }
+
+    AtomicFile file;
+    if (!file.open(cookedPath))
+    {
+        return false;
+    }
+
+    file.write(&header, sizeof(header));
+    std::uint64_t written = sizeof(header);
+    for (unsigned i = 0; i < levels.size(); i++)
+    {
+        file.writePadding(header.levels[i].offset - written);
+        file.write(&levels[i][0], levels[i].size());
+        written = header.levels[i].offset + levels[i].size();
+    }
+
+    return file.commit();
+}
+
+/******************************************************************************/
+bool CookedTexture::cookFile(const std::string &imagePath, TextureFormat format)
+{
+    MappedFile source;
+    if (!source.open(imagePath))
+    {
+        std::cerr << "Unable to load: " << imagePath << std::endl;
+        return false;
+    }
+
+    return cookSource(source, imagePath, format, CookedMesh::hashData(source.getData(), source.getSize()));
+}
+
+/******************************************************************************/
+std::string CookedTexture::getCookedPath(const std::string &imagePath, TextureFormat format)
+{
+    assert(format < NUM_TEXTURE_FORMATS);
+    return imagePath + "." + FORMAT_NAMES[format] + ".wtex";
+}
+
+/******************************************************************************/
+bool CookedTexture::isLoaded() const
+{
+    return _header != nullptr;
+}
+
+/******************************************************************************/
+TextureFormat CookedTexture::getFormat() const
+{
+    assert(_header);
+    return static_cast<TextureFormat>(_header->format);
+}
+
+/******************************************************************************/
+unsigned CookedTexture::getWidth() const
+{
+    return _header ? _header->width : 0;
+}
+
+/******************************************************************************/
+unsigned CookedTexture::getHeight() const
+{
+    return _header ? _header->height : 0;
+}
+
+/******************************************************************************/
+unsigned CookedTexture::getLevelCount() const
+{
+    return _header ? _header->levelCount : 0;
+}
+
+/******************************************************************************/
+const CookedTextureLevel& CookedTexture::getLevel(unsigned level) const
+{
+    assert(_header && level < _header->levelCount);
+    return _header->levels[level];
+}
+
+/******************************************************************************/
+const std::uint8_t* CookedTexture::getLevelData(unsigned level) const
+{
+    assert(_header && level < _header->levelCount);
+    return reinterpret_cast<const std::uint8_t*>(_file.getData() + _header->levels[level].offset);
+}
+}; //wind
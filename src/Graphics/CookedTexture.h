@@ -0,0 +1,85 @@
+#ifndef COOKED_TEXTURE_H
+#define COOKED_TEXTURE_H
+
+#include <string>
+#include <cstdint>
+
+#include "MappedFile.h"
+#include "BlockCompression.h"
+
+namespace wind
+{
+//A 32768 wide texture has 16 levels, nothing we load comes close to that.
+const unsigned COOKED_TEXTURE_MAX_LEVELS = 16;
+
+//Where one mip level sits in a cooked texture file.
+struct CookedTextureLevel
+{
+    std::uint64_t offset;
+    std::uint64_t size;
+    std::uint32_t width;
+    std::uint32_t height;
+};
+
+//The start of every cooked texture file, the levels follow it biggest first.
+struct CookedTextureHeader
+{
+    char magic[4];
+    std::uint32_t version;
+    //A hash of the image file it was cooked from, if the image changes the hash won't match and we cook it again.
+    std::uint64_t sourceHash;
+    std::uint32_t format;
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t levelCount;
+    CookedTextureLevel levels[COOKED_TEXTURE_MAX_LEVELS];
+};
+
+/**
+    This class loads a texture that is ready to go straight to the GPU.
+    The whole mip chain is built when it is cooked and can be block compressed, so loading is just mapping the file and handing
+    each level to glCompressedTexImage2D. Images don't get padded to a power of two, the levels are whatever size the image is.
+    Cooked files sit next to the image they come from with the format as part of the name, so one image can be cooked in many formats.
+    Note: The file is written in the byte order of the machine that cooked it.
+*/
+class CookedTexture
+{
+public:
+    CookedTexture();
+
+    //This function loads the cooked version of the image, cooking it first if there is no cooked file or the image has changed.
+    //If the image is missing but a cooked file is there we use the cooked file as it is.
+    bool load(const std::string &imagePath, TextureFormat format);
+
+    //This only loads a cooked file, the image is never looked at.
+    //Pass zero as the source hash to skip the hash check.
+    bool loadFile(const std::string &cookedPath, std::uint64_t sourceHash, TextureFormat format);
+    void close();
+
+    //This function writes a cooked file, it can be used to cook textures before the game ships.
+    //The pixels are RGBA with no padding.
+    static bool cook(const std::uint32_t* pixels, unsigned width, unsigned height, TextureFormat format,
+                     std::uint64_t sourceHash, const std::string &cookedPath);
+    static bool cookFile(const std::string &imagePath, TextureFormat format);
+
+    static std::string getCookedPath(const std::string &imagePath, TextureFormat format);
+
+    bool isLoaded() const;
+    TextureFormat getFormat() const;
+    unsigned getWidth() const;
+    unsigned getHeight() const;
+    unsigned getLevelCount() const;
+
+    const CookedTextureLevel& getLevel(unsigned level) const;
+    const std::uint8_t* getLevelData(unsigned level) const;
+
+private:
+    CookedTexture(const CookedTexture&);
+    CookedTexture& operator=(const CookedTexture&);
+
+    MappedFile _file;
+    const CookedTextureHeader* _header;
+};
+}; //wind
+
+#endif
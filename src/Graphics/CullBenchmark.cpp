@@ -0,0 +1,110 @@
+#include "CullBenchmark.h"
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "SceneBVH.h"
+
+namespace wind
+{
+
+namespace
+{
+    //The boxes fill a cube around the camera, so a little under a tenth of them are in view.
+    const float SCENE_HALF_SIZE = 1000.0f;
+    const float MIN_BOX_HALF_SIZE = 0.5f;
+    const float MAX_BOX_HALF_SIZE = 5.0f;
+
+    //Each cull is run a few times and the quickest is kept, so one slow run doesn't skew it.
+    const unsigned TIMING_RUNS = 5;
+
+    typedef std::chrono::high_resolution_clock Clock;
+
+    double millisecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+}
+
+/******************************************************************************/
+CullBenchmarkResult runCullBenchmark(unsigned count, unsigned seed, unsigned maxThreads)
+{
+    CullBenchmarkResult result = {};
+    result.count = count;
+
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> position(-SCENE_HALF_SIZE, SCENE_HALF_SIZE);
+    std::uniform_real_distribution<float> halfSize(MIN_BOX_HALF_SIZE, MAX_BOX_HALF_SIZE);
+
+    std::vector<CullBounds> bounds(count);
+    for (unsigned i = 0; i < count; i++)
+    {
+        for (unsigned axis = 0; axis < 3; axis++)
+        {
+            float centre = position(random);
+            float extent = halfSize(random);
+            bounds[i].min[axis] = centre - extent;
+            bounds[i].max[axis] = centre + extent;
+        }
+    }
+
+    //The camera sits in the middle looking a little off the axes, so the planes don't line up with the boxes.
+    Matrix4x4 projection;
+    Matrix4x4 view;
+    projection = projection.perspectiveRH(1.0, 16.0 / 9.0, 0.1, SCENE_HALF_SIZE);
+    view = view.lookAt(Vector3(0.0, 0.0, 0.0), Vector3(0.3, 0.2, -1.0), Vector3(0.0, 1.0, 0.0));
+    Frustum frustum(projection * view);
+
+    SceneBVH tree;
+    Clock::time_point start = Clock::now();
+    tree.build(count > 0 ? &bounds[0] : nullptr, count);
+    result.buildMilliseconds = millisecondsSince(start);
+
+    std::vector<unsigned> treeVisible;
+    std::vector<unsigned char> bruteForceVisible(count);
+    for (unsigned run = 0; run < TIMING_RUNS; run++)
+    {
+        start = Clock::now();
+        tree.cull(frustum, treeVisible, maxThreads);
+        double treeTime = millisecondsSince(start);
+
+        start = Clock::now();
+        frustum.cullBoxes(count > 0 ? &bounds[0] : nullptr, count, count > 0 ? &bruteForceVisible[0] : nullptr, maxThreads);
+        double bruteForceTime = millisecondsSince(start);
+
+        if (run == 0 || treeTime < result.treeMilliseconds)
+        {
+            result.treeMilliseconds = treeTime;
+        }
+        if (run == 0 || bruteForceTime < result.bruteForceMilliseconds)
+        {
+            result.bruteForceMilliseconds = bruteForceTime;
+        }
+    }
+
+    //Every box the tree kept is struck off, so anything left over or kept twice is a mismatch.
+    std::vector<unsigned char> treeKept(count, 0);
+    for (unsigned i = 0; i < treeVisible.size(); i++)
+    {
+        unsigned item = treeVisible[i];
+        if (item >= count || treeKept[item] != 0)
+        {
+            result.mismatches++;
+            continue;
+        }
+        treeKept[item] = 1;
+    }
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        result.visible += bruteForceVisible[i];
+        if (treeKept[i] != bruteForceVisible[i])
+        {
+            result.mismatches++;
+        }
+    }
+
+    return result;
+}
+}; //wind
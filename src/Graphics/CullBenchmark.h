@@ -0,0 +1,28 @@
+#ifndef CULL_BENCHMARK_H
+#define CULL_BENCHMARK_H
+
+#include "Frustum.h"
+
+namespace wind
+{
+struct CullBenchmarkResult
+{
+    unsigned count;
+    //How many boxes the brute force cull kept, and how many the tree and the brute force cull disagree on.
+    unsigned visible;
+    unsigned mismatches;
+
+    double buildMilliseconds;
+    double treeMilliseconds;
+    double bruteForceMilliseconds;
+};
+
+/**
+    This function scatters count random boxes around a camera, builds a SceneBVH over them and culls them with the tree
+    and with Frustum::cullBoxes over the whole list, then checks both kept exactly the same boxes and times each of them.
+    Nothing in here touches GL so it can be run without a window, the same seed always gives the same boxes.
+*/
+CullBenchmarkResult runCullBenchmark(unsigned count, unsigned seed = 1, unsigned maxThreads = 0);
+}; //wind
+
+#endif
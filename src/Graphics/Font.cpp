@@ -1,5 +1,6 @@
 #include "Font.h"
 #include "ShaderProgram2D.h"
+#include "TextureAtlas.h"
 #include "../Physics/include/Core.h"
 #include "include/TextureVertex2D.h"
 #include <iostream>
@@ -10,7 +11,9 @@ namespace wind
 /******************************************************************************/
 Font::Font() : _space(0),
     _lineHeight(0),
-    _newLine(0)
+    _newLine(0),
+    _atlas(nullptr),
+    _atlasFirst(-1)
 {
 }
 
@@ -30,7 +33,7 @@ void Font::bind(unsigned int unit)
 }
 
 /******************************************************************************/
-bool Font::loadImage(const std::string &filePath)
+bool Font::loadImage(const std::string &filePath, TextureAtlas *atlas)
 {
     bool success = true;
 
@@ -169,6 +172,17 @@ bool Font::loadImage(const std::string &filePath)
             _clip[t].h -= top;
         }
 
+        //The pixels are gone once they are a texture, so this is the only chance to copy them into the atlas.
+        if (atlas != nullptr)
+        {
+            _atlasFirst = addToAtlas(*atlas);
+            _atlas = _atlasFirst >= 0 ? atlas : nullptr;
+            if (_atlas == nullptr)
+            {
+                std::cerr << "Unable to add bitmap font to the atlas!" << std::endl;
+            }
+        }
+
         if (loadTextureFromPixels8())
         {
             if (!generateDataBuffer(SPRITE_ORIGIN_TOP_LEFT))
@@ -208,6 +222,11 @@ void Font::freeFont()
     _space = 0;
     _lineHeight = 0;
     _newLine = 0;
+
+    _atlas = nullptr;
+    _atlasFirst = -1;
+
+    _batch.invalidate();
 }
 
 void Font::renderText(ShaderProgram2D *fontProgram2D, GLfloat x, GLfloat y, 
@@ -216,142 +235,146 @@ void Font::renderText(ShaderProgram2D *fontProgram2D, GLfloat x, GLfloat y,
     //If there is a texture to render from
     if (getTextureID() != 0)
     {
-        //Draw positions
-        GLfloat dX = x;
-        GLfloat dY = y;
+        //The whole string is laid out and drawn in one go, the batch keeps the layout if the same text comes through again.
+        _batch.render(fontProgram2D, *this, x, y, text, area, align);
+    }
+}
 
-        //If the text needs to be aligned
-        if (area != nullptr)
+/******************************************************************************/
+void Font::layoutText(GLfloat x, GLfloat y, const std::string &text, const FontRect *area, int align,
+                      std::vector<TextureVertex2D> &vertices, std::vector<unsigned> &pages) const
+{
+    vertices.clear();
+    pages.clear();
+
+    //Correct empty alignment
+    if (area != nullptr && align == 0)
+    {
+        align = FONT_TEXT_ALIGN_LEFT | FONT_TEXT_ALIGN_TOP;
+    }
+
+    //First we find how wide every line is and how many there are, so each line can be aligned without rescanning the text.
+    std::vector<GLfloat> lineWidths(1, 0.f);
+    for (unsigned i = 0; i < text.length(); i++)
+    {
+        if (text[i] == ' ')
         {
-            //Correct empty alignment
-            if (align == 0)
-            {
-                align = FONT_TEXT_ALIGN_LEFT | FONT_TEXT_ALIGN_TOP;
-            }
+            lineWidths.back() += _space;
+        }
+        else if (text[i] == '\n')
+        {
+            lineWidths.push_back(0.f);
+        }
+        else
+        {
+            lineWidths.back() += _clip[static_cast<unsigned char>(text[i])].w;
+        }
+    }
 
-            //Handle horizontal alignment
+    //Handle horizontal alignment
+    auto lineStart = [&](GLfloat lineWidth)
+    {
+        if (area != nullptr)
+        {
             if (align & FONT_TEXT_ALIGN_LEFT)
             {
-                dX = area->x;
+                return area->x;
             }
             else if (align & FONT_TEXT_ALIGN_CENTERED_H)
             {
-                dX = area->x + (area->w - substringWidth(text.c_str())) / 2.f;
+                return area->x + (area->w - lineWidth) / 2.f;
             }
             else if (align & FONT_TEXT_ALIGN_RIGHT)
             {
-                dX = area->x + (area->w - substringWidth(text.c_str()));
-            }
-
-            //Handle vertical alignment
-            if (align & FONT_TEXT_ALIGN_TOP)
-            {
-                dY = area->y;
-            }
-            else if (align & FONT_TEXT_ALIGN_CENTERED_V)
-            {
-                dY = area->y + (area->h - stringHeight(text.c_str())) / 2.f;
-            }
-            else if (align & FONT_TEXT_ALIGN_BOTTOM)
-            {
-                dY = area->y + (area->h - stringHeight(text.c_str()));
+                return area->x + (area->w - lineWidth);
             }
         }
 
-        //This resets the font for drawing.
-        fontProgram2D->setModelView(wind::Matrix4x4());
-
-        //Move to draw position
-        wind::Matrix4x4 MV;
-        MV.setTranslation(dX, dY, 0.f);
-        fontProgram2D->leftMultModelView(MV);
-
-        //Set texture
-        glBindTexture(GL_TEXTURE_2D, getTextureID());
-
-        //Enable vertex and texture coordinate arrays
-        fontProgram2D->enableVertexPointer();
-        fontProgram2D->enableTexCoordPointer();
+        return x;
+    };
 
-        //Bind vertex data
-        glBindBuffer(GL_ARRAY_BUFFER, _vertexDataBuffer);
+    GLfloat dX = lineStart(lineWidths[0]);
+    GLfloat dY = y;
 
-        //Set vertex data
-        fontProgram2D->setVertexPointer(sizeof(TextureVertex2D), (GLvoid*)offsetof(TextureVertex2D, pos));
+    //Handle vertical alignment
+    if (area != nullptr)
+    {
+        GLfloat height = _lineHeight * lineWidths.size();
+        if (align & FONT_TEXT_ALIGN_TOP)
+        {
+            dY = area->y;
+        }
+        else if (align & FONT_TEXT_ALIGN_CENTERED_V)
+        {
+            dY = area->y + (area->h - height) / 2.f;
+        }
+        else if (align & FONT_TEXT_ALIGN_BOTTOM)
+        {
+            dY = area->y + (area->h - height);
+        }
+    }
 
-        //Set texture coordinate data
-        fontProgram2D->setTexCoordPointer(sizeof(TextureVertex2D), (GLvoid*)offsetof(TextureVertex2D, texCoord));
+    bool atlas = usesAtlas();
+    GLfloat tW = getTextureWidth();
+    GLfloat tH = getTextureHeight();
 
-        //Go through string
-        for (int i = 0; i < text.length(); i++)
+    unsigned line = 0;
+    for (unsigned i = 0; i < text.length(); i++)
+    {
+        //Space
+        if (text[i] == ' ')
         {
-            //Space
-            if (text[i] == ' ')
-            {
-                wind::Matrix4x4 MV;
-                MV.setTranslation(_space, 0.f, 0.f);
-                fontProgram2D->leftMultModelView(MV);
-                fontProgram2D->updateModelView();
+            dX += _space;
+        }
+        //Newline
+        else if (text[i] == '\n')
+        {
+            line++;
+            dX = lineStart(lineWidths[line]);
+            dY += _newLine;
+        }
+        //Character
+        else
+        {
+            GLuint ascii = static_cast<unsigned char>(text[i]);
+            const FontRect &clip = _clip[ascii];
 
-                dX += _space;
-            }
-            //Newline
-            else if (text[i] == '\n')
+            TextureVertex2D quad[4];
+            if (atlas)
             {
-                //Handle horizontal alignment
-                GLfloat targetX = x;
-                if (area != NULL)
-                {
-                    if (align & FONT_TEXT_ALIGN_LEFT)
-                    {
-                        targetX = area->x;
-                    }
-                    else if (align & FONT_TEXT_ALIGN_CENTERED_H)
-                    {
-                        targetX = area->x + (area->w - substringWidth(&text.c_str()[i + 1])) / 2.f;
-                    }
-                    else if (align & FONT_TEXT_ALIGN_RIGHT)
-                    {
-                        targetX = area->x + (area->w - substringWidth(&text.c_str()[i + 1]));
-                    }
-                }
-
-                //Move to target point
-                wind::Matrix4x4 MV;
-                MV.setTranslation(targetX - dX, _newLine, 0.f);
-                fontProgram2D->leftMultModelView(MV);
-                fontProgram2D->updateModelView();
-
-                dY += _newLine;
-                dX += targetX - dX;
+                const AtlasRegion &region = _atlas->getRegion(_atlasFirst + ascii);
+                buildQuad(clip, SPRITE_ORIGIN_TOP_LEFT, region.u0, region.v0, region.u1, region.v1, quad);
+                pages.push_back(region.page);
             }
-            //Character
             else
             {
-                //Get ASCII
-                GLuint ascii = static_cast<unsigned char>(text[i]);
-
-                //Update position matrix in program
-                fontProgram2D->updateModelView();
-
-                //Draw quad using vertex data and index data
-                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffers[ascii]);
-                glDrawElements(GL_TRIANGLE_FAN, 4, GL_UNSIGNED_INT, nullptr);
+                buildQuad(clip, SPRITE_ORIGIN_TOP_LEFT, clip.x / tW, clip.y / tH, (clip.x + clip.w) / tW, (clip.y + clip.h) / tH, quad);
+                pages.push_back(0);
+            }
 
-                wind::Matrix4x4 MV;
-                MV.setTranslation(_clip[ascii].w, 0.f, 0.f);
-                fontProgram2D->leftMultModelView(MV);
-                fontProgram2D->updateModelView();
-                dX += _clip[ascii].w;
+            //The quads are already where they go on screen, so the whole string can share one model view.
+            for (unsigned j = 0; j < 4; j++)
+            {
+                quad[j].pos.x += dX;
+                quad[j].pos.y += dY;
+                vertices.push_back(quad[j]);
             }
+
+            dX += clip.w;
         }
+    }
+}
 
-        //Disable vertex and texture coordinate arrays
-        fontProgram2D->disableVertexPointer();
-        fontProgram2D->disableTexCoordPointer();
+/******************************************************************************/
+bool Font::usesAtlas() const
+{
+    return _atlas != nullptr && _atlas->isBuilt();
+}
 
-        glBindTexture(GL_TEXTURE_2D, 0);
-    }
+/******************************************************************************/
+GLuint Font::getPageTexture(unsigned page) const
+{
+    return usesAtlas() ? _atlas->getPage(page).getTextureID() : getTextureID();
 }
 
 /******************************************************************************/
@@ -447,4 +470,16 @@ GLfloat Font::stringHeight(const char *text) const
     }
     return height;
 }
+
+/******************************************************************************/
+TextureAtlas* Font::getAtlas() const
+{
+    return _atlas;
+}
+
+/******************************************************************************/
+int Font::getAtlasRegion(unsigned char character) const
+{
+    return _atlas != nullptr ? _atlasFirst + character : -1;
+}
 }; //wind
\ No newline at end of file
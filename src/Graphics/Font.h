@@ -2,6 +2,7 @@
 #define FONT_H
 
 #include "SpriteSheet.h"
+#include "TextBatch.h"
 #include "include/FontRect.h"
 
 namespace
@@ -24,6 +25,7 @@ namespace wind
 **/
 
 class ShaderProgram2D;
+class TextureAtlas;
 
 class Font : public SpriteSheet
 {
@@ -35,24 +37,43 @@ public:
     virtual void bind(unsigned int unit) override;
 
     //This function will use an image file, cut it up ready for rendering.
-    bool loadImage(const std::string &filePath);
+    //If an atlas is given the characters are packed into it as well, the atlas still needs building after.
+    bool loadImage(const std::string &filePath, TextureAtlas *atlas = nullptr);
 
     //This function free the font up
     void freeFont();
 
     //This is the function that is going to render the text
+    //Text that stays on screen is better drawn through its own TextBatch, this one only keeps the last string it drew.
     void renderText(ShaderProgram2D *fontProgram2D, GLfloat x, GLfloat y, 
                     const std::string &text, FontRect *area, int align = FONT_TEXT_ALIGN_LEFT);
 
+    //This lays out the whole string as quads in screen space, four corners a character, and gives the page each one is on.
+    void layoutText(GLfloat x, GLfloat y, const std::string &text, const FontRect *area, int align,
+                    std::vector<TextureVertex2D> &vertices, std::vector<unsigned> &pages) const;
+
     GLfloat getLineHeight() const;
     FontRect getAreaString(const std::string &text) const;
     GLfloat substringWidth(const char* subtext) const;
     GLfloat stringHeight(const char* text) const;
+
+    //This gives the atlas the characters were packed into and the region of a character, or -1 if there isn't one.
+    TextureAtlas* getAtlas() const;
+    int getAtlasRegion(unsigned char character) const;
+
+    //The characters are drawn from the atlas once it has been built, until then they come from the font's own texture.
+    bool usesAtlas() const;
+    GLuint getPageTexture(unsigned page) const;
 private:
     //These are the spacing varaibles.
     GLfloat _space;
     GLfloat _lineHeight;
     GLfloat _newLine;
+
+    TextureAtlas *_atlas;
+    int _atlasFirst;
+
+    TextBatch _batch;
 };
 }; //wind
 #endif
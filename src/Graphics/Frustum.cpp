@@ -0,0 +1,294 @@
+#include "Frustum.h"
+
+#include <cmath>
+
+#include "../Physics/include/parallel.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define WIND_FRUSTUM_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace wind
+{
+
+namespace
+{
+    //Testing a box is only a few dozen instructions, so a thread needs a lot of them before it's worth starting.
+    const unsigned MIN_BOXES_PER_THREAD = 8192;
+}
+
+/******************************************************************************/
+CullBounds transformBounds(const float model[16], const Vector3 &boundsMin, const Vector3 &boundsMax)
+{
+    float centre[3] = { static_cast<float>((boundsMin.x + boundsMax.x) * 0.5),
+                        static_cast<float>((boundsMin.y + boundsMax.y) * 0.5),
+                        static_cast<float>((boundsMin.z + boundsMax.z) * 0.5) };
+    float extent[3] = { static_cast<float>((boundsMax.x - boundsMin.x) * 0.5),
+                        static_cast<float>((boundsMax.y - boundsMin.y) * 0.5),
+                        static_cast<float>((boundsMax.z - boundsMin.z) * 0.5) };
+
+    //The new centre is just the old one moved, the new half size is how far the rotated box reaches along each axis.
+    CullBounds result;
+    for (unsigned i = 0; i < 3; i++)
+    {
+        float newCentre = model[12 + i];
+        float newExtent = 0.0f;
+        for (unsigned j = 0; j < 3; j++)
+        {
+            newCentre += model[j * 4 + i] * centre[j];
+            newExtent += std::fabs(model[j * 4 + i]) * extent[j];
+        }
+
+        result.min[i] = newCentre - newExtent;
+        result.max[i] = newCentre + newExtent;
+    }
+
+    return result;
+}
+
+/******************************************************************************/
+Frustum::Frustum()
+{
+    //Without a matrix the frustum lets everything through.
+    for (unsigned i = 0; i < NUM_PLANES; i++)
+    {
+        _planes[i][0] = _planes[i][1] = _planes[i][2] = 0.0f;
+        _planes[i][3] = 1.0f;
+    }
+}
+
+/******************************************************************************/
+Frustum::Frustum(const Matrix4x4 &viewProjection)
+{
+    extract(viewProjection);
+}
+
+/******************************************************************************/
+void Frustum::extract(const Matrix4x4 &viewProjection)
+{
+    //The shader does clip = VP * position, and a point is on screen when -w <= x, y, z <= w.
+    //So each plane is the bottom row of the matrix plus or minus one of the other rows.
+    const real (*m)[4] = viewProjection.data;
+    for (unsigned i = 0; i < 3; i++)
+    {
+        for (unsigned j = 0; j < 4; j++)
+        {
+            _planes[i * 2][j] = static_cast<float>(m[3][j] + m[i][j]);
+            _planes[i * 2 + 1][j] = static_cast<float>(m[3][j] - m[i][j]);
+        }
+    }
+
+    //The planes are normalised so the sphere test can use the distance as it is.
+    for (unsigned i = 0; i < NUM_PLANES; i++)
+    {
+        float length = std::sqrt(_planes[i][0] * _planes[i][0] + _planes[i][1] * _planes[i][1] + _planes[i][2] * _planes[i][2]);
+        if (length > 0.0f)
+        {
+            for (unsigned j = 0; j < 4; j++)
+            {
+                _planes[i][j] /= length;
+            }
+        }
+    }
+}
+
+/******************************************************************************/
+bool Frustum::testSphere(const Vector3 &centre, real radius) const
+{
+    for (unsigned i = 0; i < NUM_PLANES; i++)
+    {
+        const float* plane = _planes[i];
+        real distance = plane[0] * centre.x + plane[1] * centre.y + plane[2] * centre.z + plane[3];
+        if (distance < -radius)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/******************************************************************************/
+bool Frustum::testPoint(const Vector3 &point) const
+{
+    return testSphere(point, 0.0);
+}
+
+/******************************************************************************/
+CullResult Frustum::testBox(const CullBounds &box) const
+{
+    float centre[3];
+    float extent[3];
+    for (unsigned i = 0; i < 3; i++)
+    {
+        centre[i] = (box.min[i] + box.max[i]) * 0.5f;
+        extent[i] = (box.max[i] - box.min[i]) * 0.5f;
+    }
+
+    CullResult result = CULL_INSIDE;
+    for (unsigned i = 0; i < NUM_PLANES; i++)
+    {
+        const float* plane = _planes[i];
+        float distance = plane[0] * centre[0] + plane[1] * centre[1] + plane[2] * centre[2] + plane[3];
+        float radius = std::fabs(plane[0]) * extent[0] + std::fabs(plane[1]) * extent[1] + std::fabs(plane[2]) * extent[2];
+
+        if (distance < -radius)
+        {
+            return CULL_OUTSIDE;
+        }
+
+        if (distance < radius)
+        {
+            result = CULL_INTERSECT;
+        }
+    }
+
+    return result;
+}
+
+/******************************************************************************/
+unsigned Frustum::testBoxes4(const float* centreX, const float* centreY, const float* centreZ,
+                             const float* extentX, const float* extentY, const float* extentZ) const
+{
+#ifdef WIND_FRUSTUM_SSE
+    __m128 cx = _mm_loadu_ps(centreX);
+    __m128 cy = _mm_loadu_ps(centreY);
+    __m128 cz = _mm_loadu_ps(centreZ);
+    __m128 ex = _mm_loadu_ps(extentX);
+    __m128 ey = _mm_loadu_ps(extentY);
+    __m128 ez = _mm_loadu_ps(extentZ);
+
+    //A box is outside if it is fully behind any one plane, so we or together the outside tests for every plane.
+    __m128 outside = _mm_setzero_ps();
+    for (unsigned i = 0; i < NUM_PLANES; i++)
+    {
+        const float* plane = _planes[i];
+        __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[0]), cx), _mm_mul_ps(_mm_set1_ps(plane[1]), cy)),
+                                     _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[2]), cz), _mm_set1_ps(plane[3])));
+        __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(std::fabs(plane[0])), ex), _mm_mul_ps(_mm_set1_ps(std::fabs(plane[1])), ey)),
+                                   _mm_mul_ps(_mm_set1_ps(std::fabs(plane[2])), ez));
+
+        outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+    }
+
+    return ~static_cast<unsigned>(_mm_movemask_ps(outside)) & 0xf;
+#else
+    unsigned mask = 0;
+    for (unsigned b = 0; b < 4; b++)
+    {
+        bool inside = true;
+        for (unsigned i = 0; i < NUM_PLANES && inside; i++)
+        {
+            const float* plane = _planes[i];
+            float distance = plane[0] * centreX[b] + plane[1] * centreY[b] + plane[2] * centreZ[b] + plane[3];
+            float radius = std::fabs(plane[0]) * extentX[b] + std::fabs(plane[1]) * extentY[b] + std::fabs(plane[2]) * extentZ[b];
+            inside = distance + radius >= 0.0f;
+        }
+
+        mask |= inside ? (1u << b) : 0u;
+    }
+    return mask;
+#endif
+}
+
+/******************************************************************************/
+unsigned Frustum::testSpheres4(const float* centreX, const float* centreY, const float* centreZ, const float* radius) const
+{
+#ifdef WIND_FRUSTUM_SSE
+    __m128 cx = _mm_loadu_ps(centreX);
+    __m128 cy = _mm_loadu_ps(centreY);
+    __m128 cz = _mm_loadu_ps(centreZ);
+    __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius));
+
+    __m128 outside = _mm_setzero_ps();
+    for (unsigned i = 0; i < NUM_PLANES; i++)
+    {
+        const float* plane = _planes[i];
+        __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[0]), cx), _mm_mul_ps(_mm_set1_ps(plane[1]), cy)),
+                                     _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[2]), cz), _mm_set1_ps(plane[3])));
+
+        outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negativeRadius));
+    }
+
+    return ~static_cast<unsigned>(_mm_movemask_ps(outside)) & 0xf;
+#else
+    unsigned mask = 0;
+    for (unsigned b = 0; b < 4; b++)
+    {
+        bool inside = true;
+        for (unsigned i = 0; i < NUM_PLANES && inside; i++)
+        {
+            const float* plane = _planes[i];
+            inside = plane[0] * centreX[b] + plane[1] * centreY[b] + plane[2] * centreZ[b] + plane[3] >= -radius[b];
+        }
+
+        mask |= inside ? (1u << b) : 0u;
+    }
+    return mask;
+#endif
+}
+
+/******************************************************************************/
+void Frustum::cullBoxes(const CullBounds* boxes, unsigned count, unsigned char* visible, unsigned maxThreads) const
+{
+    parallelFor(count, MIN_BOXES_PER_THREAD, [&](unsigned begin, unsigned end)
+    {
+        //The boxes come in as min and max, so each four are turned into centres and half sizes first.
+        float soa[6][4];
+        for (unsigned i = begin; i < end; i += 4)
+        {
+            unsigned groupSize = end - i < 4 ? end - i : 4;
+            for (unsigned b = 0; b < 4; b++)
+            {
+                //The last group is padded with copies of its last box.
+                const CullBounds &box = boxes[i + (b < groupSize ? b : groupSize - 1)];
+                for (unsigned axis = 0; axis < 3; axis++)
+                {
+                    soa[axis][b] = (box.min[axis] + box.max[axis]) * 0.5f;
+                    soa[axis + 3][b] = (box.max[axis] - box.min[axis]) * 0.5f;
+                }
+            }
+
+            unsigned mask = testBoxes4(soa[0], soa[1], soa[2], soa[3], soa[4], soa[5]);
+            for (unsigned b = 0; b < groupSize; b++)
+            {
+                visible[i + b] = (mask >> b) & 1;
+            }
+        }
+    }, maxThreads);
+}
+
+/******************************************************************************/
+void Frustum::cullSpheres(const float* spheres, unsigned count, unsigned char* visible, unsigned maxThreads) const
+{
+    parallelFor(count, MIN_BOXES_PER_THREAD, [&](unsigned begin, unsigned end)
+    {
+        float soa[4][4];
+        for (unsigned i = begin; i < end; i += 4)
+        {
+            unsigned groupSize = end - i < 4 ? end - i : 4;
+            for (unsigned b = 0; b < 4; b++)
+            {
+                const float* sphere = spheres + (i + (b < groupSize ? b : groupSize - 1)) * 4;
+                for (unsigned j = 0; j < 4; j++)
+                {
+                    soa[j][b] = sphere[j];
+                }
+            }
+
+            unsigned mask = testSpheres4(soa[0], soa[1], soa[2], soa[3]);
+            for (unsigned b = 0; b < groupSize; b++)
+            {
+                visible[i + b] = (mask >> b) & 1;
+            }
+        }
+    }, maxThreads);
+}
+
+/******************************************************************************/
+const float* Frustum::getPlane(unsigned index) const
+{
+    return _planes[index];
+}
+}; //wind
@@ -0,0 +1,75 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include "../Physics/include/Core.h"
+
+namespace wind
+{
+//A world space box that we cull against the frustum.
+struct CullBounds
+{
+    float min[3];
+    float max[3];
+};
+
+//This function puts a model space box through a column major model matrix and gives back the box around the result.
+CullBounds transformBounds(const float model[16], const Vector3 &boundsMin, const Vector3 &boundsMax);
+
+enum CullResult
+{
+    CULL_OUTSIDE,
+    CULL_INTERSECT,
+    CULL_INSIDE
+};
+
+/**
+    This class holds the six planes of the camera's view, they are pulled straight out of a view projection matrix like Camera::getVP.
+    Because the planes come from the same matrix the shader uses, what the frustum keeps is exactly what could end up on the screen.
+    The box and sphere tests are done four at a time with SSE when it's there, and the long list tests are split over the cores.
+    Nothing in here touches GL so it can be run and timed without a window.
+*/
+class Frustum
+{
+public:
+    Frustum();
+    explicit Frustum(const Matrix4x4 &viewProjection);
+
+    void extract(const Matrix4x4 &viewProjection);
+
+    bool testSphere(const Vector3 &centre, real radius) const;
+    bool testPoint(const Vector3 &point) const;
+    //This tells us if the box is fully inside, so a tree can stop testing everything under it.
+    CullResult testBox(const CullBounds &box) const;
+
+    //These test four boxes given as centres and half sizes, or four spheres, each pointer must have four floats.
+    //Bit i of the result is set if box i might be seen.
+    unsigned testBoxes4(const float* centreX, const float* centreY, const float* centreZ,
+                        const float* extentX, const float* extentY, const float* extentZ) const;
+    unsigned testSpheres4(const float* centreX, const float* centreY, const float* centreZ, const float* radius) const;
+
+    //These test a whole list and write 1 into visible for everything that might be seen and 0 for the rest.
+    //Spheres are four floats each, the centre then the radius.
+    void cullBoxes(const CullBounds* boxes, unsigned count, unsigned char* visible, unsigned maxThreads = 0) const;
+    void cullSpheres(const float* spheres, unsigned count, unsigned char* visible, unsigned maxThreads = 0) const;
+
+    //The planes are a, b, c, d with the normal pointing into the frustum.
+    const float* getPlane(unsigned index) const;
+
+    enum
+    {
+        PLANE_LEFT,
+        PLANE_RIGHT,
+        PLANE_BOTTOM,
+        PLANE_TOP,
+        PLANE_NEAR,
+        PLANE_FAR,
+
+        NUM_PLANES
+    };
+
+private:
+    float _planes[NUM_PLANES][4];
+};
+}; //wind
+
+#endif
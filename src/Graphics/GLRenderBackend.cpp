@@ -0,0 +1,112 @@
+#include "GLRenderBackend.h"
+
+namespace wind
+{
+/******************************************************************************/
+GLRenderBackend::GLRenderBackend() : _program(nullptr), _texture(nullptr), _mesh(nullptr), _models(nullptr), _modelCount(0),
+_objectOffset(0), _objectsWritten(false)
+{
+}
+
+/******************************************************************************/
+void GLRenderBackend::bindProgram(ShaderProgram3D* program)
+{
+    _program = program;
+    _objectsWritten = false;
+    if (_program != nullptr)
+    {
+        _program->bind();
+    }
+}
+
+/******************************************************************************/
+void GLRenderBackend::setFrameConstants(const FrameConstants &constants)
+{
+    if (_program != nullptr)
+    {
+        _program->setFrameConstants(constants);
+    }
+}
+
+/******************************************************************************/
+void GLRenderBackend::bindTexture(Texture* texture)
+{
+    if (texture != nullptr)
+    {
+        texture->bind(0);
+    }
+    else if (_texture != nullptr)
+    {
+        _texture->unbind(0);
+    }
+
+    _texture = texture;
+}
+
+/******************************************************************************/
+void GLRenderBackend::bindMesh(Mesh* mesh, unsigned lod)
+{
+    //Anything that draws the mesh outside the queue expects the full mesh.
+    if (_mesh != nullptr && _mesh != mesh)
+    {
+        _mesh->setLod(0);
+    }
+
+    mesh->bind();
+    mesh->setLod(lod);
+    _mesh = mesh;
+}
+
+/******************************************************************************/
+void GLRenderBackend::uploadModels(const float* models, unsigned count)
+{
+    _models = models;
+    _modelCount = count;
+    _objectsWritten = false;
+}
+
+/******************************************************************************/
+unsigned GLRenderBackend::drawMesh(Mesh* mesh, const float* models, unsigned first, unsigned count)
+{
+    //Meshes from the MeshManager can still be loading, those are just skipped for now.
+    if (_program == nullptr || !mesh->isLoaded())
+    {
+        return 0;
+    }
+
+    if (_program->hasObjectBlock() && _models != nullptr)
+    {
+        if (!_objectsWritten)
+        {
+            _objectOffset = _program->writeObjects(_models, _modelCount);
+            _objectsWritten = true;
+        }
+        return _program->drawObjects(mesh, _objectOffset, first, count);
+    }
+
+    return _program->drawMeshes(mesh, models, count);
+}
+
+/******************************************************************************/
+void GLRenderBackend::finish()
+{
+    Mesh::unbind();
+
+    if (_mesh != nullptr)
+    {
+        _mesh->setLod(0);
+        _mesh = nullptr;
+    }
+
+    //The queue leaves the last texture bound, the rest of the frame expects none.
+    if (_texture != nullptr)
+    {
+        _texture->unbind(0);
+        _texture = nullptr;
+    }
+    _program = nullptr;
+    _models = nullptr;
+    _modelCount = 0;
+    _objectsWritten = false;
+}
+}; //wind
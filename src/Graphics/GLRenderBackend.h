@@ -0,0 +1,45 @@
+#ifndef GL_RENDER_BACKEND_H
+#define GL_RENDER_BACKEND_H
+
+#include "RenderQueue.h"
+#include "ShaderProgram3D.h"
+#include "Texture.h"
+#include "Mesh.h"
+
+namespace wind
+{
+/**
+    This is the backend that runs a render queue with OpenGL.
+    Meshes are drawn through the program, so a program with an instanceModel attribute draws each batch with one instanced draw.
+    A program with an ObjectConstants block gets all of the frame's matrices in one write, each draw is then bound to its own.
+*/
+class GLRenderBackend : public RenderBackend
+{
+public:
+    GLRenderBackend();
+
+    void bindProgram(ShaderProgram3D* program) override;
+    void setFrameConstants(const FrameConstants &constants) override;
+    void bindTexture(Texture* texture) override;
+    void bindMesh(Mesh* mesh, unsigned lod) override;
+
+    void uploadModels(const float* models, unsigned count) override;
+    unsigned drawMesh(Mesh* mesh, const float* models, unsigned first, unsigned count) override;
+
+    void finish() override;
+
+private:
+    ShaderProgram3D* _program;
+    Texture* _texture;
+    //The mesh whose level of detail we changed, it is put back to the full mesh when we are done with it.
+    Mesh* _mesh;
+
+    //The frame's matrices are only written to a program's object block the first time that program draws.
+    const float* _models;
+    unsigned _modelCount;
+    GLintptr _objectOffset;
+    bool _objectsWritten;
+};
+}; //wind
+
+#endif
@@ -0,0 +1,64 @@
+#include "InstanceBuffer.h"
+
+namespace wind
+{
+
+namespace
+{
+    //The smallest region we make, that's a thousand model matrices.
+    const GLsizeiptr MIN_REGION_SIZE = 64 * 1024;
+
+    //Every write starts on 16 bytes so the attributes are always aligned.
+    const GLsizeiptr WRITE_ALIGNMENT = 16;
+}
+
+/******************************************************************************/
+InstanceBuffer::InstanceBuffer() : _stream(GL_ARRAY_BUFFER, MIN_REGION_SIZE)
+{
+}
+
+/******************************************************************************/
+bool InstanceBuffer::isSupported()
+{
+    return GLEW_VERSION_3_3 || GLEW_ARB_instanced_arrays;
+}
+
+/******************************************************************************/
+void InstanceBuffer::setDivisor(GLuint index, GLuint divisor)
+{
+    if (GLEW_VERSION_3_3)
+    {
+        glVertexAttribDivisor(index, divisor);
+    }
+    else
+    {
+        glVertexAttribDivisorARB(index, divisor);
+    }
+}
+
+/******************************************************************************/
+GLintptr InstanceBuffer::write(const void* data, GLsizeiptr size)
+{
+    GLintptr offset = _stream.reserve(size, WRITE_ALIGNMENT);
+    _stream.upload(offset, data, size);
+    return offset;
+}
+
+/******************************************************************************/
+void InstanceBuffer::endFrame()
+{
+    _stream.endFrame();
+}
+
+/******************************************************************************/
+GLuint InstanceBuffer::getBuffer() const
+{
+    return _stream.getBuffer();
+}
+
+/******************************************************************************/
+bool InstanceBuffer::isPersistent() const
+{
+    return _stream.isPersistent();
+}
+}; //wind
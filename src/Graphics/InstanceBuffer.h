@@ -0,0 +1,40 @@
+#ifndef INSTANCE_BUFFER_H
+#define INSTANCE_BUFFER_H
+
+#include <GL/glew.h>
+
+#include "StreamBuffer.h"
+
+namespace wind
+{
+/**
+    This class holds the per instance data for instanced draws, it is refilled every frame.
+    It is a StreamBuffer on the array buffer target, so with buffer storage a write is just a copy into this frame's fenced region.
+*/
+class InstanceBuffer
+{
+public:
+    InstanceBuffer();
+
+    //This function returns true if the driver can do instanced vertex attributes at all.
+    static bool isSupported();
+    static void setDivisor(GLuint index, GLuint divisor);
+
+    //This copies the data into the buffer and returns the offset in bytes that it went to.
+    GLintptr write(const void* data, GLsizeiptr size);
+
+    //This needs to be called once all of the frame's draws have been made.
+    void endFrame();
+
+    GLuint getBuffer() const;
+    bool isPersistent() const;
+
+private:
+    InstanceBuffer(const InstanceBuffer&);
+    InstanceBuffer& operator=(const InstanceBuffer&);
+
+    StreamBuffer _stream;
+};
+}; //wind
+
+#endif
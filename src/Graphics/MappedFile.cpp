@@ -0,0 +1,171 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace wind
+{
+
+/******************************************************************************/
+#ifdef _WIN32
+MappedFile::MappedFile() : _data(nullptr), _size(0), _file(INVALID_HANDLE_VALUE), _mapping(nullptr)
+#else
+MappedFile::MappedFile() : _data(nullptr), _size(0), _file(-1)
+#endif
+{
+}
+
+/******************************************************************************/
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string &filePath) : _data(nullptr), _size(0), _file(INVALID_HANDLE_VALUE), _mapping(nullptr)
+#else
+MappedFile::MappedFile(const std::string &filePath) : _data(nullptr), _size(0), _file(-1)
+#endif
+{
+    open(filePath);
+}
+
+/******************************************************************************/
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+/******************************************************************************/
+bool MappedFile::open(const std::string &filePath)
+{
+    close();
+
+#ifdef _WIN32
+    _file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (_file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(_file, &fileSize))
+    {
+        close();
+        return false;
+    }
+    _size = static_cast<size_t>(fileSize.QuadPart);
+
+    //A file mapping can't be made for an empty file, but an empty file is still a file we opened.
+    if (_size == 0)
+    {
+        return true;
+    }
+
+    _mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (_mapping == nullptr)
+    {
+        close();
+        return false;
+    }
+
+    _data = static_cast<const char*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (_data == nullptr)
+    {
+        close();
+        return false;
+    }
+#else
+    _file = ::open(filePath.c_str(), O_RDONLY);
+    if (_file < 0)
+    {
+        return false;
+    }
+
+    struct stat fileStat;
+    if (fstat(_file, &fileStat) != 0)
+    {
+        close();
+        return false;
+    }
+    _size = static_cast<size_t>(fileStat.st_size);
+
+    if (_size == 0)
+    {
+        return true;
+    }
+
+    void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _file, 0);
+    if (data == MAP_FAILED)
+    {
+        close();
+        return false;
+    }
+
+    //We read the file from start to end so let the OS know it can read ahead.
+    madvise(data, _size, MADV_SEQUENTIAL);
+    _data = static_cast<const char*>(data);
+#endif
+
+    return true;
+}
+
+/******************************************************************************/
+void MappedFile::close()
+{
+#ifdef _WIN32
+    if (_data != nullptr)
+    {
+        UnmapViewOfFile(_data);
+    }
+    if (_mapping != nullptr)
+    {
+        CloseHandle(_mapping);
+    }
+    if (_file != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(_file);
+    }
+
+    _mapping = nullptr;
+    _file = INVALID_HANDLE_VALUE;
+#else
+    if (_data != nullptr)
+    {
+        munmap(const_cast<char*>(_data), _size);
+    }
+    if (_file >= 0)
+    {
+        ::close(_file);
+    }
+
+    _file = -1;
+#endif
+
+    _data = nullptr;
+    _size = 0;
+}
+
+/******************************************************************************/
+bool MappedFile::isOpen() const
+{
+#ifdef _WIN32
+    return _file != INVALID_HANDLE_VALUE;
+#else
+    return _file >= 0;
+#endif
+}
+
+/******************************************************************************/
+const char* MappedFile::getData() const
+{
+    return _data;
+}
+
+/******************************************************************************/
+size_t MappedFile::getSize() const
+{
+    return _size;
+}
+}; //wind
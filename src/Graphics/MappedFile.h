@@ -0,0 +1,47 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+
+namespace wind
+{
+/**
+    This class maps a whole file into memory read only.
+    The OS pages the file in as we touch it, so there is no copy into a buffer and no getline.
+    On Windows it uses a file mapping, everywhere else it uses mmap.
+*/
+class MappedFile
+{
+public:
+    MappedFile();
+    MappedFile(const std::string &filePath);
+    ~MappedFile();
+
+    //This function opens and maps the file, any file already open is closed first.
+    bool open(const std::string &filePath);
+    void close();
+
+    bool isOpen() const;
+
+    //Note: The data is not null terminated, always use the size.
+    const char* getData() const;
+    size_t getSize() const;
+
+private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    const char* _data;
+    size_t _size;
+
+#ifdef _WIN32
+    void* _file;
+    void* _mapping;
+#else
+    int _file;
+#endif
+};
+}; //wind
+
+#endif
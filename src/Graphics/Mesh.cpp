@@ -1,5 +1,22 @@
 #include "Mesh.h"
 
+#include <algorithm>
+#include <cstddef>
+
+wind::VertexFormat Mesh::vertexFormat = wind::VERTEX_FORMAT_AUTO;
+
+namespace
+{
+	//Meshes with more triangles than this are split up, anything smaller isn't worth culling in parts.
+	const unsigned int CHUNK_TRIANGLES = 4096;
+
+	struct ChunkRange
+	{
+		unsigned int first;
+		unsigned int count;
+	};
+}
+
 Mesh::Mesh(Vertex* vertices, unsigned int numVertices, unsigned int *indices, unsigned numInderices)
 {
 	IndexedModel model;
@@ -21,65 +38,95 @@ Mesh::Mesh(Vertex* vertices, unsigned int numVertices, unsigned int *indices, un
 
 Mesh::Mesh(const std::string& filePath, const wind::Vector3& size)
 {
-    model.buildModel(filePath, 0);
-	IndexedModel iModel = model.ToIndexedModel(size);
-	initMesh(iModel);
+    loadMesh(filePath, size);
 }
 
-Mesh::Mesh(const std::string& filePath, const wind::Vector3& size, std::vector<wind::Polygon*> &poly)
+Mesh::Mesh(const std::string& filePath, const wind::Vector3& size, wind::CollisionMesh &collision)
 {
-    int getter = 0;
-    OBJModel jack(filePath, 1);
-    for(int i = 0; i < jack.face.size(); i++)
-    {
-        poly.push_back(new wind::Polygon());
-
-        poly[i]->vertices.push_back(jack.face[getter]);
-        getter++;
-        poly[i]->vertices.push_back(jack.face[getter]);
-        getter++;
-        poly[i]->vertices.push_back(jack.face[getter]);
-        getter++;
-    }
-
-	IndexedModel model = jack.ToIndexedModel(size);
-	initMesh(model);
+    addMesh(filePath, size, collision);
 }
 
 Mesh::~Mesh()
 {
-	glDeleteVertexArrays(1, &vertexArrayObject);
+	if(vertexArrayObject != 0)
+	{
+		glDeleteBuffers(NUM_BUFFERS, vertexArrayBuffers);
+		glDeleteVertexArrays(1, &vertexArrayObject);
+	}
 }
 
-void Mesh::addMesh(const std::string& filePath, const wind::Vector3& size, std::vector<wind::Polygon*> &poly)
+void Mesh::addMesh(const std::string& filePath, const wind::Vector3& size, wind::CollisionMesh &collision)
 {
-    int getter = 0;
-    OBJModel jack(filePath, 1);
-    for(int i = 0; i < jack.face.size(); i++)
+    this->filePath = filePath;
+
+    //The physics only wants the full mesh, so it reads level zero of the same cooked streams the GPU gets.
+    wind::CookedMesh cooked;
+    if(cooked.load(filePath, size))
     {
-        poly.push_back(new wind::Polygon());
-
-        poly[i]->vertices.push_back(jack.face[getter]);
-        getter++;
-        poly[i]->vertices.push_back(jack.face[getter]);
-        getter++;
-        poly[i]->vertices.push_back(jack.face[getter]);
-        getter++;
+        //The tree is saved next to the cooked mesh the first time, after that it is just read back.
+        std::string collisionPath = wind::CookedMesh::getCollisionPath(filePath, size);
+        if(!collision.load(collisionPath, cooked.getSourceHash()))
+        {
+            collision.build(cooked.getVertices()->position, cooked.getVertexCount(), sizeof(wind::CookedVertex),
+                            cooked.getIndices() + cooked.getLod(0).firstIndex, cooked.getLod(0).indexCount);
+            collision.save(collisionPath, cooked.getSourceHash());
+        }
+        initMesh(cooked);
+        return;
     }
 
-	IndexedModel model = jack.ToIndexedModel(size);
-	initMesh(model);
+    //If it couldn't be cooked the OBJ is still only parsed once, both sides use the same indexed model.
+    wind::MappedFile source(filePath);
+    if(source.isOpen() && model.parse(source.getData(), source.getSize(), false))
+    {
+        IndexedModel indexed = model.ToIndexedModel(size);
+
+        std::vector<float> positions(indexed.positions.size() * 3);
+        for(unsigned int i = 0; i < indexed.positions.size(); i++)
+        {
+            positions[i * 3] = static_cast<float>(indexed.positions[i].x);
+            positions[i * 3 + 1] = static_cast<float>(indexed.positions[i].y);
+            positions[i * 3 + 2] = static_cast<float>(indexed.positions[i].z);
+        }
+
+        collision.build(positions.empty() ? nullptr : &positions[0], indexed.positions.size(), 3 * sizeof(float),
+                        indexed.indices.empty() ? nullptr : &indexed.indices[0], indexed.indices.size());
+        initMesh(indexed);
+    }
 }
 
 void Mesh::addMesh(const std::string& filePath, const wind::Vector3& size)
 {
-    model.buildModel(filePath, 0);
-	IndexedModel iModel = model.ToIndexedModel(size);
-	initMesh(iModel);
+    loadMesh(filePath, size);
+}
+
+void Mesh::loadMesh(const std::string& filePath, const wind::Vector3& size)
+{
+    this->filePath = filePath;
+
+    //The cooked mesh is already parsed, deduped and scaled, so we skip the OBJ altogether.
+    wind::CookedMesh cooked;
+    if(cooked.load(filePath, size))
+    {
+        initMesh(cooked);
+        return;
+    }
+
+    //If it couldn't be cooked we load the OBJ the slow way, the cooker has already said why it failed.
+    wind::MappedFile source(filePath);
+    if(source.isOpen() && model.parse(source.getData(), source.getSize(), false))
+    {
+        initMesh(model.ToIndexedModel(size));
+    }
 }
 
 std::vector<wind::Vector3> Mesh::getAllVertices()
 {
+    if(model.vertices.empty() && !filePath.empty())
+    {
+        model.buildModel(filePath, 0);
+    }
+
     if(model.vertices.empty())
     {
         std::cerr << "No vertices dude, you ran this before you built the model" << std::endl;
@@ -91,6 +138,11 @@ std::vector<wind::Vector3> Mesh::getAllVertices()
 
 wind::Vector3 Mesh::getFirstVertex()
 {
+    if(model.vertices.empty() && !filePath.empty())
+    {
+        model.buildModel(filePath, 0);
+    }
+
     if(model.vertices.empty())
     {
         std::cerr << "No vertices dude, you ran this before you built the model" << std::endl;
@@ -102,41 +154,284 @@ wind::Vector3 Mesh::getFirstVertex()
 
 void Mesh::initMesh(const IndexedModel& model)
 {
-	drawCount = model.indices.size();
+	boundsMin = boundsMax = model.positions.empty() ? wind::Vector3() : model.positions[0];
+	for(unsigned int i = 1; i < model.positions.size(); i++)
+	{
+		const wind::Vector3& position = model.positions[i];
+		boundsMin = wind::Vector3(std::min(boundsMin.x, position.x), std::min(boundsMin.y, position.y), std::min(boundsMin.z, position.z));
+		boundsMax = wind::Vector3(std::max(boundsMax.x, position.x), std::max(boundsMax.y, position.y), std::max(boundsMax.z, position.z));
+	}
+
+	//The model is all doubles with padding, so we turn it into interleaved floats before it goes anywhere near the GPU.
+	std::vector<wind::CookedVertex> vertices(model.positions.size());
+	for(unsigned int i = 0; i < vertices.size(); i++)
+	{
+		wind::CookedVertex& vertex = vertices[i];
+		vertex.position[0] = static_cast<float>(model.positions[i].x);
+		vertex.position[1] = static_cast<float>(model.positions[i].y);
+		vertex.position[2] = static_cast<float>(model.positions[i].z);
+		vertex.texCoord[0] = static_cast<float>(model.texCoords[i].x);
+		vertex.texCoord[1] = static_cast<float>(model.texCoords[i].y);
+		vertex.normal[0] = static_cast<float>(model.normals[i].x);
+		vertex.normal[1] = static_cast<float>(model.normals[i].y);
+		vertex.normal[2] = static_cast<float>(model.normals[i].z);
+	}
+
+	uploadMesh(vertices.empty() ? nullptr : &vertices[0], vertices.size(),
+			   model.indices.empty() ? nullptr : &model.indices[0], model.indices.size(), nullptr, 0);
+}
+
+void Mesh::initMesh(const wind::CookedMesh& cooked)
+{
+	boundsMin = cooked.getBoundsMin();
+	boundsMax = cooked.getBoundsMax();
+
+	uploadMesh(cooked.getVertices(), cooked.getVertexCount(), cooked.getIndices(), cooked.getIndexCount(),
+			   cooked.getLodCount() > 0 ? &cooked.getLod(0) : nullptr, cooked.getLodCount());
+}
+
+void Mesh::uploadMesh(const wind::CookedVertex* vertices, unsigned int numVertices, const unsigned int* indices, unsigned int numIndices,
+					  const wind::MeshLod* lodList, unsigned int lodCount)
+{
+	wind::MeshLod full = { 0, numIndices, 0.0f, 0 };
+	if(lodCount == 0)
+	{
+		lodList = &full;
+		lodCount = 1;
+	}
+	lods.assign(lodList, lodList + lodCount);
+	drawLod = 0;
+
+	//Only level zero is split into chunks, the chunks are the same triangles in a different order so the other levels don't move.
+	std::vector<unsigned int> chunkIndices;
+	buildChunks(vertices, indices, lods[0].indexCount, chunkIndices);
+	if(!chunkIndices.empty())
+	{
+		chunkIndices.insert(chunkIndices.end(), indices + lods[0].indexCount, indices + numIndices);
+		indices = &chunkIndices[0];
+	}
+
+	drawCount = lods[0].indexCount;
+
+	//Float vertices go up as they are, packed ones are converted here.
+	wind::VertexFormat format = wind::chooseVertexFormat(vertexFormat, vertices, numVertices);
+
+	std::vector<wind::PackedVertex> packed;
+	const GLvoid* vertexData = vertices;
+	if(format == wind::VERTEX_FORMAT_PACKED)
+	{
+		wind::packVertices(vertices, numVertices, packed);
+		vertexData = packed.empty() ? nullptr : &packed[0];
+	}
 
 	glGenVertexArrays(1, &vertexArrayObject);
 	glBindVertexArray(vertexArrayObject);
     glGenBuffers(NUM_BUFFERS, vertexArrayBuffers);
 
-	glBindBuffer(GL_ARRAY_BUFFER, vertexArrayBuffers[POSITION_VB]);
-	glBufferData(GL_ARRAY_BUFFER, model.positions.size() * sizeof(model.positions[0]), &model.positions[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexArrayBuffers[VERTEX_VB]);
+	glBufferData(GL_ARRAY_BUFFER, numVertices * wind::getVertexStride(format), vertexData, GL_STATIC_DRAW);
+
+	wind::setVertexLayout(format);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vertexArrayBuffers[INDEX_VB]);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, numIndices * sizeof(unsigned int), indices, GL_STATIC_DRAW);
+
+	glBindVertexArray(0);
+}
+
+void Mesh::buildChunks(const wind::CookedVertex* vertices, const unsigned int* indices, unsigned int numIndices, std::vector<unsigned int>& chunkIndices)
+{
+	chunks.clear();
+	unsigned int numTriangles = numIndices / 3;
 
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 4, GL_DOUBLE, GL_FALSE, 0, 0);
+	if(numTriangles <= CHUNK_TRIANGLES)
+	{
+		MeshChunk chunk;
+		chunk.firstIndex = 0;
+		chunk.indexCount = numIndices;
+		chunk.boundsMin = boundsMin;
+		chunk.boundsMax = boundsMax;
+		chunks.push_back(chunk);
+		return;
+	}
 
-	glBindBuffer(GL_ARRAY_BUFFER, vertexArrayBuffers[TEXCOORD_VB]);
-	glBufferData(GL_ARRAY_BUFFER, model.texCoords.size() * sizeof(model.texCoords[0]), &model.texCoords[0], GL_STATIC_DRAW);
+	std::vector<unsigned int> triangles(numTriangles);
+	std::vector<float> centres(numTriangles * 3);
+	for(unsigned int i = 0; i < numTriangles; i++)
+	{
+		triangles[i] = i;
+		for(unsigned int axis = 0; axis < 3; axis++)
+		{
+			centres[i * 3 + axis] = (vertices[indices[i * 3]].position[axis] +
+									 vertices[indices[i * 3 + 1]].position[axis] +
+									 vertices[indices[i * 3 + 2]].position[axis]) / 3.0f;
+		}
+	}
 
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 2, GL_DOUBLE, GL_FALSE, 0, 0);
+	//The triangles are split in half along the longest side of their centres until each half is small enough.
+	std::vector<ChunkRange> ranges;
+	std::vector<ChunkRange> stack(1, ChunkRange{ 0, numTriangles });
+	while(!stack.empty())
+	{
+		ChunkRange range = stack.back();
+		stack.pop_back();
 
-	glBindBuffer(GL_ARRAY_BUFFER, vertexArrayBuffers[NORMAL_VB]);
-	glBufferData(GL_ARRAY_BUFFER, model.normals.size() * sizeof(model.normals[0]), &model.normals[0], GL_STATIC_DRAW);
+		if(range.count <= CHUNK_TRIANGLES)
+		{
+			ranges.push_back(range);
+			continue;
+		}
 
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 4, GL_DOUBLE, GL_FALSE, 0, 0);
+		float low[3] = { centres[triangles[range.first] * 3], centres[triangles[range.first] * 3 + 1], centres[triangles[range.first] * 3 + 2] };
+		float high[3] = { low[0], low[1], low[2] };
+		for(unsigned int i = range.first + 1; i < range.first + range.count; i++)
+		{
+			for(unsigned int axis = 0; axis < 3; axis++)
+			{
+				low[axis] = std::min(low[axis], centres[triangles[i] * 3 + axis]);
+				high[axis] = std::max(high[axis], centres[triangles[i] * 3 + axis]);
+			}
+		}
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vertexArrayBuffers[INDEX_VB]);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, model.indices.size() * sizeof(model.indices[0]), &model.indices[0], GL_STATIC_DRAW);
+		unsigned int axis = 0;
+		for(unsigned int i = 1; i < 3; i++)
+		{
+			if(high[i] - low[i] > high[axis] - low[axis])
+			{
+				axis = i;
+			}
+		}
 
-	glBindVertexArray(0);
+		unsigned int half = range.count / 2;
+		std::vector<unsigned int>::iterator begin = triangles.begin() + range.first;
+		std::nth_element(begin, begin + half, begin + range.count, [&](unsigned int a, unsigned int b)
+		{
+			return centres[a * 3 + axis] < centres[b * 3 + axis];
+		});
+
+		stack.push_back(ChunkRange{ range.first + half, range.count - half });
+		stack.push_back(ChunkRange{ range.first, half });
+	}
+
+	//Now the index list is written out chunk by chunk and each chunk gets the box around it's vertices.
+	//Inside a chunk the triangles go back to the order they came in, which is the order the cooker picked for the vertex cache.
+	chunkIndices.resize(numTriangles * 3);
+	for(unsigned int r = 0; r < ranges.size(); r++)
+	{
+		std::sort(triangles.begin() + ranges[r].first, triangles.begin() + ranges[r].first + ranges[r].count);
+
+		MeshChunk chunk;
+		chunk.firstIndex = ranges[r].first * 3;
+		chunk.indexCount = ranges[r].count * 3;
+
+		float low[3] = { vertices[indices[triangles[ranges[r].first] * 3]].position[0],
+						 vertices[indices[triangles[ranges[r].first] * 3]].position[1],
+						 vertices[indices[triangles[ranges[r].first] * 3]].position[2] };
+		float high[3] = { low[0], low[1], low[2] };
+
+		for(unsigned int i = ranges[r].first; i < ranges[r].first + ranges[r].count; i++)
+		{
+			for(unsigned int corner = 0; corner < 3; corner++)
+			{
+				unsigned int index = indices[triangles[i] * 3 + corner];
+				chunkIndices[i * 3 + corner] = index;
+
+				for(unsigned int axis = 0; axis < 3; axis++)
+				{
+					low[axis] = std::min(low[axis], vertices[index].position[axis]);
+					high[axis] = std::max(high[axis], vertices[index].position[axis]);
+				}
+			}
+		}
+
+		chunk.boundsMin = wind::Vector3(low[0], low[1], low[2]);
+		chunk.boundsMax = wind::Vector3(high[0], high[1], high[2]);
+		chunks.push_back(chunk);
+	}
 }
 
-void Mesh::Draw()
+void Mesh::drawChunkBound(unsigned int index)
 {
-	glBindVertexArray(vertexArrayObject);
+	const MeshChunk& chunk = chunks[index];
+	glDrawElements(GL_TRIANGLES, chunk.indexCount, GL_UNSIGNED_INT, (const GLvoid*)(chunk.firstIndex * sizeof(unsigned int)));
+}
+
+void Mesh::setVertexFormat(wind::VertexFormat format)
+{
+	vertexFormat = format;
+}
 
-	glDrawElements(GL_TRIANGLES, drawCount, GL_UNSIGNED_INT, 0);
+void Mesh::bind()
+{
+	glBindVertexArray(vertexArrayObject);
+}
 
+void Mesh::unbind()
+{
 	glBindVertexArray(0);
 }
+
+unsigned int Mesh::selectLod(float distance, float lodScale, float pixelError) const
+{
+	return lods.empty() ? 0 : wind::selectMeshLod(&lods[0], lods.size(), distance, lodScale, pixelError);
+}
+
+void Mesh::setLod(unsigned int lod)
+{
+	drawLod = lod < lods.size() ? lod : 0;
+}
+
+void Mesh::drawBound()
+{
+	if(drawCount == 0)
+	{
+		return;
+	}
+
+	const wind::MeshLod& lod = lods[drawLod];
+	glDrawElements(GL_TRIANGLES, lod.indexCount, GL_UNSIGNED_INT, (const GLvoid*)(lod.firstIndex * sizeof(unsigned int)));
+}
+
+void Mesh::drawInstancedBound(unsigned int instanceCount, GLuint instanceBuffer, GLintptr offset, GLint location)
+{
+	if(drawCount == 0 || instanceCount == 0)
+	{
+		return;
+	}
+
+	//A mat4 attribute takes four locations, one for each column, and each moves on once per instance.
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	for(GLint i = 0; i < 4; i++)
+	{
+		glEnableVertexAttribArray(location + i);
+		glVertexAttribPointer(location + i, 4, GL_FLOAT, GL_FALSE, 16 * sizeof(GLfloat), (const GLvoid*)(offset + i * 4 * sizeof(GLfloat)));
+		wind::InstanceBuffer::setDivisor(location + i, 1);
+	}
+
+	const wind::MeshLod& lod = lods[drawLod];
+	glDrawElementsInstanced(GL_TRIANGLES, lod.indexCount, GL_UNSIGNED_INT, (const GLvoid*)(lod.firstIndex * sizeof(unsigned int)), instanceCount);
+}
+
+void Mesh::DrawInstanced(unsigned int instanceCount, GLuint instanceBuffer, GLintptr offset, GLint location)
+{
+	if(drawCount == 0 || instanceCount == 0)
+	{
+		return;
+	}
+
+	bind();
+	drawInstancedBound(instanceCount, instanceBuffer, offset, location);
+	unbind();
+}
+
+void Mesh::Draw()
+{
+	if(drawCount == 0)
+	{
+		return;
+	}
+
+	bind();
+	drawBound();
+	unbind();
+}
@@ -3,8 +3,16 @@
 
 #include <GL/glew.h>
 
-#include "../Physics/include/Polygon.h"
+#include "../Physics/CollisionSystem/collision_mesh.h"
 #include "OBJLoader.h"
+#include "CookedMesh.h"
+#include "VertexFormat.h"
+#include "InstanceBuffer.h"
+
+namespace wind
+{
+    class MeshManager;
+};
 
 class Vertex
 {
@@ -48,32 +56,87 @@ class Vertex
 		wind::Vector3 norm;
 };
 
+//A run of triangles that sit close together, big meshes are split into these so the parts off screen can be skipped.
+struct MeshChunk
+{
+	unsigned int firstIndex;
+	unsigned int indexCount;
+	wind::Vector3 boundsMin;
+	wind::Vector3 boundsMax;
+};
+
 class Mesh
 {
 	public:
-		Mesh(){}
+		Mesh() : vertexArrayObject(0), drawCount(0), drawLod(0) {}
 		Mesh(Vertex* vertices, unsigned int numVertices, unsigned int *indices, unsigned numInderices);
-		Mesh(const std::string& filePath, const wind::Vector3& size, std::vector<wind::Polygon*> &poly);
+		Mesh(const std::string& filePath, const wind::Vector3& size, wind::CollisionMesh &collision);
 		Mesh(const std::string& filePath, const wind::Vector3& size);
 		virtual ~Mesh();
 
-		void addMesh(const std::string& filePath, const wind::Vector3& size, std::vector<wind::Polygon*> &poly);
+		//This also builds the collision mesh from the same vertices and indices that go to the GPU.
+		void addMesh(const std::string& filePath, const wind::Vector3& size, wind::CollisionMesh &collision);
 		void addMesh(const std::string& filePath, const wind::Vector3& size);
 
+		//These give the vertices straight from the OBJ file, the file is only parsed the first time you ask.
 		std::vector<wind::Vector3> getAllVertices();
 		wind::Vector3 getFirstVertex();
 
+		//The box around the scaled mesh.
+		wind::Vector3 getBoundsMin() const { return boundsMin; }
+		wind::Vector3 getBoundsMax() const { return boundsMax; }
+
+		//A mesh from the MeshManager is empty until it has been loaded, an empty mesh draws nothing.
+		bool isLoaded() const { return vertexArrayObject != 0; }
+
+		//This sets the vertex layout for every mesh loaded after it, by default meshes are packed when their texcoords allow it.
+		static void setVertexFormat(wind::VertexFormat format);
+
 		void Draw();
+		//This draws the mesh once for each instance, the instance data is a model matrix for each instance.
+		//The matrix goes into the four attributes starting at location.
+		void DrawInstanced(unsigned int instanceCount, GLuint instanceBuffer, GLintptr offset, GLint location);
+
+		//These are for drawing the same mesh many times in a row, bind it once and then use the bound draws.
+		void bind();
+		static void unbind();
+		void drawBound();
+		void drawInstancedBound(unsigned int instanceCount, GLuint instanceBuffer, GLintptr offset, GLint location);
+
+		//Small meshes are a single chunk, bigger ones are split so each chunk can be culled on it's own.
+		unsigned int getChunkCount() const { return chunks.size(); }
+		const MeshChunk& getChunk(unsigned int index) const { return chunks[index]; }
+		void drawChunkBound(unsigned int index);
+
+		//Level zero is the full mesh, a cooked mesh also has simpler levels that share its vertices.
+		unsigned int getLodCount() const { return lods.size(); }
+		const wind::MeshLod& getLod(unsigned int index) const { return lods[index]; }
+		//This picks the simplest level that looks the same at that distance, see selectMeshLod.
+		unsigned int selectLod(float distance, float lodScale, float pixelError = 1.0f) const;
+		//The draws use this level until it is changed, chunks are only ever drawn from level zero.
+		void setLod(unsigned int lod);
+		unsigned int getDrawLod() const { return drawLod; }
 	private:
+		friend class wind::MeshManager;
 
 	    OBJModel model;
+	    std::string filePath;
+
+		void loadMesh(const std::string& filePath, const wind::Vector3& size);
 		void initMesh(const IndexedModel& model);
+		//The cooked vertices are already interleaved floats, so they go to the GPU as one buffer.
+		void initMesh(const wind::CookedMesh& cooked);
+		//The indices hold every level one after another, a mesh without levels passes none and is all level zero.
+		void uploadMesh(const wind::CookedVertex* vertices, unsigned int numVertices, const unsigned int* indices, unsigned int numIndices,
+						const wind::MeshLod* lodList, unsigned int lodCount);
+		//If the mesh needs more than one chunk the triangles are put in chunk order in chunkIndices, otherwise it is left empty.
+		void buildChunks(const wind::CookedVertex* vertices, const unsigned int* indices, unsigned int numIndices, std::vector<unsigned int>& chunkIndices);
+
+		static wind::VertexFormat vertexFormat;
 
 		enum
 		{
-			POSITION_VB,
-			TEXCOORD_VB,
-			NORMAL_VB,
+			VERTEX_VB,
 			INDEX_VB,
 
 			NUM_BUFFERS
@@ -83,6 +146,14 @@ class Mesh
 		GLuint vertexArrayBuffers[NUM_BUFFERS];
 
 		unsigned int drawCount;
+
+		wind::Vector3 boundsMin;
+		wind::Vector3 boundsMax;
+
+		std::vector<MeshChunk> chunks;
+
+		std::vector<wind::MeshLod> lods;
+		unsigned int drawLod;
 };
 
 #endif
@@ -0,0 +1,508 @@
+#include "MeshLod.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+#include "CookedMesh.h"
+
+namespace wind
+{
+
+namespace
+{
+    //Levels stop once there are this few triangles, there is nothing left to gain.
+    const unsigned MIN_LOD_TRIANGLES = 32;
+
+    //A level has to lose at least a quarter of the triangles of the one before to be worth keeping.
+    const float MIN_LOD_REDUCTION = 0.75f;
+
+    //Borders are held in place by a plane standing up along each border edge, this is how much it counts next to the faces.
+    const double BORDER_WEIGHT = 10.0;
+
+    enum VertexKind
+    {
+        //Inside a smooth part of the mesh, it can go onto any neighbour.
+        VERTEX_MANIFOLD,
+        //On an open edge, it can only slide along the edge.
+        VERTEX_BORDER,
+        //On a seam, a corner or anything odd, it never moves.
+        VERTEX_LOCKED
+    };
+
+    //This is a symmetric 4x4 matrix, only the top half is kept.
+    struct Quadric
+    {
+        double a00, a01, a02, a11, a12, a22;
+        double b0, b1, b2;
+        double c;
+        //The total weight of the planes, the error is divided by it so it stays in the mesh's units whatever its size.
+        double weight;
+    };
+
+    struct Collapse
+    {
+        double cost;
+        //The vertex that goes away and the vertex it goes onto.
+        std::uint32_t from;
+        std::uint32_t to;
+    };
+
+    void addPlane(Quadric &quadric, double nx, double ny, double nz, double d, double weight)
+    {
+        quadric.a00 += weight * nx * nx;
+        quadric.a01 += weight * nx * ny;
+        quadric.a02 += weight * nx * nz;
+        quadric.a11 += weight * ny * ny;
+        quadric.a12 += weight * ny * nz;
+        quadric.a22 += weight * nz * nz;
+        quadric.b0 += weight * nx * d;
+        quadric.b1 += weight * ny * d;
+        quadric.b2 += weight * nz * d;
+        quadric.c += weight * d * d;
+        quadric.weight += weight;
+    }
+
+    void addQuadric(Quadric &quadric, const Quadric &other)
+    {
+        quadric.a00 += other.a00;
+        quadric.a01 += other.a01;
+        quadric.a02 += other.a02;
+        quadric.a11 += other.a11;
+        quadric.a12 += other.a12;
+        quadric.a22 += other.a22;
+        quadric.b0 += other.b0;
+        quadric.b1 += other.b1;
+        quadric.b2 += other.b2;
+        quadric.c += other.c;
+        quadric.weight += other.weight;
+    }
+
+    //This is the weighted mean of the squared distances from the point to every plane in the quadric.
+    double evaluate(const Quadric &quadric, const float p[3])
+    {
+        if (quadric.weight <= 0.0)
+        {
+            return 0.0;
+        }
+
+        double x = p[0], y = p[1], z = p[2];
+        double result = quadric.a00 * x * x + quadric.a11 * y * y + quadric.a22 * z * z +
+                        2.0 * (quadric.a01 * x * y + quadric.a02 * x * z + quadric.a12 * y * z) +
+                        2.0 * (quadric.b0 * x + quadric.b1 * y + quadric.b2 * z) + quadric.c;
+        result /= quadric.weight;
+        return result > 0.0 ? result : 0.0;
+    }
+
+    void cross(const float a[3], const float b[3], const float c[3], double out[3])
+    {
+        double ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        double ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+        out[0] = ab[1] * ac[2] - ab[2] * ac[1];
+        out[1] = ab[2] * ac[0] - ab[0] * ac[2];
+        out[2] = ab[0] * ac[1] - ab[1] * ac[0];
+    }
+
+    std::uint64_t makeEdge(std::uint32_t a, std::uint32_t b)
+    {
+        return (static_cast<std::uint64_t>(a) << 32) | b;
+    }
+
+    void buildEdges(const std::vector<std::uint32_t> &indices, const std::vector<std::uint32_t> &remap,
+                    std::unordered_map<std::uint64_t, unsigned> &edges)
+    {
+        edges.clear();
+        edges.reserve(indices.size());
+        for (unsigned i = 0; i < indices.size(); i += 3)
+        {
+            for (unsigned corner = 0; corner < 3; corner++)
+            {
+                edges[makeEdge(remap[indices[i + corner]], remap[indices[i + (corner + 1) % 3]])]++;
+            }
+        }
+    }
+
+    //Every vertex is given the first vertex with the same position, that's the one all of its copies are simplified as.
+    void buildPositionRemap(const CookedVertex* vertices, unsigned vertexCount, std::vector<std::uint32_t> &remap,
+                            std::vector<unsigned> &copies)
+    {
+        remap.resize(vertexCount);
+        copies.assign(vertexCount, 0);
+
+        std::unordered_map<std::uint64_t, std::vector<std::uint32_t>> buckets;
+        buckets.reserve(vertexCount);
+        for (unsigned i = 0; i < vertexCount; i++)
+        {
+            std::uint32_t bits[3];
+            memcpy(bits, vertices[i].position, sizeof(bits));
+            std::uint64_t hash = (static_cast<std::uint64_t>(bits[0]) * 73856093ULL) ^
+                                 (static_cast<std::uint64_t>(bits[1]) * 19349663ULL) ^
+                                 (static_cast<std::uint64_t>(bits[2]) * 83492791ULL);
+
+            std::vector<std::uint32_t> &bucket = buckets[hash];
+            remap[i] = i;
+            for (unsigned j = 0; j < bucket.size(); j++)
+            {
+                if (memcmp(vertices[bucket[j]].position, vertices[i].position, sizeof(vertices[i].position)) == 0)
+                {
+                    remap[i] = bucket[j];
+                    break;
+                }
+            }
+
+            if (remap[i] == i)
+            {
+                bucket.push_back(i);
+            }
+            copies[remap[i]]++;
+        }
+    }
+}
+
+/******************************************************************************/
+float simplifyMesh(const CookedVertex* vertices, unsigned vertexCount, const std::uint32_t* indices, unsigned indexCount,
+                   unsigned targetIndexCount, float maxError, std::vector<std::uint32_t> &result)
+{
+    result.clear();
+
+    std::vector<std::uint32_t> remap;
+    std::vector<unsigned> copies;
+    buildPositionRemap(vertices, vertexCount, remap, copies);
+
+    //Triangles that are already flat on a line are dropped straight away.
+    for (unsigned i = 0; i + 2 < indexCount; i += 3)
+    {
+        std::uint32_t a = remap[indices[i]], b = remap[indices[i + 1]], c = remap[indices[i + 2]];
+        if (a != b && b != c && a != c)
+        {
+            result.insert(result.end(), indices + i, indices + i + 3);
+        }
+    }
+
+    if (result.size() <= targetIndexCount)
+    {
+        return 0.0f;
+    }
+
+    //An edge is on the border if no triangle goes the other way along it.
+    std::unordered_map<std::uint64_t, unsigned> edges;
+    buildEdges(result, remap, edges);
+
+    std::vector<unsigned> borderEdges(vertexCount, 0);
+    std::vector<unsigned char> nonManifold(vertexCount, 0);
+    for (std::unordered_map<std::uint64_t, unsigned>::const_iterator edge = edges.begin(); edge != edges.end(); ++edge)
+    {
+        std::uint32_t a = static_cast<std::uint32_t>(edge->first >> 32);
+        std::uint32_t b = static_cast<std::uint32_t>(edge->first);
+        std::unordered_map<std::uint64_t, unsigned>::const_iterator reverse = edges.find(makeEdge(b, a));
+
+        //An edge that more than two triangles share can't be simplified around, so both ends stay where they are.
+        if (edge->second > 1 || (reverse != edges.end() && reverse->second > 1))
+        {
+            nonManifold[a] = 1;
+            nonManifold[b] = 1;
+        }
+        else if (reverse == edges.end())
+        {
+            borderEdges[a]++;
+            borderEdges[b]++;
+        }
+    }
+
+    std::vector<unsigned char> kinds(vertexCount, VERTEX_LOCKED);
+    for (unsigned i = 0; i < vertexCount; i++)
+    {
+        if (remap[i] != i || copies[i] != 1 || nonManifold[i])
+        {
+            continue;
+        }
+
+        if (borderEdges[i] == 0)
+        {
+            kinds[i] = VERTEX_MANIFOLD;
+        }
+        else if (borderEdges[i] == 2)
+        {
+            kinds[i] = VERTEX_BORDER;
+        }
+    }
+
+    //Each vertex gets the planes of the triangles around it, weighted by their area so slivers don't count for much.
+    std::vector<Quadric> quadrics(vertexCount);
+    memset(&quadrics[0], 0, quadrics.size() * sizeof(Quadric));
+    for (unsigned i = 0; i < result.size(); i += 3)
+    {
+        const float* p[3] = { vertices[result[i]].position, vertices[result[i + 1]].position, vertices[result[i + 2]].position };
+
+        double normal[3];
+        cross(p[0], p[1], p[2], normal);
+        double length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if (length <= 0.0)
+        {
+            continue;
+        }
+
+        double area = length * 0.5;
+        double nx = normal[0] / length, ny = normal[1] / length, nz = normal[2] / length;
+        double d = -(nx * p[0][0] + ny * p[0][1] + nz * p[0][2]);
+
+        for (unsigned corner = 0; corner < 3; corner++)
+        {
+            addPlane(quadrics[remap[result[i + corner]]], nx, ny, nz, d, area);
+
+            //A border edge also gets a plane standing up along it, so collapsing along the border keeps it straight.
+            std::uint32_t a = remap[result[i + corner]], b = remap[result[i + (corner + 1) % 3]];
+            if (edges.count(makeEdge(b, a)) == 0)
+            {
+                const float* pa = p[corner];
+                const float* pb = p[(corner + 1) % 3];
+                double edge[3] = { pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2] };
+                double side[3] = { edge[1] * nz - edge[2] * ny, edge[2] * nx - edge[0] * nz, edge[0] * ny - edge[1] * nx };
+                double sideLength = std::sqrt(side[0] * side[0] + side[1] * side[1] + side[2] * side[2]);
+                if (sideLength > 0.0)
+                {
+                    double sx = side[0] / sideLength, sy = side[1] / sideLength, sz = side[2] / sideLength;
+                    double sd = -(sx * pa[0] + sy * pa[1] + sz * pa[2]);
+                    double weight = BORDER_WEIGHT * (edge[0] * edge[0] + edge[1] * edge[1] + edge[2] * edge[2]);
+                    addPlane(quadrics[a], sx, sy, sz, sd, weight);
+                    addPlane(quadrics[b], sx, sy, sz, sd, weight);
+                }
+            }
+        }
+    }
+
+    double maxCost = static_cast<double>(maxError) * maxError;
+    double worstCost = 0.0;
+
+    std::vector<unsigned> triangleStart(vertexCount + 1);
+    std::vector<unsigned> vertexTriangles;
+    std::vector<Collapse> collapses;
+    std::vector<unsigned char> touched(vertexCount);
+    std::vector<std::uint32_t> collapseTo(vertexCount);
+
+    //Each pass collapses every edge it can without two collapses touching the same triangles, then the mesh is rebuilt.
+    while (result.size() > targetIndexCount)
+    {
+        unsigned triangleCount = result.size() / 3;
+
+        //The triangles around each vertex, laid out one vertex after another.
+        std::fill(triangleStart.begin(), triangleStart.end(), 0);
+        for (unsigned i = 0; i < result.size(); i++)
+        {
+            triangleStart[remap[result[i]] + 1]++;
+        }
+        for (unsigned i = 0; i < vertexCount; i++)
+        {
+            triangleStart[i + 1] += triangleStart[i];
+        }
+        vertexTriangles.resize(result.size());
+        std::vector<unsigned> fill(triangleStart.begin(), triangleStart.end() - 1);
+        for (unsigned i = 0; i < result.size(); i++)
+        {
+            vertexTriangles[fill[remap[result[i]]]++] = i / 3;
+        }
+
+        //Collapses make new edges, so the border check needs the edges as they are now.
+        buildEdges(result, remap, edges);
+
+        collapses.clear();
+        for (unsigned i = 0; i < result.size(); i += 3)
+        {
+            for (unsigned corner = 0; corner < 3; corner++)
+            {
+                std::uint32_t ends[2] = { result[i + corner], result[i + (corner + 1) % 3] };
+                for (unsigned direction = 0; direction < 2; direction++)
+                {
+                    std::uint32_t from = remap[ends[direction]];
+                    std::uint32_t to = ends[1 - direction];
+                    std::uint32_t toPosition = remap[to];
+
+                    if (kinds[from] == VERTEX_LOCKED)
+                    {
+                        continue;
+                    }
+
+                    //A border vertex can only go along the border, or the outline would get pulled in.
+                    if (kinds[from] == VERTEX_BORDER && edges.count(makeEdge(from, toPosition)) + edges.count(makeEdge(toPosition, from)) != 1)
+                    {
+                        continue;
+                    }
+
+                    Quadric quadric = quadrics[from];
+                    addQuadric(quadric, quadrics[toPosition]);
+
+                    Collapse collapse = { evaluate(quadric, vertices[to].position), from, to };
+                    collapses.push_back(collapse);
+                }
+            }
+        }
+
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) { return a.cost < b.cost; });
+
+        std::fill(touched.begin(), touched.end(), 0);
+        for (unsigned i = 0; i < vertexCount; i++)
+        {
+            collapseTo[i] = i;
+        }
+
+        unsigned collapsed = 0;
+        for (unsigned c = 0; c < collapses.size() && triangleCount * 3 > targetIndexCount; c++)
+        {
+            const Collapse &collapse = collapses[c];
+            std::uint32_t from = collapse.from;
+            std::uint32_t toPosition = remap[collapse.to];
+
+            if (collapse.cost > maxCost)
+            {
+                break;
+            }
+
+            if (touched[from] || touched[toPosition])
+            {
+                continue;
+            }
+
+            //The collapse can't turn any of the triangles that are left over onto their back.
+            bool flips = false;
+            unsigned removed = 0;
+            for (unsigned t = triangleStart[from]; t < triangleStart[from + 1] && !flips; t++)
+            {
+                const std::uint32_t* triangle = &result[vertexTriangles[t] * 3];
+                std::uint32_t a = remap[triangle[0]], b = remap[triangle[1]], d = remap[triangle[2]];
+                if (a == toPosition || b == toPosition || d == toPosition)
+                {
+                    removed++;
+                    continue;
+                }
+
+                const float* before[3] = { vertices[triangle[0]].position, vertices[triangle[1]].position, vertices[triangle[2]].position };
+                const float* after[3] = { before[0], before[1], before[2] };
+                for (unsigned corner = 0; corner < 3; corner++)
+                {
+                    if (remap[triangle[corner]] == from)
+                    {
+                        after[corner] = vertices[collapse.to].position;
+                    }
+                }
+
+                double normalBefore[3], normalAfter[3];
+                cross(before[0], before[1], before[2], normalBefore);
+                cross(after[0], after[1], after[2], normalAfter);
+                flips = normalBefore[0] * normalAfter[0] + normalBefore[1] * normalAfter[1] + normalBefore[2] * normalAfter[2] <= 0.0;
+            }
+
+            if (flips)
+            {
+                continue;
+            }
+
+            //Everything around the vertex is changing, so none of it can be collapsed again until the next pass.
+            for (unsigned t = triangleStart[from]; t < triangleStart[from + 1]; t++)
+            {
+                const std::uint32_t* triangle = &result[vertexTriangles[t] * 3];
+                touched[remap[triangle[0]]] = 1;
+                touched[remap[triangle[1]]] = 1;
+                touched[remap[triangle[2]]] = 1;
+            }
+
+            collapseTo[from] = collapse.to;
+            addQuadric(quadrics[toPosition], quadrics[from]);
+            worstCost = std::max(worstCost, collapse.cost);
+            triangleCount -= removed;
+            collapsed++;
+        }
+
+        if (collapsed == 0)
+        {
+            break;
+        }
+
+        //The collapsed vertices are swapped for where they went and the triangles that closed up are dropped.
+        unsigned write = 0;
+        for (unsigned i = 0; i < result.size(); i += 3)
+        {
+            std::uint32_t triangle[3];
+            for (unsigned corner = 0; corner < 3; corner++)
+            {
+                std::uint32_t vertex = result[i + corner];
+                triangle[corner] = collapseTo[remap[vertex]] != remap[vertex] ? collapseTo[remap[vertex]] : vertex;
+            }
+
+            if (remap[triangle[0]] != remap[triangle[1]] && remap[triangle[1]] != remap[triangle[2]] && remap[triangle[0]] != remap[triangle[2]])
+            {
+                result[write++] = triangle[0];
+                result[write++] = triangle[1];
+                result[write++] = triangle[2];
+            }
+        }
+        result.resize(write);
+    }
+
+    return static_cast<float>(std::sqrt(worstCost));
+}
+
+/******************************************************************************/
+void buildMeshLods(const CookedVertex* vertices, unsigned vertexCount, const std::uint32_t* indices, unsigned indexCount,
+                   std::vector<std::uint32_t> &lodIndices, std::vector<MeshLod> &lods)
+{
+    lodIndices.assign(indices, indices + indexCount);
+    lods.clear();
+
+    MeshLod full = { 0, indexCount, 0.0f, 0 };
+    lods.push_back(full);
+
+    //Each level is made from the one before, which is quicker, so the errors are added up to stay on the safe side.
+    std::vector<std::uint32_t> previous(indices, indices + indexCount);
+    std::vector<std::uint32_t> simplified;
+    while (lods.size() < MAX_MESH_LODS && previous.size() / 3 >= MIN_LOD_TRIANGLES * 2)
+    {
+        unsigned target = previous.size() / 6 * 3;
+        float error = simplifyMesh(vertices, vertexCount, &previous[0], previous.size(), target, 1e30f, simplified);
+
+        if (simplified.empty() || simplified.size() > previous.size() * MIN_LOD_REDUCTION)
+        {
+            break;
+        }
+
+        MeshLod lod = { static_cast<std::uint32_t>(lodIndices.size()), static_cast<std::uint32_t>(simplified.size()),
+                        lods.back().error + error, 0 };
+        lods.push_back(lod);
+        lodIndices.insert(lodIndices.end(), simplified.begin(), simplified.end());
+        previous.swap(simplified);
+    }
+}
+
+/******************************************************************************/
+float getLodScale(real fovy, unsigned viewportHeight)
+{
+    return static_cast<float>(viewportHeight / (2.0 * std::tan(fovy / 2.0)));
+}
+
+/******************************************************************************/
+unsigned selectMeshLod(const MeshLod* lods, unsigned lodCount, float distance, float lodScale, float pixelError)
+{
+    for (unsigned i = lodCount; i > 1; i--)
+    {
+        if (lods[i - 1].error * lodScale <= pixelError * distance)
+        {
+            return i - 1;
+        }
+    }
+    return 0;
+}
+
+/******************************************************************************/
+float getBoundsDistance(const float boundsMin[3], const float boundsMax[3], const Vector3 &point)
+{
+    float p[3] = { static_cast<float>(point.x), static_cast<float>(point.y), static_cast<float>(point.z) };
+
+    float squared = 0.0f;
+    for (unsigned axis = 0; axis < 3; axis++)
+    {
+        float gap = std::max(std::max(boundsMin[axis] - p[axis], p[axis] - boundsMax[axis]), 0.0f);
+        squared += gap * gap;
+    }
+    return std::sqrt(squared);
+}
+}; //wind
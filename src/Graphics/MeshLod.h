@@ -0,0 +1,53 @@
+#ifndef MESH_LOD_H
+#define MESH_LOD_H
+
+#include <vector>
+#include <cstdint>
+
+#include "../Physics/include/Core.h"
+
+namespace wind
+{
+struct CookedVertex;
+
+//A mesh has at most this many levels of detail, level zero is the full mesh.
+const unsigned MAX_MESH_LODS = 4;
+
+//One level of detail, it is a run of the mesh's index buffer. Every level uses the same vertices.
+struct MeshLod
+{
+    std::uint32_t firstIndex;
+    std::uint32_t indexCount;
+    //How far, in the mesh's units, this level can be from the full mesh.
+    float error;
+    std::uint32_t reserved;
+};
+
+/**
+    These functions make the levels of detail for a mesh and pick which one to draw.
+    The simplifier collapses edges in the order that moves the surface the least, measured with quadric error metrics, and only
+    ever collapses a vertex onto one of its neighbours, so the simplified triangles index the same vertex buffer as the full mesh.
+    Vertices on a texture or normal seam and corners of open borders are never moved, so the outline and the seams stay put.
+*/
+
+//This simplifies the triangles until there are no more than targetIndexCount indices left, or until the next collapse would
+//move the surface further than maxError. It returns how far the result is from what it was given.
+float simplifyMesh(const CookedVertex* vertices, unsigned vertexCount, const std::uint32_t* indices, unsigned indexCount,
+                   unsigned targetIndexCount, float maxError, std::vector<std::uint32_t> &result);
+
+//This builds every level for a mesh, each one has about half the triangles of the one before. The levels are written one
+//after another into lodIndices, with level zero being the indices as they were given.
+void buildMeshLods(const CookedVertex* vertices, unsigned vertexCount, const std::uint32_t* indices, unsigned indexCount,
+                   std::vector<std::uint32_t> &lodIndices, std::vector<MeshLod> &lods);
+
+//This is how many pixels something one unit across covers when it is one unit from the camera, on a screen that many pixels high.
+float getLodScale(real fovy, unsigned viewportHeight);
+
+//This picks the coarsest level whose error would cover no more than pixelError pixels at that distance.
+unsigned selectMeshLod(const MeshLod* lods, unsigned lodCount, float distance, float lodScale, float pixelError);
+
+//The distance from a point to the closest point of a box, it is zero inside the box.
+float getBoundsDistance(const float boundsMin[3], const float boundsMax[3], const Vector3 &point);
+}; //wind
+
+#endif
@@ -0,0 +1,264 @@
+#include "MeshManager.h"
+
+namespace wind
+{
+
+/******************************************************************************/
+MeshManager::MeshManager() : _stop(false)
+{
+}
+
+/******************************************************************************/
+MeshManager::~MeshManager()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+        _queue.clear();
+    }
+    _wake.notify_all();
+
+    if (_worker.joinable())
+    {
+        _worker.join();
+    }
+}
+
+/******************************************************************************/
+std::shared_ptr<Mesh> MeshManager::load(const std::string &filePath, const Vector3 &scale)
+{
+    MeshKey key = makeKey(filePath, scale);
+
+    std::map<MeshKey, std::weak_ptr<Mesh>>::iterator found = _meshes.find(key);
+    if (found != _meshes.end())
+    {
+        std::shared_ptr<Mesh> mesh = found->second.lock();
+        if (mesh)
+        {
+            //If it is still loading in the background we have to wait for it.
+            if (_pending.count(key))
+            {
+                finish();
+            }
+            return mesh;
+        }
+    }
+
+    MeshJob job;
+    job.filePath = filePath;
+    job.scale = scale;
+    job.mesh = std::make_shared<Mesh>();
+
+    loadJob(job);
+    uploadJob(job);
+
+    _meshes[key] = job.mesh;
+    return job.mesh;
+}
+
+/******************************************************************************/
+std::shared_ptr<Mesh> MeshManager::loadAsync(const std::string &filePath, const Vector3 &scale, LoadCallback callback)
+{
+    MeshKey key = makeKey(filePath, scale);
+
+    std::map<MeshKey, std::weak_ptr<Mesh>>::iterator found = _meshes.find(key);
+    if (found != _meshes.end())
+    {
+        std::shared_ptr<Mesh> mesh = found->second.lock();
+        if (mesh)
+        {
+            std::map<MeshKey, std::shared_ptr<MeshJob>>::iterator pending = _pending.find(key);
+            if (pending != _pending.end())
+            {
+                if (callback)
+                {
+                    pending->second->callbacks.push_back(callback);
+                }
+            }
+            else if (callback)
+            {
+                callback(mesh, mesh->isLoaded());
+            }
+
+            return mesh;
+        }
+    }
+
+    std::shared_ptr<MeshJob> job = std::make_shared<MeshJob>();
+    job->filePath = filePath;
+    job->scale = scale;
+    job->mesh = std::make_shared<Mesh>();
+    job->loaded = false;
+    if (callback)
+    {
+        job->callbacks.push_back(callback);
+    }
+
+    _meshes[key] = job->mesh;
+    _pending[key] = job;
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _queue.push_back(job);
+
+        //The thread is only started the first time we need it.
+        if (!_worker.joinable())
+        {
+            _worker = std::thread(&MeshManager::workerLoop, this);
+        }
+    }
+    _wake.notify_one();
+
+    return job->mesh;
+}
+
+/******************************************************************************/
+void MeshManager::update()
+{
+    std::vector<std::shared_ptr<MeshJob>> finished;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        finished.swap(_finished);
+    }
+
+    for (unsigned i = 0; i < finished.size(); i++)
+    {
+        MeshJob &job = *finished[i];
+        uploadJob(job);
+
+        //The job is removed before the callbacks run so a callback can load more meshes.
+        //If every handle was dropped while it loaded the same mesh may have been asked for again, so we only remove our own job.
+        std::map<MeshKey, std::shared_ptr<MeshJob>>::iterator pending = _pending.find(makeKey(job.filePath, job.scale));
+        if (pending != _pending.end() && pending->second == finished[i])
+        {
+            _pending.erase(pending);
+        }
+
+        std::vector<LoadCallback> callbacks;
+        callbacks.swap(job.callbacks);
+        for (unsigned j = 0; j < callbacks.size(); j++)
+        {
+            callbacks[j](job.mesh, job.mesh->isLoaded());
+        }
+    }
+}
+
+/******************************************************************************/
+void MeshManager::finish()
+{
+    while (!_pending.empty())
+    {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _done.wait(lock, [this]{ return !_finished.empty(); });
+        }
+
+        update();
+    }
+}
+
+/******************************************************************************/
+unsigned MeshManager::getMeshCount()
+{
+    //Meshes nobody uses any more are forgotten here.
+    for (std::map<MeshKey, std::weak_ptr<Mesh>>::iterator it = _meshes.begin(); it != _meshes.end();)
+    {
+        if (it->second.expired())
+        {
+            it = _meshes.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    return _meshes.size();
+}
+
+/******************************************************************************/
+unsigned MeshManager::getPendingCount() const
+{
+    return _pending.size();
+}
+
+/******************************************************************************/
+MeshManager::MeshKey MeshManager::makeKey(const std::string &filePath, const Vector3 &scale)
+{
+    //The scale is keyed as floats, the same as the cooked file it comes from.
+    return MeshKey(filePath, static_cast<float>(scale.x), static_cast<float>(scale.y), static_cast<float>(scale.z));
+}
+
+/******************************************************************************/
+void MeshManager::loadJob(MeshJob &job)
+{
+    job.loaded = false;
+
+    job.cooked.reset(new CookedMesh());
+    if (job.cooked->load(job.filePath, job.scale))
+    {
+        job.loaded = true;
+        return;
+    }
+    job.cooked.reset();
+
+    //If it couldn't be cooked we still load the OBJ, the cooker has already said why it failed.
+    MappedFile source(job.filePath);
+    OBJModel model;
+    if (source.isOpen() && model.parse(source.getData(), source.getSize(), false))
+    {
+        job.model = model.ToIndexedModel(job.scale);
+        job.loaded = true;
+    }
+}
+
+/******************************************************************************/
+void MeshManager::uploadJob(MeshJob &job)
+{
+    if (!job.loaded)
+    {
+        return;
+    }
+
+    if (job.cooked)
+    {
+        job.mesh->initMesh(*job.cooked);
+        job.cooked.reset();
+    }
+    else
+    {
+        job.mesh->initMesh(job.model);
+        job.model = IndexedModel();
+    }
+
+    job.mesh->filePath = job.filePath;
+}
+
+/******************************************************************************/
+void MeshManager::workerLoop()
+{
+    while (true)
+    {
+        std::shared_ptr<MeshJob> job;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [this]{ return _stop || !_queue.empty(); });
+            if (_stop)
+            {
+                return;
+            }
+
+            job = _queue.front();
+            _queue.pop_front();
+        }
+
+        loadJob(*job);
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _finished.push_back(job);
+        }
+        _done.notify_all();
+    }
+}
+}; //wind
@@ -0,0 +1,88 @@
+#ifndef MESH_MANAGER_H
+#define MESH_MANAGER_H
+
+#include <string>
+#include <map>
+#include <tuple>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "Mesh.h"
+
+namespace wind
+{
+/**
+    This class hands out shared meshes, every file and scale is only ever loaded once no matter how many objects use it.
+    The manager only keeps weak handles, so a mesh and its GPU buffers are freed when the last object using it goes.
+    Meshes can be loaded on a background thread, the thread does the file work and the GPU upload happens in update() on the thread with the GL context.
+*/
+class MeshManager
+{
+public:
+    //The bool is false if the mesh couldn't be loaded, the mesh is then left empty and draws nothing.
+    using LoadCallback = std::function<void(const std::shared_ptr<Mesh>&, bool)>;
+
+    MeshManager();
+    ~MeshManager();
+
+    //This function loads the mesh right away if it isn't already loaded.
+    std::shared_ptr<Mesh> load(const std::string &filePath, const Vector3 &scale = Vector3(1.0, 1.0, 1.0));
+
+    //This returns the handle straight away, the mesh draws nothing until it is ready.
+    //The callback is run from update() once the mesh is ready, or right away if it already is.
+    std::shared_ptr<Mesh> loadAsync(const std::string &filePath, const Vector3 &scale = Vector3(1.0, 1.0, 1.0), LoadCallback callback = LoadCallback());
+
+    //This function needs to be called on the GL thread every frame, it uploads any meshes that have finished loading.
+    void update();
+    //This waits for every background load and uploads them.
+    void finish();
+
+    //How many different meshes are alive and how many loads haven't been uploaded yet.
+    unsigned getMeshCount();
+    unsigned getPendingCount() const;
+
+private:
+    MeshManager(const MeshManager&);
+    MeshManager& operator=(const MeshManager&);
+
+    using MeshKey = std::tuple<std::string, float, float, float>;
+
+    struct MeshJob
+    {
+        std::string filePath;
+        Vector3 scale;
+        std::shared_ptr<Mesh> mesh;
+        std::vector<LoadCallback> callbacks;
+
+        //These are filled in by the loading thread.
+        std::unique_ptr<CookedMesh> cooked;
+        IndexedModel model;
+        bool loaded;
+    };
+
+    static MeshKey makeKey(const std::string &filePath, const Vector3 &scale);
+    static void loadJob(MeshJob &job);
+    static void uploadJob(MeshJob &job);
+
+    void workerLoop();
+
+    std::map<MeshKey, std::weak_ptr<Mesh>> _meshes;
+    std::map<MeshKey, std::shared_ptr<MeshJob>> _pending;
+
+    //The queue to the loading thread and the jobs it has finished, both are guarded by the mutex.
+    std::deque<std::shared_ptr<MeshJob>> _queue;
+    std::vector<std::shared_ptr<MeshJob>> _finished;
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _done;
+    std::thread _worker;
+    bool _stop;
+};
+}; //wind
+
+#endif
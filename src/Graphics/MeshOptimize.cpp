@@ -0,0 +1,372 @@
+#include "MeshOptimize.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "CookedMesh.h"
+
+namespace wind
+{
+
+namespace
+{
+    //These are the numbers from Forsyth's paper, the cache is a bit bigger than any real one so it also works on a smaller one.
+    const unsigned FORSYTH_CACHE_SIZE = 32;
+    const float CACHE_DECAY_POWER = 1.5f;
+    //The last triangle's vertices get a fixed score so the next one doesn't just go back and forth on the same edge.
+    const float LAST_TRIANGLE_SCORE = 0.75f;
+    //Vertices with only a few triangles left get a boost so they are finished off and don't leave lone triangles behind.
+    const float VALENCE_BOOST_SCALE = 2.0f;
+    const float VALENCE_BOOST_POWER = 0.5f;
+
+    const std::uint32_t NO_VERTEX = 0xffffffff;
+
+    float getVertexScore(int cachePosition, unsigned remaining)
+    {
+        //A vertex with nothing left to draw should never pull a triangle in.
+        if (remaining == 0)
+        {
+            return -1.0f;
+        }
+
+        float score = 0.0f;
+        if (cachePosition >= 0)
+        {
+            if (cachePosition < 3)
+            {
+                score = LAST_TRIANGLE_SCORE;
+            }
+            else
+            {
+                float scale = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+                score = std::pow(1.0f - (cachePosition - 3) * scale, CACHE_DECAY_POWER);
+            }
+        }
+
+        return score + VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remaining), -VALENCE_BOOST_POWER);
+    }
+
+    //This runs the triangles through a FIFO cache, each vertex remembers when it went in so nothing has to be shifted.
+    class FifoCache
+    {
+    public:
+        FifoCache(unsigned vertexCount, unsigned cacheSize) : _stamps(vertexCount, 0), _time(cacheSize + 1), _cacheSize(cacheSize) {}
+
+        //This returns true if the vertex had to be transformed.
+        bool add(std::uint32_t vertex)
+        {
+            if (_time - _stamps[vertex] <= _cacheSize)
+            {
+                return false;
+            }
+
+            _stamps[vertex] = _time++;
+            return true;
+        }
+
+    private:
+        std::vector<unsigned> _stamps;
+        unsigned _time;
+        unsigned _cacheSize;
+    };
+
+    struct Cluster
+    {
+        unsigned firstTriangle;
+        unsigned triangleCount;
+        float sortKey;
+    };
+}
+
+/******************************************************************************/
+void optimizeVertexCache(std::uint32_t* indices, unsigned indexCount, unsigned vertexCount)
+{
+    unsigned triangleCount = indexCount / 3;
+    if (triangleCount < 2)
+    {
+        return;
+    }
+
+    //Each vertex gets the list of triangles that use it, the ones still to be drawn are kept at the front of its list.
+    std::vector<unsigned> remaining(vertexCount, 0);
+    for (unsigned i = 0; i < triangleCount * 3; i++)
+    {
+        remaining[indices[i]]++;
+    }
+
+    std::vector<unsigned> adjacencyStart(vertexCount + 1, 0);
+    for (unsigned v = 0; v < vertexCount; v++)
+    {
+        adjacencyStart[v + 1] = adjacencyStart[v] + remaining[v];
+    }
+
+    std::vector<unsigned> adjacency(triangleCount * 3);
+    std::vector<unsigned> filled(adjacencyStart.begin(), adjacencyStart.end() - 1);
+    for (unsigned i = 0; i < triangleCount * 3; i++)
+    {
+        adjacency[filled[indices[i]]++] = i / 3;
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (unsigned v = 0; v < vertexCount; v++)
+    {
+        vertexScore[v] = getVertexScore(-1, remaining[v]);
+    }
+
+    std::vector<float> triangleScore(triangleCount);
+    int best = 0;
+    for (unsigned t = 0; t < triangleCount; t++)
+    {
+        triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+        if (triangleScore[t] > triangleScore[best])
+        {
+            best = t;
+        }
+    }
+
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<std::uint32_t> result(triangleCount * 3);
+
+    //The cache can go three over while a triangle is added, the ones past the end are the ones that just fell out.
+    std::uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+    std::uint32_t newCache[FORSYTH_CACHE_SIZE + 3];
+    unsigned cacheCount = 0;
+    unsigned cursor = 0;
+
+    for (unsigned out = 0; out < triangleCount; out++)
+    {
+        //If nothing in the cache has a triangle left we start again from the first triangle that hasn't been drawn.
+        if (best < 0)
+        {
+            while (emitted[cursor])
+            {
+                cursor++;
+            }
+            best = cursor;
+        }
+
+        const std::uint32_t* triangle = &indices[best * 3];
+        emitted[best] = true;
+
+        unsigned newCount = 0;
+        for (unsigned corner = 0; corner < 3; corner++)
+        {
+            std::uint32_t vertex = triangle[corner];
+            result[out * 3 + corner] = vertex;
+
+            //The triangle is swapped to the back of the vertex's live list and dropped off it.
+            unsigned* begin = &adjacency[adjacencyStart[vertex]];
+            unsigned* found = std::find(begin, begin + remaining[vertex], static_cast<unsigned>(best));
+            std::swap(*found, begin[remaining[vertex] - 1]);
+            remaining[vertex]--;
+
+            if (std::find(newCache, newCache + newCount, vertex) == newCache + newCount)
+            {
+                newCache[newCount++] = vertex;
+            }
+        }
+
+        for (unsigned i = 0; i < cacheCount; i++)
+        {
+            if (std::find(newCache, newCache + newCount, cache[i]) == newCache + newCount)
+            {
+                newCache[newCount++] = cache[i];
+            }
+        }
+
+        //Every vertex that moved in the cache gets a new score, and the change is passed on to its triangles.
+        for (unsigned i = 0; i < newCount; i++)
+        {
+            std::uint32_t vertex = newCache[i];
+            int position = i < FORSYTH_CACHE_SIZE ? static_cast<int>(i) : -1;
+            cachePosition[vertex] = position;
+
+            float score = getVertexScore(position, remaining[vertex]);
+            float change = score - vertexScore[vertex];
+            vertexScore[vertex] = score;
+
+            const unsigned* live = &adjacency[adjacencyStart[vertex]];
+            for (unsigned j = 0; j < remaining[vertex]; j++)
+            {
+                triangleScore[live[j]] += change;
+            }
+        }
+
+        cacheCount = std::min(newCount, FORSYTH_CACHE_SIZE);
+        std::copy(newCache, newCache + cacheCount, cache);
+
+        //The next triangle is the best one that uses something in the cache.
+        best = -1;
+        float bestScore = -1.0f;
+        for (unsigned i = 0; i < cacheCount; i++)
+        {
+            std::uint32_t vertex = cache[i];
+            const unsigned* live = &adjacency[adjacencyStart[vertex]];
+            for (unsigned j = 0; j < remaining[vertex]; j++)
+            {
+                if (triangleScore[live[j]] > bestScore)
+                {
+                    bestScore = triangleScore[live[j]];
+                    best = live[j];
+                }
+            }
+        }
+    }
+
+    std::copy(result.begin(), result.end(), indices);
+}
+
+/******************************************************************************/
+void optimizeOverdraw(std::uint32_t* indices, unsigned indexCount, const CookedVertex* vertices, unsigned vertexCount)
+{
+    unsigned triangleCount = indexCount / 3;
+    if (triangleCount < 2)
+    {
+        return;
+    }
+
+    //A cluster starts where all three of a triangle's vertices miss the cache, so moving it costs nothing.
+    std::vector<Cluster> clusters;
+    FifoCache fifo(vertexCount, ACMR_CACHE_SIZE);
+    for (unsigned t = 0; t < triangleCount; t++)
+    {
+        unsigned misses = fifo.add(indices[t * 3]) + fifo.add(indices[t * 3 + 1]) + fifo.add(indices[t * 3 + 2]);
+        if (t == 0 || misses == 3)
+        {
+            clusters.push_back(Cluster{ t, 0, 0.0f });
+        }
+        clusters.back().triangleCount++;
+    }
+
+    if (clusters.size() < 2)
+    {
+        return;
+    }
+
+    //Each cluster gets its area weighted centre and normal, the triangle normals are left at twice their area to do the weighting.
+    std::vector<float> centres(clusters.size() * 3, 0.0f);
+    std::vector<float> normals(clusters.size() * 3, 0.0f);
+    std::vector<float> areas(clusters.size(), 0.0f);
+    float meshCentre[3] = { 0.0f, 0.0f, 0.0f };
+    float meshArea = 0.0f;
+
+    for (unsigned c = 0; c < clusters.size(); c++)
+    {
+        for (unsigned t = clusters[c].firstTriangle; t < clusters[c].firstTriangle + clusters[c].triangleCount; t++)
+        {
+            const float* a = vertices[indices[t * 3]].position;
+            const float* b = vertices[indices[t * 3 + 1]].position;
+            const float* d = vertices[indices[t * 3 + 2]].position;
+
+            float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+            float ad[3] = { d[0] - a[0], d[1] - a[1], d[2] - a[2] };
+            float normal[3] = { ab[1] * ad[2] - ab[2] * ad[1], ab[2] * ad[0] - ab[0] * ad[2], ab[0] * ad[1] - ab[1] * ad[0] };
+            float area = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+            for (unsigned axis = 0; axis < 3; axis++)
+            {
+                centres[c * 3 + axis] += (a[axis] + b[axis] + d[axis]) / 3.0f * area;
+                normals[c * 3 + axis] += normal[axis];
+            }
+            areas[c] += area;
+        }
+
+        for (unsigned axis = 0; axis < 3; axis++)
+        {
+            meshCentre[axis] += centres[c * 3 + axis];
+        }
+        meshArea += areas[c];
+    }
+
+    if (meshArea <= 0.0f)
+    {
+        return;
+    }
+
+    for (unsigned axis = 0; axis < 3; axis++)
+    {
+        meshCentre[axis] /= meshArea;
+    }
+
+    //The further a cluster faces out from the centre of the mesh the sooner it is drawn.
+    for (unsigned c = 0; c < clusters.size(); c++)
+    {
+        const float* normal = &normals[c * 3];
+        float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if (areas[c] <= 0.0f || length <= 0.0f)
+        {
+            continue;
+        }
+
+        float key = 0.0f;
+        for (unsigned axis = 0; axis < 3; axis++)
+        {
+            key += (centres[c * 3 + axis] / areas[c] - meshCentre[axis]) * normal[axis];
+        }
+        clusters[c].sortKey = key / length;
+    }
+
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster &a, const Cluster &b)
+    {
+        return a.sortKey > b.sortKey;
+    });
+
+    std::vector<std::uint32_t> result;
+    result.reserve(triangleCount * 3);
+    for (unsigned c = 0; c < clusters.size(); c++)
+    {
+        result.insert(result.end(), indices + clusters[c].firstTriangle * 3,
+                      indices + (clusters[c].firstTriangle + clusters[c].triangleCount) * 3);
+    }
+
+    std::copy(result.begin(), result.end(), indices);
+}
+
+/******************************************************************************/
+unsigned optimizeVertexFetch(CookedVertex* vertices, unsigned vertexCount, std::uint32_t* indices, unsigned indexCount)
+{
+    std::vector<std::uint32_t> remap(vertexCount, NO_VERTEX);
+    unsigned used = 0;
+    for (unsigned i = 0; i < indexCount; i++)
+    {
+        std::uint32_t &index = remap[indices[i]];
+        if (index == NO_VERTEX)
+        {
+            index = used++;
+        }
+        indices[i] = index;
+    }
+
+    std::vector<CookedVertex> original(vertices, vertices + vertexCount);
+    for (unsigned v = 0; v < vertexCount; v++)
+    {
+        if (remap[v] != NO_VERTEX)
+        {
+            vertices[remap[v]] = original[v];
+        }
+    }
+
+    return used;
+}
+
+/******************************************************************************/
+float getMeshAcmr(const std::uint32_t* indices, unsigned indexCount, unsigned vertexCount, unsigned cacheSize)
+{
+    unsigned triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+    {
+        return 0.0f;
+    }
+
+    FifoCache fifo(vertexCount, cacheSize);
+    unsigned misses = 0;
+    for (unsigned i = 0; i < triangleCount * 3; i++)
+    {
+        misses += fifo.add(indices[i]);
+    }
+
+    return static_cast<float>(misses) / triangleCount;
+}
+}; //wind
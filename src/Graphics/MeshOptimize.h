@@ -0,0 +1,37 @@
+#ifndef MESH_OPTIMIZE_H
+#define MESH_OPTIMIZE_H
+
+#include <cstdint>
+
+namespace wind
+{
+struct CookedVertex;
+
+//The size of the FIFO cache the ACMR is measured with, most GPUs keep about this many transformed vertices.
+const unsigned ACMR_CACHE_SIZE = 16;
+
+/**
+    These functions reorder a mesh so the GPU does less work drawing it, none of them change what is drawn.
+    The triangles are put in the order that reuses the most transformed vertices, using Tom Forsyth's linear speed
+    vertex cache optimisation. They are then grouped into clusters that start on a cold cache, and the clusters
+    that face out from the middle of the mesh are moved first so they hide more of the rest, which cuts overdraw
+    without costing any cache misses. Last the vertices are put in the order the triangles first use them.
+*/
+
+//This reorders the triangles in place for the vertex cache, vertexCount is how many vertices the indices can use.
+void optimizeVertexCache(std::uint32_t* indices, unsigned indexCount, unsigned vertexCount);
+
+//This reorders whole clusters of triangles so the outside of the mesh is drawn first, it keeps the order inside each cluster.
+//It should be run after optimizeVertexCache, the clusters come from where its order starts on a cold cache.
+void optimizeOverdraw(std::uint32_t* indices, unsigned indexCount, const CookedVertex* vertices, unsigned vertexCount);
+
+//This puts the vertices in the order the indices first use them and points the indices at the new places.
+//Vertices that no index uses are dropped, it returns how many vertices are left.
+unsigned optimizeVertexFetch(CookedVertex* vertices, unsigned vertexCount, std::uint32_t* indices, unsigned indexCount);
+
+//The average cache miss ratio, how many vertices are transformed for each triangle with a FIFO cache of that size.
+//Three is as bad as it gets, a large regular grid gets close to a half.
+float getMeshAcmr(const std::uint32_t* indices, unsigned indexCount, unsigned vertexCount, unsigned cacheSize = ACMR_CACHE_SIZE);
+}; //wind
+
+#endif
@@ -1,531 +1,564 @@
 #include "OBJLoader.h"
-#include <fstream>
+#include "MappedFile.h"
+#include "../Physics/include/parallel.h"
 #include <iostream>
-#include <algorithm>
-#include <map>
+#include <cstring>
+#include <cmath>
 
-static bool CompareOBJIndexPtr(const OBJIndex* a, const OBJIndex* b);
-static inline unsigned int FindNextChar(unsigned int start, const char* str, unsigned int length, char token);
-static inline unsigned int ParseOBJIndexValue(const std::string& token, unsigned int start, unsigned int end);
-static inline float ParseOBJFloatValue(const std::string& token, unsigned int start, unsigned int end);
-static inline std::vector<std::string> SplitString(const std::string &s, char delim);
-
-OBJModel::OBJModel(const std::string& fileName, const bool isStatic)
+namespace
 {
-	hasUVs = false;
-	hasNormals = false;
-    std::ifstream file;
-    file.open(fileName.c_str());
-
-    std::string line;
-    if(file.is_open())
+    //A face corner straight out of the file, the values are still as they were written.
+    //Negative values count back from the last one read, so the chunk's counts when the corner was read are kept with them.
+    //They are fixed up once we know where the chunk starts.
+    struct OBJRawIndex
     {
-        while(file.good())
-        {
-            getline(file, line);
-
-            unsigned int lineLength = line.length();
-
-            if(lineLength < 2)
-			{
-                continue;
-			}
-
-            const char* lineCStr = line.c_str();
-
-            switch(lineCStr[0])
-            {
-                case 'v':
-                    if(lineCStr[1] == 't')
-					{
-                        uvs.push_back(ParseOBJVec2(line));
-					}
-                    else if(lineCStr[1] == 'n')
-					{
-                        normals.push_back(ParseOBJVec3(line));
-					}
-                    else if(lineCStr[1] == ' ' || lineCStr[1] == '\t')
-					{
-                        vertices.push_back(ParseOBJVec3(line));
-					}
-                break;
-
-                case 'f':
-                    CreateOBJFace(line, isStatic);
-                break;
+        int vertexIndex;
+        int uvIndex;
+        int normalIndex;
+        unsigned vertexCount;
+        unsigned uvCount;
+        unsigned normalCount;
+    };
+
+    //Everything one chunk of the file holds.
+    struct OBJChunk
+    {
+        std::vector<wind::Vector3> vertices;
+        std::vector<wind::Vector2> uvs;
+        std::vector<wind::Vector3> normals;
+        std::vector<OBJRawIndex> indices;
+        bool hasUVs;
+        bool hasNormals;
+    };
+
+    //We only split the file up if each chunk gets at least this many bytes.
+    const unsigned MIN_CHUNK_SIZE = 1 << 20;
+
+    const double POWERS_OF_TEN[] =
+    {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
 
-                default:
-					break;
-            };
-        }
-    }
-    else
+    inline bool IsSpace(char c)
     {
-        std::cerr << "Unable to load mesh: " << fileName << std::endl;
+        return c == ' ' || c == '\t' || c == '\r';
     }
-}
 
-void OBJModel::buildModel(const std::string& fileName, const bool isStatic)
-{
-    hasUVs = false;
-	hasNormals = false;
-    std::ifstream file;
-    file.open(fileName.c_str());
+    inline bool IsDigit(char c)
+    {
+        return static_cast<unsigned>(c - '0') < 10;
+    }
 
-    std::string line;
-    if(file.is_open())
+    inline const char* SkipSpace(const char* p, const char* end)
     {
-        while(file.good())
+        while (p < end && IsSpace(*p))
         {
-            getline(file, line);
-
-            unsigned int lineLength = line.length();
-
-            if(lineLength < 2)
-			{
-                continue;
-			}
-
-            const char* lineCStr = line.c_str();
-
-            switch(lineCStr[0])
-            {
-                case 'v':
-                    if(lineCStr[1] == 't')
-					{
-                        uvs.push_back(ParseOBJVec2(line));
-					}
-                    else if(lineCStr[1] == 'n')
-					{
-                        normals.push_back(ParseOBJVec3(line));
-					}
-                    else if(lineCStr[1] == ' ' || lineCStr[1] == '\t')
-					{
-                        vertices.push_back(ParseOBJVec3(line));
-					}
-                break;
-
-                case 'f':
-                    CreateOBJFace(line, isStatic);
-                break;
-
-                default:
-					break;
-            };
+            p++;
         }
+        return p;
     }
-    else
+
+    inline const char* NextLine(const char* p, const char* end)
     {
-        std::cerr << "Unable to load mesh: " << fileName << std::endl;
+        const char* newLine = static_cast<const char*>(memchr(p, '\n', end - p));
+        return newLine ? newLine + 1 : end;
     }
-}
 
-void IndexedModel::CalcNormals()
-{
-    for(unsigned int i = 0; i < indices.size(); i += 3)
+    //This parses a number like 1, -2.5, .5 or 1.5e-3. We build the digits up as an integer and scale once at the end.
+    //Up to 19 digits fit in the integer, any more only move the exponent.
+    const char* ParseFloat(const char* p, const char* end, double* value)
     {
-        int i0 = indices[i];
-        int i1 = indices[i + 1];
-        int i2 = indices[i + 2];
-
-        wind::Vector3 v1 = positions[i1] - positions[i0];
-        wind::Vector3 v2 = positions[i2] - positions[i0];
+        p = SkipSpace(p, end);
 
-        wind::Vector3 normal = (v1 % v2);
-		normal.normalise();
-
-        normals[i0] += normal;
-        normals[i1] += normal;
-        normals[i2] += normal;
-    }
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+        {
+            negative = (*p == '-');
+            p++;
+        }
 
-    for(unsigned int i = 0; i < positions.size(); i++)
-	{
-        normals[i].normalise();
-	}
-}
+        unsigned long long mantissa = 0;
+        int exponent = 0;
+        int digits = 0;
 
-IndexedModel OBJModel::ToIndexedModel(const wind::Vector3& Size)
-{
-    IndexedModel result;
-    IndexedModel normalModel;
+        while (p < end && IsDigit(*p))
+        {
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += (mantissa != 0);
+            }
+            else
+            {
+                exponent++;
+            }
+            p++;
+        }
 
-    unsigned int numIndices = OBJIndices.size();
+        if (p < end && *p == '.')
+        {
+            p++;
+            while (p < end && IsDigit(*p))
+            {
+                if (digits < 19)
+                {
+                    mantissa = mantissa * 10 + (*p - '0');
+                    digits += (mantissa != 0);
+                    exponent--;
+                }
+                p++;
+            }
+        }
 
-    std::vector<OBJIndex*> indexLookup;
+        if (p < end && (*p == 'e' || *p == 'E'))
+        {
+            p++;
+            bool negativeExponent = false;
+            if (p < end && (*p == '-' || *p == '+'))
+            {
+                negativeExponent = (*p == '-');
+                p++;
+            }
 
-    for(unsigned int i = 0; i < numIndices; i++)
-	{
-        indexLookup.push_back(&OBJIndices[i]);
-	}
+            int e = 0;
+            while (p < end && IsDigit(*p))
+            {
+                e = (e < 10000) ? e * 10 + (*p - '0') : e;
+                p++;
+            }
+            exponent += negativeExponent ? -e : e;
+        }
 
-    std::sort(indexLookup.begin(), indexLookup.end(), CompareOBJIndexPtr);
+        double result = static_cast<double>(mantissa);
+        if (exponent < 0)
+        {
+            result = (exponent >= -22) ? result / POWERS_OF_TEN[-exponent] : result * std::pow(10.0, exponent);
+        }
+        else if (exponent > 0)
+        {
+            result = (exponent <= 22) ? result * POWERS_OF_TEN[exponent] : result * std::pow(10.0, exponent);
+        }
 
-    std::map<OBJIndex, unsigned int> normalModelIndexMap;
-    std::map<unsigned int, unsigned int> indexMap;
+        *value = negative ? -result : result;
+        return p;
+    }
 
-    for(unsigned int i = 0; i < numIndices; i++)
+    const char* ParseInt(const char* p, const char* end, int* value)
     {
-        OBJIndex* currentIndex = &OBJIndices[i];
-
-        wind::Vector3 currentPosition = vertices[currentIndex->vertexIndex];
-        wind::Vector2 currentTexCoord;
-        wind::Vector3 currentNormal;
-
-		//This just checkly scales the mesh by whatever you want.
-		currentPosition.componentProductUpdate(Size);
-
-        if(hasUVs)
-		{
-            currentTexCoord = uvs[currentIndex->uvIndex];
-		}
-        else
-		{
-            currentTexCoord = wind::Vector2(0, 0);
-		}
-
-        if(hasNormals)
-		{
-            currentNormal = normals[currentIndex->normalIndex];
-		}
-        else
-		{
-            currentNormal = wind::Vector3(0, 0, 0);
-		}
-
-        unsigned int normalModelIndex;
-        unsigned int resultModelIndex;
-
-        //Create model to properly generate normals on
-        std::map<OBJIndex, unsigned int>::iterator it = normalModelIndexMap.find(*currentIndex);
-
-        if(it == normalModelIndexMap.end())
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
         {
-            normalModelIndex = normalModel.positions.size();
-
-            normalModelIndexMap.insert(std::pair<OBJIndex, unsigned int>(*currentIndex, normalModelIndex));
-            normalModel.positions.push_back(currentPosition);
-            normalModel.texCoords.push_back(currentTexCoord);
-            normalModel.normals.push_back(currentNormal);
+            negative = (*p == '-');
+            p++;
         }
-        else
-		{
-            normalModelIndex = it->second;
-		}
-
-        //Create model which properly separates texture coordinates
-        unsigned int previousVertexLocation = FindLastVertexIndex(indexLookup, currentIndex, result);
 
-        if(previousVertexLocation == (unsigned int)-1)
+        int result = 0;
+        while (p < end && IsDigit(*p))
         {
-            resultModelIndex = result.positions.size();
-
-            result.positions.push_back(currentPosition);
-            result.texCoords.push_back(currentTexCoord);
-            result.normals.push_back(currentNormal);
+            result = result * 10 + (*p - '0');
+            p++;
         }
-        else
-		{
-            resultModelIndex = previousVertexLocation;
-		}
-
-        normalModel.indices.push_back(normalModelIndex);
-        result.indices.push_back(resultModelIndex);
-        indexMap.insert(std::pair<unsigned int, unsigned int>(resultModelIndex, normalModelIndex));
+
+        *value = negative ? -result : result;
+        return p;
     }
 
-    if(!hasNormals)
+    //This parses a corner like 1, 1/2, 1//3 or 1/2/3.
+    const char* ParseCorner(const char* p, const char* end, OBJChunk* chunk, OBJRawIndex* corner)
     {
-        normalModel.CalcNormals();
+        int value = 0;
+        p = ParseInt(p, end, &value);
+        corner->vertexIndex = value;
+        corner->vertexCount = chunk->vertices.size();
+        //A corner without a uv or normal uses the first one.
+        corner->uvIndex = 1;
+        corner->uvCount = chunk->uvs.size();
+        corner->normalIndex = 1;
+        corner->normalCount = chunk->normals.size();
+
+        if (p < end && *p == '/')
+        {
+            p++;
+            if (p < end && *p != '/')
+            {
+                p = ParseInt(p, end, &value);
+                corner->uvIndex = value;
+                chunk->hasUVs = true;
+            }
 
-        for(unsigned int i = 0; i < result.positions.size(); i++)
-		{
-            result.normals[i] = normalModel.normals[indexMap[i]];
-		}
-    }
+            if (p < end && *p == '/')
+            {
+                p++;
+                p = ParseInt(p, end, &value);
+                corner->normalIndex = value;
+                chunk->hasNormals = true;
+            }
+        }
 
-    return result;
-};
+        //Skip anything we don't understand up to the next corner.
+        while (p < end && !IsSpace(*p) && *p != '\n')
+        {
+            p++;
+        }
 
-unsigned int OBJModel::FindLastVertexIndex(const std::vector<OBJIndex*>& indexLookup, const OBJIndex* currentIndex, const IndexedModel& result)
-{
-    unsigned int start = 0;
-    unsigned int end = indexLookup.size();
-    unsigned int current = ((end - start) / 2) + start;
-    unsigned int previous = start;
+        return p;
+    }
 
-    while(current != previous)
+    void ParseChunk(const char* p, const char* end, OBJChunk* chunk)
     {
-        OBJIndex* testIndex = indexLookup[current];
+        chunk->hasUVs = false;
+        chunk->hasNormals = false;
 
-        if(testIndex->vertexIndex == currentIndex->vertexIndex)
-        {
-            unsigned int countStart = current;
+        std::vector<OBJRawIndex> corners;
 
-            for(unsigned int i = 0; i < current; i++)
+        while (p < end)
+        {
+            p = SkipSpace(p, end);
+            if (end - p < 2)
             {
-                OBJIndex* possibleIndex = indexLookup[current - i];
-
-                if(possibleIndex == currentIndex)
-				{
-                    continue;
-				}
+                break;
+            }
 
-                if(possibleIndex->vertexIndex != currentIndex->vertexIndex)
-				{
-                    break;
-				}
+            double x = 0, y = 0, z = 0;
 
-                countStart--;
+            if (p[0] == 'v' && IsSpace(p[1]))
+            {
+                p = ParseFloat(p + 2, end, &x);
+                p = ParseFloat(p, end, &y);
+                p = ParseFloat(p, end, &z);
+                chunk->vertices.push_back(wind::Vector3(x, y, z));
             }
-
-            for(unsigned int i = countStart; i < indexLookup.size() - countStart; i++)
+            else if (p[0] == 'v' && p[1] == 't')
             {
-                OBJIndex* possibleIndex = indexLookup[current + i];
-
-                if(possibleIndex == currentIndex)
-				{
-                    continue;
-				}
-
-                if(possibleIndex->vertexIndex != currentIndex->vertexIndex)
-				{
-                    break;
-				}
-                else if((!hasUVs || possibleIndex->uvIndex == currentIndex->uvIndex)
-                    && (!hasNormals || possibleIndex->normalIndex == currentIndex->normalIndex))
+                p = ParseFloat(p + 2, end, &x);
+                p = ParseFloat(p, end, &y);
+                chunk->uvs.push_back(wind::Vector2(x, y));
+            }
+            else if (p[0] == 'v' && p[1] == 'n')
+            {
+                p = ParseFloat(p + 2, end, &x);
+                p = ParseFloat(p, end, &y);
+                p = ParseFloat(p, end, &z);
+                chunk->normals.push_back(wind::Vector3(x, y, z));
+            }
+            else if (p[0] == 'f' && IsSpace(p[1]))
+            {
+                corners.clear();
+                p += 2;
+
+                while (true)
                 {
-                    wind::Vector3 currentPosition = vertices[currentIndex->vertexIndex];
-                    wind::Vector2 currentTexCoord;
-                    wind::Vector3 currentNormal;
-
-                    if(hasUVs)
-					{
-                        currentTexCoord = uvs[currentIndex->uvIndex];
-					}
-                    else
-					{
-                        currentTexCoord = wind::Vector2(0, 0);
-					}
-
-                    if(hasNormals)
-					{
-                        currentNormal = normals[currentIndex->normalIndex];
-					}
-                    else
-					{
-                        currentNormal = wind::Vector3(0, 0, 0);
-					}
-
-                    for(unsigned int j = 0; j < result.positions.size(); j++)
+                    p = SkipSpace(p, end);
+                    if (p >= end || *p == '\n' || *p == '#')
                     {
-                        if(currentPosition == result.positions[j] && ((!hasUVs || currentTexCoord == result.texCoords[j]) && (!hasNormals || currentNormal == result.normals[j])))
-                        {
-                            return j;
-                        }
+                        break;
                     }
+
+                    OBJRawIndex corner;
+                    p = ParseCorner(p, end, chunk, &corner);
+                    corners.push_back(corner);
+                }
+
+                //Any face with more than three corners is turned into a fan, a quad gives the same two triangles as before.
+                for (unsigned i = 2; i < corners.size(); i++)
+                {
+                    chunk->indices.push_back(corners[0]);
+                    chunk->indices.push_back(corners[i - 1]);
+                    chunk->indices.push_back(corners[i]);
                 }
             }
 
-            return -1;
+            p = NextLine(p, end);
         }
-        else
+    }
+
+    //Turns an index out of the file into a zero based index for the whole file.
+    //OBJ counts from 1, and negative values count back from the last one read, which was count into the chunk at base.
+    //It returns false for zero or anything that counts back past the start of the file.
+    inline bool FileIndex(int value, unsigned base, unsigned count, unsigned* index)
+    {
+        if (value > 0)
         {
-            if(testIndex->vertexIndex < currentIndex->vertexIndex)
-			{
-                start = current;
-			}
-            else
-			{
-                end = current;
-			}
+            *index = static_cast<unsigned>(value - 1);
+            return true;
         }
 
-        previous = current;
-        current = ((end - start) / 2) + start;
+        long long resolved = static_cast<long long>(base) + count + value;
+        if (value == 0 || resolved < 0)
+        {
+            return false;
+        }
+
+        *index = static_cast<unsigned>(resolved);
+        return true;
     }
 
-    return -1;
+    inline unsigned HashOBJIndex(unsigned v, unsigned vt, unsigned vn)
+    {
+        return (v * 73856093u) ^ (vt * 19349663u) ^ (vn * 83492791u);
+    }
 }
 
-void OBJModel::CreateOBJFace(const std::string& line, const bool isStatic)
+OBJModel::OBJModel(const std::string& fileName, const bool isStatic)
 {
-    std::vector<std::string> tokens = SplitString(line, ' ');
+    buildModel(fileName, isStatic);
+}
 
-    for(int i = 0; i < 3; i++)
+bool OBJModel::buildModel(const std::string& fileName, const bool isStatic)
+{
+    wind::MappedFile file;
+    if (!file.open(fileName))
     {
-        this->OBJIndices.push_back(ParseOBJIndex(tokens[i + 1], &hasUVs, &hasNormals));
-    }
+        std::cerr << "Unable to load mesh: " << fileName << std::endl;
 
-    if(static_cast<int>(tokens.size()) > 4)
-    {
-        this->OBJIndices.push_back(ParseOBJIndex(tokens[1], &hasUVs, &hasNormals));
-        this->OBJIndices.push_back(ParseOBJIndex(tokens[3], &hasUVs, &hasNormals));
-        this->OBJIndices.push_back(ParseOBJIndex(tokens[4], &hasUVs, &hasNormals));
+        OBJIndices.clear();
+        vertices.clear();
+        uvs.clear();
+        normals.clear();
+        face.clear();
+        hasUVs = false;
+        hasNormals = false;
+        return false;
     }
 
-    if(isStatic)
+    if (!parse(file.getData(), file.getSize(), isStatic))
     {
-        for(std::vector<OBJIndex>::iterator it = OBJIndices.end() - 3; it != OBJIndices.end(); it++)
-        {
-             face.push_back(vertices[it->vertexIndex]);
-        }
+        std::cerr << "Bad face index in mesh: " << fileName << std::endl;
+        return false;
     }
+
+    return true;
 }
 
-OBJIndex OBJModel::ParseOBJIndex(const std::string& token, bool* hasUVs, bool* hasNormals)
+bool OBJModel::parse(const char* data, size_t size, const bool isStatic)
 {
-    unsigned int tokenLength = token.length();
-    const char* tokenString = token.c_str();
-
-    unsigned int vertIndexStart = 0;
-    unsigned int vertIndexEnd = FindNextChar(vertIndexStart, tokenString, tokenLength, '/');
-
-    OBJIndex result;
-    result.vertexIndex = ParseOBJIndexValue(token, vertIndexStart, vertIndexEnd);
-    result.uvIndex = 0;
-    result.normalIndex = 0;
-
-    if(vertIndexEnd >= tokenLength)
-	{
-        return result;
-	}
-
-    vertIndexStart = vertIndexEnd + 1;
-    vertIndexEnd = FindNextChar(vertIndexStart, tokenString, tokenLength, '/');
+    OBJIndices.clear();
+    vertices.clear();
+    uvs.clear();
+    normals.clear();
+    face.clear();
+    hasUVs = false;
+    hasNormals = false;
 
-    result.uvIndex = ParseOBJIndexValue(token, vertIndexStart, vertIndexEnd);
-    *hasUVs = true;
+    if (size == 0)
+    {
+        return true;
+    }
 
-    if(vertIndexEnd >= tokenLength)
-	{
-        return result;
-	}
+    //Firstly we split the file into chunks, each chunk ends at a line break so no line is cut in half.
+    unsigned chunkCount = wind::parallelThreadCount(size / MIN_CHUNK_SIZE, 1);
+    std::vector<const char*> chunkStart(chunkCount + 1);
+    chunkStart[0] = data;
+    chunkStart[chunkCount] = data + size;
+    for (unsigned i = 1; i < chunkCount; i++)
+    {
+        const char* split = data + (size / chunkCount) * i;
+        split = split < chunkStart[i - 1] ? chunkStart[i - 1] : split;
+        chunkStart[i] = NextLine(split, data + size);
+    }
 
-    vertIndexStart = vertIndexEnd + 1;
-    vertIndexEnd = FindNextChar(vertIndexStart, tokenString, tokenLength, '/');
+    std::vector<OBJChunk> chunks(chunkCount);
+    wind::parallelFor(chunkCount, 1, [&chunks, &chunkStart](unsigned begin, unsigned end)
+    {
+        for (unsigned i = begin; i < end; i++)
+        {
+            ParseChunk(chunkStart[i], chunkStart[i + 1], &chunks[i]);
+        }
+    });
 
-    result.normalIndex = ParseOBJIndexValue(token, vertIndexStart, vertIndexEnd);
-    *hasNormals = true;
+    //Next we work out where each chunk starts in the whole file.
+    std::vector<unsigned> vertexBase(chunkCount), uvBase(chunkCount), normalBase(chunkCount), indexBase(chunkCount);
+    unsigned vertexCount = 0, uvCount = 0, normalCount = 0, indexCount = 0;
+    for (unsigned i = 0; i < chunkCount; i++)
+    {
+        vertexBase[i] = vertexCount;
+        uvBase[i] = uvCount;
+        normalBase[i] = normalCount;
+        indexBase[i] = indexCount;
+
+        vertexCount += chunks[i].vertices.size();
+        uvCount += chunks[i].uvs.size();
+        normalCount += chunks[i].normals.size();
+        indexCount += chunks[i].indices.size();
+
+        hasUVs = hasUVs || chunks[i].hasUVs;
+        hasNormals = hasNormals || chunks[i].hasNormals;
+    }
 
-    return result;
-}
+    vertices.resize(vertexCount);
+    uvs.resize(uvCount);
+    normals.resize(normalCount);
+    OBJIndices.resize(indexCount);
 
-wind::Vector3 OBJModel::ParseOBJVec3(const std::string& line)
-{
-    unsigned int tokenLength = line.length();
-    const char* tokenString = line.c_str();
+    //Then every chunk copies itself into place and fixes its indices, the chunks don't overlap so they can all do it at once.
+    std::vector<char> badIndex(chunkCount, 0);
+    wind::parallelFor(chunkCount, 1, [&](unsigned begin, unsigned end)
+    {
+        for (unsigned c = begin; c < end; c++)
+        {
+            const OBJChunk& chunk = chunks[c];
+            std::copy(chunk.vertices.begin(), chunk.vertices.end(), vertices.begin() + vertexBase[c]);
+            std::copy(chunk.uvs.begin(), chunk.uvs.end(), uvs.begin() + uvBase[c]);
+            std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + normalBase[c]);
 
-    unsigned int vertIndexStart = 2;
+            for (unsigned i = 0; i < chunk.indices.size(); i++)
+            {
+                const OBJRawIndex& raw = chunk.indices[i];
+                OBJIndex& index = OBJIndices[indexBase[c] + i];
+                bool bad = !FileIndex(raw.vertexIndex, vertexBase[c], raw.vertexCount, &index.vertexIndex) ||
+                           !FileIndex(raw.uvIndex, uvBase[c], raw.uvCount, &index.uvIndex) ||
+                           !FileIndex(raw.normalIndex, normalBase[c], raw.normalCount, &index.normalIndex);
+
+                bad = bad || index.vertexIndex >= vertexCount ||
+                           (chunk.hasUVs && index.uvIndex >= uvCount) ||
+                           (chunk.hasNormals && index.normalIndex >= normalCount);
+                badIndex[c] |= bad;
+            }
+        }
+    });
 
-    while(vertIndexStart < tokenLength)
+    for (unsigned i = 0; i < chunkCount; i++)
     {
-        if(tokenString[vertIndexStart] != ' ')
-		{
-            break;
-		}
+        if (badIndex[i])
+        {
+            OBJIndices.clear();
+            return false;
+        }
+    }
 
-        vertIndexStart++;
+    //Faces that don't give a uv or normal use the first one, so there has to be one.
+    if ((hasUVs && uvs.empty()) || (hasNormals && normals.empty()))
+    {
+        OBJIndices.clear();
+        return false;
     }
 
-    unsigned int vertIndexEnd = FindNextChar(vertIndexStart, tokenString, tokenLength, ' ');
+    if (isStatic)
+    {
+        face.resize(OBJIndices.size());
+        for (unsigned i = 0; i < OBJIndices.size(); i++)
+        {
+            face[i] = vertices[OBJIndices[i].vertexIndex];
+        }
+    }
 
-    float x = ParseOBJFloatValue(line, vertIndexStart, vertIndexEnd);
+    return true;
+}
 
-    vertIndexStart = vertIndexEnd + 1;
-    vertIndexEnd = FindNextChar(vertIndexStart, tokenString, tokenLength, ' ');
+void IndexedModel::CalcNormals()
+{
+    for(unsigned int i = 0; i < indices.size(); i += 3)
+    {
+        int i0 = indices[i];
+        int i1 = indices[i + 1];
+        int i2 = indices[i + 2];
 
-    float y = ParseOBJFloatValue(line, vertIndexStart, vertIndexEnd);
+        wind::Vector3 v1 = positions[i1] - positions[i0];
+        wind::Vector3 v2 = positions[i2] - positions[i0];
 
-    vertIndexStart = vertIndexEnd + 1;
-    vertIndexEnd = FindNextChar(vertIndexStart, tokenString, tokenLength, ' ');
+        wind::Vector3 normal = (v1 % v2);
+		normal.normalise();
 
-    float z = ParseOBJFloatValue(line, vertIndexStart, vertIndexEnd);
+        normals[i0] += normal;
+        normals[i1] += normal;
+        normals[i2] += normal;
+    }
 
-    return wind::Vector3(x, y, z);
+    for(unsigned int i = 0; i < positions.size(); i++)
+	{
+        normals[i].normalise();
+	}
 }
 
-wind::Vector2 OBJModel::ParseOBJVec2(const std::string& line)
+IndexedModel OBJModel::ToIndexedModel(const wind::Vector3& Size)
 {
-    unsigned int tokenLength = line.length();
-    const char* tokenString = line.c_str();
+    IndexedModel result;
 
-    unsigned int vertIndexStart = 3;
+    unsigned int numIndices = OBJIndices.size();
+    result.indices.resize(numIndices);
 
-    while(vertIndexStart < tokenLength)
+    //This is an open addressing hash table from the position, uv and normal triple to the vertex we made for it.
+    //It's kept at least half empty so the probes stay short.
+    unsigned int tableSize = 16;
+    while (tableSize < numIndices * 2)
     {
-        if(tokenString[vertIndexStart] != ' ')
-		{
-            break;
-		}
-
-        vertIndexStart++;
+        tableSize <<= 1;
     }
+    const unsigned int mask = tableSize - 1;
+    const unsigned int empty = 0xffffffffu;
+    std::vector<unsigned int> table(tableSize, empty);
 
-    unsigned int vertIndexEnd = FindNextChar(vertIndexStart, tokenString, tokenLength, ' ');
+    //For each vertex we made, the position it came from. This is used to share the normals we make.
+    std::vector<unsigned int> vertexPosition;
 
-    float x = ParseOBJFloatValue(line, vertIndexStart, vertIndexEnd);
+    for (unsigned int i = 0; i < numIndices; i++)
+    {
+        const OBJIndex& current = OBJIndices[i];
+        unsigned int uv = hasUVs ? current.uvIndex : 0;
+        unsigned int normal = hasNormals ? current.normalIndex : 0;
 
-    vertIndexStart = vertIndexEnd + 1;
-    vertIndexEnd = FindNextChar(vertIndexStart, tokenString, tokenLength, ' ');
+        unsigned int slot = HashOBJIndex(current.vertexIndex, uv, normal) & mask;
+        while (table[slot] != empty)
+        {
+            const OBJIndex& other = OBJIndices[table[slot]];
+            if (other.vertexIndex == current.vertexIndex &&
+                (!hasUVs || other.uvIndex == uv) &&
+                (!hasNormals || other.normalIndex == normal))
+            {
+                break;
+            }
+            slot = (slot + 1) & mask;
+        }
 
-    float y = ParseOBJFloatValue(line, vertIndexStart, vertIndexEnd);
+        //The table holds the first OBJ index that used the triple, the vertex it made is already in the result indices.
+        if (table[slot] != empty)
+        {
+            result.indices[i] = result.indices[table[slot]];
+            continue;
+        }
 
-    return wind::Vector2(x, y);
-}
+        table[slot] = i;
+        result.indices[i] = result.positions.size();
 
-static bool CompareOBJIndexPtr(const OBJIndex* a, const OBJIndex* b)
-{
-    return a->vertexIndex < b->vertexIndex;
-}
+		//This just checkly scales the mesh by whatever you want.
+        wind::Vector3 position = vertices[current.vertexIndex];
+		position.componentProductUpdate(Size);
 
-static inline unsigned int FindNextChar(unsigned int start, const char* str, unsigned int length, char token)
-{
-    unsigned int result = start;
-    while(result < length)
-    {
-        result++;
-        if(str[result] == token)
-            break;
+        result.positions.push_back(position);
+        result.texCoords.push_back(hasUVs ? uvs[uv] : wind::Vector2(0, 0));
+        result.normals.push_back(hasNormals ? normals[normal] : wind::Vector3(0, 0, 0));
+        vertexPosition.push_back(current.vertexIndex);
     }
 
-    return result;
-}
+    //If the file has no normals we make smooth ones. Every vertex from the same position shares a normal, even if its uvs are different.
+    if (!hasNormals)
+    {
+        std::vector<wind::Vector3> smoothNormals(vertices.size());
 
-static inline unsigned int ParseOBJIndexValue(const std::string& token, unsigned int start, unsigned int end)
-{
-    return atoi(token.substr(start, end - start).c_str()) - 1;
-}
+        for (unsigned int i = 0; i + 2 < numIndices; i += 3)
+        {
+            unsigned int i0 = result.indices[i];
+            unsigned int i1 = result.indices[i + 1];
+            unsigned int i2 = result.indices[i + 2];
 
-static inline float ParseOBJFloatValue(const std::string& token, unsigned int start, unsigned int end)
-{
-    return static_cast<float>(atof(token.substr(start, end - start).c_str()));
-}
+            wind::Vector3 v1 = result.positions[i1] - result.positions[i0];
+            wind::Vector3 v2 = result.positions[i2] - result.positions[i0];
 
-static inline std::vector<std::string> SplitString(const std::string &s, char delim)
-{
-    std::vector<std::string> elems;
+            wind::Vector3 normal = (v1 % v2);
+            normal.normalise();
 
-    const char* cstr = s.c_str();
-    unsigned int strLength = s.length();
-    unsigned int start = 0;
-    unsigned int end = 0;
+            smoothNormals[vertexPosition[i0]] += normal;
+            smoothNormals[vertexPosition[i1]] += normal;
+            smoothNormals[vertexPosition[i2]] += normal;
+        }
 
-    while(end <= strLength)
-    {
-        while(end <= strLength)
+        for (unsigned int i = 0; i < result.positions.size(); i++)
         {
-            if(cstr[end] == delim)
-			{
-                break;
-			}
-            end++;
+            result.normals[i] = smoothNormals[vertexPosition[i]];
+            result.normals[i].normalise();
         }
-
-        elems.push_back(s.substr(start, end - start));
-        start = end + 1;
-        end = start;
     }
 
-    return elems;
+    return result;
 }
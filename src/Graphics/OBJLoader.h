@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <string>
+#include <cstddef>
 #include "../Physics/include/Core.h"
 
 struct OBJIndex
@@ -25,6 +26,11 @@ class IndexedModel
 		void CalcNormals();
 };
 
+/**
+    This class loads a Wavefront OBJ file.
+    The file is memory mapped and parsed straight out of the mapping, big files are split into chunks at line breaks and the chunks are parsed in parallel.
+    Faces with more than three corners are split into a fan of triangles.
+*/
 class OBJModel
 {
 	public:
@@ -36,18 +42,18 @@ class OBJModel
 		bool hasUVs;
 		bool hasNormals;
 
-		OBJModel(){}
+		OBJModel() : hasUVs(false), hasNormals(false) {}
 		OBJModel(const std::string& fileName, const bool isStatic);
-		void buildModel(const std::string& fileName, const bool isStatic);
 
-		IndexedModel ToIndexedModel(const wind::Vector3& size);
-	private:
-		unsigned int FindLastVertexIndex(const std::vector<OBJIndex*>& indexLookup, const OBJIndex* currentIndex, const IndexedModel& result);
-		void CreateOBJFace(const std::string& line, const bool isStatic);
+		//Loads the file, anything loaded before is thrown away.
+		//If isStatic is true the corners of each triangle are also copied into face.
+		bool buildModel(const std::string& fileName, const bool isStatic);
+
+		//This does the same as buildModel but for OBJ text that is already in memory.
+		bool parse(const char* data, size_t size, const bool isStatic);
 
-		wind::Vector2 ParseOBJVec2(const std::string& line);
-		wind::Vector3 ParseOBJVec3(const std::string& line);
-		OBJIndex ParseOBJIndex(const std::string& token, bool* hasUVs, bool* hasNormals);
+		//Builds the model for the GPU, each different position, uv and normal triple becomes one vertex.
+		IndexedModel ToIndexedModel(const wind::Vector3& size);
 };
 
 #endif
@@ -0,0 +1,368 @@
+#include "RenderCommandBuffer.h"
+
+#include <cstring>
+#include <iostream>
+
+#include "AtomicFile.h"
+#include "MappedFile.h"
+
+namespace wind
+{
+
+namespace
+{
+    const char COMMAND_MAGIC[4] = { 'W', 'C', 'M', 'D' };
+    const std::uint32_t COMMAND_VERSION = 1;
+
+    const unsigned FRAME_CONSTANTS_FLOATS = sizeof(FrameConstants) / sizeof(float);
+}
+
+/******************************************************************************/
+RenderCommandBuffer::RenderCommandBuffer() : _uploadSource(nullptr), _uploadData(0), _uploadCount(0)
+{
+}
+
+/******************************************************************************/
+void RenderCommandBuffer::bindProgram(ShaderProgram3D* program)
+{
+    addCommand(RENDER_COMMAND_BIND_PROGRAM, getId(_programs, _programIds, program), 0, 0, 0);
+}
+
+/******************************************************************************/
+void RenderCommandBuffer::setFrameConstants(const FrameConstants &constants)
+{
+    std::uint32_t data = addData(reinterpret_cast<const float*>(&constants), FRAME_CONSTANTS_FLOATS);
+    addCommand(RENDER_COMMAND_SET_FRAME_CONSTANTS, RENDER_NO_RESOURCE, data, 0, FRAME_CONSTANTS_FLOATS);
+}
+
+/******************************************************************************/
+void RenderCommandBuffer::bindTexture(Texture* texture)
+{
+    addCommand(RENDER_COMMAND_BIND_TEXTURE, getId(_textures, _textureIds, texture), 0, 0, 0);
+}
+
+/******************************************************************************/
+void RenderCommandBuffer::bindMesh(Mesh* mesh, unsigned lod)
+{
+    //The level of detail goes where a draw keeps its first matrix.
+    addCommand(RENDER_COMMAND_BIND_MESH, getId(_meshes, _meshIds, mesh), 0, lod, 0);
+}
+
+/******************************************************************************/
+void RenderCommandBuffer::uploadModels(const float* models, unsigned count)
+{
+    _uploadSource = models;
+    _uploadData = addData(models, count * 16);
+    _uploadCount = count;
+    addCommand(RENDER_COMMAND_UPLOAD_MODELS, RENDER_NO_RESOURCE, _uploadData, 0, count);
+}
+
+/******************************************************************************/
+unsigned RenderCommandBuffer::drawMesh(Mesh* mesh, const float* models, unsigned first, unsigned count)
+{
+    //The queue draws straight out of what it uploaded, so most draws don't need any floats of their own.
+    std::uint32_t data = 0;
+    if (_uploadSource != nullptr && models == _uploadSource + first * 16 && first + count <= _uploadCount)
+    {
+        data = _uploadData + first * 16;
+    }
+    else
+    {
+        data = addData(models, count * 16);
+    }
+
+    addCommand(RENDER_COMMAND_DRAW_MESH, getId(_meshes, _meshIds, mesh), data, first, count);
+    //Nothing is drawn yet so there are no draw calls to count.
+    return 0;
+}
+
+/******************************************************************************/
+void RenderCommandBuffer::finish()
+{
+    addCommand(RENDER_COMMAND_FINISH, RENDER_NO_RESOURCE, 0, 0, 0);
+    _uploadSource = nullptr;
+}
+
+/******************************************************************************/
+void RenderCommandBuffer::clear()
+{
+    _commands.clear();
+    _data.clear();
+    _uploadSource = nullptr;
+    _uploadData = 0;
+    _uploadCount = 0;
+}
+
+/******************************************************************************/
+bool RenderCommandBuffer::replay(RenderBackend &backend) const
+{
+    //Everything is checked first, so a stream that can't be drawn isn't drawn half way.
+    for (unsigned i = 0; i < _commands.size(); i++)
+    {
+        const RenderCommand &command = _commands[i];
+        bool valid = true;
+        switch (command.type)
+        {
+        case RENDER_COMMAND_BIND_PROGRAM:
+            valid = command.resource == RENDER_NO_RESOURCE || (command.resource < _programs.size() && _programs[command.resource] != nullptr);
+            break;
+        case RENDER_COMMAND_BIND_TEXTURE:
+            valid = command.resource == RENDER_NO_RESOURCE || (command.resource < _textures.size() && _textures[command.resource] != nullptr);
+            break;
+        case RENDER_COMMAND_BIND_MESH:
+        case RENDER_COMMAND_DRAW_MESH:
+            valid = command.resource < _meshes.size() && _meshes[command.resource] != nullptr;
+            break;
+        default:
+            break;
+        }
+
+        if (valid && (command.type == RENDER_COMMAND_UPLOAD_MODELS || command.type == RENDER_COMMAND_DRAW_MESH))
+        {
+            valid = static_cast<std::uint64_t>(command.data) + static_cast<std::uint64_t>(command.count) * 16 <= _data.size();
+        }
+        else if (valid && command.type == RENDER_COMMAND_SET_FRAME_CONSTANTS)
+        {
+            valid = command.count == FRAME_CONSTANTS_FLOATS && command.data + command.count <= _data.size();
+        }
+
+        if (!valid)
+        {
+            std::cerr << "Render command " << i << " can't be replayed, its resource isn't set or its data is missing." << std::endl;
+            return false;
+        }
+    }
+
+    for (unsigned i = 0; i < _commands.size(); i++)
+    {
+        const RenderCommand &command = _commands[i];
+        const float* data = _data.empty() ? nullptr : &_data[0] + command.data;
+        switch (command.type)
+        {
+        case RENDER_COMMAND_BIND_PROGRAM:
+            backend.bindProgram(command.resource == RENDER_NO_RESOURCE ? nullptr : _programs[command.resource]);
+            break;
+        case RENDER_COMMAND_SET_FRAME_CONSTANTS:
+        {
+            FrameConstants constants;
+            memcpy(&constants, data, sizeof(constants));
+            backend.setFrameConstants(constants);
+            break;
+        }
+        case RENDER_COMMAND_BIND_TEXTURE:
+            backend.bindTexture(command.resource == RENDER_NO_RESOURCE ? nullptr : _textures[command.resource]);
+            break;
+        case RENDER_COMMAND_BIND_MESH:
+            backend.bindMesh(_meshes[command.resource], command.first);
+            break;
+        case RENDER_COMMAND_UPLOAD_MODELS:
+            backend.uploadModels(data, command.count);
+            break;
+        case RENDER_COMMAND_DRAW_MESH:
+            backend.drawMesh(_meshes[command.resource], data, command.first, command.count);
+            break;
+        case RENDER_COMMAND_FINISH:
+            backend.finish();
+            break;
+        default:
+            break;
+        }
+    }
+
+    return true;
+}
+
+/******************************************************************************/
+bool RenderCommandBuffer::save(const std::string &path) const
+{
+    RenderCommandHeader header;
+    memcpy(header.magic, COMMAND_MAGIC, sizeof(COMMAND_MAGIC));
+    header.version = COMMAND_VERSION;
+    header.commandCount = _commands.size();
+    header.dataCount = _data.size();
+    header.programCount = _programs.size();
+    header.textureCount = _textures.size();
+    header.meshCount = _meshes.size();
+
+    AtomicFile file;
+    if (file.open(path))
+    {
+        file.write(&header, sizeof(header));
+        if (!_commands.empty())
+        {
+            file.write(&_commands[0], _commands.size() * sizeof(RenderCommand));
+        }
+        if (!_data.empty())
+        {
+            file.write(&_data[0], _data.size() * sizeof(float));
+        }
+    }
+
+    if (!file.commit())
+    {
+        std::cerr << "Unable to write render commands: " << path << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+/******************************************************************************/
+bool RenderCommandBuffer::load(const std::string &path)
+{
+    MappedFile file;
+    if (!file.open(path) || file.getSize() < sizeof(RenderCommandHeader))
+    {
+        std::cerr << "Unable to open render commands: " << path << std::endl;
+        return false;
+    }
+
+    const RenderCommandHeader* header = reinterpret_cast<const RenderCommandHeader*>(file.getData());
+    std::uint64_t expectedSize = sizeof(RenderCommandHeader) +
+                                 static_cast<std::uint64_t>(header->commandCount) * sizeof(RenderCommand) +
+                                 static_cast<std::uint64_t>(header->dataCount) * sizeof(float);
+
+    if (memcmp(header->magic, COMMAND_MAGIC, sizeof(COMMAND_MAGIC)) != 0 || header->version != COMMAND_VERSION ||
+        expectedSize != file.getSize())
+    {
+        std::cerr << "Not a render command file: " << path << std::endl;
+        return false;
+    }
+
+    const char* data = file.getData() + sizeof(RenderCommandHeader);
+    _commands.resize(header->commandCount);
+    if (!_commands.empty())
+    {
+        memcpy(&_commands[0], data, _commands.size() * sizeof(RenderCommand));
+    }
+
+    data += _commands.size() * sizeof(RenderCommand);
+    _data.resize(header->dataCount);
+    if (!_data.empty())
+    {
+        memcpy(&_data[0], data, _data.size() * sizeof(float));
+    }
+
+    //We only know how many resources there were, they have to be set again before the stream can go to GL.
+    _programs.assign(header->programCount, nullptr);
+    _textures.assign(header->textureCount, nullptr);
+    _meshes.assign(header->meshCount, nullptr);
+    _programIds.clear();
+    _textureIds.clear();
+    _meshIds.clear();
+
+    _uploadSource = nullptr;
+    _uploadData = 0;
+    _uploadCount = 0;
+    return true;
+}
+
+/******************************************************************************/
+void RenderCommandBuffer::setProgram(unsigned id, ShaderProgram3D* program)
+{
+    if (id < _programs.size())
+    {
+        _programs[id] = program;
+        _programIds[program] = id;
+    }
+}
+
+/******************************************************************************/
+void RenderCommandBuffer::setTexture(unsigned id, Texture* texture)
+{
+    if (id < _textures.size())
+    {
+        _textures[id] = texture;
+        _textureIds[texture] = id;
+    }
+}
+
+/******************************************************************************/
+void RenderCommandBuffer::setMesh(unsigned id, Mesh* mesh)
+{
+    if (id < _meshes.size())
+    {
+        _meshes[id] = mesh;
+        _meshIds[mesh] = id;
+    }
+}
+
+/******************************************************************************/
+unsigned RenderCommandBuffer::getCommandCount() const
+{
+    return _commands.size();
+}
+
+/******************************************************************************/
+const RenderCommand& RenderCommandBuffer::getCommand(unsigned index) const
+{
+    return _commands[index];
+}
+
+/******************************************************************************/
+const std::vector<float>& RenderCommandBuffer::getData() const
+{
+    return _data;
+}
+
+/******************************************************************************/
+unsigned RenderCommandBuffer::getProgramCount() const
+{
+    return _programs.size();
+}
+
+/******************************************************************************/
+unsigned RenderCommandBuffer::getTextureCount() const
+{
+    return _textures.size();
+}
+
+/******************************************************************************/
+unsigned RenderCommandBuffer::getMeshCount() const
+{
+    return _meshes.size();
+}
+
+/******************************************************************************/
+template<typename T>
+std::uint16_t RenderCommandBuffer::getId(std::vector<T*> &resources, std::unordered_map<const void*, std::uint16_t> &ids, T* resource)
+{
+    if (resource == nullptr)
+    {
+        return RENDER_NO_RESOURCE;
+    }
+
+    std::unordered_map<const void*, std::uint16_t>::const_iterator found = ids.find(resource);
+    if (found != ids.end())
+    {
+        return found->second;
+    }
+
+    if (resources.size() >= RENDER_NO_RESOURCE)
+    {
+        std::cerr << "Too many resources to record, the rest are recorded as nothing." << std::endl;
+        return RENDER_NO_RESOURCE;
+    }
+
+    std::uint16_t id = static_cast<std::uint16_t>(resources.size());
+    resources.push_back(resource);
+    ids[resource] = id;
+    return id;
+}
+
+/******************************************************************************/
+void RenderCommandBuffer::addCommand(RenderCommandType type, std::uint16_t resource, std::uint32_t data, std::uint32_t first,
+                                     std::uint32_t count)
+{
+    RenderCommand command = { static_cast<std::uint16_t>(type), resource, data, first, count };
+    _commands.push_back(command);
+}
+
+/******************************************************************************/
+std::uint32_t RenderCommandBuffer::addData(const float* data, unsigned count)
+{
+    std::uint32_t offset = _data.size();
+    _data.insert(_data.end(), data, data + count);
+    return offset;
+}
+}; //wind
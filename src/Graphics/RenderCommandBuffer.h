@@ -0,0 +1,122 @@
+#ifndef RENDER_COMMAND_BUFFER_H
+#define RENDER_COMMAND_BUFFER_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+#include "RenderQueue.h"
+
+namespace wind
+{
+enum RenderCommandType
+{
+    RENDER_COMMAND_BIND_PROGRAM,
+    RENDER_COMMAND_SET_FRAME_CONSTANTS,
+    RENDER_COMMAND_BIND_TEXTURE,
+    RENDER_COMMAND_BIND_MESH,
+    RENDER_COMMAND_UPLOAD_MODELS,
+    RENDER_COMMAND_DRAW_MESH,
+    RENDER_COMMAND_FINISH,
+    RENDER_COMMAND_TYPE_COUNT
+};
+
+//The resource of a bind to nothing, like a null texture.
+const std::uint16_t RENDER_NO_RESOURCE = 0xffff;
+
+//Every command is the same 16 bytes, the floats it needs are kept in a separate stream.
+struct RenderCommand
+{
+    std::uint16_t type;
+    //The id of the program, texture or mesh that is bound or drawn.
+    std::uint16_t resource;
+    //Where the command's floats start in the data stream.
+    std::uint32_t data;
+    //For draws this is where the matrices start in the last upload, for mesh binds it is the level of detail.
+    std::uint32_t first;
+    //How many model matrices, or for frame constants how many floats.
+    std::uint32_t count;
+};
+
+//The start of a saved command stream, the commands and then the floats follow it.
+struct RenderCommandHeader
+{
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t commandCount;
+    std::uint32_t dataCount;
+    std::uint32_t programCount;
+    std::uint32_t textureCount;
+    std::uint32_t meshCount;
+};
+
+/**
+    This class is a render backend that doesn't draw anything, it writes down what it is asked to do as a stream of commands instead.
+    Run a render queue into it and the frame can be replayed later into any other backend, the GLRenderBackend draws it for real
+    and the RenderCommandValidator counts it and checks it is sane, which needs no GL context at all.
+    Programs, textures and meshes are given a small id the first time they are seen and the commands only keep the ids. The stream
+    can be saved and loaded again, a loaded stream knows how many of each there were but not what they were, so to replay it to GL
+    they have to be set again with setProgram, setTexture and setMesh.
+*/
+class RenderCommandBuffer : public RenderBackend
+{
+public:
+    RenderCommandBuffer();
+
+    void bindProgram(ShaderProgram3D* program) override;
+    void setFrameConstants(const FrameConstants &constants) override;
+    void bindTexture(Texture* texture) override;
+    void bindMesh(Mesh* mesh, unsigned lod) override;
+
+    void uploadModels(const float* models, unsigned count) override;
+    unsigned drawMesh(Mesh* mesh, const float* models, unsigned first, unsigned count) override;
+
+    void finish() override;
+
+    //This throws the commands away but keeps the ids, so the same mesh has the same id frame after frame.
+    void clear();
+
+    //This runs every command through the backend, it returns false without doing anything if an id has nothing set for it.
+    bool replay(RenderBackend &backend) const;
+
+    bool save(const std::string &path) const;
+    bool load(const std::string &path);
+
+    void setProgram(unsigned id, ShaderProgram3D* program);
+    void setTexture(unsigned id, Texture* texture);
+    void setMesh(unsigned id, Mesh* mesh);
+
+    unsigned getCommandCount() const;
+    const RenderCommand& getCommand(unsigned index) const;
+    const std::vector<float>& getData() const;
+
+    unsigned getProgramCount() const;
+    unsigned getTextureCount() const;
+    unsigned getMeshCount() const;
+
+private:
+    template<typename T>
+    std::uint16_t getId(std::vector<T*> &resources, std::unordered_map<const void*, std::uint16_t> &ids, T* resource);
+
+    void addCommand(RenderCommandType type, std::uint16_t resource, std::uint32_t data, std::uint32_t first, std::uint32_t count);
+    std::uint32_t addData(const float* data, unsigned count);
+
+    std::vector<RenderCommand> _commands;
+    std::vector<float> _data;
+
+    std::vector<ShaderProgram3D*> _programs;
+    std::vector<Texture*> _textures;
+    std::vector<Mesh*> _meshes;
+    std::unordered_map<const void*, std::uint16_t> _programIds;
+    std::unordered_map<const void*, std::uint16_t> _textureIds;
+    std::unordered_map<const void*, std::uint16_t> _meshIds;
+
+    //This is the last upload, a draw of matrices from it points into it rather than copying them again.
+    const float* _uploadSource;
+    std::uint32_t _uploadData;
+    unsigned _uploadCount;
+};
+}; //wind
+
+#endif
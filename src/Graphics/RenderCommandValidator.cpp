@@ -0,0 +1,195 @@
+#include "RenderCommandValidator.h"
+#include "MeshLod.h"
+
+#include <cstring>
+#include <sstream>
+
+namespace wind
+{
+
+namespace
+{
+    //After this many the rest of the problems are only counted.
+    const unsigned MAX_ERRORS = 32;
+
+    const unsigned FRAME_CONSTANTS_FLOATS = sizeof(FrameConstants) / sizeof(float);
+    const unsigned NOTHING_BOUND = 0xffffffff;
+}
+
+/******************************************************************************/
+RenderCommandValidator::RenderCommandValidator() : _errorCount(0)
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+/******************************************************************************/
+bool RenderCommandValidator::validate(const RenderCommandBuffer &commands)
+{
+    memset(&_stats, 0, sizeof(_stats));
+    _errors.clear();
+    _errorCount = 0;
+
+    const std::vector<float> &data = commands.getData();
+    _stats.commands = commands.getCommandCount();
+    _stats.dataBytes = data.size() * sizeof(float);
+
+    //The resource of a texture bind can be nothing, so NOTHING_BOUND means we haven't seen a bind at all yet.
+    unsigned program = NOTHING_BOUND;
+    unsigned texture = NOTHING_BOUND;
+    unsigned mesh = NOTHING_BOUND;
+    unsigned lod = 0;
+    bool finished = false;
+
+    for (unsigned i = 0; i < commands.getCommandCount(); i++)
+    {
+        const RenderCommand &command = commands.getCommand(i);
+        if (finished)
+        {
+            addError(i, "comes after the finish");
+            finished = false;
+        }
+
+        switch (command.type)
+        {
+        case RENDER_COMMAND_BIND_PROGRAM:
+            _stats.programBinds++;
+            if (command.resource != RENDER_NO_RESOURCE && command.resource >= commands.getProgramCount())
+            {
+                addError(i, "binds a program that doesn't exist");
+            }
+            if (command.resource == program)
+            {
+                _stats.redundantBinds++;
+            }
+            program = command.resource;
+            break;
+
+        case RENDER_COMMAND_SET_FRAME_CONSTANTS:
+            _stats.frameConstants++;
+            if (command.count != FRAME_CONSTANTS_FLOATS || static_cast<std::uint64_t>(command.data) + command.count > data.size())
+            {
+                addError(i, "has frame constants that aren't in the stream");
+            }
+            if (program == NOTHING_BOUND || program == RENDER_NO_RESOURCE)
+            {
+                addError(i, "sets frame constants with no program bound");
+            }
+            break;
+
+        case RENDER_COMMAND_BIND_TEXTURE:
+            _stats.textureBinds++;
+            if (command.resource != RENDER_NO_RESOURCE && command.resource >= commands.getTextureCount())
+            {
+                addError(i, "binds a texture that doesn't exist");
+            }
+            if (command.resource == texture)
+            {
+                _stats.redundantBinds++;
+            }
+            texture = command.resource;
+            break;
+
+        case RENDER_COMMAND_BIND_MESH:
+            _stats.meshBinds++;
+            if (command.resource >= commands.getMeshCount())
+            {
+                addError(i, "binds a mesh that doesn't exist");
+            }
+            if (command.first >= MAX_MESH_LODS)
+            {
+                addError(i, "binds a level of detail that no mesh has");
+            }
+            if (command.resource == mesh && command.first == lod)
+            {
+                _stats.redundantBinds++;
+            }
+            mesh = command.resource;
+            lod = command.first;
+            break;
+
+        case RENDER_COMMAND_UPLOAD_MODELS:
+            _stats.uploads++;
+            _stats.uploadedModels += command.count;
+            if (static_cast<std::uint64_t>(command.data) + static_cast<std::uint64_t>(command.count) * 16 > data.size())
+            {
+                addError(i, "uploads matrices that aren't in the stream");
+            }
+            break;
+
+        case RENDER_COMMAND_DRAW_MESH:
+            _stats.draws++;
+            _stats.drawnModels += command.count;
+            if (program == NOTHING_BOUND || program == RENDER_NO_RESOURCE)
+            {
+                addError(i, "draws with no program bound");
+            }
+            if (mesh == NOTHING_BOUND)
+            {
+                addError(i, "draws with no mesh bound");
+            }
+            else if (command.resource != mesh)
+            {
+                addError(i, "draws a mesh that isn't the bound one");
+            }
+            if (command.count == 0)
+            {
+                addError(i, "draws nothing");
+            }
+            if (static_cast<std::uint64_t>(command.data) + static_cast<std::uint64_t>(command.count) * 16 > data.size())
+            {
+                addError(i, "draws matrices that aren't in the stream");
+            }
+            break;
+
+        case RENDER_COMMAND_FINISH:
+            finished = true;
+            //The backend starts from nothing again after a finish.
+            program = NOTHING_BOUND;
+            texture = NOTHING_BOUND;
+            mesh = NOTHING_BOUND;
+            break;
+
+        default:
+            addError(i, "isn't a command");
+            break;
+        }
+    }
+
+    if (commands.getCommandCount() != 0 && !finished)
+    {
+        addError(commands.getCommandCount() - 1, "is the last command but isn't a finish");
+    }
+
+    return _errorCount == 0;
+}
+
+/******************************************************************************/
+const RenderCommandStats& RenderCommandValidator::getStats() const
+{
+    return _stats;
+}
+
+/******************************************************************************/
+const std::vector<std::string>& RenderCommandValidator::getErrors() const
+{
+    return _errors;
+}
+
+/******************************************************************************/
+unsigned RenderCommandValidator::getErrorCount() const
+{
+    return _errorCount;
+}
+
+/******************************************************************************/
+void RenderCommandValidator::addError(unsigned index, const std::string &error)
+{
+    _errorCount++;
+    if (_errors.size() < MAX_ERRORS)
+    {
+        std::ostringstream message;
+        message << "Render command " << index << " " << error << ".";
+        _errors.push_back(message.str());
+    }
+}
+}; //wind
@@ -0,0 +1,57 @@
+#ifndef RENDER_COMMAND_VALIDATOR_H
+#define RENDER_COMMAND_VALIDATOR_H
+
+#include <string>
+#include <vector>
+
+#include "RenderCommandBuffer.h"
+
+namespace wind
+{
+//What was in a command stream.
+struct RenderCommandStats
+{
+    unsigned commands;
+    unsigned programBinds;
+    unsigned frameConstants;
+    unsigned textureBinds;
+    unsigned meshBinds;
+    //Binds of the same thing that was already bound, the render queue should never make these.
+    unsigned redundantBinds;
+    unsigned uploads;
+    unsigned uploadedModels;
+    unsigned draws;
+    unsigned drawnModels;
+    //How many bytes of floats the stream carries, which is roughly what would go to the GPU.
+    unsigned dataBytes;
+};
+
+/**
+    This class runs a command stream without drawing anything, it counts what is in it and checks that it makes sense.
+    It only looks at the ids, so it works on a stream that was just loaded from disk and needs no GL context.
+    A draw is wrong if no program or no mesh is bound, if it draws a different mesh from the bound one, or if its matrices
+    aren't in the stream. A stream also has to end with a finish and have nothing after it.
+*/
+class RenderCommandValidator
+{
+public:
+    RenderCommandValidator();
+
+    //This returns true if the stream had nothing wrong with it.
+    bool validate(const RenderCommandBuffer &commands);
+
+    const RenderCommandStats& getStats() const;
+    //Only the first few problems are kept, the count has them all.
+    const std::vector<std::string>& getErrors() const;
+    unsigned getErrorCount() const;
+
+private:
+    void addError(unsigned index, const std::string &error);
+
+    RenderCommandStats _stats;
+    std::vector<std::string> _errors;
+    unsigned _errorCount;
+};
+}; //wind
+
+#endif
@@ -0,0 +1,324 @@
+#include "RenderQueue.h"
+
+#include <cstring>
+
+namespace wind
+{
+
+namespace
+{
+    //How many bits each part of the key gets.
+    const unsigned PROGRAM_BITS = 8;
+    const unsigned TEXTURE_BITS = 16;
+    const unsigned MESH_BITS = 16;
+    const unsigned LOD_BITS = 2;
+    const unsigned DEPTH_BITS = 22;
+
+    const unsigned LOD_SHIFT = DEPTH_BITS;
+    const unsigned MESH_SHIFT = LOD_SHIFT + LOD_BITS;
+    const unsigned TEXTURE_SHIFT = MESH_SHIFT + MESH_BITS;
+    const unsigned PROGRAM_SHIFT = TEXTURE_SHIFT + TEXTURE_BITS;
+}
+
+/******************************************************************************/
+RenderQueue::RenderQueue() : _hasFrameConstants(false), _sortedItems(false)
+{
+    memset(&_frameConstants, 0, sizeof(_frameConstants));
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+/******************************************************************************/
+void RenderQueue::begin(const Vector3 &viewPosition)
+{
+    _viewPosition = viewPosition;
+    _items.clear();
+    _sorted.clear();
+    _sortedItems = false;
+    _hasFrameConstants = false;
+}
+
+/******************************************************************************/
+void RenderQueue::setFrameConstants(const FrameConstants &constants)
+{
+    _frameConstants = constants;
+    _hasFrameConstants = true;
+}
+
+/******************************************************************************/
+void RenderQueue::submit(ShaderProgram3D* program, Texture* texture, Mesh* mesh, const float model[16], unsigned lod)
+{
+    if (mesh == nullptr)
+    {
+        return;
+    }
+
+    RenderItem item;
+    item.program = program;
+    item.texture = texture;
+    item.mesh = mesh;
+    item.lod = lod;
+    memcpy(item.model, model, sizeof(item.model));
+    item.hasBounds = false;
+    item.visible = true;
+    _items.push_back(item);
+    _sortedItems = false;
+}
+
+/******************************************************************************/
+void RenderQueue::submit(ShaderProgram3D* program, Texture* texture, Mesh* mesh, const float model[16], const CullBounds &bounds, unsigned lod)
+{
+    unsigned count = _items.size();
+    submit(program, texture, mesh, model, lod);
+
+    if (_items.size() != count)
+    {
+        _items.back().bounds = bounds;
+        _items.back().hasBounds = true;
+    }
+}
+
+/******************************************************************************/
+void RenderQueue::cull(const Frustum &frustum, unsigned maxThreads)
+{
+    _cullBounds.clear();
+    _cullItems.clear();
+    for (unsigned i = 0; i < _items.size(); i++)
+    {
+        if (_items[i].hasBounds)
+        {
+            _items[i].visible = false;
+            _cullBounds.push_back(_items[i].bounds);
+            _cullItems.push_back(i);
+        }
+    }
+
+    //The tree is rebuilt each frame as most of what we draw is moving.
+    _tree.build(_cullBounds.empty() ? nullptr : &_cullBounds[0], _cullBounds.size());
+    _tree.cull(frustum, _visible, maxThreads);
+
+    for (unsigned i = 0; i < _visible.size(); i++)
+    {
+        _items[_cullItems[_visible[i]]].visible = true;
+    }
+
+    _sortedItems = false;
+}
+
+/******************************************************************************/
+std::uint64_t RenderQueue::makeKey(unsigned programId, unsigned textureId, unsigned meshId, unsigned lod, float depth)
+{
+    //A positive float's bits go up as the float does, so the top bits of the float make a depth we can sort on.
+    //The sign bit is always zero here so we skip it.
+    std::uint32_t depthBits;
+    depth = depth > 0.0f ? depth : 0.0f;
+    memcpy(&depthBits, &depth, sizeof(depthBits));
+    depthBits >>= 31 - DEPTH_BITS;
+
+    return (static_cast<std::uint64_t>(programId & ((1u << PROGRAM_BITS) - 1)) << PROGRAM_SHIFT) |
+           (static_cast<std::uint64_t>(textureId & ((1u << TEXTURE_BITS) - 1)) << TEXTURE_SHIFT) |
+           (static_cast<std::uint64_t>(meshId & ((1u << MESH_BITS) - 1)) << MESH_SHIFT) |
+           (static_cast<std::uint64_t>(lod & ((1u << LOD_BITS) - 1)) << LOD_SHIFT) |
+           static_cast<std::uint64_t>(depthBits);
+}
+
+/******************************************************************************/
+unsigned RenderQueue::getId(std::unordered_map<const void*, unsigned> &ids, const void* pointer, unsigned limit)
+{
+    std::unordered_map<const void*, unsigned>::iterator found = ids.find(pointer);
+    if (found != ids.end())
+    {
+        return found->second;
+    }
+
+    //If we run out of ids we start again, a few things might share an id for a frame but they are still drawn right.
+    if (ids.size() >= limit)
+    {
+        ids.clear();
+    }
+
+    unsigned id = ids.size();
+    ids[pointer] = id;
+    return id;
+}
+
+/******************************************************************************/
+void RenderQueue::sort()
+{
+    _sorted.clear();
+    for (unsigned i = 0; i < _items.size(); i++)
+    {
+        const RenderItem &item = _items[i];
+        if (!item.visible)
+        {
+            continue;
+        }
+
+        Vector3 position(item.model[12], item.model[13], item.model[14]);
+
+        SortEntry entry;
+        entry.key = makeKey(getId(_programIds, item.program, 1u << PROGRAM_BITS),
+                            getId(_textureIds, item.texture, 1u << TEXTURE_BITS),
+                            getId(_meshIds, item.mesh, 1u << MESH_BITS),
+                            item.lod,
+                            static_cast<float>((position - _viewPosition).squareMagnitude()));
+        entry.index = i;
+        _sorted.push_back(entry);
+    }
+
+    unsigned count = _sorted.size();
+    _scratch.resize(count);
+
+    //This is a least significant byte first radix sort, all eight histograms are counted in one pass.
+    unsigned histogram[8][256];
+    memset(histogram, 0, sizeof(histogram));
+    for (unsigned i = 0; i < count; i++)
+    {
+        std::uint64_t key = _sorted[i].key;
+        for (unsigned pass = 0; pass < 8; pass++)
+        {
+            histogram[pass][(key >> (pass * 8)) & 0xff]++;
+        }
+    }
+
+    for (unsigned pass = 0; pass < 8; pass++)
+    {
+        unsigned shift = pass * 8;
+
+        //If every key has the same byte here this pass wouldn't move anything.
+        if (count == 0 || histogram[pass][(_sorted[0].key >> shift) & 0xff] == count)
+        {
+            continue;
+        }
+
+        unsigned offset = 0;
+        for (unsigned i = 0; i < 256; i++)
+        {
+            unsigned bucket = histogram[pass][i];
+            histogram[pass][i] = offset;
+            offset += bucket;
+        }
+
+        for (unsigned i = 0; i < count; i++)
+        {
+            const SortEntry &entry = _sorted[i];
+            _scratch[histogram[pass][(entry.key >> shift) & 0xff]++] = entry;
+        }
+
+        _sorted.swap(_scratch);
+    }
+
+    _sortedItems = true;
+}
+
+/******************************************************************************/
+void RenderQueue::execute(RenderBackend &backend)
+{
+    if (!_sortedItems)
+    {
+        sort();
+    }
+
+    memset(&_stats, 0, sizeof(_stats));
+    _stats.items = _items.size();
+    _stats.culled = _items.size() - _sorted.size();
+
+    //Every model matrix is gathered in the order it is drawn, so the backend can upload the whole frame's matrices in one go.
+    _batch.resize(_sorted.size() * 16);
+    for (unsigned i = 0; i < _sorted.size(); i++)
+    {
+        memcpy(&_batch[i * 16], _items[_sorted[i].index].model, 16 * sizeof(float));
+    }
+
+    if (!_sorted.empty())
+    {
+        backend.uploadModels(&_batch[0], _sorted.size());
+    }
+
+    ShaderProgram3D* program = nullptr;
+    Texture* texture = nullptr;
+    Mesh* mesh = nullptr;
+    unsigned lod = 0;
+    bool first = true;
+
+    unsigned begin = 0;
+    while (begin < _sorted.size())
+    {
+        const RenderItem &item = _items[_sorted[begin].index];
+
+        if (first || item.program != program)
+        {
+            backend.bindProgram(item.program);
+            if (_hasFrameConstants)
+            {
+                backend.setFrameConstants(_frameConstants);
+            }
+            program = item.program;
+            _stats.programBinds++;
+        }
+
+        if (first || item.texture != texture)
+        {
+            backend.bindTexture(item.texture);
+            texture = item.texture;
+            _stats.textureBinds++;
+        }
+
+        if (first || item.mesh != mesh || item.lod != lod)
+        {
+            backend.bindMesh(item.mesh, item.lod);
+            mesh = item.mesh;
+            lod = item.lod;
+            _stats.meshBinds++;
+        }
+        first = false;
+
+        //Everything after this that uses the same program, texture and mesh goes into one batch.
+        unsigned end = begin;
+        while (end < _sorted.size())
+        {
+            const RenderItem &next = _items[_sorted[end].index];
+            if (next.program != program || next.texture != texture || next.mesh != mesh || next.lod != lod)
+            {
+                break;
+            }
+
+            end++;
+        }
+
+        _stats.draws += backend.drawMesh(mesh, &_batch[begin * 16], begin, end - begin);
+        begin = end;
+    }
+
+    backend.finish();
+}
+
+/******************************************************************************/
+unsigned RenderQueue::getItemCount() const
+{
+    return _items.size();
+}
+
+/******************************************************************************/
+unsigned RenderQueue::getVisibleCount() const
+{
+    return _sorted.size();
+}
+
+/******************************************************************************/
+std::uint64_t RenderQueue::getKey(unsigned index) const
+{
+    return _sorted[index].key;
+}
+
+/******************************************************************************/
+const float* RenderQueue::getModel(unsigned index) const
+{
+    return _items[_sorted[index].index].model;
+}
+
+/******************************************************************************/
+const RenderStats& RenderQueue::getStats() const
+{
+    return _stats;
+}
+}; //wind
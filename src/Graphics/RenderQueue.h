@@ -0,0 +1,147 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+#include "../Physics/include/Core.h"
+#include "Frustum.h"
+#include "SceneBVH.h"
+#include "include/UniformBlocks.h"
+
+class Mesh;
+
+namespace wind
+{
+class Texture;
+class ShaderProgram3D;
+
+//What got done when the queue was last run.
+struct RenderStats
+{
+    unsigned items;
+    unsigned culled;
+    unsigned draws;
+    unsigned programBinds;
+    unsigned textureBinds;
+    unsigned meshBinds;
+};
+
+/**
+    This is the interface the render queue draws through, it only gets told when something really has to change.
+    The GL one is GLRenderBackend, anything else can be used to run the queue without a GL context.
+*/
+class RenderBackend
+{
+public:
+    virtual ~RenderBackend() {}
+
+    virtual void bindProgram(ShaderProgram3D* program) = 0;
+    //This is called after each program bind if the queue was given frame constants.
+    virtual void setFrameConstants(const FrameConstants& /*constants*/) {}
+    //The texture can be null which means no texture.
+    virtual void bindTexture(Texture* texture) = 0;
+    //The level of detail is one of the mesh's levels, the draws after this use that level.
+    virtual void bindMesh(Mesh* mesh, unsigned lod) = 0;
+
+    //This is called once before anything is drawn with every model matrix the queue is about to draw, in the order they are drawn.
+    //A backend that keeps the matrices on the GPU can put them all up at once here.
+    virtual void uploadModels(const float* /*models*/, unsigned /*count*/) {}
+
+    //This draws the bound mesh once for each model matrix, the matrices are 16 floats each.
+    //First is where the matrices start in the ones given to uploadModels. It returns how many draw calls it needed.
+    virtual unsigned drawMesh(Mesh* mesh, const float* models, unsigned first, unsigned count) = 0;
+
+    //This is called once the whole queue has been drawn.
+    virtual void finish() {}
+};
+
+/**
+    This class collects everything that is drawn in a frame and draws it in the order that needs the least state changes.
+    Each item gets a 64 bit key, from the top bit down it holds the program, the texture, the mesh, the level of detail and the depth.
+    The keys are radix sorted, and when the queue is run a program, texture or mesh is only bound if it is different from the last one.
+    Items that share all three and the same level of detail are handed to the backend together so it can draw them in one go.
+    Items submitted with a box can be frustum culled first, only what is left is sorted and drawn.
+*/
+class RenderQueue
+{
+public:
+    RenderQueue();
+
+    //This function empties the queue, the view position is used to sort near items first.
+    void begin(const Vector3 &viewPosition);
+    //The camera and colour every program in the queue is drawn with, they are handed to the backend with each program.
+    void setFrameConstants(const FrameConstants &constants);
+
+    //The model is a column major matrix like the one RigidBody::getGLTransform gives.
+    //The level of detail is usually picked with Mesh::selectLod, zero is the full mesh.
+    void submit(ShaderProgram3D* program, Texture* texture, Mesh* mesh, const float model[16], unsigned lod = 0);
+    //Items given a world space box can be culled, the ones without are always drawn.
+    void submit(ShaderProgram3D* program, Texture* texture, Mesh* mesh, const float model[16], const CullBounds &bounds, unsigned lod = 0);
+
+    //This function drops every item whose box is outside the frustum, it needs to be called before sort.
+    void cull(const Frustum &frustum, unsigned maxThreads = 0);
+
+    void sort();
+    void execute(RenderBackend &backend);
+
+    unsigned getItemCount() const;
+    //This is how many items are left after culling, the sorted order only has these in it.
+    unsigned getVisibleCount() const;
+    //These are in sorted order once sort has been called.
+    std::uint64_t getKey(unsigned index) const;
+    const float* getModel(unsigned index) const;
+
+    const RenderStats& getStats() const;
+
+    //This function builds the key for an item, the ids are cut down to fit their part of the key.
+    static std::uint64_t makeKey(unsigned programId, unsigned textureId, unsigned meshId, unsigned lod, float depth);
+
+private:
+    struct RenderItem
+    {
+        ShaderProgram3D* program;
+        Texture* texture;
+        Mesh* mesh;
+        unsigned lod;
+        float model[16];
+        CullBounds bounds;
+        bool hasBounds;
+        bool visible;
+    };
+
+    struct SortEntry
+    {
+        std::uint64_t key;
+        std::uint32_t index;
+    };
+
+    //Each program, texture and mesh is given a small id the first time we see it.
+    unsigned getId(std::unordered_map<const void*, unsigned> &ids, const void* pointer, unsigned limit);
+
+    Vector3 _viewPosition;
+    FrameConstants _frameConstants;
+    bool _hasFrameConstants;
+
+    std::vector<RenderItem> _items;
+    std::vector<SortEntry> _sorted;
+    std::vector<SortEntry> _scratch;
+    std::vector<float> _batch;
+    bool _sortedItems;
+
+    //The boxes of the items that can be culled, the tree gives back positions in this list.
+    SceneBVH _tree;
+    std::vector<CullBounds> _cullBounds;
+    std::vector<unsigned> _cullItems;
+    std::vector<unsigned> _visible;
+
+    std::unordered_map<const void*, unsigned> _programIds;
+    std::unordered_map<const void*, unsigned> _textureIds;
+    std::unordered_map<const void*, unsigned> _meshIds;
+
+    RenderStats _stats;
+};
+}; //wind
+
+#endif
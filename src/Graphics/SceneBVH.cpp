@@ -0,0 +1,328 @@
+#include "SceneBVH.h"
+
+#include <algorithm>
+
+#include "../Physics/include/parallel.h"
+
+namespace wind
+{
+
+namespace
+{
+    //Four boxes fill one SSE test.
+    const unsigned MAX_LEAF_ITEMS = 4;
+
+    //Culling a small scene is quicker than starting a thread, so we only split up big ones.
+    const unsigned MIN_ITEMS_PER_THREAD = 4096;
+
+    //Each thread gets a few subtrees so one thread with all the visible stuff doesn't hold the rest up.
+    const unsigned TASKS_PER_THREAD = 4;
+
+    float getCentre(const CullBounds &bounds, unsigned axis)
+    {
+        return (bounds.min[axis] + bounds.max[axis]) * 0.5f;
+    }
+
+    //This puts two zero bits between each of the bottom ten bits.
+    std::uint32_t spreadBits(std::uint32_t value)
+    {
+        value &= 0x3ff;
+        value = (value | (value << 16)) & 0x030000ff;
+        value = (value | (value << 8)) & 0x0300f00f;
+        value = (value | (value << 4)) & 0x030c30c3;
+        value = (value | (value << 2)) & 0x09249249;
+        return value;
+    }
+}
+
+/******************************************************************************/
+SceneBVH::SceneBVH()
+{
+}
+
+/******************************************************************************/
+void SceneBVH::build(const CullBounds* bounds, unsigned count)
+{
+    clear();
+    if (count == 0)
+    {
+        return;
+    }
+
+    _bounds.assign(bounds, bounds + count);
+    sortItems();
+
+    //A balanced tree with four per leaf has at most twice as many nodes as leaves.
+    _nodes.reserve(2 * (count / MAX_LEAF_ITEMS + 1));
+    buildNode(0, count);
+
+    //The last group of four can read past the end, so there's a little padding.
+    for (unsigned axis = 0; axis < 3; axis++)
+    {
+        _centres[axis].assign(count + MAX_LEAF_ITEMS - 1, 0.0f);
+        _extents[axis].assign(count + MAX_LEAF_ITEMS - 1, 0.0f);
+
+        for (unsigned i = 0; i < count; i++)
+        {
+            const CullBounds &item = _bounds[_items[i]];
+            _centres[axis][i] = getCentre(item, axis);
+            _extents[axis][i] = (item.max[axis] - item.min[axis]) * 0.5f;
+        }
+    }
+}
+
+/******************************************************************************/
+void SceneBVH::clear()
+{
+    _nodes.clear();
+    _bounds.clear();
+    _items.clear();
+    for (unsigned axis = 0; axis < 3; axis++)
+    {
+        _centres[axis].clear();
+        _extents[axis].clear();
+    }
+}
+
+/******************************************************************************/
+void SceneBVH::sortItems()
+{
+    unsigned count = _bounds.size();
+
+    float low[3];
+    float high[3];
+    for (unsigned axis = 0; axis < 3; axis++)
+    {
+        low[axis] = high[axis] = getCentre(_bounds[0], axis);
+    }
+
+    for (unsigned i = 1; i < count; i++)
+    {
+        for (unsigned axis = 0; axis < 3; axis++)
+        {
+            float centre = getCentre(_bounds[i], axis);
+            low[axis] = std::min(low[axis], centre);
+            high[axis] = std::max(high[axis], centre);
+        }
+    }
+
+    //Each centre is cut down to ten bits an axis and the bits are woven together, things close in space end up close in the list.
+    _sortKeys.resize(count);
+    _sortScratch.resize(count);
+    for (unsigned i = 0; i < count; i++)
+    {
+        std::uint32_t code = 0;
+        for (unsigned axis = 0; axis < 3; axis++)
+        {
+            float size = high[axis] - low[axis];
+            float scaled = size > 0.0f ? (getCentre(_bounds[i], axis) - low[axis]) / size * 1023.0f : 0.0f;
+            code |= spreadBits(static_cast<std::uint32_t>(scaled)) << axis;
+        }
+
+        _sortKeys[i] = (static_cast<std::uint64_t>(code) << 32) | i;
+    }
+
+    //The codes are 30 bits so the radix sort only needs four passes of eight bits.
+    for (unsigned shift = 32; shift < 64; shift += 8)
+    {
+        unsigned histogram[257] = { 0 };
+        for (unsigned i = 0; i < count; i++)
+        {
+            histogram[((_sortKeys[i] >> shift) & 0xff) + 1]++;
+        }
+
+        for (unsigned i = 0; i < 256; i++)
+        {
+            histogram[i + 1] += histogram[i];
+        }
+
+        for (unsigned i = 0; i < count; i++)
+        {
+            _sortScratch[histogram[(_sortKeys[i] >> shift) & 0xff]++] = _sortKeys[i];
+        }
+
+        _sortKeys.swap(_sortScratch);
+    }
+
+    _items.resize(count);
+    for (unsigned i = 0; i < count; i++)
+    {
+        _items[i] = static_cast<unsigned>(_sortKeys[i] & 0xffffffff);
+    }
+}
+
+/******************************************************************************/
+unsigned SceneBVH::buildNode(unsigned first, unsigned count)
+{
+    unsigned index = _nodes.size();
+    _nodes.push_back(Node());
+
+    CullBounds bounds;
+    unsigned right = 0;
+
+    if (count > MAX_LEAF_ITEMS)
+    {
+        //The items are already in Morton order, so each half of the range is a block of space.
+        unsigned half = count / 2;
+        unsigned left = buildNode(first, half);
+        right = buildNode(first + half, count - half);
+
+        //The node's box is just the box around it's two children.
+        const CullBounds &leftBounds = _nodes[left].bounds;
+        const CullBounds &rightBounds = _nodes[right].bounds;
+        for (unsigned i = 0; i < 3; i++)
+        {
+            bounds.min[i] = std::min(leftBounds.min[i], rightBounds.min[i]);
+            bounds.max[i] = std::max(leftBounds.max[i], rightBounds.max[i]);
+        }
+    }
+    else
+    {
+        bounds = _bounds[_items[first]];
+        for (unsigned i = first + 1; i < first + count; i++)
+        {
+            const CullBounds &item = _bounds[_items[i]];
+            for (unsigned axis = 0; axis < 3; axis++)
+            {
+                bounds.min[axis] = std::min(bounds.min[axis], item.min[axis]);
+                bounds.max[axis] = std::max(bounds.max[axis], item.max[axis]);
+            }
+        }
+    }
+
+    Node &node = _nodes[index];
+    node.bounds = bounds;
+    node.first = first;
+    node.count = count;
+    node.right = right;
+
+    return index;
+}
+
+/******************************************************************************/
+void SceneBVH::cull(const Frustum &frustum, std::vector<unsigned> &visible, unsigned maxThreads)
+{
+    visible.clear();
+    if (_nodes.empty())
+    {
+        return;
+    }
+
+    unsigned threads = parallelThreadCount(_items.size(), MIN_ITEMS_PER_THREAD, maxThreads);
+    if (threads == 1)
+    {
+        cullNode(frustum, 0, visible);
+        return;
+    }
+
+    //Firstly we walk the top of the tree a level at a time until we have enough subtrees to share out.
+    //Anything that is fully in or out on the way down is dealt with here.
+    std::vector<unsigned> pending(1, 0);
+    unsigned target = threads * TASKS_PER_THREAD;
+    _tasks.clear();
+
+    for (unsigned head = 0; head < pending.size(); head++)
+    {
+        const Node &node = _nodes[pending[head]];
+        CullResult result = frustum.testBox(node.bounds);
+
+        if (result == CULL_OUTSIDE)
+        {
+            continue;
+        }
+
+        if (result == CULL_INSIDE)
+        {
+            addItems(node, visible);
+        }
+        else if (node.right == 0 || _tasks.size() + pending.size() - head >= target)
+        {
+            _tasks.push_back(pending[head]);
+        }
+        else
+        {
+            pending.push_back(pending[head] + 1);
+            pending.push_back(node.right);
+        }
+    }
+
+    //Each subtree fills it's own list so the threads never share anything.
+    if (_taskVisible.size() < _tasks.size())
+    {
+        _taskVisible.resize(_tasks.size());
+    }
+
+    parallelFor(_tasks.size(), 1, [&](unsigned begin, unsigned end)
+    {
+        for (unsigned i = begin; i < end; i++)
+        {
+            _taskVisible[i].clear();
+            cullNode(frustum, _tasks[i], _taskVisible[i]);
+        }
+    }, threads);
+
+    for (unsigned i = 0; i < _tasks.size(); i++)
+    {
+        visible.insert(visible.end(), _taskVisible[i].begin(), _taskVisible[i].end());
+    }
+}
+
+/******************************************************************************/
+void SceneBVH::cullNode(const Frustum &frustum, unsigned index, std::vector<unsigned> &visible) const
+{
+    const Node &node = _nodes[index];
+    CullResult result = frustum.testBox(node.bounds);
+
+    if (result == CULL_OUTSIDE)
+    {
+        return;
+    }
+
+    if (result == CULL_INSIDE)
+    {
+        addItems(node, visible);
+        return;
+    }
+
+    if (node.right != 0)
+    {
+        cullNode(frustum, index + 1, visible);
+        cullNode(frustum, node.right, visible);
+        return;
+    }
+
+    //A leaf's items are tested four at a time, anything past the end of the leaf is ignored.
+    for (unsigned i = node.first; i < node.first + node.count; i += 4)
+    {
+        unsigned mask = frustum.testBoxes4(&_centres[0][i], &_centres[1][i], &_centres[2][i],
+                                           &_extents[0][i], &_extents[1][i], &_extents[2][i]);
+
+        unsigned end = std::min(node.first + node.count, i + 4);
+        for (unsigned j = i; j < end; j++)
+        {
+            if (mask & (1u << (j - i)))
+            {
+                visible.push_back(_items[j]);
+            }
+        }
+    }
+}
+
+/******************************************************************************/
+void SceneBVH::addItems(const Node &node, std::vector<unsigned> &visible) const
+{
+    visible.insert(visible.end(), _items.begin() + node.first, _items.begin() + node.first + node.count);
+}
+
+/******************************************************************************/
+unsigned SceneBVH::getItemCount() const
+{
+    return _items.size();
+}
+
+/******************************************************************************/
+unsigned SceneBVH::getNodeCount() const
+{
+    return _nodes.size();
+}
+}; //wind
@@ -0,0 +1,65 @@
+#ifndef SCENE_BVH_H
+#define SCENE_BVH_H
+
+#include <vector>
+#include <cstdint>
+
+#include "Frustum.h"
+
+namespace wind
+{
+/**
+    This is a bounding volume tree over the boxes of everything in the scene, it is only used to find what the camera can see.
+    It is rebuilt from scratch each time the boxes change. The boxes are sorted along a Morton curve and the list is cut in half
+    at each level, so the build is linear and the tree is always balanced.
+    Leaves hold up to four boxes which are tested against the frustum together, and a node that is fully inside the frustum
+    takes everything under it without any more tests.
+    Big trees are culled across the cores, the top of the tree is walked first and the subtrees it finds are shared out.
+*/
+class SceneBVH
+{
+public:
+    SceneBVH();
+
+    void build(const CullBounds* bounds, unsigned count);
+    void clear();
+
+    //This fills visible with the index of every box that might be seen, the list isn't in any order.
+    void cull(const Frustum &frustum, std::vector<unsigned> &visible, unsigned maxThreads = 0);
+
+    unsigned getItemCount() const;
+    unsigned getNodeCount() const;
+
+private:
+    struct Node
+    {
+        CullBounds bounds;
+        //Every node covers the items from first to first + count, the right child is zero for a leaf.
+        //The left child is always the next node.
+        unsigned first;
+        unsigned count;
+        unsigned right;
+    };
+
+    //This puts the items in Morton order of their centres, after that the tree is built by cutting the list in half.
+    void sortItems();
+    unsigned buildNode(unsigned first, unsigned count);
+    void cullNode(const Frustum &frustum, unsigned node, std::vector<unsigned> &visible) const;
+    void addItems(const Node &node, std::vector<unsigned> &visible) const;
+
+    std::vector<Node> _nodes;
+    std::vector<CullBounds> _bounds;
+    std::vector<std::uint64_t> _sortKeys;
+    std::vector<std::uint64_t> _sortScratch;
+    //The items in tree order, so each leaf's items sit next to each other.
+    std::vector<unsigned> _items;
+    //The centre and half size of each item in tree order, split up so four can be loaded at once.
+    std::vector<float> _centres[3];
+    std::vector<float> _extents[3];
+
+    std::vector<unsigned> _tasks;
+    std::vector<std::vector<unsigned>> _taskVisible;
+};
+}; //wind
+
+#endif
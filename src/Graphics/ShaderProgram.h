@@ -11,13 +11,16 @@
 
 namespace wind
 {
+class ShaderRegistry;
+
 class ShaderProgram
 {
 public:
     ShaderProgram();
     virtual ~ShaderProgram();
 
-    virtual bool loadProgram() = 0;
+    //The program comes from the registry, so programs with the same shaders are only compiled once.
+    virtual bool loadProgram(ShaderRegistry &registry) = 0;
     virtual void freeProgram();
 
     void bind();
@@ -26,27 +29,11 @@ public:
     GLuint getProgramID() const;
 
 protected:
-    enum
-    {
-        VERTEX_SHADER,
-        FRAGMENT_SHADER,
-
-        TOTAL_SHADERS
-    };
-protected:
-
-    void printProgramLog(GLuint program) const;
-    void printShaderLog(GLuint shader) const;
-
-    GLuint loadShaderFromFile(const std::string &path, GLenum shaderType);
-
-    void compileShaders();
-    void addVertexShader(const std::string &filepath);
-    void addFragmentShader(const std::string &filepath);
-    GLuint buildShaders(const std::string &vertexFilePath, const std::string &fragmentFilePath);
+    //This gets the program for the two shaders from the registry, it returns false if they wouldn't compile.
+    bool loadShaders(ShaderRegistry &registry, const std::string &vertexFilePath, const std::string &fragmentFilePath);
 
     GLuint _programID;
-    GLuint _shaders[TOTAL_SHADERS];
+    ShaderRegistry *_registry;
 };
 }; //wind
 #endif
@@ -22,10 +22,12 @@ void ShaderProgram2D::enableBlend()
 }
 
 /******************************************************************************/
-bool ShaderProgram2D::loadProgram()
+bool ShaderProgram2D::loadProgram(ShaderRegistry &registry)
 {
-    buildShaders("res/2DFragShader.vsh", "res/2DFragShader.fsh");
-    compileShaders();
+    if (!loadShaders(registry, "res/2DFragShader.vsh", "res/2DFragShader.fsh"))
+    {
+        return false;
+    }
 
     _vertexPos2DLocation = glGetAttribLocation(_programID, "vertexPosition2D");
     if (_vertexPos2DLocation == -1)
@@ -21,7 +21,7 @@ public:
     ShaderProgram2D();
 
     void enableBlend();
-    bool loadProgram();
+    bool loadProgram(ShaderRegistry &registry);
 
     void setVertexPointer(GLsizei stride, const GLvoid* data);
     void setTexCoordPointer(GLsizei stride, const GLvoid* data);
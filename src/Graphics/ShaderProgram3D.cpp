@@ -1,12 +1,16 @@
 #include "ShaderProgram3D.h"
 
+#include <cstring>
+
 namespace wind
 {
 /******************************************************************************/
 ShaderProgram3D::ShaderProgram3D() : _vertexPos3DLocation(0), _indicesPos3DLocation(0),
 _texCoordLocation(0), _textColourLocation(0), _textureUnitLocation(0),
-_modelLocation(0), _cameraLocation(0), _normalLocation(0)
+_modelLocation(0), _cameraLocation(0), _normalLocation(0), _instanced(false), _instanceModelLocation(-1),
+_frameBlock(false), _objectBlock(false), _frameDirty(false)
 {
+    memset(&_frameConstants, 0, sizeof(_frameConstants));
     glClearColor(0.9f, 0.95f, 1.0f, 1.0f);
     glViewport(0.f, 0.f, 800, 600);
 }
@@ -22,10 +26,12 @@ void ShaderProgram3D::disableBlend()
 }
 
 /******************************************************************************/
-bool ShaderProgram3D::loadProgram()
+bool ShaderProgram3D::loadProgram(ShaderRegistry &registry)
 {
-    buildShaders("res/basicShader.vsh", "res/basicShader.fsh");
-    compileShaders();
+    if (!loadShaders(registry, "res/basicShader.vsh", "res/basicShader.fsh"))
+    {
+        return false;
+    }
 
     _vertexPos3DLocation = glGetAttribLocation(_programID, "vertexPosition3D");
     if (_vertexPos3DLocation == -1)
@@ -45,8 +51,29 @@ bool ShaderProgram3D::loadProgram()
         std::cerr << "normal is not a valid glsl program variable!" << std::endl;
     }
 
+    //The camera, the colour and the model matrix can come from uniform blocks instead of their own uniforms, see UniformBuffer.h.
+    _frameBlock = false;
+    _objectBlock = false;
+    if (UniformBuffer::isSupported())
+    {
+        GLuint frameIndex = glGetUniformBlockIndex(_programID, "FrameConstants");
+        if (frameIndex != GL_INVALID_INDEX)
+        {
+            glUniformBlockBinding(_programID, frameIndex, FRAME_CONSTANTS_BINDING);
+            _frameBlock = true;
+        }
+
+        GLuint objectIndex = glGetUniformBlockIndex(_programID, "ObjectConstants");
+        if (objectIndex != GL_INVALID_INDEX)
+        {
+            glUniformBlockBinding(_programID, objectIndex, OBJECT_CONSTANTS_BINDING);
+            _objectBlock = true;
+        }
+    }
+    _frameDirty = _frameBlock;
+
     _textColourLocation = glGetUniformLocation(_programID, "texColour");
-    if (_textColourLocation == -1)
+    if (_textColourLocation == -1 && !_frameBlock)
     {
         std::cerr << "textColour is not a valid glsl program variable!" << std::endl;
     }
@@ -58,17 +85,27 @@ bool ShaderProgram3D::loadProgram()
     }
 
     _cameraLocation = glGetUniformLocation(_programID, "camera");
-    if (_cameraLocation == -1)
+    if (_cameraLocation == -1 && !_frameBlock)
     {
         std::cerr << "camera is not a valid glsl program variable!" << std::endl;
     }
 
+    //A shader can either take the model matrix as a uniform or as a per instance mat4 attribute called instanceModel.
     _modelLocation = glGetUniformLocation(_programID, "model");
-    if (_modelLocation == -1)
+    _instanceModelLocation = glGetAttribLocation(_programID, "instanceModel");
+    if (_modelLocation == -1 && _instanceModelLocation == -1 && !_objectBlock)
     {
         std::cerr << "model is not a valid glsl program variable!" << std::endl;
     }
 
+    _instanced = _instanceModelLocation != -1 && InstanceBuffer::isSupported();
+    if (_instanceModelLocation != -1 && !_instanced)
+    {
+        std::cerr << "instanceModel needs instanced arrays which this driver doesn't have!" << std::endl;
+    }
+    //Instances bring their own model matrix, so the block is only used when they aren't.
+    _objectBlock = _objectBlock && !_instanced;
+
     return true;
 }
 
@@ -175,6 +212,21 @@ void ShaderProgram3D::updateCamera(const Camera &cam)
     Matrix4x4 viewProjection = cam.getVP();
     //When then turn that matrix to a GLfloat matrix and pass it into the shader by a uniform.
     viewProjection.getGLTransform(_finalProjection);
+
+    if (_frameBlock)
+    {
+        //With a frame block it goes up with everything else in the block when the first thing is drawn.
+        memcpy(_frameConstants.viewProjection, _finalProjection, sizeof(_finalProjection));
+
+        Vector3 position = cam.getBody().getPosition();
+        _frameConstants.cameraPosition[0] = (GLfloat)position.x;
+        _frameConstants.cameraPosition[1] = (GLfloat)position.y;
+        _frameConstants.cameraPosition[2] = (GLfloat)position.z;
+        _frameConstants.cameraPosition[3] = 1.f;
+        _frameDirty = true;
+        return;
+    }
+
     glUniformMatrix4fv(_cameraLocation, 1, GL_FALSE, _finalProjection);
 }
 
@@ -198,12 +250,162 @@ void ShaderProgram3D::updateModel(const std::vector<std::unique_ptr<wind::RigidB
     }
 }
 
+/******************************************************************************/
+void ShaderProgram3D::drawInstances(Mesh* mesh, unsigned int count)
+{
+    commitFrame();
+    GLintptr offset = _instanceBuffer.write(&_instanceData[0], count * 16 * sizeof(GLfloat));
+    mesh->DrawInstanced(count, _instanceBuffer.getBuffer(), offset, _instanceModelLocation);
+}
+
+/******************************************************************************/
+unsigned int ShaderProgram3D::drawMeshes(Mesh* mesh, const GLfloat* models, unsigned int count)
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    commitFrame();
+
+    if (_objectBlock)
+    {
+        return drawObjects(mesh, writeObjects(models, count), 0, count);
+    }
+
+    if (_instanced)
+    {
+        GLintptr offset = _instanceBuffer.write(models, count * 16 * sizeof(GLfloat));
+        mesh->drawInstancedBound(count, _instanceBuffer.getBuffer(), offset, _instanceModelLocation);
+        return 1;
+    }
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        glUniformMatrix4fv(_modelLocation, 1, GL_FALSE, models + i * 16);
+        mesh->drawBound();
+    }
+    return count;
+}
+
+/******************************************************************************/
+GLintptr ShaderProgram3D::writeObjects(const GLfloat* models, unsigned int count)
+{
+    //The matrices are packed one after another, which is exactly an array of ObjectConstants.
+    return _objectBuffer.writeBlocks(models, sizeof(ObjectConstants), count);
+}
+
+/******************************************************************************/
+unsigned int ShaderProgram3D::drawObjects(Mesh* mesh, GLintptr offset, unsigned int first, unsigned int count)
+{
+    commitFrame();
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        bindObject(offset, first + i);
+        mesh->drawBound();
+    }
+    return count;
+}
+
+/******************************************************************************/
+void ShaderProgram3D::bindObject(GLintptr offset, unsigned int index)
+{
+    _objectBuffer.bindRange(OBJECT_CONSTANTS_BINDING, offset + index * UniformBuffer::getStride(sizeof(ObjectConstants)),
+                            sizeof(ObjectConstants));
+}
+
+/******************************************************************************/
+void ShaderProgram3D::commitFrame()
+{
+    if (!_frameDirty)
+    {
+        return;
+    }
+
+    GLintptr offset = _frameBuffer.write(&_frameConstants, sizeof(FrameConstants));
+    _frameBuffer.bindRange(FRAME_CONSTANTS_BINDING, offset, sizeof(FrameConstants));
+    _frameDirty = false;
+}
+
+/******************************************************************************/
+void ShaderProgram3D::endFrame()
+{
+    _instanceBuffer.endFrame();
+    _frameBuffer.endFrame();
+    _objectBuffer.endFrame();
+
+    //The binding points are shared, so next frame's block is bound again even if nothing in it changed.
+    _frameDirty = _frameBlock;
+}
+
+/******************************************************************************/
+bool ShaderProgram3D::isInstanced() const
+{
+    return _instanced;
+}
+
+/******************************************************************************/
+bool ShaderProgram3D::hasFrameBlock() const
+{
+    return _frameBlock;
+}
+
+/******************************************************************************/
+bool ShaderProgram3D::hasObjectBlock() const
+{
+    return _objectBlock;
+}
+
 /******************************************************************************/
 void ShaderProgram3D::setTextColor(ColourRGBA colour)
 {
+    if (_frameBlock)
+    {
+        _frameConstants.colour[0] = colour.r;
+        _frameConstants.colour[1] = colour.g;
+        _frameConstants.colour[2] = colour.b;
+        _frameConstants.colour[3] = colour.a;
+        _frameDirty = true;
+        return;
+    }
+
     glUniform4f(_textColourLocation, colour.r, colour.g, colour.b, colour.a);
 }
 
+/******************************************************************************/
+void ShaderProgram3D::setFrameConstants(const FrameConstants &constants)
+{
+    if (_frameBlock)
+    {
+        _frameConstants = constants;
+        _frameDirty = true;
+        return;
+    }
+
+    glUniformMatrix4fv(_cameraLocation, 1, GL_FALSE, constants.viewProjection);
+    glUniform4fv(_textColourLocation, 1, constants.colour);
+}
+
+/******************************************************************************/
+FrameConstants ShaderProgram3D::makeFrameConstants(const Camera &cam, const ColourRGBA &colour)
+{
+    FrameConstants constants;
+    cam.getVP().getGLTransform(constants.viewProjection);
+
+    Vector3 position = cam.getBody().getPosition();
+    constants.cameraPosition[0] = (GLfloat)position.x;
+    constants.cameraPosition[1] = (GLfloat)position.y;
+    constants.cameraPosition[2] = (GLfloat)position.z;
+    constants.cameraPosition[3] = 1.f;
+
+    constants.colour[0] = colour.r;
+    constants.colour[1] = colour.g;
+    constants.colour[2] = colour.b;
+    constants.colour[3] = colour.a;
+    return constants;
+}
+
 /******************************************************************************/
 void ShaderProgram3D::setTextureUnit(GLuint unit)
 {
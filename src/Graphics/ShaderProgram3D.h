@@ -5,12 +5,15 @@
 #include <iostream>
 #include <memory>
 #include <vector>
+#include <algorithm>
 
 #include "Texture.h"
 #include "include/ColourRGBA.h"
 #include "ShaderProgram.h"
 #include "../Camera.h"
 #include "Mesh.h"
+#include "InstanceBuffer.h"
+#include "UniformBuffer.h"
 
 namespace wind
 {
@@ -20,7 +23,7 @@ public:
     ShaderProgram3D();
 
     void disableBlend();
-    bool loadProgram();
+    bool loadProgram(ShaderRegistry &registry);
 
     void setVertexPointer(GLsizei stride, const GLvoid* data);
     void setIndicesPointer(GLsizei stride, const GLvoid* data);
@@ -48,6 +51,10 @@ public:
     void setTextColor(ColourRGBA colour);
     void setTextureUnit(GLuint unit);
 
+    //This sets the camera and the colour together, through the frame block if the shader has one or their uniforms if not.
+    void setFrameConstants(const FrameConstants &constants);
+    static FrameConstants makeFrameConstants(const Camera &cam, const ColourRGBA &colour);
+
     void updateModel(const std::vector<std::unique_ptr<wind::RigidBody>>& transforms, 
                      const std::vector<std::unique_ptr<Mesh>>& mesh);
     void updateCamera(const Camera &cam);
@@ -56,9 +63,67 @@ public:
                 const std::vector<std::unique_ptr<Mesh>>& mesh, const Camera &cam);
 
     //This template model takes in the a vector of the models of the same type and renders them.
+    //If the shader has an instanceModel attribute every model sharing a mesh is drawn with one instanced draw.
     template<typename T>
-    void drawModels(T mesh)
+    void drawModels(const T& mesh)
     {
+        if (_instanced)
+        {
+            //Firstly we sort the models by the mesh they use, then each run of the same mesh becomes one draw.
+            _instanceOrder.clear();
+            for (unsigned int i = 0; i < mesh.size(); i++)
+            {
+                Mesh* model = getMeshPointer(mesh.at(i)->getMesh());
+                if (model != nullptr && model->isLoaded())
+                {
+                    _instanceOrder.push_back(std::make_pair(model, i));
+                }
+            }
+            std::sort(_instanceOrder.begin(), _instanceOrder.end());
+
+            unsigned int begin = 0;
+            while (begin < _instanceOrder.size())
+            {
+                unsigned int end = begin;
+                _instanceData.clear();
+                while (end < _instanceOrder.size() && _instanceOrder[end].first == _instanceOrder[begin].first)
+                {
+                    _instanceData.resize(_instanceData.size() + 16);
+                    mesh.at(_instanceOrder[end].second)->getBody()->getGLTransform(&_instanceData[_instanceData.size() - 16]);
+                    end++;
+                }
+
+                drawInstances(_instanceOrder[begin].first, end - begin);
+                begin = end;
+            }
+            return;
+        }
+
+        commitFrame();
+
+        if (_objectBlock)
+        {
+            if (mesh.empty())
+            {
+                return;
+            }
+
+            //All of the model matrices go up in one write, then each draw just points the block at its own matrix.
+            _instanceData.resize(mesh.size() * 16);
+            for (unsigned int i = 0; i < mesh.size(); i++)
+            {
+                mesh.at(i)->getBody()->getGLTransform(&_instanceData[i * 16]);
+            }
+
+            GLintptr offset = writeObjects(&_instanceData[0], mesh.size());
+            for (unsigned int i = 0; i < mesh.size(); i++)
+            {
+                bindObject(offset, i);
+                mesh.at(i)->draw();
+            }
+            return;
+        }
+
         for (unsigned int i = 0; i < mesh.size(); i++)
         {
             //Each model needs it's own matrix model for translation that's why we recreate the GLfloat[] every loop
@@ -75,19 +140,58 @@ public:
 
     //This template model takes in the a single models of the same type and renders them.
     template<typename T>
-    void drawModel(T mesh)
+    void drawModel(const T& mesh)
     {
+        if (_instanced)
+        {
+            //The shader reads the model matrix from the instance data so a single model is just one instance.
+            Mesh* model = getMeshPointer(mesh->getMesh());
+            if (model != nullptr && model->isLoaded())
+            {
+                _instanceData.resize(16);
+                mesh->getBody()->getGLTransform(&_instanceData[0]);
+                drawInstances(model, 1);
+            }
+            return;
+        }
+
+        commitFrame();
+
         //Each model needs it's own matrix model for translation that's why we recreate the GLfloat[] every loop
         GLfloat tempModel[16] = { 0 };
         //Note: That this rotation is using RigidBody motion rather than any all transform matrix.
         mesh->getBody()->getGLTransform(tempModel);
 
+        if (_objectBlock)
+        {
+            bindObject(writeObjects(tempModel, 1), 0);
+            mesh->draw();
+            return;
+        }
+
         //Then each matrix is passed into the shader but we need to add 1 to the starting position as not to conflict with the model view projection transform.
         glUniformMatrix4fv(_modelLocation, 1, GL_FALSE, tempModel);
 
         mesh->draw();
     }
 
+    //This draws a mesh that has already been bound once for each of the model matrices, the matrices are 16 floats each.
+    //It returns how many draw calls were made.
+    unsigned int drawMeshes(Mesh* mesh, const GLfloat* models, unsigned int count);
+
+    //When the shader has an ObjectConstants block the model matrices can be written once up front and drawn later by where they went.
+    //writeObjects returns the offset of the first one, drawObjects draws the bound mesh with count of them starting at first.
+    GLintptr writeObjects(const GLfloat* models, unsigned int count);
+    unsigned int drawObjects(Mesh* mesh, GLintptr offset, unsigned int first, unsigned int count);
+
+    //This needs to be called once everything has been drawn for the frame.
+    void endFrame();
+
+    bool isInstanced() const;
+    //These are true if the shader takes the camera and colour, or the model matrix, from a uniform block.
+    bool hasFrameBlock() const;
+    bool hasObjectBlock() const;
+
 public:
     //Attribute locations
     GLint _vertexPos3DLocation;
@@ -111,6 +215,30 @@ public:
 
     //Modelview matrix
     Matrix4x4 _modelViewMatrix;
+
+private:
+    static Mesh* getMeshPointer(Mesh* mesh) { return mesh; }
+    static Mesh* getMeshPointer(const std::shared_ptr<Mesh>& mesh) { return mesh.get(); }
+
+    //This uploads the matrices in the instance data and draws that many instances of the mesh.
+    void drawInstances(Mesh* mesh, unsigned int count);
+
+    //The frame constants are only written when something draws after they change, so the camera and colour go up together.
+    void commitFrame();
+    void bindObject(GLintptr offset, unsigned int index);
+
+    bool _instanced;
+    GLint _instanceModelLocation;
+    InstanceBuffer _instanceBuffer;
+    std::vector<GLfloat> _instanceData;
+    std::vector<std::pair<Mesh*, unsigned int>> _instanceOrder;
+
+    bool _frameBlock;
+    bool _objectBlock;
+    bool _frameDirty;
+    FrameConstants _frameConstants;
+    UniformBuffer _frameBuffer;
+    UniformBuffer _objectBuffer;
 };
 }; //wind
 #endif
@@ -0,0 +1,423 @@
+#include "ShaderRegistry.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <GL/glu.h>
+
+#include "AtomicFile.h"
+#include "CookedMesh.h"
+#include "MappedFile.h"
+
+namespace wind
+{
+
+namespace
+{
+    const char BINARY_MAGIC[4] = { 'W', 'P', 'R', 'G' };
+    const std::uint32_t BINARY_VERSION = 1;
+}
+
+/******************************************************************************/
+ShaderRegistry::ShaderRegistry() : _binaryCacheEnabled(true), _driverHash(0), _compileCount(0), _binaryLoadCount(0)
+{
+}
+
+/******************************************************************************/
+ShaderRegistry::~ShaderRegistry()
+{
+    for (auto it = _programs.begin(); it != _programs.end(); ++it)
+    {
+        glDeleteProgram(it->second.program);
+    }
+}
+
+/******************************************************************************/
+GLuint ShaderRegistry::acquire(const std::string &vertexFilePath, const std::string &fragmentFilePath)
+{
+    std::string vertexSource, fragmentSource;
+    if (!readSource(vertexFilePath, vertexSource) || !readSource(fragmentFilePath, fragmentSource))
+    {
+        return 0;
+    }
+
+    //The zero keeps the two sources apart, so moving code from one shader to the other still changes the hash.
+    std::string sources = vertexSource;
+    sources.push_back('\0');
+    sources += fragmentSource;
+    std::uint64_t sourceHash = CookedMesh::hashData(sources.data(), sources.size());
+
+    auto found = _programs.find(sourceHash);
+    if (found != _programs.end())
+    {
+        found->second.references++;
+        return found->second.program;
+    }
+
+    std::string binaryPath = getBinaryPath(vertexFilePath, fragmentFilePath);
+
+    GLuint program = 0;
+    if (isBinaryCacheSupported())
+    {
+        program = loadBinary(binaryPath, sourceHash);
+    }
+
+    if (program == 0)
+    {
+        program = compileProgram(vertexSource, fragmentSource, vertexFilePath, fragmentFilePath);
+        if (program == 0)
+        {
+            return 0;
+        }
+
+        if (isBinaryCacheSupported())
+        {
+            saveBinary(program, binaryPath, sourceHash);
+        }
+    }
+
+    Entry entry = { program, 1 };
+    _programs[sourceHash] = entry;
+    _sourceHashes[program] = sourceHash;
+    return program;
+}
+
+/******************************************************************************/
+void ShaderRegistry::release(GLuint program)
+{
+    auto found = _sourceHashes.find(program);
+    if (found == _sourceHashes.end())
+    {
+        return;
+    }
+
+    Entry &entry = _programs[found->second];
+    if (--entry.references == 0)
+    {
+        glDeleteProgram(program);
+        _programs.erase(found->second);
+        _sourceHashes.erase(found);
+    }
+}
+
+/******************************************************************************/
+void ShaderRegistry::setBinaryCacheEnabled(bool enabled)
+{
+    _binaryCacheEnabled = enabled;
+}
+
+/******************************************************************************/
+bool ShaderRegistry::isBinaryCacheSupported() const
+{
+    if (!_binaryCacheEnabled || !(GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary))
+    {
+        return false;
+    }
+
+    //Some drivers have the functions but no formats to save in.
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+/******************************************************************************/
+std::string ShaderRegistry::getBinaryPath(const std::string &vertexFilePath, const std::string &fragmentFilePath)
+{
+    //The binary sits next to the vertex shader, the fragment shader's name is hashed in since a vertex shader can be used twice.
+    std::uint64_t fragmentHash = CookedMesh::hashData(fragmentFilePath.data(), fragmentFilePath.size());
+
+    char name[32];
+    snprintf(name, sizeof(name), ".%016llx.wprog", static_cast<unsigned long long>(fragmentHash));
+    return vertexFilePath + name;
+}
+
+/******************************************************************************/
+unsigned ShaderRegistry::getProgramCount() const
+{
+    return _programs.size();
+}
+
+/******************************************************************************/
+unsigned ShaderRegistry::getCompileCount() const
+{
+    return _compileCount;
+}
+
+/******************************************************************************/
+unsigned ShaderRegistry::getBinaryLoadCount() const
+{
+    return _binaryLoadCount;
+}
+
+/******************************************************************************/
+GLuint ShaderRegistry::loadBinary(const std::string &binaryPath, std::uint64_t sourceHash)
+{
+    MappedFile file;
+    if (!file.open(binaryPath) || file.getSize() < sizeof(ProgramBinaryHeader))
+    {
+        return 0;
+    }
+
+    const ProgramBinaryHeader* header = reinterpret_cast<const ProgramBinaryHeader*>(file.getData());
+    bool valid = memcmp(header->magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0 &&
+                 header->version == BINARY_VERSION &&
+                 header->driverHash == getDriverHash() &&
+                 header->sourceHash == sourceHash &&
+                 header->binarySize <= file.getSize() - sizeof(ProgramBinaryHeader);
+    if (!valid)
+    {
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header->binaryFormat, file.getData() + sizeof(ProgramBinaryHeader), header->binarySize);
+
+    //The driver can still turn a binary down, after an update for example, so we check it linked before using it.
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked != GL_TRUE)
+    {
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    _binaryLoadCount++;
+    return program;
+}
+
+/******************************************************************************/
+void ShaderRegistry::saveBinary(GLuint program, const std::string &binaryPath, std::uint64_t sourceHash)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+    {
+        return;
+    }
+
+    ProgramBinaryHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    header.version = BINARY_VERSION;
+    header.driverHash = getDriverHash();
+    header.sourceHash = sourceHash;
+
+    std::vector<char> binary(length);
+    GLsizei written = 0;
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &written, &format, &binary[0]);
+    if (written <= 0)
+    {
+        return;
+    }
+    header.binaryFormat = format;
+    header.binarySize = written;
+
+    AtomicFile file;
+    if (file.open(binaryPath))
+    {
+        file.write(&header, sizeof(header));
+        file.write(&binary[0], written);
+        file.commit();
+    }
+}
+
+/******************************************************************************/
+GLuint ShaderRegistry::compileProgram(const std::string &vertexSource, const std::string &fragmentSource,
+                                      const std::string &vertexFilePath, const std::string &fragmentFilePath)
+{
+    GLuint vertexShader = compileShader(vertexSource, vertexFilePath, GL_VERTEX_SHADER);
+    if (vertexShader == 0)
+    {
+        return 0;
+    }
+
+    GLuint fragmentShader = compileShader(fragmentSource, fragmentFilePath, GL_FRAGMENT_SHADER);
+    if (fragmentShader == 0)
+    {
+        glDeleteShader(vertexShader);
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+
+    //The driver has to be told up front that we want the binary back.
+    if (isBinaryCacheSupported())
+    {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    glLinkProgram(program);
+
+    GLint programSuccess = GL_TRUE;
+    glGetProgramiv(program, GL_LINK_STATUS, &programSuccess);
+    if (programSuccess != GL_TRUE)
+    {
+        std::cerr << "Error linking program: " << program << std::endl;
+        printProgramLog(program);
+        glDeleteProgram(program);
+        program = 0;
+    }
+    else
+    {
+        glValidateProgram(program);
+
+        glGetProgramiv(program, GL_VALIDATE_STATUS, &programSuccess);
+        if (programSuccess != GL_TRUE)
+        {
+            std::cerr << "Error validating program: " << program << std::endl;
+            printProgramLog(program);
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+
+    //Clean up excess shader references
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    if (program != 0)
+    {
+        _compileCount++;
+    }
+
+    return program;
+}
+
+/******************************************************************************/
+bool ShaderRegistry::readSource(const std::string &filePath, std::string &source)
+{
+    MappedFile file;
+    if (!file.open(filePath))
+    {
+        std::cerr << "Unable to open file " << filePath << std::endl;
+        return false;
+    }
+
+    source.assign(file.getData(), file.getSize());
+    return true;
+}
+
+/******************************************************************************/
+GLuint ShaderRegistry::compileShader(const std::string &source, const std::string &filePath, GLenum shaderType)
+{
+    //Create shader ID
+    GLuint shaderID = glCreateShader(shaderType);
+
+    //Set shader source
+    const GLchar* shaderSourceChar[1] = { source.c_str() };
+    GLint shaderSourceLength[1] = { static_cast<GLint>(source.length()) };
+    glShaderSource(shaderID, 1, shaderSourceChar, shaderSourceLength);
+
+    //Compile shader source
+    glCompileShader(shaderID);
+
+    //Check shader for errors
+    GLint shaderCompiled = GL_FALSE;
+    glGetShaderiv(shaderID, GL_COMPILE_STATUS, &shaderCompiled);
+    if (shaderCompiled != GL_TRUE)
+    {
+        std::cerr << "Unable to compile shader " << filePath << std::endl;
+        std::cerr << "\n\nSource:\n\n" << source << std::endl;
+        printShaderLog(shaderID);
+        glDeleteShader(shaderID);
+        shaderID = 0;
+    }
+
+    return shaderID;
+}
+
+/******************************************************************************/
+//These 2 functions have to use char raw pointers because that's how OpenGL works...
+void ShaderRegistry::printProgramLog(GLuint program)
+{
+    //Make sure name is shader
+    if (glIsProgram(program))
+    {
+        //Program log length
+        int infoLogLength = 0;
+        int maxLength = infoLogLength;
+
+        //Get info string length
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &maxLength);
+
+        //Allocate string
+        char* infoLog = new char[maxLength];
+
+        //Get info log
+        glGetProgramInfoLog(program, maxLength, &infoLogLength, infoLog);
+        if (infoLogLength > 0)
+        {
+            //Print Log
+            std::cerr << infoLog << std::endl;
+        }
+
+        //Deallocate string
+        delete[] infoLog;
+    }
+    else
+    {
+        std::cerr << "Name " << program << " is not a program." << std::endl;
+    }
+}
+
+/******************************************************************************/
+void ShaderRegistry::printShaderLog(GLuint shader)
+{
+    //Make sure name is shader
+    if (glIsShader(shader))
+    {
+        //Shader log length
+        int infoLogLength = 0;
+        int maxLength = infoLogLength;
+
+        //Get info string length
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &maxLength);
+
+        //Allocate string
+        char* infoLog = new char[maxLength];
+
+        //Get info log
+        glGetShaderInfoLog(shader, maxLength, &infoLogLength, infoLog);
+        if (infoLogLength > 0)
+        {
+            //Print Log
+            std::cerr << infoLog << std::endl;
+        }
+
+        //Deallocate string
+        delete[] infoLog;
+    }
+    else
+    {
+        std::cerr << "Name " << shader << " is not a shader." << std::endl;
+    }
+}
+
+/******************************************************************************/
+std::uint64_t ShaderRegistry::getDriverHash()
+{
+    //This needs a context, so it is worked out the first time a binary is looked at rather than in the constructor.
+    if (_driverHash == 0)
+    {
+        std::string driver;
+        const GLenum names[3] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+        for (unsigned i = 0; i < 3; i++)
+        {
+            const GLubyte* name = glGetString(names[i]);
+            if (name != nullptr)
+            {
+                driver += reinterpret_cast<const char*>(name);
+            }
+            driver.push_back('\n');
+        }
+
+        _driverHash = CookedMesh::hashData(driver.data(), driver.size());
+    }
+
+    return _driverHash;
+}
+}; //wind
@@ -0,0 +1,87 @@
+#ifndef SHADER_REGISTRY_H
+#define SHADER_REGISTRY_H
+
+#include <string>
+#include <cstdint>
+#include <unordered_map>
+#include <GL/glew.h>
+
+namespace wind
+{
+//The start of every program binary file, the driver's binary follows it.
+struct ProgramBinaryHeader
+{
+    char magic[4];
+    std::uint32_t version;
+    //A hash of the vendor, renderer and version strings, a binary is only any good to the driver that made it.
+    std::uint64_t driverHash;
+    //A hash of both shader sources, if either changes the binary is stale.
+    std::uint64_t sourceHash;
+    std::uint32_t binaryFormat;
+    std::uint32_t binarySize;
+};
+
+/**
+    This class compiles each shader program once and hands the same GL program to everyone who asks for it.
+    Programs are looked up by a hash of their sources, so two ShaderProgram2Ds share one program, and they are counted so the
+    program is only deleted when the last one lets go.
+    When the driver supports it the linked program is saved with glGetProgramBinary next to the vertex shader, and later launches
+    load that instead of compiling. A binary from another driver, or from older sources, is ignored and replaced.
+    Note: Programs that are shared share their uniforms, so set them before drawing rather than once at load.
+*/
+class ShaderRegistry
+{
+public:
+    ShaderRegistry();
+    ~ShaderRegistry();
+
+    //This returns the program for the two shaders, compiling it or loading its binary if no one has it yet. It returns 0 if it fails.
+    GLuint acquire(const std::string &vertexFilePath, const std::string &fragmentFilePath);
+    //Every acquire needs a release, the program is deleted with the last one.
+    void release(GLuint program);
+
+    //The binary cache can be turned off, shaders are then always compiled.
+    void setBinaryCacheEnabled(bool enabled);
+    bool isBinaryCacheSupported() const;
+
+    static std::string getBinaryPath(const std::string &vertexFilePath, const std::string &fragmentFilePath);
+
+    unsigned getProgramCount() const;
+    //How many programs were compiled from source and how many were loaded from a binary.
+    unsigned getCompileCount() const;
+    unsigned getBinaryLoadCount() const;
+
+private:
+    ShaderRegistry(const ShaderRegistry&);
+    ShaderRegistry& operator=(const ShaderRegistry&);
+
+    struct Entry
+    {
+        GLuint program;
+        unsigned references;
+    };
+
+    GLuint loadBinary(const std::string &binaryPath, std::uint64_t sourceHash);
+    void saveBinary(GLuint program, const std::string &binaryPath, std::uint64_t sourceHash);
+    GLuint compileProgram(const std::string &vertexSource, const std::string &fragmentSource,
+                          const std::string &vertexFilePath, const std::string &fragmentFilePath);
+
+    static bool readSource(const std::string &filePath, std::string &source);
+    static GLuint compileShader(const std::string &source, const std::string &filePath, GLenum shaderType);
+    static void printProgramLog(GLuint program);
+    static void printShaderLog(GLuint shader);
+
+    std::uint64_t getDriverHash();
+
+    //Both maps hold the same entries, one is looked up by source and the other by the GL program.
+    std::unordered_map<std::uint64_t, Entry> _programs;
+    std::unordered_map<GLuint, std::uint64_t> _sourceHashes;
+
+    bool _binaryCacheEnabled;
+    std::uint64_t _driverHash;
+    unsigned _compileCount;
+    unsigned _binaryLoadCount;
+};
+}; //wind
+
+#endif
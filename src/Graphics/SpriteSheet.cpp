@@ -1,10 +1,11 @@
 #include "SpriteSheet.h"
+#include "TextureAtlas.h"
 
 namespace wind
 {
 /******************************************************************************/
 //Starting off we need to set everything to null
-SpriteSheet::SpriteSheet() : _vertexDataBuffer(0), _indexBuffers(nullptr)
+SpriteSheet::SpriteSheet() : _vertexDataBuffer(0), _indexBuffer(0)
 {
 }
 
@@ -44,113 +45,36 @@ bool SpriteSheet::generateDataBuffer(SpriteOrigin origin)
 	{
 		//Allocate vertex data
 		int totalSprites = _clip.size();
-		TextureVertex2D* vertexData = new TextureVertex2D[totalSprites * 4];
-		_indexBuffers = new GLuint[totalSprites];
-
-		//Allocate vertex data buffer name
-		glGenBuffers(1, &_vertexDataBuffer);
-
-		//Allocate index buffers names
-		glGenBuffers(totalSprites, _indexBuffers);
+		std::vector<TextureVertex2D> vertexData(totalSprites * 4);
+		std::vector<GLuint> indexData(totalSprites * 6);
 
 		//Go through clips
 		GLfloat tW = getTextureWidth();
 		GLfloat tH = getTextureHeight();
-		GLuint spriteIndices[4] = { 0, 0, 0, 0 };
-
-		//Origin variables
-		GLfloat vTop = 0.f;
-		GLfloat vBottom = 0.f;
-		GLfloat vLeft = 0.f;
-		GLfloat vRight = 0.f;
 
 		for (int i = 0; i < totalSprites; i++)
 		{
-			//Initialize indices
-			spriteIndices[0] = i * 4 + 0;
-			spriteIndices[1] = i * 4 + 1;
-			spriteIndices[2] = i * 4 + 2;
-			spriteIndices[3] = i * 4 + 3;
-
-			//Set origin
-			switch (origin)
-			{
-			case SPRITE_ORIGIN_TOP_LEFT:
-				vTop = 0.f;
-				vBottom = _clip[i].h;
-				vLeft = 0.f;
-				vRight = _clip[i].w;
-				break;
-
-			case SPRITE_ORIGIN_TOP_RIGHT:
-				vTop = 0.f;
-				vBottom = _clip[i].h;
-				vLeft = -_clip[i].w;
-				vRight = 0.f;
-				break;
-
-			case SPRITE_ORIGIN_BOTTOM_LEFT:
-				vTop = -_clip[i].h;
-				vBottom = 0.f;
-				vLeft = 0.f;
-				vRight = _clip[i].w;
-				break;
-
-			case SPRITE_ORIGIN_BOTTOM_RIGHT:
-				vTop = -_clip[i].h;
-				vBottom = 0.f;
-				vLeft = -_clip[i].w;
-				vRight = 0.f;
-				break;
-
-				//Also for LSPRITE_ORIGIN_CENTER
-			default:
-				vTop = -_clip[i].h / 2.f;
-				vBottom = _clip[i].h / 2.f;
-				vLeft = -_clip[i].w / 2.f;
-				vRight = _clip[i].w / 2.f;
-				break;
-			}
-
-			//Top left
-			vertexData[spriteIndices[0]].pos.x = vLeft;
-			vertexData[spriteIndices[0]].pos.y = vTop;
-
-			vertexData[spriteIndices[0]].texCoord.s = (_clip[i].x) / tW;
-			vertexData[spriteIndices[0]].texCoord.t = (_clip[i].y) / tH;
-
-			//Top right
-			vertexData[spriteIndices[1]].pos.x = vRight;
-			vertexData[spriteIndices[1]].pos.y = vTop;
-
-			vertexData[spriteIndices[1]].texCoord.s = (_clip[i].x + _clip[i].w) / tW;
-			vertexData[spriteIndices[1]].texCoord.t = (_clip[i].y) / tH;
-
-			//Bottom right
-			vertexData[spriteIndices[2]].pos.x = vRight;
-			vertexData[spriteIndices[2]].pos.y = vBottom;
-
-			vertexData[spriteIndices[2]].texCoord.s = (_clip[i].x + _clip[i].w) / tW;
-			vertexData[spriteIndices[2]].texCoord.t = (_clip[i].y + _clip[i].h) / tH;
-
-			//Bottom left
-			vertexData[spriteIndices[3]].pos.x = vLeft;
-			vertexData[spriteIndices[3]].pos.y = vBottom;
-
-			vertexData[spriteIndices[3]].texCoord.s = (_clip[i].x) / tW;
-			vertexData[spriteIndices[3]].texCoord.t = (_clip[i].y + _clip[i].h) / tH;
-
-			//Bind sprite index buffer data
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffers[i]);
-			glBufferData(GL_ELEMENT_ARRAY_BUFFER, 4 * sizeof(GLuint), spriteIndices, GL_STATIC_DRAW);
+			buildQuad(_clip[i], origin, _clip[i].x / tW, _clip[i].y / tH,
+					  (_clip[i].x + _clip[i].w) / tW, (_clip[i].y + _clip[i].h) / tH, &vertexData[i * 4]);
+
+			//Every sprite is two triangles in the one index buffer, so a sprite is drawn from an offset instead of its own buffer.
+			indexData[i * 6 + 0] = i * 4 + 0;
+			indexData[i * 6 + 1] = i * 4 + 1;
+			indexData[i * 6 + 2] = i * 4 + 2;
+			indexData[i * 6 + 3] = i * 4 + 0;
+			indexData[i * 6 + 4] = i * 4 + 2;
+			indexData[i * 6 + 5] = i * 4 + 3;
 		}
 
 		//Bind vertex data
+		glGenBuffers(1, &_vertexDataBuffer);
 		glBindBuffer(GL_ARRAY_BUFFER, _vertexDataBuffer);
-		glBufferData(GL_ARRAY_BUFFER, totalSprites * 4 * sizeof(TextureVertex2D), vertexData, GL_STATIC_DRAW);
+		glBufferData(GL_ARRAY_BUFFER, totalSprites * 4 * sizeof(TextureVertex2D), &vertexData[0], GL_STATIC_DRAW);
 
-		//Deallocate vertex data
-		delete[] vertexData;
+		//Bind index data
+		glGenBuffers(1, &_indexBuffer);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, totalSprites * 6 * sizeof(GLuint), &indexData[0], GL_STATIC_DRAW);
 	}
 	//No clips
 	else
@@ -171,6 +95,98 @@ bool SpriteSheet::generateDataBuffer(SpriteOrigin origin)
 	return true;
 }
 
+/******************************************************************************/
+int SpriteSheet::addToAtlas(TextureAtlas &atlas) const
+{
+	if (getPixelData32() != nullptr)
+	{
+		return atlas.addImages32(getPixelData32(), getTextureWidth(), _clip);
+	}
+
+	if (getPixelData8() != nullptr)
+	{
+		return atlas.addImages8(getPixelData8(), getTextureWidth(), _clip);
+	}
+
+	printf("No pixels to add to the atlas!\n");
+	return -1;
+}
+
+/******************************************************************************/
+void SpriteSheet::buildQuad(const FontRect &clip, SpriteOrigin origin, GLfloat s0, GLfloat t0, GLfloat s1, GLfloat t1,
+							TextureVertex2D* quad)
+{
+	//Origin variables
+	GLfloat vTop = 0.f;
+	GLfloat vBottom = 0.f;
+	GLfloat vLeft = 0.f;
+	GLfloat vRight = 0.f;
+
+	//Set origin
+	switch (origin)
+	{
+	case SPRITE_ORIGIN_TOP_LEFT:
+		vTop = 0.f;
+		vBottom = clip.h;
+		vLeft = 0.f;
+		vRight = clip.w;
+		break;
+
+	case SPRITE_ORIGIN_TOP_RIGHT:
+		vTop = 0.f;
+		vBottom = clip.h;
+		vLeft = -clip.w;
+		vRight = 0.f;
+		break;
+
+	case SPRITE_ORIGIN_BOTTOM_LEFT:
+		vTop = -clip.h;
+		vBottom = 0.f;
+		vLeft = 0.f;
+		vRight = clip.w;
+		break;
+
+	case SPRITE_ORIGIN_BOTTOM_RIGHT:
+		vTop = -clip.h;
+		vBottom = 0.f;
+		vLeft = -clip.w;
+		vRight = 0.f;
+		break;
+
+		//Also for LSPRITE_ORIGIN_CENTER
+	default:
+		vTop = -clip.h / 2.f;
+		vBottom = clip.h / 2.f;
+		vLeft = -clip.w / 2.f;
+		vRight = clip.w / 2.f;
+		break;
+	}
+
+	//Top left
+	quad[0].pos.x = vLeft;
+	quad[0].pos.y = vTop;
+	quad[0].texCoord.s = s0;
+	quad[0].texCoord.t = t0;
+
+	//Top right
+	quad[1].pos.x = vRight;
+	quad[1].pos.y = vTop;
+	quad[1].texCoord.s = s1;
+	quad[1].texCoord.t = t0;
+
+	//Bottom right
+	quad[2].pos.x = vRight;
+	quad[2].pos.y = vBottom;
+	quad[2].texCoord.s = s1;
+	quad[2].texCoord.t = t1;
+
+	//Bottom left
+	quad[3].pos.x = vLeft;
+	quad[3].pos.y = vBottom;
+	quad[3].texCoord.s = s0;
+	quad[3].texCoord.t = t1;
+}
+
 /******************************************************************************/
 void SpriteSheet::freeSheet()
 {
@@ -180,11 +196,10 @@ void SpriteSheet::freeSheet()
 		_vertexDataBuffer = 0;
 	}
 
-	if (_indexBuffers != nullptr)
+	if (_indexBuffer != 0)
 	{
-		glDeleteBuffers(_clip.size(), _indexBuffers);
-		delete[] _indexBuffers;
-		_indexBuffers = nullptr;
+		glDeleteBuffers(1, &_indexBuffer);
+		_indexBuffer = 0;
 	}
 
 	_clip.clear();
@@ -224,8 +239,8 @@ void SpriteSheet::renderSprite(int index)
 		program2D.setVertexPointer(sizeof(TextureVertex2D), (GLvoid*)offsetof(TextureVertex2D, pos));
 
 		//Draw quad using vertex data and index data
-		glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, indexBuffers[index]);
-		glDrawElements( GL_TRIANGLE_FAN, 4, GL_UNSIGNED_INT, NULL );
+		glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+		glDrawElements( GL_TRIANGLES, 6, GL_UNSIGNED_INT, (GLvoid*)(index * 6 * sizeof(GLuint)) );
 
 		//Disable vertex and texture coordinate arrays
 		program2D.disableVertexPointer();
@@ -23,6 +23,8 @@ enum SpriteOrigin
 
 namespace wind
 {
+class TextureAtlas;
+
 /*
     This class is going to handle spritesheeting textures.
 **/
@@ -43,6 +45,14 @@ public:
     //This is the main loading function while also creating a VBO and IBO.
     bool generateDataBuffer(SpriteOrigin orgin = SPRITE_ORIGIN_CENTER);
 
+    //This copies every clip into the atlas and returns the region of the first one, the rest follow in order.
+    //It needs the pixels, so call it before they are turned into a texture.
+    int addToAtlas(TextureAtlas &atlas) const;
+
+    //This fills in the four corners of a sprite's quad going clockwise from the top left, the atlas uses it as well.
+    static void buildQuad(const FontRect &clip, SpriteOrigin origin, GLfloat s0, GLfloat t0, GLfloat s1, GLfloat t1,
+                          TextureVertex2D* quad);
+
     //This function cleans up texture data
     void freeSheet();
 
@@ -55,9 +65,9 @@ protected:
     //This will hold the font rect for the sprite in a sprite sheet.
     std::vector<FontRect> _clip;
 
-    //VBO data
+    //VBO data, every sprite has six indices in the one index buffer.
     GLuint _vertexDataBuffer;
-    GLuint* _indexBuffers;
+    GLuint _indexBuffer;
 };
 }; //wind
 #endif
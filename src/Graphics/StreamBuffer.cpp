@@ -0,0 +1,212 @@
+#include "StreamBuffer.h"
+
+#include <cstring>
+
+namespace wind
+{
+
+namespace
+{
+    const GLbitfield PERSISTENT_FLAGS = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    GLsizeiptr alignUp(GLsizeiptr size, GLsizeiptr alignment)
+    {
+        return (size + alignment - 1) / alignment * alignment;
+    }
+}
+
+/******************************************************************************/
+StreamBuffer::StreamBuffer(GLenum target, GLsizeiptr minRegionSize) : _target(target), _minRegionSize(minRegionSize),
+_buffer(0), _regionSize(0), _offset(0), _region(0), _mapped(nullptr), _persistent(false)
+{
+    for (unsigned i = 0; i < NUM_REGIONS; i++)
+    {
+        _fences[i] = nullptr;
+    }
+}
+
+/******************************************************************************/
+StreamBuffer::~StreamBuffer()
+{
+    destroy();
+}
+
+/******************************************************************************/
+GLintptr StreamBuffer::reserve(GLsizeiptr size, GLsizeiptr alignment)
+{
+    if (_buffer == 0 || size > _regionSize)
+    {
+        //The buffer is made big enough for a few of these, that way it doesn't grow every time we add an object.
+        GLsizeiptr regionSize = _regionSize > _minRegionSize ? _regionSize : _minRegionSize;
+        while (regionSize < size * 4)
+        {
+            regionSize *= 2;
+        }
+
+        //Each region has to start on the alignment too, or the offsets in the later regions would be off.
+        destroy();
+        create(alignUp(regionSize, alignment));
+    }
+    else if (_offset + size > _regionSize)
+    {
+        if (_persistent)
+        {
+            //We have used up this frame's region, so we grow. The draws already made keep the old buffer alive until they are done.
+            GLsizeiptr regionSize = _regionSize * 2;
+            destroy();
+            create(regionSize);
+        }
+        else
+        {
+            //Orphaning gives us fresh memory, the driver keeps the old memory until the draws using it are done.
+            glBindBuffer(_target, _buffer);
+            glBufferData(_target, _regionSize, nullptr, GL_STREAM_DRAW);
+            glBindBuffer(_target, 0);
+            _offset = 0;
+        }
+    }
+
+    GLintptr offset = _offset;
+    if (_persistent)
+    {
+        offset += _regionSize * _region;
+    }
+
+    _offset = alignUp(_offset + size, alignment);
+    return offset;
+}
+
+/******************************************************************************/
+void StreamBuffer::upload(GLintptr offset, const void* data, GLsizeiptr size)
+{
+    if (_persistent)
+    {
+        memcpy(_mapped + offset, data, size);
+    }
+    else
+    {
+        glBindBuffer(_target, _buffer);
+        glBufferSubData(_target, offset, size, data);
+        glBindBuffer(_target, 0);
+    }
+}
+
+/******************************************************************************/
+char* StreamBuffer::getMapped(GLintptr offset) const
+{
+    return _persistent ? _mapped + offset : nullptr;
+}
+
+/******************************************************************************/
+void StreamBuffer::endFrame()
+{
+    if (!_persistent || _buffer == 0)
+    {
+        return;
+    }
+
+    //The region we just used is fenced, then we move on to the oldest one and wait for the GPU to be done with it.
+    if (_fences[_region] != nullptr)
+    {
+        glDeleteSync(_fences[_region]);
+    }
+    _fences[_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    _region = (_region + 1) % NUM_REGIONS;
+    _offset = 0;
+
+    waitForRegion(_region);
+}
+
+/******************************************************************************/
+GLuint StreamBuffer::getBuffer() const
+{
+    return _buffer;
+}
+
+/******************************************************************************/
+bool StreamBuffer::isPersistent() const
+{
+    return _persistent;
+}
+
+/******************************************************************************/
+void StreamBuffer::create(GLsizeiptr regionSize)
+{
+    _regionSize = regionSize;
+    _offset = 0;
+    _region = 0;
+
+    glGenBuffers(1, &_buffer);
+    glBindBuffer(_target, _buffer);
+
+    _persistent = false;
+    if (GLEW_ARB_buffer_storage)
+    {
+        GLsizeiptr totalSize = _regionSize * NUM_REGIONS;
+        glBufferStorage(_target, totalSize, nullptr, PERSISTENT_FLAGS);
+        _mapped = static_cast<char*>(glMapBufferRange(_target, 0, totalSize, PERSISTENT_FLAGS));
+
+        if (_mapped != nullptr)
+        {
+            _persistent = true;
+            glBindBuffer(_target, 0);
+            return;
+        }
+
+        //The storage can't be changed once it is set, so if mapping failed we need a new buffer.
+        glDeleteBuffers(1, &_buffer);
+        glGenBuffers(1, &_buffer);
+        glBindBuffer(_target, _buffer);
+    }
+
+    glBufferData(_target, _regionSize, nullptr, GL_STREAM_DRAW);
+    glBindBuffer(_target, 0);
+}
+
+/******************************************************************************/
+void StreamBuffer::destroy()
+{
+    for (unsigned i = 0; i < NUM_REGIONS; i++)
+    {
+        if (_fences[i] != nullptr)
+        {
+            glDeleteSync(_fences[i]);
+            _fences[i] = nullptr;
+        }
+    }
+
+    if (_buffer != 0)
+    {
+        if (_mapped != nullptr)
+        {
+            glBindBuffer(_target, _buffer);
+            glUnmapBuffer(_target);
+            glBindBuffer(_target, 0);
+        }
+        glDeleteBuffers(1, &_buffer);
+    }
+
+    _buffer = 0;
+    _mapped = nullptr;
+    _persistent = false;
+}
+
+/******************************************************************************/
+void StreamBuffer::waitForRegion(unsigned region)
+{
+    if (_fences[region] == nullptr)
+    {
+        return;
+    }
+
+    GLenum result = glClientWaitSync(_fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+    while (result == GL_TIMEOUT_EXPIRED)
+    {
+        result = glClientWaitSync(_fences[region], 0, 1000000);
+    }
+
+    glDeleteSync(_fences[region]);
+    _fences[region] = nullptr;
+}
+}; //wind
@@ -0,0 +1,59 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <GL/glew.h>
+
+namespace wind
+{
+/**
+    This class is a buffer that is refilled every frame, the InstanceBuffer and UniformBuffer are both built on it.
+    When the driver has buffer storage the buffer is mapped once and split into a region for each frame in flight, each region is fenced so we never write over data the GPU is still reading.
+    Without buffer storage the buffer is orphaned whenever it fills up and written with glBufferSubData.
+*/
+class StreamBuffer
+{
+public:
+    StreamBuffer(GLenum target, GLsizeiptr minRegionSize);
+    ~StreamBuffer();
+
+    //This finds room for size bytes, growing or orphaning the buffer if it has to, and returns where they go.
+    //Every reservation starts on the alignment, so the alignment has to stay the same for the life of the buffer.
+    GLintptr reserve(GLsizeiptr size, GLsizeiptr alignment);
+
+    //This copies the data to an offset that was reserved, through the mapping if there is one.
+    void upload(GLintptr offset, const void* data, GLsizeiptr size);
+
+    //This is where a reserved offset is in the mapping so it can be written straight to, it is null without buffer storage.
+    char* getMapped(GLintptr offset) const;
+
+    //This needs to be called once all of the frame's draws have been made.
+    void endFrame();
+
+    GLuint getBuffer() const;
+    bool isPersistent() const;
+
+private:
+    StreamBuffer(const StreamBuffer&);
+    StreamBuffer& operator=(const StreamBuffer&);
+
+    void create(GLsizeiptr regionSize);
+    void destroy();
+    void waitForRegion(unsigned region);
+
+    static const unsigned NUM_REGIONS = 3;
+
+    GLenum _target;
+    GLsizeiptr _minRegionSize;
+
+    GLuint _buffer;
+    GLsizeiptr _regionSize;
+    GLsizeiptr _offset;
+    unsigned _region;
+
+    char* _mapped;
+    GLsync _fences[NUM_REGIONS];
+    bool _persistent;
+};
+}; //wind
+
+#endif
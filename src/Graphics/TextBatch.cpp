@@ -0,0 +1,205 @@
+#include "TextBatch.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include "Font.h"
+#include "ShaderProgram2D.h"
+
+namespace wind
+{
+
+namespace
+{
+    //Room for a line or two of text to start with, the buffers double when a longer string comes along.
+    const unsigned INITIAL_QUAD_CAPACITY = 64;
+}
+
+/******************************************************************************/
+TextBatch::TextBatch() : _vertexBuffer(0), _indexBuffer(0), _capacity(0), _cached(false), _font(nullptr),
+_x(0.f), _y(0.f), _hasArea(false), _align(0), _usedAtlas(false), _valid(false)
+{
+}
+
+/******************************************************************************/
+TextBatch::~TextBatch()
+{
+    freeBatch();
+}
+
+/******************************************************************************/
+void TextBatch::render(ShaderProgram2D *program, const Font &font, GLfloat x, GLfloat y, const std::string &text,
+                       const FontRect *area, int align)
+{
+    _cached = matches(font, x, y, text, area, align);
+    if (!_cached)
+    {
+        font.layoutText(x, y, text, area, align, _vertices, _pages);
+
+        _font = &font;
+        _text = text;
+        _x = x;
+        _y = y;
+        _hasArea = area != nullptr;
+        if (_hasArea)
+        {
+            _area = *area;
+        }
+        _align = align;
+        _usedAtlas = font.usesAtlas();
+        _valid = true;
+
+        upload();
+    }
+
+    if (_runs.empty())
+    {
+        return;
+    }
+
+    //The quads are already in screen space.
+    program->setModelView(Matrix4x4());
+    program->updateModelView();
+
+    program->enableVertexPointer();
+    program->enableTexCoordPointer();
+
+    glBindBuffer(GL_ARRAY_BUFFER, _vertexBuffer);
+    program->setVertexPointer(sizeof(TextureVertex2D), (GLvoid*)offsetof(TextureVertex2D, pos));
+    program->setTexCoordPointer(sizeof(TextureVertex2D), (GLvoid*)offsetof(TextureVertex2D, texCoord));
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer);
+
+    for (unsigned i = 0; i < _runs.size(); i++)
+    {
+        glBindTexture(GL_TEXTURE_2D, _runs[i].texture);
+        glDrawElements(GL_TRIANGLES, _runs[i].count * 6, GL_UNSIGNED_INT, (GLvoid*)(_runs[i].first * 6 * sizeof(GLuint)));
+    }
+
+    program->disableVertexPointer();
+    program->disableTexCoordPointer();
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+/******************************************************************************/
+void TextBatch::invalidate()
+{
+    _valid = false;
+}
+
+/******************************************************************************/
+void TextBatch::freeBatch()
+{
+    if (_vertexBuffer != 0)
+    {
+        glDeleteBuffers(1, &_vertexBuffer);
+        _vertexBuffer = 0;
+    }
+
+    if (_indexBuffer != 0)
+    {
+        glDeleteBuffers(1, &_indexBuffer);
+        _indexBuffer = 0;
+    }
+
+    _capacity = 0;
+    _vertices.clear();
+    _pages.clear();
+    _runs.clear();
+    _valid = false;
+}
+
+/******************************************************************************/
+unsigned TextBatch::getQuadCount() const
+{
+    return _pages.size();
+}
+
+/******************************************************************************/
+bool TextBatch::wasCached() const
+{
+    return _cached;
+}
+
+/******************************************************************************/
+bool TextBatch::matches(const Font &font, GLfloat x, GLfloat y, const std::string &text, const FontRect *area, int align) const
+{
+    if (!_valid || _font != &font || _x != x || _y != y || _align != align || _hasArea != (area != nullptr) ||
+        _usedAtlas != font.usesAtlas() || _text != text)
+    {
+        return false;
+    }
+
+    return area == nullptr || (_area.x == area->x && _area.y == area->y && _area.w == area->w && _area.h == area->h);
+}
+
+/******************************************************************************/
+void TextBatch::upload()
+{
+    unsigned quadCount = _pages.size();
+
+    //The quads are sorted by page so each page is one draw, the order on a page doesn't matter to how the text looks.
+    std::vector<unsigned> order(quadCount);
+    for (unsigned i = 0; i < quadCount; i++)
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [this](unsigned a, unsigned b) { return _pages[a] < _pages[b]; });
+
+    std::vector<TextureVertex2D> sorted(_vertices.size());
+    _runs.clear();
+    for (unsigned i = 0; i < quadCount; i++)
+    {
+        memcpy(&sorted[i * 4], &_vertices[order[i] * 4], 4 * sizeof(TextureVertex2D));
+
+        unsigned page = _pages[order[i]];
+        if (_runs.empty() || _pages[order[i - 1]] != page)
+        {
+            TextureRun run = { _font->getPageTexture(page), i, 0 };
+            _runs.push_back(run);
+        }
+        _runs.back().count++;
+    }
+
+    if (quadCount == 0)
+    {
+        return;
+    }
+
+    if (_vertexBuffer == 0)
+    {
+        glGenBuffers(1, &_vertexBuffer);
+        glGenBuffers(1, &_indexBuffer);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, _vertexBuffer);
+    if (quadCount > _capacity)
+    {
+        _capacity = std::max(std::max(_capacity * 2, quadCount), INITIAL_QUAD_CAPACITY);
+
+        //The indices never change, two triangles a quad, so they only go up when the buffers grow.
+        std::vector<GLuint> indexData(_capacity * 6);
+        for (unsigned i = 0; i < _capacity; i++)
+        {
+            indexData[i * 6 + 0] = i * 4 + 0;
+            indexData[i * 6 + 1] = i * 4 + 1;
+            indexData[i * 6 + 2] = i * 4 + 2;
+            indexData[i * 6 + 3] = i * 4 + 0;
+            indexData[i * 6 + 4] = i * 4 + 2;
+            indexData[i * 6 + 5] = i * 4 + 3;
+        }
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexData.size() * sizeof(GLuint), &indexData[0], GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+
+    //The buffer is orphaned first, so the driver doesn't have to wait for last frame's draw to finish with it.
+    glBufferData(GL_ARRAY_BUFFER, _capacity * 4 * sizeof(TextureVertex2D), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sorted.size() * sizeof(TextureVertex2D), &sorted[0]);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+}; //wind
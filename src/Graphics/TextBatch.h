@@ -0,0 +1,80 @@
+#ifndef TEXT_BATCH_H
+#define TEXT_BATCH_H
+
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+
+#include "include/FontRect.h"
+#include "include/TextureVertex2D.h"
+
+namespace wind
+{
+class Font;
+class ShaderProgram2D;
+
+/**
+    This class draws a whole string in one call.
+    The string is laid out once on the CPU as quads in screen space, the quads go up in one streaming vertex buffer and are drawn
+    with one draw for each texture the characters are on, which is one unless the font's atlas spilled over a page.
+    The layout is kept, so if the same string is drawn in the same place next frame nothing is laid out or uploaded again.
+    Note: Keep one batch for each piece of text that stays up on screen, text that changes shares a batch just fine.
+*/
+class TextBatch
+{
+public:
+    TextBatch();
+    ~TextBatch();
+
+    //This draws the text the same way Font::renderText does, the program has to be bound.
+    void render(ShaderProgram2D *program, const Font &font, GLfloat x, GLfloat y, const std::string &text,
+                const FontRect *area, int align);
+
+    //This throws away the layout, it has to be called if the font is reloaded.
+    void invalidate();
+    void freeBatch();
+
+    //How many characters were drawn last time, and whether the last render could reuse the layout from before.
+    unsigned getQuadCount() const;
+    bool wasCached() const;
+
+private:
+    TextBatch(const TextBatch&);
+    TextBatch& operator=(const TextBatch&);
+
+    //This checks if the layout we have is for the same text in the same place.
+    bool matches(const Font &font, GLfloat x, GLfloat y, const std::string &text, const FontRect *area, int align) const;
+    void upload();
+
+    //A run of quads that are all on the same texture.
+    struct TextureRun
+    {
+        GLuint texture;
+        unsigned first;
+        unsigned count;
+    };
+
+    GLuint _vertexBuffer;
+    GLuint _indexBuffer;
+    //How many quads the buffers have room for.
+    unsigned _capacity;
+
+    std::vector<TextureVertex2D> _vertices;
+    std::vector<unsigned> _pages;
+    std::vector<TextureRun> _runs;
+    bool _cached;
+
+    //This is what the layout was made from.
+    const Font *_font;
+    std::string _text;
+    GLfloat _x;
+    GLfloat _y;
+    bool _hasArea;
+    FontRect _area;
+    int _align;
+    bool _usedAtlas;
+    bool _valid;
+};
+}; //wind
+
+#endif
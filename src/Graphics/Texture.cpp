@@ -1,5 +1,7 @@
 #include "Texture.h"
 
+#include "CookedTexture.h"
+
 namespace wind
 {
 
@@ -36,9 +38,85 @@ void Texture::unbind(unsigned int unit)
     glBindTexture(GL_TEXTURE_2D, 0);
 }
 
+/******************************************************************************/
+std::mutex& Texture::getImageLibraryMutex()
+{
+    static std::mutex imageLibraryMutex;
+    return imageLibraryMutex;
+}
+
+/******************************************************************************/
+bool Texture::decodeImage32(const std::string &filePath, const char* data, std::size_t size,
+                            std::vector<GLuint> &pixels, GLuint &width, GLuint &height)
+{
+    std::lock_guard<std::mutex> lock(getImageLibraryMutex());
+
+    bool loadSuccess = false;
+
+    ILuint imgID = 0;
+    ilGenImages(1, &imgID);
+    ilBindImage(imgID);
+
+    //DevIL can't tell every format from the data alone, so if it doesn't know it we let it go by the file name.
+    ILboolean success = ilLoadL(IL_TYPE_UNKNOWN, data, static_cast<ILuint>(size));
+    if (success != IL_TRUE)
+    {
+        success = ilLoadImage(filePath.c_str());
+    }
+
+    if (success == IL_TRUE && ilConvertImage(IL_RGBA, IL_UNSIGNED_BYTE) == IL_TRUE)
+    {
+        width = static_cast<GLuint>(ilGetInteger(IL_IMAGE_WIDTH));
+        height = static_cast<GLuint>(ilGetInteger(IL_IMAGE_HEIGHT));
+
+        const GLuint* imagePixels = reinterpret_cast<const GLuint*>(ilGetData());
+        pixels.assign(imagePixels, imagePixels + width * height);
+        loadSuccess = width > 0 && height > 0;
+    }
+
+    ilDeleteImages(1, &imgID);
+
+    return loadSuccess;
+}
+
+/******************************************************************************/
+bool Texture::isFormatSupported(TextureFormat format)
+{
+    switch (format)
+    {
+    case TEXTURE_FORMAT_RGBA8:
+        return true;
+    case TEXTURE_FORMAT_BC1:
+    case TEXTURE_FORMAT_BC3:
+        return GLEW_EXT_texture_compression_s3tc != 0;
+    case TEXTURE_FORMAT_BC7:
+        return GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc;
+    default:
+        return false;
+    }
+}
+
+/******************************************************************************/
+GLenum Texture::getInternalFormat(TextureFormat format)
+{
+    switch (format)
+    {
+    case TEXTURE_FORMAT_BC1:
+        return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case TEXTURE_FORMAT_BC3:
+        return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case TEXTURE_FORMAT_BC7:
+        return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    default:
+        return GL_RGBA;
+    }
+}
+
 /******************************************************************************/
 bool Texture::loadTextureFromFile32(const std::string &filePath)
 {
+    std::lock_guard<std::mutex> lock(getImageLibraryMutex());
+
     bool loadSuccess = false;
 
     //This will generate the ID we need for that image.
@@ -90,6 +168,8 @@ bool Texture::loadTextureFromFile32(const std::string &filePath)
 /******************************************************************************/
 bool Texture::loadPixelsFromFile32(const std::string &filePath)
 {
+    std::lock_guard<std::mutex> lock(getImageLibraryMutex());
+
     freeTexture();
 
     bool loadSuccess = false;
@@ -248,6 +328,8 @@ bool Texture::loadTextureFromPixels32()
 /******************************************************************************/
 bool Texture::loadTextureCube(std::vector<std::string> filePaths)
 {
+    std::lock_guard<std::mutex> lock(getImageLibraryMutex());
+
     bool loadSuccess = false;
     GLuint textureID;
     glGenTextures(1, &textureID);
@@ -307,6 +389,61 @@ bool Texture::loadTextureCube(std::vector<std::string> filePaths)
     _pixelFormat = GL_RGBA;
 }
 
+/******************************************************************************/
+bool Texture::loadCookedTexture(const CookedTexture &cooked)
+{
+    if (!cooked.isLoaded() || !isFormatSupported(cooked.getFormat()))
+    {
+        return false;
+    }
+
+    freeTexture();
+
+    //Cooked textures are never padded, the levels are whatever size the image is.
+    _imageWidth = _textureWidth = cooked.getWidth();
+    _imageHeight = _textureHeight = cooked.getHeight();
+
+    glGenTextures(1, &_textureID);
+    glBindTexture(GL_TEXTURE_2D, _textureID);
+
+    TextureFormat format = cooked.getFormat();
+    GLenum internalFormat = getInternalFormat(format);
+    for (unsigned i = 0; i < cooked.getLevelCount(); i++)
+    {
+        const CookedTextureLevel &level = cooked.getLevel(i);
+        if (format == TEXTURE_FORMAT_RGBA8)
+        {
+            glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, cooked.getLevelData(i));
+        }
+        else
+        {
+            glCompressedTexImage2D(GL_TEXTURE_2D, i, internalFormat, level.width, level.height, 0,
+                                   static_cast<GLsizei>(level.size), cooked.getLevelData(i));
+        }
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, cooked.getLevelCount() - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    GLenum error = glGetError();
+    if (error != GL_NO_ERROR)
+    {
+        std::cerr << "Error loading cooked texture! " << gluErrorString(error) << std::endl;
+        return false;
+    }
+
+    initVBO();
+
+    _pixelFormat = GL_RGBA;
+
+    return true;
+}
+
 /******************************************************************************/
 bool Texture::loadTextureFromPixels32(GLuint *pixels, GLuint imgWidth, GLuint imgHeight,
                                       GLuint texWidth, GLuint texHeight)
@@ -425,6 +562,8 @@ void Texture::padPixels32()
 /******************************************************************************/
 bool Texture::loadPixelsFromFile8(std::string filePath)
 {
+    std::lock_guard<std::mutex> lock(getImageLibraryMutex());
+
     freeTexture();
 
     bool loadSuccess = false;
@@ -9,12 +9,17 @@
 #include <IL/il.h>
 #include <IL/ilu.h>
 #include <cstring>
+#include <mutex>
 
 #include "include/TextureVertex2D.h"
 #include "include/FontRect.h"
+#include "BlockCompression.h"
 
 namespace wind
 {
+class TextureStreamer;
+class CookedTexture;
+
 /**
     In this class we are loading textures using some external code.
     I have made it so it can be used as an instance variable so you can run the constructor or load the file by a function.
@@ -30,6 +35,18 @@ public:
     virtual void bind(unsigned int unit);
     void unbind(unsigned int unit);
 
+    //DevIL keeps one bound image for the whole program, so anything using it from more than one thread has to hold this.
+    static std::mutex& getImageLibraryMutex();
+
+    //This decodes an image that is already in memory to RGBA with no padding, it takes the DevIL lock itself.
+    //The path is only used if DevIL can't tell the format from the data.
+    static bool decodeImage32(const std::string &filePath, const char* data, std::size_t size,
+                              std::vector<GLuint> &pixels, GLuint &width, GLuint &height);
+
+    //This tells us if the card can sample the format, RGBA8 always works.
+    static bool isFormatSupported(TextureFormat format);
+    static GLenum getInternalFormat(TextureFormat format);
+
     //This function will be able to load any image with DevIL.
     bool loadTextureFromFile32(const std::string &filePath);
     bool loadPixelsFromFile32(const std::string &filePath);
@@ -40,6 +57,9 @@ public:
 
     bool loadTextureCube(std::vector<std::string> filePaths);
 
+    //This uploads every mip level of a cooked texture, the texture isn't padded so the texture size is the image size.
+    bool loadCookedTexture(const CookedTexture &cooked);
+
     void createPixels32(GLuint imgWidth, GLuint imgHeight);
     void copyPixels32(GLuint* pixels, GLuint imgWidth, GLuint imgHeight);
     void padPixels32();
@@ -82,6 +102,8 @@ protected:
     GLuint powerOfTwo(GLuint number) const;
     void freeVBO();
 private:
+    friend class TextureStreamer;
+
     GLuint _textureID;
 
     //All data holds parts of the image data.
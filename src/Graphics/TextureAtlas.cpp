@@ -0,0 +1,465 @@
+#include "TextureAtlas.h"
+
+#include <algorithm>
+
+#include "ShaderProgram2D.h"
+
+namespace wind
+{
+
+namespace
+{
+    //An 8 bit pixel goes into every channel, so it's white with the value as alpha and red.
+    GLuint expandPixel8(GLubyte value)
+    {
+        return value * 0x01010101u;
+    }
+
+    GLuint copyPixel32(GLuint value)
+    {
+        return value;
+    }
+}
+
+/******************************************************************************/
+SkylinePacker::SkylinePacker() : _width(0), _height(0), _usedArea(0)
+{
+}
+
+/******************************************************************************/
+SkylinePacker::SkylinePacker(unsigned width, unsigned height)
+{
+    reset(width, height);
+}
+
+/******************************************************************************/
+void SkylinePacker::reset(unsigned width, unsigned height)
+{
+    _width = width;
+    _height = height;
+    _usedArea = 0;
+
+    //An empty page is one flat segment along the bottom.
+    Segment floor = { 0, 0, width };
+    _skyline.assign(1, floor);
+}
+
+/******************************************************************************/
+bool SkylinePacker::insert(unsigned width, unsigned height, unsigned &x, unsigned &y)
+{
+    unsigned best = ~0u;
+    unsigned bestTop = ~0u;
+    unsigned bestWidth = ~0u;
+    unsigned bestY = 0;
+
+    //We take the spot where the top of the rectangle is lowest, and the narrowest segment if there is a tie.
+    for (unsigned i = 0; i < _skyline.size(); i++)
+    {
+        unsigned fitY;
+        if (fits(i, width, height, fitY))
+        {
+            unsigned top = fitY + height;
+            if (top < bestTop || (top == bestTop && _skyline[i].width < bestWidth))
+            {
+                best = i;
+                bestTop = top;
+                bestWidth = _skyline[i].width;
+                bestY = fitY;
+            }
+        }
+    }
+
+    if (best == ~0u)
+    {
+        return false;
+    }
+
+    x = _skyline[best].x;
+    y = bestY;
+
+    Segment segment = { x, bestY + height, width };
+    _skyline.insert(_skyline.begin() + best, segment);
+
+    //The new segment covers the start of the ones after it, so those are cut back or removed.
+    for (unsigned i = best + 1; i < _skyline.size();)
+    {
+        unsigned previousEnd = _skyline[i - 1].x + _skyline[i - 1].width;
+        if (_skyline[i].x >= previousEnd)
+        {
+            break;
+        }
+
+        unsigned shrink = previousEnd - _skyline[i].x;
+        if (_skyline[i].width <= shrink)
+        {
+            _skyline.erase(_skyline.begin() + i);
+            continue;
+        }
+
+        _skyline[i].x += shrink;
+        _skyline[i].width -= shrink;
+        break;
+    }
+
+    //Segments next to each other at the same height are joined so the list stays short.
+    for (unsigned i = 0; i + 1 < _skyline.size();)
+    {
+        if (_skyline[i].y == _skyline[i + 1].y)
+        {
+            _skyline[i].width += _skyline[i + 1].width;
+            _skyline.erase(_skyline.begin() + i + 1);
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    _usedArea += static_cast<std::uint64_t>(width) * height;
+    return true;
+}
+
+/******************************************************************************/
+float SkylinePacker::getOccupancy() const
+{
+    std::uint64_t area = static_cast<std::uint64_t>(_width) * _height;
+    return area > 0 ? static_cast<float>(_usedArea) / area : 0.0f;
+}
+
+/******************************************************************************/
+bool SkylinePacker::fits(unsigned segment, unsigned width, unsigned height, unsigned &y) const
+{
+    if (_skyline[segment].x + width > _width)
+    {
+        return false;
+    }
+
+    //The rectangle has to sit on the highest segment it spans.
+    y = 0;
+    unsigned widthLeft = width;
+    for (unsigned i = segment; widthLeft > 0; i++)
+    {
+        y = std::max(y, _skyline[i].y);
+        if (y + height > _height)
+        {
+            return false;
+        }
+
+        widthLeft -= std::min(widthLeft, _skyline[i].width);
+    }
+
+    return true;
+}
+
+/******************************************************************************/
+TextureAtlas::TextureAtlas(unsigned pageSize, unsigned padding) : _pageSize(pageSize), _padding(padding),
+_vertexBuffer(0), _indexBuffer(0), _boundPage(0)
+{
+}
+
+/******************************************************************************/
+TextureAtlas::~TextureAtlas()
+{
+    freeAtlas();
+}
+
+/******************************************************************************/
+int TextureAtlas::addImage32(const GLuint* pixels, unsigned stride, const FontRect &clip)
+{
+    return addImages(pixels, stride, std::vector<FontRect>(1, clip), copyPixel32);
+}
+
+/******************************************************************************/
+int TextureAtlas::addImage8(const GLubyte* pixels, unsigned stride, const FontRect &clip)
+{
+    return addImages(pixels, stride, std::vector<FontRect>(1, clip), expandPixel8);
+}
+
+/******************************************************************************/
+int TextureAtlas::addImages32(const GLuint* pixels, unsigned stride, const std::vector<FontRect> &clips)
+{
+    return addImages(pixels, stride, clips, copyPixel32);
+}
+
+/******************************************************************************/
+int TextureAtlas::addImages8(const GLubyte* pixels, unsigned stride, const std::vector<FontRect> &clips)
+{
+    return addImages(pixels, stride, clips, expandPixel8);
+}
+
+/******************************************************************************/
+bool TextureAtlas::build(SpriteOrigin origin)
+{
+    if (_regions.empty())
+    {
+        std::cerr << "No images to build the atlas from!" << std::endl;
+        return false;
+    }
+
+    //A rebuild starts again from the pixels we kept, the pages are small enough that keeping them is cheap.
+    if (_vertexBuffer != 0)
+    {
+        glDeleteBuffers(1, &_vertexBuffer);
+        glDeleteBuffers(1, &_indexBuffer);
+        _vertexBuffer = _indexBuffer = 0;
+    }
+
+    for (unsigned i = 0; i < _pages.size(); i++)
+    {
+        if (!_pages[i]->texture.loadTextureFromPixels32(&_pages[i]->pixels[0], _pageSize, _pageSize, _pageSize, _pageSize))
+        {
+            return false;
+        }
+
+        //Neighbouring images would bleed in at the edges if the page wrapped.
+        glBindTexture(GL_TEXTURE_2D, _pages[i]->texture.getTextureID());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    std::vector<TextureVertex2D> vertexData(_regions.size() * 4);
+    std::vector<GLuint> indexData(_regions.size() * 6);
+    for (unsigned i = 0; i < _regions.size(); i++)
+    {
+        const AtlasRegion &region = _regions[i];
+        SpriteSheet::buildQuad(region.rect, origin, region.u0, region.v0, region.u1, region.v1, &vertexData[i * 4]);
+
+        //Two triangles a quad, so any run of regions can go in one draw.
+        const GLuint quad[6] = { 0, 1, 2, 0, 2, 3 };
+        for (unsigned j = 0; j < 6; j++)
+        {
+            indexData[i * 6 + j] = i * 4 + quad[j];
+        }
+    }
+
+    glGenBuffers(1, &_vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, _vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, vertexData.size() * sizeof(TextureVertex2D), &vertexData[0], GL_STATIC_DRAW);
+
+    glGenBuffers(1, &_indexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexData.size() * sizeof(GLuint), &indexData[0], GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    GLenum error = glGetError();
+    if (error != GL_NO_ERROR)
+    {
+        std::cerr << "Error building texture atlas! " << gluErrorString(error) << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+/******************************************************************************/
+void TextureAtlas::freeAtlas()
+{
+    if (_vertexBuffer != 0)
+    {
+        glDeleteBuffers(1, &_vertexBuffer);
+        _vertexBuffer = 0;
+    }
+
+    if (_indexBuffer != 0)
+    {
+        glDeleteBuffers(1, &_indexBuffer);
+        _indexBuffer = 0;
+    }
+
+    _pages.clear();
+    _regions.clear();
+}
+
+/******************************************************************************/
+bool TextureAtlas::isBuilt() const
+{
+    return _vertexBuffer != 0;
+}
+
+/******************************************************************************/
+unsigned TextureAtlas::getRegionCount() const
+{
+    return _regions.size();
+}
+
+/******************************************************************************/
+const AtlasRegion& TextureAtlas::getRegion(int index) const
+{
+    assert(index >= 0 && static_cast<unsigned>(index) < _regions.size());
+    return _regions[index];
+}
+
+/******************************************************************************/
+unsigned TextureAtlas::getPageCount() const
+{
+    return _pages.size();
+}
+
+/******************************************************************************/
+const Texture& TextureAtlas::getPage(unsigned page) const
+{
+    assert(page < _pages.size());
+    return _pages[page]->texture;
+}
+
+/******************************************************************************/
+unsigned TextureAtlas::getPageSize() const
+{
+    return _pageSize;
+}
+
+/******************************************************************************/
+void TextureAtlas::bind(ShaderProgram2D *program, unsigned page)
+{
+    assert(page < _pages.size());
+    _boundPage = page;
+
+    glBindTexture(GL_TEXTURE_2D, _pages[page]->texture.getTextureID());
+
+    program->enableVertexPointer();
+    program->enableTexCoordPointer();
+
+    glBindBuffer(GL_ARRAY_BUFFER, _vertexBuffer);
+    program->setVertexPointer(sizeof(TextureVertex2D), (GLvoid*)offsetof(TextureVertex2D, pos));
+    program->setTexCoordPointer(sizeof(TextureVertex2D), (GLvoid*)offsetof(TextureVertex2D, texCoord));
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer);
+}
+
+/******************************************************************************/
+void TextureAtlas::unbind(ShaderProgram2D *program)
+{
+    program->disableVertexPointer();
+    program->disableTexCoordPointer();
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+/******************************************************************************/
+void TextureAtlas::drawRegion(ShaderProgram2D *program, int index, GLfloat x, GLfloat y)
+{
+    assert(getRegion(index).page == _boundPage);
+
+    Matrix4x4 MV;
+    MV.setTranslation(x, y, 0.f);
+    program->setModelView(MV);
+    program->updateModelView();
+
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, (GLvoid*)(index * 6 * sizeof(GLuint)));
+}
+
+/******************************************************************************/
+bool TextureAtlas::place(unsigned width, unsigned height, AtlasRegion &region)
+{
+    unsigned paddedWidth = width + _padding * 2;
+    unsigned paddedHeight = height + _padding * 2;
+    if (paddedWidth > _pageSize || paddedHeight > _pageSize)
+    {
+        return false;
+    }
+
+    unsigned x = 0;
+    unsigned y = 0;
+    unsigned page = 0;
+    while (page < _pages.size() && !_pages[page]->packer.insert(paddedWidth, paddedHeight, x, y))
+    {
+        page++;
+    }
+
+    if (page == _pages.size())
+    {
+        std::unique_ptr<Page> newPage(new Page());
+        newPage->packer.reset(_pageSize, _pageSize);
+        newPage->pixels.assign(_pageSize * _pageSize, 0);
+        newPage->packer.insert(paddedWidth, paddedHeight, x, y);
+        _pages.push_back(std::move(newPage));
+    }
+
+    region.page = page;
+    region.rect.x = static_cast<GLfloat>(x + _padding);
+    region.rect.y = static_cast<GLfloat>(y + _padding);
+    region.rect.w = static_cast<GLfloat>(width);
+    region.rect.h = static_cast<GLfloat>(height);
+
+    GLfloat size = static_cast<GLfloat>(_pageSize);
+    region.u0 = region.rect.x / size;
+    region.v0 = region.rect.y / size;
+    region.u1 = (region.rect.x + region.rect.w) / size;
+    region.v1 = (region.rect.y + region.rect.h) / size;
+    return true;
+}
+
+/******************************************************************************/
+template<typename Read>
+void TextureAtlas::copyImage(const AtlasRegion &region, unsigned stride, const FontRect &clip, Read read)
+{
+    std::vector<GLuint> &destination = _pages[region.page]->pixels;
+
+    int width = static_cast<int>(region.rect.w);
+    int height = static_cast<int>(region.rect.h);
+    int padding = static_cast<int>(_padding);
+    if (width == 0 || height == 0)
+    {
+        return;
+    }
+
+    unsigned left = static_cast<unsigned>(region.rect.x) - _padding;
+    unsigned top = static_cast<unsigned>(region.rect.y) - _padding;
+
+    //Every pixel of the padded area copies the nearest pixel of the image.
+    for (int y = -padding; y < height + padding; y++)
+    {
+        unsigned sourceY = static_cast<unsigned>(clip.y) + std::min(std::max(y, 0), height - 1);
+        for (int x = -padding; x < width + padding; x++)
+        {
+            unsigned sourceX = static_cast<unsigned>(clip.x) + std::min(std::max(x, 0), width - 1);
+            destination[(top + y + padding) * _pageSize + left + x + padding] = read(sourceY * stride + sourceX);
+        }
+    }
+}
+
+/******************************************************************************/
+template<typename Pixel, typename Convert>
+int TextureAtlas::addImages(const Pixel* pixels, unsigned stride, const std::vector<FontRect> &clips, Convert convert)
+{
+    if (clips.empty())
+    {
+        return -1;
+    }
+
+    //Tall images go first, the skyline stays flat that way and there are fewer gaps under it.
+    std::vector<unsigned> order(clips.size());
+    for (unsigned i = 0; i < order.size(); i++)
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&clips](unsigned a, unsigned b)
+    {
+        return clips[a].h > clips[b].h;
+    });
+
+    int first = _regions.size();
+    _regions.resize(_regions.size() + clips.size());
+    for (unsigned i = 0; i < order.size(); i++)
+    {
+        const FontRect &clip = clips[order[i]];
+        AtlasRegion &region = _regions[first + order[i]];
+
+        if (!place(static_cast<unsigned>(clip.w), static_cast<unsigned>(clip.h), region))
+        {
+            std::cerr << "Image is too big for a " << _pageSize << " atlas page!" << std::endl;
+            _regions.resize(first);
+            return -1;
+        }
+
+        copyImage(region, stride, clip, [pixels, convert](unsigned index) { return convert(pixels[index]); });
+    }
+
+    return first;
+}
+}; //wind
@@ -0,0 +1,137 @@
+#ifndef TEXTURE_ATLAS_H
+#define TEXTURE_ATLAS_H
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "Texture.h"
+#include "SpriteSheet.h"
+#include "include/FontRect.h"
+
+namespace wind
+{
+class ShaderProgram2D;
+
+/**
+    This class packs rectangles into a page with the skyline method.
+    The skyline is the top edge of everything packed so far, as a list of flat segments. Each new rectangle goes wherever its
+    top would end up lowest, so the page fills from the bottom up with very little wasted space and packing stays fast.
+*/
+class SkylinePacker
+{
+public:
+    SkylinePacker();
+    SkylinePacker(unsigned width, unsigned height);
+
+    //This clears the page.
+    void reset(unsigned width, unsigned height);
+
+    //This finds a place for the rectangle, it returns false if there isn't room.
+    bool insert(unsigned width, unsigned height, unsigned &x, unsigned &y);
+
+    //How much of the page has been packed, from 0 to 1.
+    float getOccupancy() const;
+
+private:
+    struct Segment
+    {
+        unsigned x;
+        unsigned y;
+        unsigned width;
+    };
+
+    //This finds how high a rectangle would have to sit to start on the segment, it returns false if it doesn't fit there.
+    bool fits(unsigned segment, unsigned width, unsigned height, unsigned &y) const;
+
+    std::vector<Segment> _skyline;
+    unsigned _width;
+    unsigned _height;
+    std::uint64_t _usedArea;
+};
+
+//Where an image ended up in the atlas, the rect is in pixels and the UVs are what the shared vertex buffer uses.
+struct AtlasRegion
+{
+    unsigned page;
+    FontRect rect;
+    GLfloat u0;
+    GLfloat v0;
+    GLfloat u1;
+    GLfloat v1;
+};
+
+/**
+    This class packs lots of images, sprite sheets and fonts into a few shared RGBA pages.
+    Every region gets a quad in one shared vertex buffer and six indices in one shared index buffer, so everything on a page
+    can be drawn after binding the page and the buffers just once.
+    Images are copied in as they are added, and build uploads the pages and the buffers once everything is in.
+    Note: 8 bit images are copied into all four channels, so a shader reading the red channel as coverage still works.
+*/
+class TextureAtlas
+{
+public:
+    //Every image gets a border of its own edge pixels, so filtering never pulls in its neighbours.
+    explicit TextureAtlas(unsigned pageSize = 1024, unsigned padding = 1);
+    ~TextureAtlas();
+
+    //These add the part of the image under the clip and return the region's index, or -1 if it is bigger than a page.
+    //The stride is the width of a row of the image in pixels.
+    int addImage32(const GLuint* pixels, unsigned stride, const FontRect &clip);
+    int addImage8(const GLubyte* pixels, unsigned stride, const FontRect &clip);
+
+    //These add a whole sheet of clips and return the index of the first one, the rest follow in order.
+    //The clips are packed tallest first which packs much tighter than going in order.
+    int addImages32(const GLuint* pixels, unsigned stride, const std::vector<FontRect> &clips);
+    int addImages8(const GLubyte* pixels, unsigned stride, const std::vector<FontRect> &clips);
+
+    //This uploads the pages and makes the shared buffers, images added after this need another build.
+    bool build(SpriteOrigin origin = SPRITE_ORIGIN_CENTER);
+    void freeAtlas();
+    bool isBuilt() const;
+
+    unsigned getRegionCount() const;
+    const AtlasRegion& getRegion(int index) const;
+
+    unsigned getPageCount() const;
+    const Texture& getPage(unsigned page) const;
+    unsigned getPageSize() const;
+
+    //This binds a page and the shared buffers, any region on the page can then be drawn without binding anything else.
+    void bind(ShaderProgram2D *program, unsigned page);
+    void unbind(ShaderProgram2D *program);
+
+    //The region has to be on the bound page.
+    void drawRegion(ShaderProgram2D *program, int index, GLfloat x, GLfloat y);
+
+private:
+    TextureAtlas(const TextureAtlas&);
+    TextureAtlas& operator=(const TextureAtlas&);
+
+    struct Page
+    {
+        SkylinePacker packer;
+        std::vector<GLuint> pixels;
+        Texture texture;
+    };
+
+    //This finds room for a width by height image, making a new page if none of them have room.
+    bool place(unsigned width, unsigned height, AtlasRegion &region);
+    //This copies an image into its region with its edges stretched out over the padding, read gives the RGBA pixel at an index.
+    template<typename Read>
+    void copyImage(const AtlasRegion &region, unsigned stride, const FontRect &clip, Read read);
+    template<typename Pixel, typename Convert>
+    int addImages(const Pixel* pixels, unsigned stride, const std::vector<FontRect> &clips, Convert convert);
+
+    unsigned _pageSize;
+    unsigned _padding;
+    std::vector<std::unique_ptr<Page>> _pages;
+    std::vector<AtlasRegion> _regions;
+
+    GLuint _vertexBuffer;
+    GLuint _indexBuffer;
+    unsigned _boundPage;
+};
+}; //wind
+
+#endif
@@ -0,0 +1,423 @@
+#include "TextureStreamer.h"
+
+#include "MappedFile.h"
+
+namespace wind
+{
+
+namespace
+{
+    //Four megabytes a frame is a 1024 by 1024 image, that's well under a millisecond of bus time on anything recent.
+    const unsigned DEFAULT_UPLOAD_BUDGET = 4 * 1024 * 1024;
+
+    //Two greys in a checker, it's obvious something is still loading without being too loud about it.
+    GLuint placeholderPixels[4] = { 0xff808080, 0xffa0a0a0, 0xffa0a0a0, 0xff808080 };
+
+    GLuint powerOfTwo(GLuint number)
+    {
+        if (number != 0)
+        {
+            number--;
+            number |= (number >> 1);
+            number |= (number >> 2);
+            number |= (number >> 4);
+            number |= (number >> 8);
+            number |= (number >> 16);
+            number++;
+        }
+
+        return number;
+    }
+}
+
+/******************************************************************************/
+TextureStreamer::TextureStreamer(unsigned workerCount) : _workerCount(workerCount > 0 ? workerCount : 1),
+_uploadBudget(DEFAULT_UPLOAD_BUDGET), _pending(0), _pixelBuffer(0), _stop(false)
+{
+}
+
+/******************************************************************************/
+TextureStreamer::~TextureStreamer()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+        _queue.clear();
+    }
+    _wake.notify_all();
+
+    for (unsigned i = 0; i < _workers.size(); i++)
+    {
+        _workers[i].join();
+    }
+
+    //Textures that were part way up are thrown away, their Texture still has the placeholder.
+    for (unsigned i = 0; i < _uploads.size(); i++)
+    {
+        if (_uploads[i]->textureID != 0)
+        {
+            glDeleteTextures(1, &_uploads[i]->textureID);
+        }
+    }
+
+    if (_pixelBuffer != 0)
+    {
+        glDeleteBuffers(1, &_pixelBuffer);
+    }
+}
+
+/******************************************************************************/
+void TextureStreamer::load(Texture &texture, const std::string &filePath, LoadCallback callback)
+{
+    queueJob(texture, filePath, false, TEXTURE_FORMAT_RGBA8, callback);
+}
+
+/******************************************************************************/
+void TextureStreamer::loadCooked(Texture &texture, const std::string &filePath, TextureFormat format, LoadCallback callback)
+{
+    queueJob(texture, filePath, true, Texture::isFormatSupported(format) ? format : TEXTURE_FORMAT_RGBA8, callback);
+}
+
+/******************************************************************************/
+void TextureStreamer::update()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _uploads.insert(_uploads.end(), _decoded.begin(), _decoded.end());
+        _decoded.clear();
+    }
+
+    //Textures go up in the order they were decoded, a big one can take a few frames before the next starts.
+    unsigned budget = _uploadBudget;
+    while (!_uploads.empty() && budget > 0)
+    {
+        TextureJob &job = *_uploads.front();
+
+        bool done = true;
+        if (job.loaded)
+        {
+            unsigned used = job.cooked ? uploadCookedJob(job, budget, done) : uploadJob(job, budget, done);
+            budget = used < budget ? budget - used : 0;
+        }
+
+        if (!done)
+        {
+            break;
+        }
+
+        std::shared_ptr<TextureJob> finished = _uploads.front();
+        _uploads.pop_front();
+        completeJob(*finished);
+    }
+}
+
+/******************************************************************************/
+void TextureStreamer::finish()
+{
+    unsigned budget = _uploadBudget;
+    _uploadBudget = ~0u;
+
+    while (_pending > 0)
+    {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _done.wait(lock, [this]{ return !_decoded.empty() || !_uploads.empty(); });
+        }
+
+        update();
+    }
+
+    _uploadBudget = budget;
+}
+
+/******************************************************************************/
+void TextureStreamer::setUploadBudget(unsigned bytes)
+{
+    _uploadBudget = bytes;
+}
+
+/******************************************************************************/
+unsigned TextureStreamer::getUploadBudget() const
+{
+    return _uploadBudget;
+}
+
+/******************************************************************************/
+unsigned TextureStreamer::getPendingCount() const
+{
+    return _pending;
+}
+
+/******************************************************************************/
+void TextureStreamer::queueJob(Texture &texture, const std::string &filePath, bool cooked, TextureFormat format, LoadCallback callback)
+{
+    texture.loadTextureFromPixels32(placeholderPixels, 2, 2, 2, 2);
+
+    std::shared_ptr<TextureJob> job = std::make_shared<TextureJob>();
+    job->texture = &texture;
+    job->filePath = filePath;
+    job->callback = callback;
+    job->imageWidth = job->imageHeight = job->textureWidth = job->textureHeight = 0;
+    job->loaded = false;
+    job->cooked = cooked;
+    job->format = format;
+    job->textureID = 0;
+    job->rowsUploaded = 0;
+    job->levelsUploaded = 0;
+
+    _pending++;
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _queue.push_back(job);
+        startWorkers();
+    }
+    _wake.notify_one();
+}
+
+/******************************************************************************/
+void TextureStreamer::decodeJob(TextureJob &job)
+{
+    job.loaded = false;
+
+    if (job.cooked)
+    {
+        //The cooked file is mapped, the levels are read straight out of it when they go up.
+        job.loaded = job.cookedTexture.load(job.filePath, job.format);
+        job.imageWidth = job.textureWidth = job.cookedTexture.getWidth();
+        job.imageHeight = job.textureHeight = job.cookedTexture.getHeight();
+        return;
+    }
+
+    //The file is read before the decode takes the lock, so only the decode itself holds up the other workers.
+    MappedFile source(job.filePath);
+    if (!source.isOpen())
+    {
+        return;
+    }
+
+    std::vector<GLuint> pixels;
+    if (!Texture::decodeImage32(job.filePath, source.getData(), source.getSize(), pixels, job.imageWidth, job.imageHeight))
+    {
+        return;
+    }
+
+    job.textureWidth = powerOfTwo(job.imageWidth);
+    job.textureHeight = powerOfTwo(job.imageHeight);
+
+    //This pads the image the same way Texture::padPixels32 does, every row goes at the start of its padded row.
+    if (job.imageWidth != job.textureWidth || job.imageHeight != job.textureHeight)
+    {
+        job.pixels.assign(job.textureWidth * job.textureHeight, 0);
+        for (GLuint i = 0; i < job.imageHeight; i++)
+        {
+            memcpy(&job.pixels[i * job.textureWidth], &pixels[i * job.imageWidth], job.imageWidth * 4);
+        }
+    }
+    else
+    {
+        job.pixels.swap(pixels);
+    }
+
+    job.loaded = true;
+}
+
+/******************************************************************************/
+unsigned TextureStreamer::uploadJob(TextureJob &job, unsigned budget, bool &done)
+{
+    if (job.textureID == 0)
+    {
+        //The storage is made up front and the rows are filled in over the next few frames.
+        glGenTextures(1, &job.textureID);
+        glBindTexture(GL_TEXTURE_2D, job.textureID);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, job.textureWidth, job.textureHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    }
+
+    //We always send at least a row so a tiny budget can't stop a texture from ever loading.
+    unsigned rowBytes = job.textureWidth * 4;
+    GLuint rows = budget / rowBytes;
+    rows = rows > 0 ? rows : 1;
+    rows = rows < job.textureHeight - job.rowsUploaded ? rows : job.textureHeight - job.rowsUploaded;
+    unsigned bytes = rows * rowBytes;
+
+    const GLuint* source = &job.pixels[job.rowsUploaded * job.textureWidth];
+
+    const GLvoid* data = fillPixelBuffer(source, bytes);
+
+    glBindTexture(GL_TEXTURE_2D, job.textureID);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, job.rowsUploaded, job.textureWidth, rows, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    job.rowsUploaded += rows;
+    done = job.rowsUploaded == job.textureHeight;
+
+    return bytes;
+}
+
+/******************************************************************************/
+unsigned TextureStreamer::uploadCookedJob(TextureJob &job, unsigned budget, bool &done)
+{
+    const CookedTexture &cooked = job.cookedTexture;
+    if (job.textureID == 0)
+    {
+        glGenTextures(1, &job.textureID);
+        glBindTexture(GL_TEXTURE_2D, job.textureID);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, cooked.getLevelCount() - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    }
+
+    //Levels go up whole, at least one a frame, the smallest ones usually all fit in what's left of the budget.
+    unsigned used = 0;
+    GLenum internalFormat = Texture::getInternalFormat(job.format);
+    while (job.levelsUploaded < cooked.getLevelCount())
+    {
+        const CookedTextureLevel &level = cooked.getLevel(job.levelsUploaded);
+        unsigned bytes = static_cast<unsigned>(level.size);
+        if (used > 0 && used + bytes > budget)
+        {
+            break;
+        }
+
+        const GLvoid* data = fillPixelBuffer(cooked.getLevelData(job.levelsUploaded), bytes);
+
+        glBindTexture(GL_TEXTURE_2D, job.textureID);
+        if (job.format == TEXTURE_FORMAT_RGBA8)
+        {
+            glTexImage2D(GL_TEXTURE_2D, job.levelsUploaded, GL_RGBA, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+        }
+        else
+        {
+            glCompressedTexImage2D(GL_TEXTURE_2D, job.levelsUploaded, internalFormat, level.width, level.height, 0, bytes, data);
+        }
+
+        job.levelsUploaded++;
+        used += bytes;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    done = job.levelsUploaded == cooked.getLevelCount();
+
+    return used;
+}
+
+/******************************************************************************/
+const GLvoid* TextureStreamer::fillPixelBuffer(const void* data, unsigned bytes)
+{
+    //The buffer is orphaned each time, so the driver can hand us fresh memory while the last strip is still being copied.
+    if (_pixelBuffer == 0)
+    {
+        glGenBuffers(1, &_pixelBuffer);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _pixelBuffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+
+    void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (mapped == nullptr)
+    {
+        //If the map failed we send the data straight from memory instead.
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return data;
+    }
+
+    memcpy(mapped, data, bytes);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    return nullptr;
+}
+
+/******************************************************************************/
+void TextureStreamer::completeJob(TextureJob &job)
+{
+    _pending--;
+
+    Texture &texture = *job.texture;
+    if (job.loaded)
+    {
+        GLenum error = glGetError();
+        if (error != GL_NO_ERROR)
+        {
+            std::cerr << "Error uploading texture " << job.filePath << "! " << gluErrorString(error) << std::endl;
+            glDeleteTextures(1, &job.textureID);
+            job.loaded = false;
+        }
+        else
+        {
+            //Now the real texture takes the placeholder's place.
+            if (texture._textureID != 0)
+            {
+                glDeleteTextures(1, &texture._textureID);
+            }
+
+            texture._textureID = job.textureID;
+            texture._imageWidth = job.imageWidth;
+            texture._imageHeight = job.imageHeight;
+            texture._textureWidth = job.textureWidth;
+            texture._textureHeight = job.textureHeight;
+            texture._pixelFormat = GL_RGBA;
+            texture.initVBO();
+        }
+    }
+    else
+    {
+        std::cerr << "Unable to load: " << job.filePath << std::endl;
+    }
+
+    job.textureID = 0;
+    job.pixels = std::vector<GLuint>();
+    job.cookedTexture.close();
+
+    if (job.callback)
+    {
+        job.callback(texture, job.loaded);
+    }
+}
+
+/******************************************************************************/
+void TextureStreamer::startWorkers()
+{
+    //The threads are only started the first time we need them.
+    while (_workers.size() < _workerCount)
+    {
+        _workers.push_back(std::thread(&TextureStreamer::workerLoop, this));
+    }
+}
+
+/******************************************************************************/
+void TextureStreamer::workerLoop()
+{
+    while (true)
+    {
+        std::shared_ptr<TextureJob> job;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [this]{ return _stop || !_queue.empty(); });
+            if (_stop)
+            {
+                return;
+            }
+
+            job = _queue.front();
+            _queue.pop_front();
+        }
+
+        decodeJob(*job);
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _decoded.push_back(job);
+        }
+        _done.notify_all();
+    }
+}
+}; //wind
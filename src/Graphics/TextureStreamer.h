@@ -0,0 +1,112 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "Texture.h"
+#include "CookedTexture.h"
+
+namespace wind
+{
+/**
+    This class loads textures without stalling the frame loop.
+    A texture is given a small placeholder straight away, the image is decoded into memory on a worker thread and then
+    uploaded a strip of rows at a time through a pixel buffer object, never more than the byte budget a frame.
+    When the last row is up the real texture takes the placeholder's place.
+    Cooked textures go up a whole mip level at a time instead, and are cooked on the worker first if they need to be.
+    Note: DevIL can only decode one image at a time, so the workers take turns decoding but the file reads and copies overlap.
+*/
+class TextureStreamer
+{
+public:
+    //The bool is false if the image couldn't be loaded, the texture then keeps the placeholder.
+    using LoadCallback = std::function<void(Texture&, bool)>;
+
+    explicit TextureStreamer(unsigned workerCount = 1);
+    ~TextureStreamer();
+
+    //The texture has to stay alive until it is loaded or the streamer is gone, it is given the placeholder right away.
+    void load(Texture &texture, const std::string &filePath, LoadCallback callback = LoadCallback());
+    //This is the same but loads the cooked version of the image, if the card can't use the format we fall back to RGBA8.
+    void loadCooked(Texture &texture, const std::string &filePath, TextureFormat format, LoadCallback callback = LoadCallback());
+
+    //This function needs to be called on the GL thread every frame, it uploads as much as the budget allows.
+    void update();
+    //This waits for every load and uploads all of them, the budget is ignored.
+    void finish();
+
+    //How many bytes of pixels can go to the GPU each frame.
+    void setUploadBudget(unsigned bytes);
+    unsigned getUploadBudget() const;
+
+    //How many textures haven't been swapped in yet.
+    unsigned getPendingCount() const;
+
+private:
+    TextureStreamer(const TextureStreamer&);
+    TextureStreamer& operator=(const TextureStreamer&);
+
+    struct TextureJob
+    {
+        Texture* texture;
+        std::string filePath;
+        LoadCallback callback;
+
+        //These are filled in by the worker, the pixels are already padded to the texture size.
+        std::vector<GLuint> pixels;
+        GLuint imageWidth;
+        GLuint imageHeight;
+        GLuint textureWidth;
+        GLuint textureHeight;
+        bool loaded;
+
+        //Cooked jobs keep their file mapped here instead of filling the pixels.
+        bool cooked;
+        TextureFormat format;
+        CookedTexture cookedTexture;
+
+        //This is the texture being uploaded and how many rows or levels have gone up.
+        GLuint textureID;
+        GLuint rowsUploaded;
+        GLuint levelsUploaded;
+    };
+
+    void queueJob(Texture &texture, const std::string &filePath, bool cooked, TextureFormat format, LoadCallback callback);
+    static void decodeJob(TextureJob &job);
+    //This uploads up to the budget and returns how many bytes it used, it returns true in done when the job is finished.
+    unsigned uploadJob(TextureJob &job, unsigned budget, bool &done);
+    unsigned uploadCookedJob(TextureJob &job, unsigned budget, bool &done);
+    //This copies the data into the pixel buffer and returns what to pass to glTexImage, which is null unless the map failed.
+    const GLvoid* fillPixelBuffer(const void* data, unsigned bytes);
+    void completeJob(TextureJob &job);
+
+    void startWorkers();
+    void workerLoop();
+
+    unsigned _workerCount;
+    unsigned _uploadBudget;
+    unsigned _pending;
+    GLuint _pixelBuffer;
+
+    //Jobs that have been decoded and are waiting for, or part way through, their upload.
+    std::deque<std::shared_ptr<TextureJob>> _uploads;
+
+    //The queue to the workers and the jobs they have finished, both are guarded by the mutex.
+    std::deque<std::shared_ptr<TextureJob>> _queue;
+    std::vector<std::shared_ptr<TextureJob>> _decoded;
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _done;
+    std::vector<std::thread> _workers;
+    bool _stop;
+};
+}; //wind
+
+#endif
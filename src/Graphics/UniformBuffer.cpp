@@ -0,0 +1,113 @@
+#include "UniformBuffer.h"
+
+#include <cstring>
+
+namespace wind
+{
+
+namespace
+{
+    //The smallest region we make, that's a thousand objects at the usual 256 byte alignment.
+    const GLsizeiptr MIN_REGION_SIZE = 256 * 1024;
+
+    //std140 blocks never need less than this.
+    const GLsizeiptr MIN_OFFSET_ALIGNMENT = 16;
+}
+
+/******************************************************************************/
+UniformBuffer::UniformBuffer() : _stream(GL_UNIFORM_BUFFER, MIN_REGION_SIZE)
+{
+}
+
+/******************************************************************************/
+bool UniformBuffer::isSupported()
+{
+    return GLEW_VERSION_3_1 || GLEW_ARB_uniform_buffer_object;
+}
+
+/******************************************************************************/
+GLsizeiptr UniformBuffer::getOffsetAlignment()
+{
+    //The alignment never changes so the driver is only asked once.
+    static GLsizeiptr alignment = 0;
+    if (alignment == 0)
+    {
+        GLint value = 0;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &value);
+        alignment = value > MIN_OFFSET_ALIGNMENT ? value : MIN_OFFSET_ALIGNMENT;
+    }
+    return alignment;
+}
+
+/******************************************************************************/
+GLsizeiptr UniformBuffer::getStride(GLsizeiptr size)
+{
+    GLsizeiptr alignment = getOffsetAlignment();
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+/******************************************************************************/
+GLintptr UniformBuffer::write(const void* data, GLsizeiptr size)
+{
+    GLintptr offset = _stream.reserve(size, getOffsetAlignment());
+    _stream.upload(offset, data, size);
+    return offset;
+}
+
+/******************************************************************************/
+GLintptr UniformBuffer::writeBlocks(const void* data, GLsizeiptr size, unsigned count)
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    GLsizeiptr stride = getStride(size);
+    GLsizeiptr total = stride * (count - 1) + size;
+    GLintptr offset = _stream.reserve(total, getOffsetAlignment());
+
+    const char* source = static_cast<const char*>(data);
+    char* destination = _stream.getMapped(offset);
+    if (destination == nullptr)
+    {
+        _staging.resize(total);
+        destination = &_staging[0];
+    }
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        memcpy(destination + i * stride, source + i * size, size);
+    }
+
+    if (!_stream.isPersistent())
+    {
+        _stream.upload(offset, &_staging[0], total);
+    }
+
+    return offset;
+}
+
+/******************************************************************************/
+void UniformBuffer::bindRange(GLuint binding, GLintptr offset, GLsizeiptr size) const
+{
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, _stream.getBuffer(), offset, size);
+}
+
+/******************************************************************************/
+void UniformBuffer::endFrame()
+{
+    _stream.endFrame();
+}
+
+/******************************************************************************/
+GLuint UniformBuffer::getBuffer() const
+{
+    return _stream.getBuffer();
+}
+
+/******************************************************************************/
+bool UniformBuffer::isPersistent() const
+{
+    return _stream.isPersistent();
+}
+}; //wind
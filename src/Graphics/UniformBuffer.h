@@ -0,0 +1,57 @@
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include <vector>
+#include <GL/glew.h>
+
+#include "StreamBuffer.h"
+#include "include/UniformBlocks.h"
+
+namespace wind
+{
+//The binding points the blocks are bound to, every program that has a block gets it pointed at the same point.
+const GLuint FRAME_CONSTANTS_BINDING = 0;
+const GLuint OBJECT_CONSTANTS_BINDING = 1;
+
+/**
+    This class holds uniform blocks that are rewritten every frame, each write goes to a new place in the buffer and is bound by its offset.
+    Like the InstanceBuffer it is a StreamBuffer, on the uniform buffer target, so with buffer storage a write is just a copy.
+    Every write starts on the driver's uniform offset alignment, that's often 256 bytes, so any block written can be bound on its own.
+*/
+class UniformBuffer
+{
+public:
+    UniformBuffer();
+
+    //This function returns true if the driver has uniform buffer objects at all.
+    static bool isSupported();
+    //This is how far apart two blocks that are bound on their own have to be.
+    static GLsizeiptr getOffsetAlignment();
+
+    //This copies one block into the buffer and returns the offset in bytes that it went to.
+    GLintptr write(const void* data, GLsizeiptr size);
+    //This copies count blocks of size bytes that are packed together, each one ends up getStride(size) bytes after the last.
+    //It is still just one write, it returns the offset of the first block.
+    GLintptr writeBlocks(const void* data, GLsizeiptr size, unsigned count);
+    static GLsizeiptr getStride(GLsizeiptr size);
+
+    void bindRange(GLuint binding, GLintptr offset, GLsizeiptr size) const;
+
+    //This needs to be called once all of the frame's draws have been made.
+    void endFrame();
+
+    GLuint getBuffer() const;
+    bool isPersistent() const;
+
+private:
+    UniformBuffer(const UniformBuffer&);
+    UniformBuffer& operator=(const UniformBuffer&);
+
+    StreamBuffer _stream;
+
+    //Without a mapping the blocks are spread out here first so they still go up in one call.
+    std::vector<char> _staging;
+};
+}; //wind
+
+#endif
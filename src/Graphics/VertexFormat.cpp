@@ -0,0 +1,185 @@
+#include "VertexFormat.h"
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+
+namespace wind
+{
+
+namespace
+{
+    //Half floats have ten bits after the point, so between one and two they are 1/1024 apart.
+    //We allow half of that, which is about a texel on a 2048 texture.
+    const float MAX_TEXCOORD_ERROR = 1.0f / 2048.0f;
+
+    std::int16_t floatToShort(float value)
+    {
+        value = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+        return static_cast<std::int16_t>(std::floor(value * 32767.0f + 0.5f));
+    }
+}
+
+/******************************************************************************/
+VertexFormat chooseVertexFormat(VertexFormat format, const CookedVertex* vertices, unsigned count)
+{
+    if (format != VERTEX_FORMAT_AUTO)
+    {
+        return format;
+    }
+
+    //Texcoords that tile a texture many times lose too much in a half float, so those meshes stay as floats.
+    for (unsigned i = 0; i < count; i++)
+    {
+        for (unsigned j = 0; j < 2; j++)
+        {
+            float texCoord = vertices[i].texCoord[j];
+            if (std::fabs(halfToFloat(floatToHalf(texCoord)) - texCoord) > MAX_TEXCOORD_ERROR)
+            {
+                return VERTEX_FORMAT_FLOAT;
+            }
+        }
+    }
+
+    return VERTEX_FORMAT_PACKED;
+}
+
+/******************************************************************************/
+unsigned getVertexStride(VertexFormat format)
+{
+    return format == VERTEX_FORMAT_FLOAT ? sizeof(CookedVertex) : sizeof(PackedVertex);
+}
+
+/******************************************************************************/
+void packVertices(const CookedVertex* vertices, unsigned count, std::vector<PackedVertex> &out)
+{
+    out.resize(count);
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        const CookedVertex &in = vertices[i];
+        PackedVertex &packed = out[i];
+
+        packed.position[0] = in.position[0];
+        packed.position[1] = in.position[1];
+        packed.position[2] = in.position[2];
+
+        packed.texCoord[0] = floatToHalf(in.texCoord[0]);
+        packed.texCoord[1] = floatToHalf(in.texCoord[1]);
+
+        packed.normal[0] = floatToShort(in.normal[0]);
+        packed.normal[1] = floatToShort(in.normal[1]);
+        packed.normal[2] = floatToShort(in.normal[2]);
+        packed.normal[3] = 0;
+    }
+}
+
+/******************************************************************************/
+std::uint16_t floatToHalf(float value)
+{
+    std::uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    std::uint32_t sign = (bits >> 16) & 0x8000;
+    std::uint32_t exponent = (bits >> 23) & 0xff;
+    std::uint32_t mantissa = bits & 0x7fffff;
+
+    //Infinity stays infinity and NaN stays NaN.
+    if (exponent == 0xff)
+    {
+        return static_cast<std::uint16_t>(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+    }
+
+    int halfExponent = static_cast<int>(exponent) - 127 + 15;
+
+    //Too big for a half float.
+    if (halfExponent >= 31)
+    {
+        return static_cast<std::uint16_t>(sign | 0x7c00);
+    }
+
+    //Too small for a normal half float, so we make a denormal or zero.
+    if (halfExponent <= 0)
+    {
+        if (halfExponent < -10)
+        {
+            return static_cast<std::uint16_t>(sign);
+        }
+
+        mantissa |= 0x800000;
+        unsigned shift = 14 - halfExponent;
+        std::uint32_t half = mantissa >> shift;
+        std::uint32_t remainder = mantissa & ((1u << shift) - 1);
+        std::uint32_t halfway = 1u << (shift - 1);
+
+        if (remainder > halfway || (remainder == halfway && (half & 1)))
+        {
+            half++;
+        }
+        return static_cast<std::uint16_t>(sign | half);
+    }
+
+    //We round to the nearest, ties go to even. If the rounding carries it moves into the exponent which is what we want.
+    std::uint32_t half = (static_cast<std::uint32_t>(halfExponent) << 10) | (mantissa >> 13);
+    std::uint32_t remainder = mantissa & 0x1fff;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+    {
+        half++;
+    }
+
+    return static_cast<std::uint16_t>(sign | half);
+}
+
+/******************************************************************************/
+float halfToFloat(std::uint16_t value)
+{
+    std::uint32_t sign = static_cast<std::uint32_t>(value & 0x8000) << 16;
+    std::uint32_t exponent = (value >> 10) & 0x1f;
+    std::uint32_t mantissa = value & 0x3ff;
+
+    std::uint32_t bits;
+    if (exponent == 0x1f)
+    {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    }
+    else if (exponent != 0)
+    {
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    }
+    else
+    {
+        //Denormals are just the mantissa scaled down.
+        float result = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign ? -result : result;
+    }
+
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+/******************************************************************************/
+void setVertexLayout(VertexFormat format)
+{
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+
+    if (format == VERTEX_FORMAT_FLOAT)
+    {
+        const GLsizei stride = sizeof(CookedVertex);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (const GLvoid*)offsetof(CookedVertex, position));
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (const GLvoid*)offsetof(CookedVertex, texCoord));
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (const GLvoid*)offsetof(CookedVertex, normal));
+    }
+    else
+    {
+        //The shader still sees floats, the normal shorts are turned back into -1 to 1 by the GPU.
+        const GLsizei stride = sizeof(PackedVertex);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (const GLvoid*)offsetof(PackedVertex, position));
+        glVertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, stride, (const GLvoid*)offsetof(PackedVertex, texCoord));
+        glVertexAttribPointer(2, 3, GL_SHORT, GL_TRUE, stride, (const GLvoid*)offsetof(PackedVertex, normal));
+    }
+}
+}; //wind
@@ -0,0 +1,45 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <vector>
+#include <cstdint>
+
+#include "CookedMesh.h"
+
+namespace wind
+{
+//How a mesh's vertices are laid out on the GPU. Both are one interleaved buffer.
+enum VertexFormat
+{
+    //Position, texcoord and normal all as floats, 32 bytes a vertex.
+    VERTEX_FORMAT_FLOAT,
+    //Float position, half float texcoord and a normalised short normal, 24 bytes a vertex.
+    VERTEX_FORMAT_PACKED,
+    //Packed unless the texcoords are too big for a half float to hold them accurately.
+    VERTEX_FORMAT_AUTO
+};
+
+//The packed vertex, the normal has a fourth short so every attribute starts on four bytes.
+struct PackedVertex
+{
+    float position[3];
+    std::uint16_t texCoord[2];
+    std::int16_t normal[4];
+};
+
+//This function picks the format to use for a set of vertices, it only changes anything for VERTEX_FORMAT_AUTO.
+VertexFormat chooseVertexFormat(VertexFormat format, const CookedVertex* vertices, unsigned count);
+
+unsigned getVertexStride(VertexFormat format);
+
+//This packs the float vertices into the out buffer, the buffer is resized to fit.
+void packVertices(const CookedVertex* vertices, unsigned count, std::vector<PackedVertex> &out);
+
+std::uint16_t floatToHalf(float value);
+float halfToFloat(std::uint16_t value);
+
+//This sets up the attribute pointers 0, 1 and 2 for the vertex buffer that is bound.
+void setVertexLayout(VertexFormat format);
+}; //wind
+
+#endif
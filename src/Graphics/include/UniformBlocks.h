@@ -0,0 +1,22 @@
+#ifndef UNIFORMBLOCKS_H
+#define UNIFORMBLOCKS_H
+
+/**
+	These are laid out the std140 way, every member is a multiple of 16 bytes so they match these GLSL blocks byte for byte:
+		layout(std140) uniform FrameConstants { mat4 viewProjection; vec4 cameraPosition; vec4 texColour; };
+		layout(std140) uniform ObjectConstants { mat4 model; };
+	They are plain floats so they can be used without GL, like in a RenderCommandBuffer.
+*/
+struct FrameConstants
+{
+	float viewProjection[16];
+	float cameraPosition[4];
+	float colour[4];
+};
+
+struct ObjectConstants
+{
+	float model[16];
+};
+
+#endif
@@ -0,0 +1,161 @@
+#ifndef COLLISION_GEOMETRY_H
+#define COLLISION_GEOMETRY_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "collision_narrow.h"
+
+/**
+    These are the closest point and triangle mesh helpers the contact generation and the world query both use.
+    They are only meant for the collision system's own files.
+*/
+
+namespace wind
+{
+    //This finds the point on the segment from start to end closest to the given point.
+    inline Vector3 closestPointOnSegment(const Vector3& point, const Vector3& start, const Vector3& end)
+    {
+        Vector3 line = end - start;
+        real length = line * line;
+        if(length <= real_epsilon)
+        {
+            return start;
+        }
+
+        real along = std::max((real)0.0, std::min((real)1.0, ((point - start) * line) / length));
+        return start + line * along;
+    }
+
+    //This finds the closest points between the segments p1 q1 and p2 q2.
+    inline void closestPointsOnSegments(const Vector3& p1, const Vector3& q1, const Vector3& p2, const Vector3& q2, Vector3& onOne, Vector3& onTwo)
+    {
+        Vector3 d1 = q1 - p1;
+        Vector3 d2 = q2 - p2;
+        real a = d1 * d1;
+        real e = d2 * d2;
+
+        //If either segment is only a point, it is the closest point on the other one to it.
+        if(a <= real_epsilon)
+        {
+            onOne = p1;
+            onTwo = closestPointOnSegment(p1, p2, q2);
+            return;
+        }
+        if(e <= real_epsilon)
+        {
+            onOne = closestPointOnSegment(p2, p1, q1);
+            onTwo = p2;
+            return;
+        }
+
+        Vector3 r = p1 - p2;
+        real b = d1 * d2;
+        real c = d1 * r;
+        real f = d2 * r;
+        real denom = a * e - b * b;
+        real s = denom != 0 ? std::max((real)0.0, std::min((real)1.0, (b * f - c * e) / denom)) : 0;
+        real t = (b * s + f) / e;
+
+        if(t < 0)
+        {
+            t = 0;
+            s = std::max((real)0.0, std::min((real)1.0, -c / a));
+        }
+        else if(t > 1)
+        {
+            t = 1;
+            s = std::max((real)0.0, std::min((real)1.0, (b - c) / a));
+        }
+
+        onOne = p1 + d1 * s;
+        onTwo = p2 + d2 * t;
+    }
+
+    //This finds the point on the triangle closest to p, it works out which of the seven regions of the triangle p is over.
+    inline Vector3 closestPointOnTriangle(const Vector3& p, const Vector3& a, const Vector3& b, const Vector3& c)
+    {
+        Vector3 ab = b - a;
+        Vector3 ac = c - a;
+        Vector3 ap = p - a;
+
+        real d1 = ab * ap;
+        real d2 = ac * ap;
+        if(d1 <= 0 && d2 <= 0)
+        {
+            return a;
+        }
+
+        Vector3 bp = p - b;
+        real d3 = ab * bp;
+        real d4 = ac * bp;
+        if(d3 >= 0 && d4 <= d3)
+        {
+            return b;
+        }
+
+        real vc = d1 * d4 - d3 * d2;
+        if(vc <= 0 && d1 >= 0 && d3 <= 0)
+        {
+            return a + ab * (d1 / (d1 - d3));
+        }
+
+        Vector3 cp = p - c;
+        real d5 = ab * cp;
+        real d6 = ac * cp;
+        if(d6 >= 0 && d5 <= d6)
+        {
+            return c;
+        }
+
+        real vb = d5 * d2 - d1 * d6;
+        if(vb <= 0 && d2 >= 0 && d6 <= 0)
+        {
+            return a + ac * (d2 / (d2 - d6));
+        }
+
+        real va = d3 * d6 - d5 * d4;
+        if(va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+        {
+            return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+        }
+
+        real denom = ((real)1.0) / (va + vb + vc);
+        return a + ab * (vb * denom) + ac * (vc * denom);
+    }
+
+    //The list of a mesh's triangles is kept between calls so the physics step doesn't allocate for every pair, each thread has its own.
+    inline std::vector<unsigned>& getMeshTriangleList()
+    {
+        static thread_local std::vector<unsigned> triangles;
+        triangles.clear();
+        return triangles;
+    }
+
+    //This adds the mesh's triangles that might touch a world space box, given as its centre and the half size along the world axes.
+    inline void findMeshTriangles(const TriangleMesh& mesh, const Vector3& centre, const Vector3& extent, std::vector<unsigned>& found)
+    {
+        //The world box is moved into the mesh's space, its extent along the mesh's axes comes from the absolute rotation.
+        const Matrix4& transform = mesh.getTransform();
+        Vector3 localCentre = transform.transformInverse(centre);
+        Vector3 localExtent;
+        for(unsigned i = 0; i < 3; i++)
+        {
+            Vector3 axis = transform.getAxisVector(i);
+            localExtent[i] = std::abs(axis.x) * extent.x + std::abs(axis.y) * extent.y + std::abs(axis.z) * extent.z;
+        }
+
+        mesh.mesh->queryBox(localCentre - localExtent, localCentre + localExtent, found);
+    }
+
+    inline void getWorldTriangle(const TriangleMesh& mesh, unsigned index, Vector3& a, Vector3& b, Vector3& c)
+    {
+        mesh.mesh->getTriangle(index, a, b, c);
+        a = mesh.getTransform().transform(a);
+        b = mesh.getTransform().transform(b);
+        c = mesh.getTransform().transform(c);
+    }
+};
+
+#endif // COLLISION_GEOMETRY_H
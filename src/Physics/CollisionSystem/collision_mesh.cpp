@@ -0,0 +1,679 @@
+#include "collision_mesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+#include "../../Graphics/AtomicFile.h"
+
+using namespace wind;
+
+namespace
+{
+    //Leaves hold this many triangles at most, the count has to fit in the top bits of a node.
+    const unsigned MAX_LEAF_TRIANGLES = 8;
+    //Nodes with this few triangles are always leaves, testing them costs less than the nodes it would take to split them.
+    const unsigned MIN_SPLIT_TRIANGLES = 4;
+    const unsigned LEAF_COUNT_SHIFT = 28;
+    const std::uint32_t LEAF_FIRST_MASK = (1u << LEAF_COUNT_SHIFT) - 1;
+
+    //The surface area heuristic sorts the centres into this many bins along each axis and tries a split between each bin.
+    const unsigned SAH_BINS = 16;
+    //How much a step down the tree costs next to testing one triangle.
+    const float SAH_TRAVERSAL_COST = 1.0f;
+    //Past this depth the triangles are just split in half, so the tree can never get deeper than the query stack.
+    const unsigned SAH_MAX_DEPTH = 32;
+    const unsigned MAX_STACK = 64;
+
+    const std::uint16_t QUANT_STEPS = 0xffff;
+
+    const char COLLISION_MAGIC[4] = { 'W', 'C', 'O', 'L' };
+    const std::uint32_t COLLISION_VERSION = 1;
+
+    struct CollisionMeshHeader
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint64_t sourceHash;
+        std::uint32_t vertexCount;
+        std::uint32_t triangleCount;
+        std::uint32_t nodeCount;
+        std::uint32_t nodeSize;
+        float boundsMin[3];
+        float boundsMax[3];
+    };
+
+    //The welding is done on the exact bits of the position, the render mesh copies its seam vertices exactly.
+    struct PositionKey
+    {
+        std::uint32_t bits[3];
+
+        bool operator==(const PositionKey &other) const
+        {
+            return bits[0] == other.bits[0] && bits[1] == other.bits[1] && bits[2] == other.bits[2];
+        }
+    };
+
+    struct PositionHash
+    {
+        size_t operator()(const PositionKey &key) const
+        {
+            return (key.bits[0] * 73856093u) ^ (key.bits[1] * 19349663u) ^ (key.bits[2] * 83492791u);
+        }
+    };
+
+    inline bool boxesOverlap(const float aMin[3], const float aMax[3], const float bMin[3], const float bMax[3])
+    {
+        return aMin[0] <= bMax[0] && aMax[0] >= bMin[0] &&
+               aMin[1] <= bMax[1] && aMax[1] >= bMin[1] &&
+               aMin[2] <= bMax[2] && aMax[2] >= bMin[2];
+    }
+
+    //Half the surface area of a box, the heuristic only compares them so the half doesn't matter.
+    inline float getHalfArea(const float boxMin[3], const float boxMax[3])
+    {
+        float x = boxMax[0] - boxMin[0];
+        float y = boxMax[1] - boxMin[1];
+        float z = boxMax[2] - boxMin[2];
+        return x * y + y * z + z * x;
+    }
+
+    inline void growBox(float boxMin[3], float boxMax[3], const float otherMin[3], const float otherMax[3])
+    {
+        for(unsigned axis = 0; axis < 3; axis++)
+        {
+            boxMin[axis] = std::min(boxMin[axis], otherMin[axis]);
+            boxMax[axis] = std::max(boxMax[axis], otherMax[axis]);
+        }
+    }
+
+    inline void emptyBox(float boxMin[3], float boxMax[3])
+    {
+        for(unsigned axis = 0; axis < 3; axis++)
+        {
+            boxMin[axis] = 1e30f;
+            boxMax[axis] = -1e30f;
+        }
+    }
+}
+
+CollisionMesh::CollisionMesh()
+{
+    clear();
+}
+
+void CollisionMesh::build(const float* positions, unsigned vertexCount, unsigned stride, const std::uint32_t* indices, unsigned indexCount)
+{
+    clear();
+
+    //Every copy of a position is pointed at the first one we saw.
+    std::unordered_map<PositionKey, unsigned, PositionHash> welded;
+    std::vector<unsigned> remap(vertexCount);
+    for(unsigned i = 0; i < vertexCount; i++)
+    {
+        const float* position = reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + static_cast<size_t>(i) * stride);
+
+        PositionKey key;
+        memcpy(key.bits, position, sizeof(key.bits));
+
+        std::pair<std::unordered_map<PositionKey, unsigned, PositionHash>::iterator, bool> found = welded.insert(std::make_pair(key, vertices.size() / 3));
+        if(found.second)
+        {
+            vertices.insert(vertices.end(), position, position + 3);
+        }
+        remap[i] = found.first->second;
+    }
+
+    std::vector<BuildTriangle> build;
+    for(unsigned i = 0; i + 2 < indexCount; i += 3)
+    {
+        if(indices[i] >= vertexCount || indices[i + 1] >= vertexCount || indices[i + 2] >= vertexCount)
+        {
+            continue;
+        }
+
+        std::uint32_t corner[3] = { remap[indices[i]], remap[indices[i + 1]], remap[indices[i + 2]] };
+        if(corner[0] == corner[1] || corner[1] == corner[2] || corner[0] == corner[2])
+        {
+            continue;
+        }
+
+        const float* a = &vertices[corner[0] * 3];
+        const float* b = &vertices[corner[1] * 3];
+        const float* c = &vertices[corner[2] * 3];
+        float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+        float normal[3] = { ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0] };
+        if(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2] <= 0.0f)
+        {
+            continue;
+        }
+
+        BuildTriangle triangle;
+        for(unsigned axis = 0; axis < 3; axis++)
+        {
+            triangle.boundsMin[axis] = std::min(a[axis], std::min(b[axis], c[axis]));
+            triangle.boundsMax[axis] = std::max(a[axis], std::max(b[axis], c[axis]));
+            triangle.centre[axis] = (triangle.boundsMin[axis] + triangle.boundsMax[axis]) * 0.5f;
+        }
+        triangle.index = triangles.size() / 3;
+        build.push_back(triangle);
+
+        triangles.insert(triangles.end(), corner, corner + 3);
+    }
+
+    if(build.empty())
+    {
+        clear();
+        return;
+    }
+
+    //The whole mesh's box is the frame every node is quantised in.
+    emptyBox(boundsMin, boundsMax);
+    for(unsigned t = 0; t < build.size(); t++)
+    {
+        growBox(boundsMin, boundsMax, build[t].boundsMin, build[t].boundsMax);
+    }
+    for(unsigned axis = 0; axis < 3; axis++)
+    {
+        float extent = boundsMax[axis] - boundsMin[axis];
+        quantScale[axis] = extent > 0.0f ? QUANT_STEPS / extent : 0.0f;
+    }
+
+    nodes.reserve(build.size() * 2 / MAX_LEAF_TRIANGLES + 1);
+    buildNode(0, build.size(), 0, build);
+
+    //The triangles are put in the order the leaves reach them, so each leaf reads one run of the list.
+    std::vector<std::uint32_t> sorted(triangles.size());
+    for(unsigned t = 0; t < build.size(); t++)
+    {
+        memcpy(&sorted[t * 3], &triangles[build[t].index * 3], 3 * sizeof(std::uint32_t));
+    }
+    triangles.swap(sorted);
+}
+
+void CollisionMesh::buildNode(unsigned first, unsigned count, unsigned depth, std::vector<BuildTriangle> &build)
+{
+    unsigned index = nodes.size();
+    nodes.push_back(Node());
+
+    float nodeMin[3], nodeMax[3];
+    float centreMin[3], centreMax[3];
+    emptyBox(nodeMin, nodeMax);
+    emptyBox(centreMin, centreMax);
+    for(unsigned i = first; i < first + count; i++)
+    {
+        growBox(nodeMin, nodeMax, build[i].boundsMin, build[i].boundsMax);
+        growBox(centreMin, centreMax, build[i].centre, build[i].centre);
+    }
+
+    quantise(nodeMin, false, nodes[index].quantMin);
+    quantise(nodeMax, true, nodes[index].quantMax);
+
+    //We try every split between the bins along every axis and keep the one with the least area times triangles on each side.
+    float bestCost = 1e30f;
+    unsigned bestAxis = 0;
+    unsigned bestSplit = 0;
+    if(count > MIN_SPLIT_TRIANGLES && depth < SAH_MAX_DEPTH)
+    {
+        for(unsigned axis = 0; axis < 3; axis++)
+        {
+            float extent = centreMax[axis] - centreMin[axis];
+            if(extent <= 0.0f)
+            {
+                continue;
+            }
+
+            unsigned binCount[SAH_BINS] = {};
+            float binMin[SAH_BINS][3], binMax[SAH_BINS][3];
+            for(unsigned b = 0; b < SAH_BINS; b++)
+            {
+                emptyBox(binMin[b], binMax[b]);
+            }
+
+            float binScale = SAH_BINS / extent;
+            for(unsigned i = first; i < first + count; i++)
+            {
+                unsigned b = std::min(SAH_BINS - 1, static_cast<unsigned>((build[i].centre[axis] - centreMin[axis]) * binScale));
+                binCount[b]++;
+                growBox(binMin[b], binMax[b], build[i].boundsMin, build[i].boundsMax);
+            }
+
+            //The right side is swept first so the left sweep can price each split as it goes.
+            float rightCost[SAH_BINS];
+            float sideMin[3], sideMax[3];
+            unsigned sideCount = 0;
+            emptyBox(sideMin, sideMax);
+            for(unsigned b = SAH_BINS - 1; b > 0; b--)
+            {
+                growBox(sideMin, sideMax, binMin[b], binMax[b]);
+                sideCount += binCount[b];
+                rightCost[b] = sideCount > 0 ? getHalfArea(sideMin, sideMax) * sideCount : 0.0f;
+            }
+
+            emptyBox(sideMin, sideMax);
+            sideCount = 0;
+            for(unsigned b = 0; b + 1 < SAH_BINS; b++)
+            {
+                growBox(sideMin, sideMax, binMin[b], binMax[b]);
+                sideCount += binCount[b];
+                if(sideCount == 0 || sideCount == count)
+                {
+                    continue;
+                }
+
+                float cost = getHalfArea(sideMin, sideMax) * sideCount + rightCost[b + 1];
+                if(cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = b + 1;
+                }
+            }
+        }
+    }
+
+    float area = getHalfArea(nodeMin, nodeMax);
+    bool split = count > MAX_LEAF_TRIANGLES;
+    if(bestSplit != 0 && area > 0.0f && !split)
+    {
+        //A small node is only split if the heuristic says testing its triangles costs more than going down a level.
+        split = SAH_TRAVERSAL_COST + bestCost / area < count;
+    }
+
+    if(!split)
+    {
+        nodes[index].data = (count << LEAF_COUNT_SHIFT) | first;
+        return;
+    }
+
+    unsigned half = 0;
+    if(bestSplit != 0)
+    {
+        float binScale = SAH_BINS / (centreMax[bestAxis] - centreMin[bestAxis]);
+        float low = centreMin[bestAxis];
+        std::vector<BuildTriangle>::iterator middle = std::partition(build.begin() + first, build.begin() + first + count,
+                                                                      [&](const BuildTriangle &triangle)
+        {
+            return std::min(SAH_BINS - 1, static_cast<unsigned>((triangle.centre[bestAxis] - low) * binScale)) < bestSplit;
+        });
+        half = middle - (build.begin() + first);
+    }
+
+    //If there was no good split, all of the centres are in the same place or the tree is too deep, we cut it in half instead.
+    if(half == 0 || half == count)
+    {
+        unsigned axis = 0;
+        for(unsigned i = 1; i < 3; i++)
+        {
+            if(centreMax[i] - centreMin[i] > centreMax[axis] - centreMin[axis])
+            {
+                axis = i;
+            }
+        }
+
+        half = count / 2;
+        std::vector<BuildTriangle>::iterator begin = build.begin() + first;
+        std::nth_element(begin, begin + half, begin + count, [axis](const BuildTriangle &a, const BuildTriangle &b)
+        {
+            return a.centre[axis] < b.centre[axis];
+        });
+    }
+
+    buildNode(first, half, depth + 1, build);
+    unsigned right = nodes.size();
+    buildNode(first + half, count - half, depth + 1, build);
+    nodes[index].data = right;
+}
+
+void CollisionMesh::quantise(const float point[3], bool roundUp, std::uint16_t result[3]) const
+{
+    //One extra step is added on the way out so the rounding of the floats can never make a box smaller.
+    for(unsigned axis = 0; axis < 3; axis++)
+    {
+        float steps = (point[axis] - boundsMin[axis]) * quantScale[axis];
+        steps = roundUp ? std::ceil(steps) + 1.0f : std::floor(steps) - 1.0f;
+        steps = std::max(0.0f, std::min(static_cast<float>(QUANT_STEPS), steps));
+        result[axis] = static_cast<std::uint16_t>(steps);
+    }
+}
+
+void CollisionMesh::clear()
+{
+    vertices.clear();
+    triangles.clear();
+    nodes.clear();
+
+    for(unsigned axis = 0; axis < 3; axis++)
+    {
+        boundsMin[axis] = 0.0f;
+        boundsMax[axis] = 0.0f;
+        quantScale[axis] = 0.0f;
+    }
+}
+
+bool CollisionMesh::save(const std::string &filePath, std::uint64_t sourceHash) const
+{
+    CollisionMeshHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, COLLISION_MAGIC, sizeof(COLLISION_MAGIC));
+    header.version = COLLISION_VERSION;
+    header.sourceHash = sourceHash;
+    header.vertexCount = getVertexCount();
+    header.triangleCount = getTriangleCount();
+    header.nodeCount = nodes.size();
+    header.nodeSize = sizeof(Node);
+    memcpy(header.boundsMin, boundsMin, sizeof(boundsMin));
+    memcpy(header.boundsMax, boundsMax, sizeof(boundsMax));
+
+    //Like the cooked meshes it is written to a temporary file first, so a half written file is never loaded.
+    AtomicFile file;
+    if(!file.open(filePath))
+    {
+        return false;
+    }
+
+    file.write(&header, sizeof(header));
+    if(!vertices.empty())
+    {
+        file.write(&vertices[0], vertices.size() * sizeof(float));
+        file.write(&triangles[0], triangles.size() * sizeof(std::uint32_t));
+        file.write(&nodes[0], nodes.size() * sizeof(Node));
+    }
+
+    return file.commit();
+}
+
+bool CollisionMesh::load(const std::string &filePath, std::uint64_t sourceHash)
+{
+    clear();
+
+    std::ifstream file(filePath.c_str(), std::ios::binary | std::ios::ate);
+    if(!file.is_open())
+    {
+        return false;
+    }
+    std::uint64_t fileSize = static_cast<std::uint64_t>(file.tellg());
+    file.seekg(0);
+
+    CollisionMeshHeader header;
+    if(!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+       memcmp(header.magic, COLLISION_MAGIC, sizeof(COLLISION_MAGIC)) != 0 ||
+       header.version != COLLISION_VERSION ||
+       header.nodeSize != sizeof(Node) ||
+       header.sourceHash != sourceHash)
+    {
+        return false;
+    }
+
+    //The counts are checked against what is really in the file before anything is made that big.
+    std::uint64_t vertexBytes = static_cast<std::uint64_t>(header.vertexCount) * 3 * sizeof(float);
+    std::uint64_t triangleBytes = static_cast<std::uint64_t>(header.triangleCount) * 3 * sizeof(std::uint32_t);
+    std::uint64_t nodeBytes = static_cast<std::uint64_t>(header.nodeCount) * sizeof(Node);
+    if(sizeof(header) + vertexBytes + triangleBytes + nodeBytes > fileSize)
+    {
+        return false;
+    }
+
+    vertices.resize(static_cast<size_t>(header.vertexCount) * 3);
+    triangles.resize(static_cast<size_t>(header.triangleCount) * 3);
+    nodes.resize(header.nodeCount);
+    if(!vertices.empty())
+    {
+        file.read(reinterpret_cast<char*>(&vertices[0]), vertices.size() * sizeof(float));
+    }
+    if(!triangles.empty())
+    {
+        file.read(reinterpret_cast<char*>(&triangles[0]), triangles.size() * sizeof(std::uint32_t));
+    }
+    if(!nodes.empty())
+    {
+        file.read(reinterpret_cast<char*>(&nodes[0]), nodes.size() * sizeof(Node));
+    }
+
+    if(!file)
+    {
+        clear();
+        return false;
+    }
+
+    //Nothing is trusted until every index has been checked, a bad file shouldn't be able to crash a query.
+    bool valid = header.triangleCount > 0 ? header.nodeCount > 0 : header.nodeCount == 0;
+    for(unsigned i = 0; valid && i < triangles.size(); i++)
+    {
+        valid = triangles[i] < vertices.size() / 3;
+    }
+    //Children always come after their parent, so one pass down the list finds how deep each node is.
+    //A node a query steps into has its ancestors' other children on the stack as well as its own two, so it can't be too deep.
+    std::vector<unsigned> depths(nodes.size(), 1);
+    for(unsigned i = 0; valid && i < nodes.size(); i++)
+    {
+        unsigned count = nodes[i].data >> LEAF_COUNT_SHIFT;
+        unsigned first = nodes[i].data & LEAF_FIRST_MASK;
+        valid = count > 0 ? first + count <= triangles.size() / 3 : first > i + 1 && first < nodes.size() && depths[i] < MAX_STACK;
+        if(valid && count == 0)
+        {
+            depths[i + 1] = std::max(depths[i + 1], depths[i] + 1);
+            depths[first] = std::max(depths[first], depths[i] + 1);
+        }
+    }
+
+    if(!valid)
+    {
+        clear();
+        return false;
+    }
+
+    memcpy(boundsMin, header.boundsMin, sizeof(boundsMin));
+    memcpy(boundsMax, header.boundsMax, sizeof(boundsMax));
+    for(unsigned axis = 0; axis < 3; axis++)
+    {
+        float extent = boundsMax[axis] - boundsMin[axis];
+        quantScale[axis] = extent > 0.0f ? QUANT_STEPS / extent : 0.0f;
+    }
+
+    return true;
+}
+
+unsigned CollisionMesh::getVertexCount() const
+{
+    return vertices.size() / 3;
+}
+
+unsigned CollisionMesh::getTriangleCount() const
+{
+    return triangles.size() / 3;
+}
+
+Vector3 CollisionMesh::getVertex(unsigned index) const
+{
+    return Vector3(vertices[index * 3], vertices[index * 3 + 1], vertices[index * 3 + 2]);
+}
+
+void CollisionMesh::getTriangle(unsigned index, Vector3 &a, Vector3 &b, Vector3 &c) const
+{
+    a = getVertex(triangles[index * 3]);
+    b = getVertex(triangles[index * 3 + 1]);
+    c = getVertex(triangles[index * 3 + 2]);
+}
+
+Vector3 CollisionMesh::getBoundsMin() const
+{
+    return Vector3(boundsMin[0], boundsMin[1], boundsMin[2]);
+}
+
+Vector3 CollisionMesh::getBoundsMax() const
+{
+    return Vector3(boundsMax[0], boundsMax[1], boundsMax[2]);
+}
+
+void CollisionMesh::queryBox(const Vector3 &boxMin, const Vector3 &boxMax, std::vector<unsigned> &found) const
+{
+    if(nodes.empty())
+    {
+        return;
+    }
+
+    float queryMin[3] = { static_cast<float>(boxMin.x), static_cast<float>(boxMin.y), static_cast<float>(boxMin.z) };
+    float queryMax[3] = { static_cast<float>(boxMax.x), static_cast<float>(boxMax.y), static_cast<float>(boxMax.z) };
+    if(!boxesOverlap(boundsMin, boundsMax, queryMin, queryMax))
+    {
+        return;
+    }
+
+    //The query box is quantised the same way as the nodes, so the nodes are tested without turning them back into floats.
+    std::uint16_t quantMin[3];
+    std::uint16_t quantMax[3];
+    quantise(queryMin, false, quantMin);
+    quantise(queryMax, true, quantMax);
+
+    unsigned stack[MAX_STACK];
+    unsigned stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while(stackSize > 0)
+    {
+        unsigned index = stack[--stackSize];
+        const Node &node = nodes[index];
+        if(node.quantMin[0] > quantMax[0] || node.quantMax[0] < quantMin[0] ||
+           node.quantMin[1] > quantMax[1] || node.quantMax[1] < quantMin[1] ||
+           node.quantMin[2] > quantMax[2] || node.quantMax[2] < quantMin[2])
+        {
+            continue;
+        }
+
+        unsigned count = node.data >> LEAF_COUNT_SHIFT;
+        if(count == 0)
+        {
+            stack[stackSize++] = node.data;
+            stack[stackSize++] = index + 1;
+            continue;
+        }
+
+        unsigned first = node.data & LEAF_FIRST_MASK;
+        for(unsigned t = first; t < first + count; t++)
+        {
+            float triangleMin[3];
+            float triangleMax[3];
+            const float* a = &vertices[triangles[t * 3] * 3];
+            const float* b = &vertices[triangles[t * 3 + 1] * 3];
+            const float* c = &vertices[triangles[t * 3 + 2] * 3];
+            for(unsigned axis = 0; axis < 3; axis++)
+            {
+                triangleMin[axis] = std::min(a[axis], std::min(b[axis], c[axis]));
+                triangleMax[axis] = std::max(a[axis], std::max(b[axis], c[axis]));
+            }
+
+            if(boxesOverlap(triangleMin, triangleMax, queryMin, queryMax))
+            {
+                found.push_back(t);
+            }
+        }
+    }
+}
+
+void CollisionMesh::sweep(const Vector3 &origin, const Vector3 &direction, real radius, real maxDistance, SweepTest &test) const
+{
+    if(nodes.empty())
+    {
+        return;
+    }
+
+    //The node boxes are turned back into floats here, a step is the mesh's extent over the number of steps.
+    float step[3];
+    float start[3] = { static_cast<float>(origin.x), static_cast<float>(origin.y), static_cast<float>(origin.z) };
+    float inverse[3];
+    for(unsigned axis = 0; axis < 3; axis++)
+    {
+        step[axis] = (boundsMax[axis] - boundsMin[axis]) / QUANT_STEPS;
+        inverse[axis] = direction[axis] != 0 ? static_cast<float>(1.0 / direction[axis]) : 1e30f;
+    }
+    float grow = static_cast<float>(radius);
+
+    //This gives where the ray goes into a node, or a negative number if it misses it.
+    auto enterNode = [&](const Node &node, float furthest) -> float
+    {
+        float enter = 0.0f;
+        float leave = furthest;
+        for(unsigned axis = 0; axis < 3; axis++)
+        {
+            float low = boundsMin[axis] + node.quantMin[axis] * step[axis] - grow;
+            float high = boundsMin[axis] + node.quantMax[axis] * step[axis] + grow;
+            float nearSide = (low - start[axis]) * inverse[axis];
+            float farSide = (high - start[axis]) * inverse[axis];
+            if(nearSide > farSide)
+            {
+                std::swap(nearSide, farSide);
+            }
+
+            enter = std::max(enter, nearSide);
+            leave = std::min(leave, farSide);
+        }
+
+        return enter <= leave ? enter : -1.0f;
+    };
+
+    unsigned stack[MAX_STACK];
+    unsigned stackSize = 0;
+    if(enterNode(nodes[0], static_cast<float>(maxDistance)) >= 0.0f)
+    {
+        stack[stackSize++] = 0;
+    }
+
+    while(stackSize > 0)
+    {
+        unsigned index = stack[--stackSize];
+        const Node &node = nodes[index];
+        float furthest = static_cast<float>(maxDistance);
+
+        unsigned count = node.data >> LEAF_COUNT_SHIFT;
+        if(count == 0)
+        {
+            //The nearer child is pushed last so it comes off the stack first.
+            unsigned children[2] = { index + 1, node.data };
+            float enter[2] = { enterNode(nodes[children[0]], furthest), enterNode(nodes[children[1]], furthest) };
+            if(enter[0] >= 0.0f && enter[1] >= 0.0f && enter[0] < enter[1])
+            {
+                std::swap(children[0], children[1]);
+                std::swap(enter[0], enter[1]);
+            }
+
+            for(unsigned child = 0; child < 2; child++)
+            {
+                if(enter[child] >= 0.0f)
+                {
+                    stack[stackSize++] = children[child];
+                }
+            }
+            continue;
+        }
+
+        //A node that was pushed before a closer hit was found might be past it now.
+        if(enterNode(node, furthest) < 0.0f)
+        {
+            continue;
+        }
+
+        unsigned first = node.data & LEAF_FIRST_MASK;
+        for(unsigned t = first; t < first + count; t++)
+        {
+            test.testTriangle(t, maxDistance);
+            if(maxDistance < 0)
+            {
+                return;
+            }
+        }
+    }
+}
+
+unsigned CollisionMesh::getNodeCount() const
+{
+    return nodes.size();
+}
+
+unsigned CollisionMesh::getMemoryUsage() const
+{
+    return vertices.size() * sizeof(float) + triangles.size() * sizeof(std::uint32_t) + nodes.size() * sizeof(Node);
+}
@@ -0,0 +1,114 @@
+#ifndef COLLISION_MESH_H
+#define COLLISION_MESH_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "../include/Core.h"
+
+namespace wind
+{
+    /**
+        This class holds a triangle mesh for the physics, like the static geometry of a level.
+        It is built straight from the vertex and index buffers the renderer uses so the model file is only read once.
+        The positions are welded, so the copies a render mesh makes for its texture and normal seams are only kept once,
+        and the triangles are kept as one flat list of indices with a bounding volume tree over them.
+
+        The tree is built with the surface area heuristic and each node's box is stored as 16 bit steps across the mesh's box,
+        rounded outwards, so a node is 16 bytes and four of them fit in a cache line.
+        The mesh can be saved next to the cooked render mesh so the tree is only ever built once.
+        Everything is in the mesh's own space, anything that is tested against it has to be moved into that space first.
+    */
+    class CollisionMesh
+    {
+        public:
+            CollisionMesh();
+
+            /**
+                This function builds the mesh, the positions are three floats each and stride is the bytes from one vertex to the next.
+                That lets it read an interleaved render vertex buffer as it is. Triangles with no area are left out.
+            */
+            void build(const float* positions, unsigned vertexCount, unsigned stride, const std::uint32_t* indices, unsigned indexCount);
+
+            void clear();
+
+            /**
+                These functions write and read the mesh with its tree, the source hash is whatever the caller uses to tell
+                if the file is stale, like the hash of the model it came from. Load fails if the hash doesn't match.
+            */
+            bool save(const std::string &filePath, std::uint64_t sourceHash) const;
+            bool load(const std::string &filePath, std::uint64_t sourceHash);
+
+            unsigned getVertexCount() const;
+            unsigned getTriangleCount() const;
+            Vector3 getVertex(unsigned index) const;
+            void getTriangle(unsigned index, Vector3 &a, Vector3 &b, Vector3 &c) const;
+
+            //The box around the whole mesh.
+            Vector3 getBoundsMin() const;
+            Vector3 getBoundsMax() const;
+
+            //This function adds every triangle whose box touches the given box to the list, the list isn't cleared first.
+            void queryBox(const Vector3 &boxMin, const Vector3 &boxMax, std::vector<unsigned> &found) const;
+
+            /**
+                This is told about each triangle a sweep reaches. It gets the furthest the sweep still cares about,
+                and if it hits the triangle closer than that it shortens it, so the sweep stops looking past the hit.
+                Setting it below zero stops the sweep straight away, for when any hit will do.
+            */
+            class SweepTest
+            {
+                public:
+                    virtual ~SweepTest() {}
+                    virtual void testTriangle(unsigned triangle, real &maxDistance) = 0;
+            };
+
+            /**
+                This function walks the tree along a ray, the direction has to be normalised.
+                Every triangle whose box comes within the radius of the ray before maxDistance is handed to the test,
+                the nearer side of the tree is walked first so a close hit cuts off most of the rest.
+            */
+            void sweep(const Vector3 &origin, const Vector3 &direction, real radius, real maxDistance, SweepTest &test) const;
+
+            unsigned getNodeCount() const;
+            //How many bytes the vertices, triangles and tree take up.
+            unsigned getMemoryUsage() const;
+
+        private:
+            struct Node
+            {
+                std::uint16_t quantMin[3];
+                std::uint16_t quantMax[3];
+                //A leaf has its triangle count in the top four bits and its first triangle in the rest.
+                //Any other node has a count of zero and the index of its right child, the left child is always the next node.
+                std::uint32_t data;
+            };
+
+            struct BuildTriangle
+            {
+                float boundsMin[3];
+                float boundsMax[3];
+                float centre[3];
+                unsigned index;
+            };
+
+            void buildNode(unsigned first, unsigned count, unsigned depth, std::vector<BuildTriangle> &build);
+            void quantise(const float point[3], bool roundUp, std::uint16_t result[3]) const;
+
+            //The welded positions, three floats each.
+            std::vector<float> vertices;
+
+            //Three indices for each triangle, they are stored in the order the tree's leaves cover them.
+            std::vector<std::uint32_t> triangles;
+
+            std::vector<Node> nodes;
+
+            //The node boxes are steps of 1 / quantScale from boundsMin.
+            float boundsMin[3];
+            float boundsMax[3];
+            float quantScale[3];
+    };
+};
+
+#endif // COLLISION_MESH_H
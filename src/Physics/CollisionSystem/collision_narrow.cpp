@@ -1,4 +1,5 @@
 #include "collision_narrow.h"
+#include "collision_geometry.h"
 
 using namespace wind;
 
@@ -751,3 +752,334 @@ unsigned PlayerGeometry::BoxAndBox(const Box& first, const Box& second, Collisio
 
     return 0;
 }
+
+/**Triangle mesh helpers*/
+//How many times a box that only overlaps a triangle's middle moves between the closest points to find where they meet.
+const unsigned BOX_TRIANGLE_CLOSEST_STEPS = 4;
+
+//This writes one contact against a static mesh, it returns false once the contact array is full.
+inline bool addMeshContact(CollisionData& data, RigidBody* body, const Vector3& point, const Vector3& normal, real penetration)
+{
+    if(data.contactsLeft <= 0)
+    {
+        return false;
+    }
+
+    Contact* contact = data.contacts;
+    contact->contactNormal = normal;
+    contact->contactPoint = point;
+    contact->penetration = penetration;
+    contact->setContactData(body, nullptr, data.friction, data.restitution);
+
+    data.addContact(1);
+    return data.contactsLeft > 0;
+}
+
+unsigned CollisionDetection::SphereAndTriangleMesh(const Sphere& sphere, const TriangleMesh& mesh, CollisionData& data)
+{
+    if(data.contactsLeft <= 0 || mesh.mesh == nullptr)
+    {
+        return 0;
+    }
+
+    Vector3 centre = sphere.getAxis(3);
+    std::vector<unsigned>& candidates = getMeshTriangleList();
+    findMeshTriangles(mesh, centre, Vector3(sphere.radius, sphere.radius, sphere.radius), candidates);
+
+    unsigned contactsUsed = 0;
+    for(unsigned i = 0; i < candidates.size(); i++)
+    {
+        Vector3 a, b, c;
+        getWorldTriangle(mesh, candidates[i], a, b, c);
+
+        Vector3 closest = closestPointOnTriangle(centre, a, b, c);
+        Vector3 toCentre = centre - closest;
+        real distance = toCentre.magnitude();
+        if(distance >= sphere.radius)
+        {
+            continue;
+        }
+
+        //If the centre is right on the triangle we can't tell which side it came from, so it goes out the front.
+        Vector3 normal = (b - a) % (c - a);
+        normal.normalise();
+        if(distance > real_epsilon)
+        {
+            normal = toCentre * (((real)1.0) / distance);
+        }
+
+        contactsUsed++;
+        if(!addMeshContact(data, sphere.body, closest, normal, sphere.radius - distance))
+        {
+            break;
+        }
+    }
+
+    return contactsUsed;
+}
+
+unsigned CollisionDetection::CapsuleAndTriangleMesh(const Capsule& capsule, const TriangleMesh& mesh, CollisionData& data)
+{
+    if(data.contactsLeft <= 0 || mesh.mesh == nullptr)
+    {
+        return 0;
+    }
+
+    Vector3 centre = capsule.getAxis(3);
+    Vector3 axis = capsule.getAxis(1);
+    axis.normalise();
+    Vector3 top = centre + axis * capsule.halfHeight;
+    Vector3 bottom = centre - axis * capsule.halfHeight;
+
+    Vector3 extent(std::abs(axis.x) * capsule.halfHeight + capsule.radius,
+                   std::abs(axis.y) * capsule.halfHeight + capsule.radius,
+                   std::abs(axis.z) * capsule.halfHeight + capsule.radius);
+    std::vector<unsigned>& candidates = getMeshTriangleList();
+    findMeshTriangles(mesh, centre, extent, candidates);
+
+    unsigned contactsUsed = 0;
+    for(unsigned i = 0; i < candidates.size(); i++)
+    {
+        Vector3 a, b, c;
+        getWorldTriangle(mesh, candidates[i], a, b, c);
+
+        Vector3 faceNormal = (b - a) % (c - a);
+        faceNormal.normalise();
+
+        //The side of the triangle the capsule is on is the side it gets pushed out of.
+        real topDistance = (top - a) * faceNormal;
+        real bottomDistance = (bottom - a) * faceNormal;
+        if((centre - a) * faceNormal < 0)
+        {
+            faceNormal = faceNormal * -1.0;
+            topDistance = -topDistance;
+            bottomDistance = -bottomDistance;
+        }
+
+        //If the line goes through the triangle the capsule is pushed out until its deepest end is clear.
+        if(topDistance * bottomDistance < 0)
+        {
+            real t = topDistance / (topDistance - bottomDistance);
+            Vector3 crossing = top + (bottom - top) * t;
+            if((closestPointOnTriangle(crossing, a, b, c) - crossing).squareMagnitude() <= real_epsilon)
+            {
+                contactsUsed++;
+                if(!addMeshContact(data, capsule.body, crossing, faceNormal, capsule.radius - std::min(topDistance, bottomDistance)))
+                {
+                    break;
+                }
+                continue;
+            }
+        }
+
+        //Otherwise the closest points are from an end of the line to the face, or from the line to an edge.
+        Vector3 onLine = top;
+        Vector3 onTriangle = closestPointOnTriangle(top, a, b, c);
+        real best = (onLine - onTriangle).squareMagnitude();
+
+        Vector3 candidate = closestPointOnTriangle(bottom, a, b, c);
+        if((bottom - candidate).squareMagnitude() < best)
+        {
+            onLine = bottom;
+            onTriangle = candidate;
+            best = (bottom - candidate).squareMagnitude();
+        }
+
+        const Vector3* corners[3] = { &a, &b, &c };
+        for(unsigned edge = 0; edge < 3; edge++)
+        {
+            Vector3 lineCandidate, edgeCandidate;
+            closestPointsOnSegments(top, bottom, *corners[edge], *corners[(edge + 1) % 3], lineCandidate, edgeCandidate);
+            real distance = (lineCandidate - edgeCandidate).squareMagnitude();
+            if(distance < best)
+            {
+                onLine = lineCandidate;
+                onTriangle = edgeCandidate;
+                best = distance;
+            }
+        }
+
+        if(best >= capsule.radius * capsule.radius)
+        {
+            continue;
+        }
+
+        real distance = std::sqrt(best);
+        Vector3 normal = faceNormal;
+        if(distance > real_epsilon)
+        {
+            normal = (onLine - onTriangle) * (((real)1.0) / distance);
+        }
+
+        contactsUsed++;
+        if(!addMeshContact(data, capsule.body, onTriangle, normal, capsule.radius - distance))
+        {
+            break;
+        }
+    }
+
+    return contactsUsed;
+}
+
+unsigned CollisionDetection::BoxAndTriangleMesh(const Box& box, const TriangleMesh& mesh, CollisionData& data)
+{
+    if(data.contactsLeft <= 0 || mesh.mesh == nullptr)
+    {
+        return 0;
+    }
+
+    //The box's extent along the world axes, so the mesh can find what is near it.
+    Vector3 centre = box.getAxis(3);
+    Vector3 worldExtent(std::abs(box.getAxis(0).x) * box.halfSize.x + std::abs(box.getAxis(1).x) * box.halfSize.y + std::abs(box.getAxis(2).x) * box.halfSize.z,
+                        std::abs(box.getAxis(0).y) * box.halfSize.x + std::abs(box.getAxis(1).y) * box.halfSize.y + std::abs(box.getAxis(2).y) * box.halfSize.z,
+                        std::abs(box.getAxis(0).z) * box.halfSize.x + std::abs(box.getAxis(1).z) * box.halfSize.y + std::abs(box.getAxis(2).z) * box.halfSize.z);
+    std::vector<unsigned>& candidates = getMeshTriangleList();
+    findMeshTriangles(mesh, centre, worldExtent, candidates);
+
+    real mults[8][3] = { {1, 1, 1}, {-1, 1, 1}, {1, -1, 1}, {-1, -1, 1}, {1, 1, -1}, {-1, 1, -1}, {1, -1, -1}, {-1, -1, -1} };
+    const Vector3 boxAxes[3] = { Vector3(1, 0, 0), Vector3(0, 1, 0), Vector3(0, 0, 1) };
+
+    unsigned contactsUsed = 0;
+    for(unsigned i = 0; i < candidates.size(); i++)
+    {
+        //Everything is done in the box's space, where the box sits on the origin along the axes.
+        Vector3 world[3];
+        getWorldTriangle(mesh, candidates[i], world[0], world[1], world[2]);
+        Vector3 corner[3] = { box.transform.transformInverse(world[0]),
+                              box.transform.transformInverse(world[1]),
+                              box.transform.transformInverse(world[2]) };
+        Vector3 edges[3] = { corner[1] - corner[0], corner[2] - corner[1], corner[0] - corner[2] };
+
+        Vector3 faceNormal = edges[0] % (corner[2] - corner[0]);
+        faceNormal.normalise();
+
+        //The face goes first, it is pushed out the side the box's centre is on.
+        real planeDistance = corner[0] * faceNormal;
+        if(planeDistance > 0)
+        {
+            faceNormal = faceNormal * -1.0;
+            planeDistance = -planeDistance;
+        }
+
+        real faceRadius = box.halfSize.x * std::abs(faceNormal.x) + box.halfSize.y * std::abs(faceNormal.y) + box.halfSize.z * std::abs(faceNormal.z);
+        real bestPenetration = faceRadius + planeDistance;
+        if(bestPenetration <= 0)
+        {
+            continue;
+        }
+        Vector3 bestAxis = faceNormal;
+        bool faceAxis = true;
+
+        //Then the box's three axes and the nine crosses of them with the edges, if any of them separate there is no contact.
+        bool separated = false;
+        for(unsigned test = 0; test < 12 && !separated; test++)
+        {
+            Vector3 axis = test < 3 ? boxAxes[test] : boxAxes[(test - 3) / 3] % edges[(test - 3) % 3];
+            if(axis.squareMagnitude() < 0.0001)
+            {
+                continue;
+            }
+            axis.normalise();
+
+            real radius = box.halfSize.x * std::abs(axis.x) + box.halfSize.y * std::abs(axis.y) + box.halfSize.z * std::abs(axis.z);
+            real p0 = corner[0] * axis;
+            real p1 = corner[1] * axis;
+            real p2 = corner[2] * axis;
+            real low = std::min(p0, std::min(p1, p2));
+            real high = std::max(p0, std::max(p1, p2));
+
+            real pushBack = radius - low;
+            real pushForward = high + radius;
+            if(pushBack <= 0 || pushForward <= 0)
+            {
+                separated = true;
+                break;
+            }
+
+            //The face is kept unless another axis is a lot better. Next to a triangle's edge the box's side is often a little
+            //shallower than the face, and pushing boxes sideways off every edge of a floor makes them catch as they slide.
+            real penetration = std::min(pushBack, pushForward);
+            if(penetration < bestPenetration * 0.5)
+            {
+                bestPenetration = penetration;
+                bestAxis = pushBack < pushForward ? axis * -1.0 : axis;
+                faceAxis = false;
+            }
+        }
+
+        if(separated)
+        {
+            continue;
+        }
+
+        Vector3 worldNormal = box.transform.transformDirection(bestAxis);
+        bool full = false;
+        unsigned triangleContacts = 0;
+
+        if(faceAxis)
+        {
+            //The box's corners under the triangle each get a contact, like a box on a half space.
+            for(unsigned v = 0; v < 8 && !full; v++)
+            {
+                Vector3 vertex(mults[v][0] * box.halfSize.x, mults[v][1] * box.halfSize.y, mults[v][2] * box.halfSize.z);
+                real depth = (corner[0] - vertex) * faceNormal;
+                if(depth <= 0)
+                {
+                    continue;
+                }
+
+                Vector3 onPlane = vertex + faceNormal * depth;
+                if((closestPointOnTriangle(onPlane, corner[0], corner[1], corner[2]) - onPlane).squareMagnitude() > 0.000001)
+                {
+                    continue;
+                }
+
+                triangleContacts++;
+                full = !addMeshContact(data, box.body, box.transform.transform(vertex), worldNormal, depth);
+            }
+        }
+
+        if(triangleContacts == 0 && !full)
+        {
+            Vector3 point;
+            if(faceAxis)
+            {
+                //No corner is over the triangle, so it is smaller than the box or the box hangs off its edge.
+                //The contact goes where the triangle and box meet, found by moving between the closest points on each a few times.
+                point = closestPointOnTriangle(Vector3(), corner[0], corner[1], corner[2]);
+                for(unsigned step = 0; step < BOX_TRIANGLE_CLOSEST_STEPS; step++)
+                {
+                    Vector3 inBox(std::max(-box.halfSize.x, std::min(box.halfSize.x, point.x)),
+                                  std::max(-box.halfSize.y, std::min(box.halfSize.y, point.y)),
+                                  std::max(-box.halfSize.z, std::min(box.halfSize.z, point.z)));
+                    point = closestPointOnTriangle(inBox, corner[0], corner[1], corner[2]);
+                }
+                point = box.transform.transform(point);
+            }
+            else
+            {
+                //Otherwise the triangle has poked into the box, the contact goes on its corner that went in the furthest.
+                unsigned deepest = 0;
+                for(unsigned v = 1; v < 3; v++)
+                {
+                    if(corner[v] * bestAxis > corner[deepest] * bestAxis)
+                    {
+                        deepest = v;
+                    }
+                }
+                point = world[deepest];
+            }
+
+            triangleContacts++;
+            full = !addMeshContact(data, box.body, point, worldNormal, bestPenetration);
+        }
+
+        contactsUsed += triangleContacts;
+        if(full)
+        {
+            break;
+        }
+    }
+
+    return contactsUsed;
+}
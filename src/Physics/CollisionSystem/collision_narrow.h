@@ -8,6 +8,7 @@
 
 //All includes are already in contact.
 #include "contact.h"
+#include "collision_mesh.h"
 
 /**
     Each collision algorithm will need 2 rigid bodies to detect a collision between the two.
@@ -20,6 +21,7 @@ namespace wind
     class CollisionDetection;
     class IntersectionTests;
 	class PlayerGeometry;
+    class CollisionMesh;
 
     /**
         This structure is used to contain information for the collision detector to use in building contact data.
@@ -86,6 +88,7 @@ namespace wind
             friend class IntersectionTests;
             friend class CollisionDetection;
 			friend class PlayerGeometry;
+            friend class CollisionQuery;
 
             RigidBody* body;
             //The offset the matrix will only handle rotation and orientation of the rigid body.
@@ -140,6 +143,28 @@ namespace wind
             Vector3 halfSize;
     };
 
+    /**
+        This class holds data on a capsule, which is every point within the radius of a line.
+        The line runs along the body's y axis, its ends are halfHeight above and below the centre.
+    */
+    class Capsule : public Primitive
+    {
+        public:
+            real radius;
+
+            real halfHeight;
+    };
+
+    /**
+        This class is a triangle mesh for static geometry like a level.
+        The mesh isn't owned, it has to live as long as this does. A mesh with no body just sits at the origin.
+    */
+    class TriangleMesh : public Primitive
+    {
+        public:
+            const CollisionMesh* mesh;
+    };
+
     class IntersectionTests
     {
         public:
@@ -184,6 +209,16 @@ namespace wind
 
         //This function handles box on box collision which uses the SAT to get all the contact information.
       unsigned BoxAndBox(const Box& first, const Box& second, CollisionData& data);
+
+        /**
+            These functions collide a primitive with every triangle of a mesh that is close enough, the mesh's tree finds them.
+            The contact normals push the primitive out of the mesh and the mesh is never moved, like a half space.
+            A triangle can be hit from either side, the primitive is pushed out on the side its centre is on.
+        */
+        static unsigned SphereAndTriangleMesh(const Sphere& sphere, const TriangleMesh& mesh, CollisionData& data);
+        static unsigned CapsuleAndTriangleMesh(const Capsule& capsule, const TriangleMesh& mesh, CollisionData& data);
+        //This one uses the separating axis test against each triangle, a triangle gets a contact for each of the box's corners under it.
+        static unsigned BoxAndTriangleMesh(const Box& box, const TriangleMesh& mesh, CollisionData& data);
     };
 
 	class PlayerGeometry
@@ -0,0 +1,1918 @@
+#include "collision_query.h"
+#include "collision_geometry.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "../include/parallel.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define WIND_QUERY_SSE
+#include <xmmintrin.h>
+#endif
+
+using namespace wind;
+
+namespace
+{
+    //Leaves of the tree hold this many shapes at most.
+    const unsigned QUERY_LEAF_SHAPES = 4;
+    const unsigned MAX_STACK = 64;
+
+    //The tree's boxes are floats, they are grown by this much so the rounding can never make one smaller than its shape.
+    const float BOUNDS_MARGIN = 0.001f;
+
+    //The batched rays go through the tree this many at a time, one for each lane of an SSE register.
+    const unsigned PACKET_SIZE = 4;
+    //Each thread gets at least this many packets, fewer than that costs more to start the thread than it saves.
+    const unsigned MIN_PACKETS_PER_THREAD = 16;
+
+    //A box cast against a capsule moves up to the capsule this many times at most, and stops once it is this close.
+    const unsigned MAX_ADVANCE_STEPS = 64;
+    const real ADVANCE_TOLERANCE = 0.0001;
+    //How many times the closest point between a capsule's line and a box is narrowed down.
+    const unsigned SEGMENT_SEARCH_STEPS = 32;
+
+    //A point this close outside a triangle still counts as on it, so a ray can't slip through the seam between two of them.
+    const real SURFACE_TOLERANCE = 1e-7;
+
+    //This checks if a point on the triangle's plane is inside it.
+    inline bool insideTriangle(const Vector3& p, const Vector3& a, const Vector3& b, const Vector3& c)
+    {
+        Vector3 ab = b - a;
+        Vector3 ac = c - a;
+        Vector3 ap = p - a;
+
+        real abab = ab * ab;
+        real abac = ab * ac;
+        real acac = ac * ac;
+        real denom = abab * acac - abac * abac;
+        if(denom <= 0)
+        {
+            return false;
+        }
+
+        real v = (acac * (ap * ab) - abac * (ap * ac)) / denom;
+        real w = (abab * (ap * ac) - abac * (ap * ab)) / denom;
+        return v >= -SURFACE_TOLERANCE && w >= -SURFACE_TOLERANCE && v + w <= 1 + SURFACE_TOLERANCE;
+    }
+
+    //The half size of the box along the world axes.
+    inline Vector3 getBoxExtent(const Box& box)
+    {
+        Vector3 extent;
+        for(unsigned i = 0; i < 3; i++)
+        {
+            extent[i] = std::abs(box.getAxis(0)[i]) * box.halfSize.x + std::abs(box.getAxis(1)[i]) * box.halfSize.y + std::abs(box.getAxis(2)[i]) * box.halfSize.z;
+        }
+        return extent;
+    }
+
+    inline real getBoxRadiusOnAxis(const Box& box, const Vector3& axis)
+    {
+        return box.halfSize.x * std::abs(axis * box.getAxis(0)) +
+               box.halfSize.y * std::abs(axis * box.getAxis(1)) +
+               box.halfSize.z * std::abs(axis * box.getAxis(2));
+    }
+
+    inline Vector3 closestPointOnBox(const Box& box, const Vector3& point)
+    {
+        Vector3 local = box.getTransform().transformInverse(point);
+        for(unsigned i = 0; i < 3; i++)
+        {
+            local[i] = std::max(-box.halfSize[i], std::min(box.halfSize[i], local[i]));
+        }
+        return box.getTransform().transform(local);
+    }
+
+    //The distance from a point to a box only goes down and then up along a line, so it can be narrowed down by thirds.
+    inline real closestPointsOnSegmentAndBox(const Box& box, const Vector3& start, const Vector3& end, Vector3& onSegment, Vector3& onBox)
+    {
+        Vector3 line = end - start;
+        real low = 0;
+        real high = 1;
+        for(unsigned i = 0; i < SEGMENT_SEARCH_STEPS; i++)
+        {
+            real first = low + (high - low) / 3;
+            real second = high - (high - low) / 3;
+            Vector3 firstPoint = start + line * first;
+            Vector3 secondPoint = start + line * second;
+            if((firstPoint - closestPointOnBox(box, firstPoint)).squareMagnitude() < (secondPoint - closestPointOnBox(box, secondPoint)).squareMagnitude())
+            {
+                high = second;
+            }
+            else
+            {
+                low = first;
+            }
+        }
+
+        onSegment = start + line * ((low + high) * 0.5);
+        onBox = closestPointOnBox(box, onSegment);
+        return (onSegment - onBox).magnitude();
+    }
+
+    inline void getCapsuleEnds(const Capsule& capsule, Vector3& top, Vector3& bottom)
+    {
+        Vector3 axis = capsule.getAxis(1);
+        axis.normalise();
+        top = capsule.getAxis(3) + axis * capsule.halfHeight;
+        bottom = capsule.getAxis(3) - axis * capsule.halfHeight;
+    }
+
+    /**
+        This checks a box against the corners of a convex shape along each axis. If none of the axes separate them
+        the normal is set to the axis that pushes the box out the least, pointing from the shape to the box.
+    */
+    inline bool boxAndPointsOverlap(const Box& box, const Vector3* points, unsigned pointCount, const Vector3* axes, unsigned axisCount, Vector3& normal)
+    {
+        Vector3 centre = box.getAxis(3);
+        real best = 0;
+        bool found = false;
+        for(unsigned i = 0; i < axisCount; i++)
+        {
+            Vector3 axis = axes[i];
+            if(axis.squareMagnitude() < 0.0001)
+            {
+                continue;
+            }
+            axis.normalise();
+
+            real radius = getBoxRadiusOnAxis(box, axis);
+            real middle = centre * axis;
+            real low = points[0] * axis;
+            real high = low;
+            for(unsigned p = 1; p < pointCount; p++)
+            {
+                real projection = points[p] * axis;
+                low = std::min(low, projection);
+                high = std::max(high, projection);
+            }
+
+            real pushUp = high - (middle - radius);
+            real pushDown = (middle + radius) - low;
+            if(pushUp <= 0 || pushDown <= 0)
+            {
+                return false;
+            }
+
+            real push = std::min(pushUp, pushDown);
+            if(!found || push < best)
+            {
+                best = push;
+                normal = pushUp < pushDown ? axis : axis * -1.0;
+                found = true;
+            }
+        }
+
+        return true;
+    }
+
+    //The thirteen axes that can separate a box and a triangle, the box's faces, the triangle's face and the crosses of their edges.
+    inline void getBoxTriangleAxes(const Box& box, const Vector3 corners[3], Vector3 axes[13])
+    {
+        Vector3 edges[3] = { corners[1] - corners[0], corners[2] - corners[1], corners[0] - corners[2] };
+        for(unsigned i = 0; i < 3; i++)
+        {
+            axes[i] = box.getAxis(i);
+            for(unsigned edge = 0; edge < 3; edge++)
+            {
+                axes[4 + i * 3 + edge] = box.getAxis(i) % edges[edge];
+            }
+        }
+        axes[3] = edges[0] % (corners[2] - corners[0]);
+    }
+
+    inline void getBoxCorners(const Box& box, Vector3 corners[8])
+    {
+        for(unsigned i = 0; i < 8; i++)
+        {
+            Vector3 local((i & 1) ? box.halfSize.x : -box.halfSize.x, (i & 2) ? box.halfSize.y : -box.halfSize.y, (i & 4) ? box.halfSize.z : -box.halfSize.z);
+            corners[i] = box.getTransform().transform(local);
+        }
+    }
+
+    /**
+        These sweep a sphere along a normalised direction and give the first distance it touches the shape.
+        A sphere with a radius of zero is a ray. If it starts touching the distance is zero and the normal points back along the direction.
+    */
+    inline bool sweepSphere(const Vector3& origin, const Vector3& direction, const Vector3& centre, real radius, real maxDistance, real& distance, Vector3& normal)
+    {
+        Vector3 offset = origin - centre;
+        real c = offset * offset - radius * radius;
+        if(c <= 0)
+        {
+            distance = 0;
+            normal = direction * -1.0;
+            return true;
+        }
+
+        real b = offset * direction;
+        real discriminant = b * b - c;
+        if(b >= 0 || discriminant < 0)
+        {
+            return false;
+        }
+
+        real t = -b - std::sqrt(discriminant);
+        if(t > maxDistance)
+        {
+            return false;
+        }
+
+        distance = t;
+        normal = origin + direction * t - centre;
+        normal.normalise();
+        return true;
+    }
+
+    //A capsule is a cylinder around the line with a sphere on each end.
+    inline bool sweepCapsule(const Vector3& origin, const Vector3& direction, const Vector3& start, const Vector3& end, real radius, real maxDistance,
+                             real& distance, Vector3& normal)
+    {
+        if((origin - closestPointOnSegment(origin, start, end)).squareMagnitude() <= radius * radius)
+        {
+            distance = 0;
+            normal = direction * -1.0;
+            return true;
+        }
+
+        real best = maxDistance;
+        bool hit = false;
+
+        //The cylinder is where the distance from the line, leaving out the part along it, is the radius.
+        Vector3 line = end - start;
+        real lineLength = line * line;
+        if(lineLength > real_epsilon)
+        {
+            Vector3 offset = origin - start;
+            real lineDirection = line * direction;
+            real lineOffset = line * offset;
+            real a = lineLength - lineDirection * lineDirection;
+            real b = lineLength * (offset * direction) - lineOffset * lineDirection;
+            real c = lineLength * (offset * offset) - lineOffset * lineOffset - radius * radius * lineLength;
+            real discriminant = b * b - a * c;
+            if(a > real_epsilon * lineLength && discriminant >= 0)
+            {
+                real t = (-b - std::sqrt(discriminant)) / a;
+                real along = lineOffset + t * lineDirection;
+                if(t >= 0 && t <= best && along >= 0 && along <= lineLength)
+                {
+                    best = t;
+                    hit = true;
+                }
+            }
+        }
+
+        Vector3 endNormal;
+        real endDistance;
+        if(sweepSphere(origin, direction, start, radius, best, endDistance, endNormal))
+        {
+            best = endDistance;
+            hit = true;
+        }
+        if(sweepSphere(origin, direction, end, radius, best, endDistance, endNormal))
+        {
+            best = endDistance;
+            hit = true;
+        }
+
+        if(!hit)
+        {
+            return false;
+        }
+
+        Vector3 centre = origin + direction * best;
+        distance = best;
+        normal = centre - closestPointOnSegment(centre, start, end);
+        normal.normalise();
+        return true;
+    }
+
+    inline bool sweepHalfSpace(const Vector3& origin, const Vector3& direction, real radius, const Plane& plane, real maxDistance, real& distance, Vector3& normal)
+    {
+        real height = plane.direction * origin - plane.offset;
+        if(height <= radius)
+        {
+            distance = 0;
+            normal = direction * -1.0;
+            return true;
+        }
+
+        real speed = plane.direction * direction;
+        if(speed >= 0)
+        {
+            return false;
+        }
+
+        real t = (height - radius) / -speed;
+        if(t > maxDistance)
+        {
+            return false;
+        }
+
+        distance = t;
+        normal = plane.direction;
+        return true;
+    }
+
+    //A sphere moving at a box touches it first on a face, or on an edge or corner, which are rounded by the radius.
+    inline bool sweepBox(const Vector3& origin, const Vector3& direction, real radius, const Box& box, real maxDistance, real& distance, Vector3& normal)
+    {
+        //Everything is done in the box's space, where the box sits on the origin along the axes.
+        const Matrix4& transform = box.getTransform();
+        Vector3 start = transform.transformInverse(origin);
+        Vector3 along = transform.transformInverseDirection(direction);
+        const Vector3& half = box.halfSize;
+
+        Vector3 clamped;
+        for(unsigned axis = 0; axis < 3; axis++)
+        {
+            clamped[axis] = std::max(-half[axis], std::min(half[axis], start[axis]));
+        }
+        if((start - clamped).squareMagnitude() <= radius * radius)
+        {
+            distance = 0;
+            normal = direction * -1.0;
+            return true;
+        }
+
+        //First the box is grown by the radius on every side.
+        real enter = -1e30;
+        real leave = maxDistance;
+        int enterAxis = -1;
+        for(unsigned axis = 0; axis < 3; axis++)
+        {
+            real low = -half[axis] - radius;
+            real high = half[axis] + radius;
+            if(std::abs(along[axis]) < real_epsilon)
+            {
+                if(start[axis] < low || start[axis] > high)
+                {
+                    return false;
+                }
+                continue;
+            }
+
+            real nearSide = (low - start[axis]) / along[axis];
+            real farSide = (high - start[axis]) / along[axis];
+            if(nearSide > farSide)
+            {
+                std::swap(nearSide, farSide);
+            }
+
+            if(nearSide > enter)
+            {
+                enter = nearSide;
+                enterAxis = axis;
+            }
+            leave = std::min(leave, farSide);
+            if(enter > leave)
+            {
+                return false;
+            }
+        }
+
+        //If it comes in over the middle of a face that is the hit.
+        if(enterAxis >= 0 && enter >= 0)
+        {
+            Vector3 point = start + along * enter;
+            bool onFace = true;
+            for(unsigned axis = 0; axis < 3; axis++)
+            {
+                if(static_cast<int>(axis) != enterAxis && std::abs(point[axis]) > half[axis] + SURFACE_TOLERANCE)
+                {
+                    onFace = false;
+                }
+            }
+
+            if(onFace)
+            {
+                Vector3 localNormal;
+                localNormal[enterAxis] = point[enterAxis] > 0 ? 1.0 : -1.0;
+                distance = enter;
+                normal = transform.transformDirection(localNormal);
+                return true;
+            }
+        }
+
+        if(radius <= 0)
+        {
+            return false;
+        }
+
+        //Otherwise it came in over a rounded edge or corner, the edges are capsules and their ends are the corners.
+        real best = maxDistance;
+        bool hit = false;
+        Vector3 localNormal;
+        for(unsigned axis = 0; axis < 3; axis++)
+        {
+            unsigned u = (axis + 1) % 3;
+            unsigned v = (axis + 2) % 3;
+            for(unsigned corner = 0; corner < 4; corner++)
+            {
+                Vector3 edgeStart;
+                edgeStart[u] = (corner & 1) ? half[u] : -half[u];
+                edgeStart[v] = (corner & 2) ? half[v] : -half[v];
+                edgeStart[axis] = -half[axis];
+                Vector3 edgeEnd = edgeStart;
+                edgeEnd[axis] = half[axis];
+
+                real edgeDistance;
+                Vector3 edgeNormal;
+                if(sweepCapsule(start, along, edgeStart, edgeEnd, radius, best, edgeDistance, edgeNormal))
+                {
+                    best = edgeDistance;
+                    localNormal = edgeNormal;
+                    hit = true;
+                }
+            }
+        }
+
+        if(!hit)
+        {
+            return false;
+        }
+
+        distance = best;
+        normal = transform.transformDirection(localNormal);
+        return true;
+    }
+
+    //Triangles can be hit from either side, the normal is on the side the sweep came from.
+    inline bool sweepTriangle(const Vector3& origin, const Vector3& direction, real radius, const Vector3& a, const Vector3& b, const Vector3& c,
+                              real maxDistance, real& distance, Vector3& normal)
+    {
+        Vector3 face = (b - a) % (c - a);
+        face.normalise();
+        real height = (origin - a) * face;
+        if(height < 0)
+        {
+            face = face * -1.0;
+            height = -height;
+        }
+
+        if(radius > 0 && (origin - closestPointOnTriangle(origin, a, b, c)).squareMagnitude() <= radius * radius)
+        {
+            distance = 0;
+            normal = direction * -1.0;
+            return true;
+        }
+
+        //The face is always touched before the edges if it is touched at all.
+        real speed = direction * face;
+        if(speed < 0)
+        {
+            real t = (height - radius) / -speed;
+            if(t >= 0 && t <= maxDistance && insideTriangle(origin + direction * t - face * radius, a, b, c))
+            {
+                distance = t;
+                normal = face;
+                return true;
+            }
+        }
+
+        if(radius <= 0)
+        {
+            return false;
+        }
+
+        real best = maxDistance;
+        bool hit = false;
+        const Vector3* corners[3] = { &a, &b, &c };
+        for(unsigned edge = 0; edge < 3; edge++)
+        {
+            real edgeDistance;
+            Vector3 edgeNormal;
+            if(sweepCapsule(origin, direction, *corners[edge], *corners[(edge + 1) % 3], radius, best, edgeDistance, edgeNormal))
+            {
+                best = edgeDistance;
+                normal = edgeNormal;
+                hit = true;
+            }
+        }
+
+        distance = best;
+        return hit;
+    }
+
+    /**
+        This moves a box along a normalised direction at the corners of a convex shape. The box doesn't turn so none of
+        the axes change, and along each one the box and the shape overlap for one stretch of the line. The box first
+        touches the shape where the last of those stretches starts, and the axis it started on gives the normal.
+    */
+    inline bool sweepBoxAndPoints(const Box& box, const Vector3& direction, const Vector3* points, unsigned pointCount, const Vector3* axes, unsigned axisCount,
+                                  real maxDistance, real& distance, Vector3& normal)
+    {
+        Vector3 centre = box.getAxis(3);
+        real enter = -1e30;
+        real leave = maxDistance;
+        for(unsigned i = 0; i < axisCount; i++)
+        {
+            Vector3 axis = axes[i];
+            if(axis.squareMagnitude() < 0.0001)
+            {
+                continue;
+            }
+            axis.normalise();
+
+            real radius = getBoxRadiusOnAxis(box, axis);
+            real middle = centre * axis;
+            real low = points[0] * axis;
+            real high = low;
+            for(unsigned p = 1; p < pointCount; p++)
+            {
+                real projection = points[p] * axis;
+                low = std::min(low, projection);
+                high = std::max(high, projection);
+            }
+
+            //The box overlaps on this axis while its middle is between these two.
+            real first = low - radius - middle;
+            real last = high + radius - middle;
+            real speed = direction * axis;
+            if(std::abs(speed) < real_epsilon)
+            {
+                if(first > 0 || last < 0)
+                {
+                    return false;
+                }
+                continue;
+            }
+
+            real start = first / speed;
+            real end = last / speed;
+            if(start > end)
+            {
+                std::swap(start, end);
+            }
+
+            if(start > enter)
+            {
+                enter = start;
+                normal = speed > 0 ? axis * -1.0 : axis;
+            }
+            leave = std::min(leave, end);
+            if(enter > leave)
+            {
+                return false;
+            }
+        }
+
+        //If every stretch ended before the start the box is moving away from the shape.
+        if(leave < 0)
+        {
+            return false;
+        }
+
+        if(enter <= 0)
+        {
+            distance = 0;
+            normal = direction * -1.0;
+            return true;
+        }
+
+        distance = enter;
+        return true;
+    }
+
+    //This sweeps a sphere or ray through a mesh in the mesh's own space, keeping the closest triangle it hits.
+    class SphereMeshSweep : public CollisionMesh::SweepTest
+    {
+        public:
+            SphereMeshSweep(const CollisionMesh& mesh, const Vector3& origin, const Vector3& direction, real radius, bool stopAtFirst) :
+                mesh(mesh), origin(origin), direction(direction), radius(radius), stopAtFirst(stopAtFirst), hit(false), distance(0), triangle(0)
+            {
+            }
+
+            virtual void testTriangle(unsigned index, real &maxDistance)
+            {
+                Vector3 a, b, c;
+                mesh.getTriangle(index, a, b, c);
+
+                real t;
+                Vector3 n;
+                if(!sweepTriangle(origin, direction, radius, a, b, c, maxDistance, t, n) || (hit && t >= distance))
+                {
+                    return;
+                }
+
+                hit = true;
+                distance = t;
+                normal = n;
+                triangle = index;
+
+                //Anything past the hit can't be closer, and once any hit will do nothing more needs looking at.
+                maxDistance = stopAtFirst ? -1.0 : t;
+            }
+
+            const CollisionMesh& mesh;
+            Vector3 origin;
+            Vector3 direction;
+            real radius;
+            bool stopAtFirst;
+
+            bool hit;
+            real distance;
+            Vector3 normal;
+            unsigned triangle;
+    };
+
+    //This moves a box through a mesh, it walks the mesh's tree in the mesh's space but tests each triangle in the world.
+    class BoxMeshSweep : public CollisionMesh::SweepTest
+    {
+        public:
+            BoxMeshSweep(const TriangleMesh& mesh, const Box& box, const Vector3& direction) :
+                mesh(mesh), box(box), direction(direction), hit(false), distance(0), triangle(0)
+            {
+            }
+
+            virtual void testTriangle(unsigned index, real &maxDistance)
+            {
+                Vector3 corners[3];
+                mesh.mesh->getTriangle(index, corners[0], corners[1], corners[2]);
+                for(unsigned i = 0; i < 3; i++)
+                {
+                    corners[i] = mesh.getTransform().transform(corners[i]);
+                }
+
+                Vector3 axes[13];
+                getBoxTriangleAxes(box, corners, axes);
+
+                real t;
+                Vector3 n;
+                if(!sweepBoxAndPoints(box, direction, corners, 3, axes, 13, maxDistance, t, n) || (hit && t >= distance))
+                {
+                    return;
+                }
+
+                //The contact goes on the triangle's corner that reached furthest into the box.
+                unsigned deepest = 0;
+                for(unsigned i = 1; i < 3; i++)
+                {
+                    if(corners[i] * n > corners[deepest] * n)
+                    {
+                        deepest = i;
+                    }
+                }
+
+                hit = true;
+                distance = t;
+                normal = n;
+                point = corners[deepest];
+                triangle = index;
+                maxDistance = t;
+            }
+
+            const TriangleMesh& mesh;
+            const Box& box;
+            Vector3 direction;
+
+            bool hit;
+            real distance;
+            Vector3 normal;
+            Vector3 point;
+            unsigned triangle;
+    };
+
+    //The candidate list is kept between queries so it doesn't allocate every time, each thread has its own.
+    inline std::vector<unsigned>& getCandidateList()
+    {
+        static thread_local std::vector<unsigned> candidates;
+        candidates.clear();
+        return candidates;
+    }
+
+    inline void setFloats(float result[3], const Vector3& vec, float margin)
+    {
+        result[0] = static_cast<float>(vec.x) + margin;
+        result[1] = static_cast<float>(vec.y) + margin;
+        result[2] = static_cast<float>(vec.z) + margin;
+    }
+
+    //The slab test for one ray against a float box, it gives where the ray goes in or a negative number if it misses.
+    inline float enterBox(const float start[3], const float inverse[3], float grow, const float boxMin[3], const float boxMax[3], float furthest)
+    {
+        float enter = 0.0f;
+        float leave = furthest;
+        for(unsigned axis = 0; axis < 3; axis++)
+        {
+            float nearSide = (boxMin[axis] - grow - start[axis]) * inverse[axis];
+            float farSide = (boxMax[axis] + grow - start[axis]) * inverse[axis];
+            if(nearSide > farSide)
+            {
+                std::swap(nearSide, farSide);
+            }
+
+            enter = std::max(enter, nearSide);
+            leave = std::min(leave, farSide);
+        }
+
+        return enter <= leave ? enter : -1.0f;
+    }
+
+    inline float getInverse(real value)
+    {
+        return value != 0 ? static_cast<float>(1.0 / value) : 1e30f;
+    }
+
+    /**
+        This holds four rays laid out so each of their parts fills one SSE register.
+    */
+    struct RayPacket
+    {
+        float originX[PACKET_SIZE];
+        float originY[PACKET_SIZE];
+        float originZ[PACKET_SIZE];
+        float inverseX[PACKET_SIZE];
+        float inverseY[PACKET_SIZE];
+        float inverseZ[PACKET_SIZE];
+        float furthest[PACKET_SIZE];
+    };
+
+    //This tests all four rays against a box at once, it returns a bit for each ray that goes through it.
+    inline unsigned packetEntersBox(const RayPacket& packet, const float boxMin[3], const float boxMax[3])
+    {
+#ifdef WIND_QUERY_SSE
+        __m128 lowX = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boxMin[0]), _mm_loadu_ps(packet.originX)), _mm_loadu_ps(packet.inverseX));
+        __m128 highX = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boxMax[0]), _mm_loadu_ps(packet.originX)), _mm_loadu_ps(packet.inverseX));
+        __m128 lowY = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boxMin[1]), _mm_loadu_ps(packet.originY)), _mm_loadu_ps(packet.inverseY));
+        __m128 highY = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boxMax[1]), _mm_loadu_ps(packet.originY)), _mm_loadu_ps(packet.inverseY));
+        __m128 lowZ = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boxMin[2]), _mm_loadu_ps(packet.originZ)), _mm_loadu_ps(packet.inverseZ));
+        __m128 highZ = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boxMax[2]), _mm_loadu_ps(packet.originZ)), _mm_loadu_ps(packet.inverseZ));
+
+        __m128 enter = _mm_max_ps(_mm_max_ps(_mm_min_ps(lowX, highX), _mm_min_ps(lowY, highY)), _mm_max_ps(_mm_min_ps(lowZ, highZ), _mm_setzero_ps()));
+        __m128 leave = _mm_min_ps(_mm_min_ps(_mm_max_ps(lowX, highX), _mm_max_ps(lowY, highY)), _mm_min_ps(_mm_max_ps(lowZ, highZ), _mm_loadu_ps(packet.furthest)));
+
+        return static_cast<unsigned>(_mm_movemask_ps(_mm_cmple_ps(enter, leave)));
+#else
+        unsigned mask = 0;
+        for(unsigned lane = 0; lane < PACKET_SIZE; lane++)
+        {
+            float start[3] = { packet.originX[lane], packet.originY[lane], packet.originZ[lane] };
+            float inverse[3] = { packet.inverseX[lane], packet.inverseY[lane], packet.inverseZ[lane] };
+            if(enterBox(start, inverse, 0.0f, boxMin, boxMax, packet.furthest[lane]) >= 0.0f)
+            {
+                mask |= 1u << lane;
+            }
+        }
+        return mask;
+#endif
+    }
+}
+
+CollisionQuery::CollisionQuery()
+{
+}
+
+unsigned CollisionQuery::addSphere(const Sphere* sphere, unsigned groups)
+{
+    return addShape(SHAPE_SPHERE, sphere, groups);
+}
+
+unsigned CollisionQuery::addBox(const Box* box, unsigned groups)
+{
+    return addShape(SHAPE_BOX, box, groups);
+}
+
+unsigned CollisionQuery::addCapsule(const Capsule* capsule, unsigned groups)
+{
+    return addShape(SHAPE_CAPSULE, capsule, groups);
+}
+
+unsigned CollisionQuery::addHalfSpace(const Plane* plane, unsigned groups)
+{
+    return addShape(SHAPE_HALF_SPACE, plane, groups);
+}
+
+unsigned CollisionQuery::addMesh(const TriangleMesh* mesh, unsigned groups)
+{
+    if(mesh->mesh == nullptr)
+    {
+        return QUERY_NO_SHAPE;
+    }
+
+    return addShape(SHAPE_MESH, mesh, groups);
+}
+
+unsigned CollisionQuery::addTrigger(const Box* box, unsigned watchGroups, unsigned groups)
+{
+    unsigned index = addShape(SHAPE_BOX, box, groups);
+    shapes[index].trigger = true;
+    shapes[index].watchGroups = watchGroups;
+    triggers.push_back(index);
+    return index;
+}
+
+unsigned CollisionQuery::addTrigger(const Sphere* sphere, unsigned watchGroups, unsigned groups)
+{
+    unsigned index = addShape(SHAPE_SPHERE, sphere, groups);
+    shapes[index].trigger = true;
+    shapes[index].watchGroups = watchGroups;
+    triggers.push_back(index);
+    return index;
+}
+
+unsigned CollisionQuery::addShape(ShapeType type, const Primitive* primitive, unsigned groups)
+{
+    Shape shape;
+    shape.type = type;
+    shape.primitive = primitive;
+    shape.groups = groups;
+    for(unsigned axis = 0; axis < 3; axis++)
+    {
+        shape.boundsMin[axis] = 0.0f;
+        shape.boundsMax[axis] = 0.0f;
+    }
+    shape.trigger = false;
+    shape.watchGroups = 0;
+    //A new shape counts as moved so the triggers test it on its first update.
+    shape.moved = true;
+
+    unsigned index = shapes.size();
+    if(!freeShapes.empty())
+    {
+        index = freeShapes.back();
+        freeShapes.pop_back();
+        shapes[index] = shape;
+    }
+    else
+    {
+        shapes.push_back(shape);
+    }
+
+    if(type == SHAPE_HALF_SPACE)
+    {
+        halfSpaces.push_back(index);
+    }
+
+    return index;
+}
+
+void CollisionQuery::remove(unsigned shape)
+{
+    if(shape >= shapes.size() || shapes[shape].type == SHAPE_NONE)
+    {
+        return;
+    }
+
+    if(shapes[shape].type == SHAPE_HALF_SPACE)
+    {
+        halfSpaces.erase(std::find(halfSpaces.begin(), halfSpaces.end(), shape));
+    }
+
+    if(shapes[shape].trigger)
+    {
+        triggers.erase(std::find(triggers.begin(), triggers.end(), shape));
+    }
+
+    //Its pairs are ended now, if they were left for the next update a new shape given the same id would carry them on.
+    unsigned kept = 0;
+    for(unsigned i = 0; i < triggerPairs.size(); i++)
+    {
+        const TriggerPair &pair = triggerPairs[i];
+        if(unsigned(pair.key >> 32) == shape || unsigned(pair.key) == shape)
+        {
+            addTriggerEvent(TRIGGER_EXIT, pair);
+        }
+        else
+        {
+            triggerPairs[kept++] = pair;
+        }
+    }
+    triggerPairs.resize(kept);
+
+    //The tree might still have it in a leaf until the next update, with no groups no query will look at it.
+    shapes[shape].type = SHAPE_NONE;
+    shapes[shape].primitive = nullptr;
+    shapes[shape].groups = 0;
+    shapes[shape].trigger = false;
+    freeShapes.push_back(shape);
+}
+
+void CollisionQuery::clear()
+{
+    shapes.clear();
+    freeShapes.clear();
+    halfSpaces.clear();
+    leafShapes.clear();
+    nodes.clear();
+    triggers.clear();
+    triggerPairs.clear();
+    triggerEvents.clear();
+}
+
+const Primitive* CollisionQuery::getPrimitive(unsigned shape) const
+{
+    return shape < shapes.size() ? shapes[shape].primitive : nullptr;
+}
+
+unsigned CollisionQuery::getGroups(unsigned shape) const
+{
+    return shape < shapes.size() ? shapes[shape].groups : 0;
+}
+
+void CollisionQuery::update()
+{
+    leafShapes.clear();
+    nodes.clear();
+
+    for(unsigned i = 0; i < shapes.size(); i++)
+    {
+        Shape &shape = shapes[i];
+        Vector3 centre;
+        Vector3 extent;
+        switch(shape.type)
+        {
+            case SHAPE_SPHERE:
+            {
+                const Sphere* sphere = static_cast<const Sphere*>(shape.primitive);
+                centre = sphere->getAxis(3);
+                extent = Vector3(sphere->radius, sphere->radius, sphere->radius);
+                break;
+            }
+            case SHAPE_BOX:
+            {
+                const Box* box = static_cast<const Box*>(shape.primitive);
+                centre = box->getAxis(3);
+                extent = getBoxExtent(*box);
+                break;
+            }
+            case SHAPE_CAPSULE:
+            {
+                const Capsule* capsule = static_cast<const Capsule*>(shape.primitive);
+                Vector3 axis = capsule->getAxis(1);
+                axis.normalise();
+                centre = capsule->getAxis(3);
+                extent = Vector3(std::abs(axis.x) * capsule->halfHeight + capsule->radius,
+                                 std::abs(axis.y) * capsule->halfHeight + capsule->radius,
+                                 std::abs(axis.z) * capsule->halfHeight + capsule->radius);
+                break;
+            }
+            case SHAPE_MESH:
+            {
+                //The mesh's own box is turned with it, its extent along the world axes comes from the absolute rotation.
+                const TriangleMesh* mesh = static_cast<const TriangleMesh*>(shape.primitive);
+                Vector3 localCentre = (mesh->mesh->getBoundsMin() + mesh->mesh->getBoundsMax()) * 0.5;
+                Vector3 localExtent = (mesh->mesh->getBoundsMax() - mesh->mesh->getBoundsMin()) * 0.5;
+                centre = mesh->getTransform().transform(localCentre);
+                for(unsigned axis = 0; axis < 3; axis++)
+                {
+                    extent[axis] = std::abs(mesh->getAxis(0)[axis]) * localExtent.x +
+                                   std::abs(mesh->getAxis(1)[axis]) * localExtent.y +
+                                   std::abs(mesh->getAxis(2)[axis]) * localExtent.z;
+                }
+                break;
+            }
+            case SHAPE_HALF_SPACE:
+                //A plane's normal and offset aren't in its transform, so the triggers always test it again.
+                shape.moved = true;
+                continue;
+            default:
+                continue;
+        }
+
+        float boundsMin[3];
+        float boundsMax[3];
+        setFloats(boundsMin, centre - extent, -BOUNDS_MARGIN);
+        setFloats(boundsMax, centre + extent, BOUNDS_MARGIN);
+
+        //It has moved if it has turned or changed size as well as if it has gone somewhere else.
+        const Matrix4 &transform = shape.primitive->getTransform();
+        shape.moved = shape.moved || !std::equal(&transform.data[0][0], &transform.data[0][0] + 12, &shape.lastTransform.data[0][0]) ||
+                      !std::equal(boundsMin, boundsMin + 3, shape.boundsMin) || !std::equal(boundsMax, boundsMax + 3, shape.boundsMax);
+        shape.lastTransform = transform;
+        std::copy(boundsMin, boundsMin + 3, shape.boundsMin);
+        std::copy(boundsMax, boundsMax + 3, shape.boundsMax);
+        leafShapes.push_back(i);
+    }
+
+    if(!leafShapes.empty())
+    {
+        nodes.reserve(leafShapes.size() * 2 / QUERY_LEAF_SHAPES + 1);
+        buildNode(0, leafShapes.size());
+    }
+
+    updateTriggers();
+
+    for(unsigned i = 0; i < shapes.size(); i++)
+    {
+        shapes[i].moved = false;
+    }
+}
+
+void CollisionQuery::updateTriggers()
+{
+    nextTriggerPairs.clear();
+
+    for(unsigned t = 0; t < triggers.size(); t++)
+    {
+        unsigned trigger = triggers[t];
+        const Shape &triggerShape = shapes[trigger];
+
+        std::vector<unsigned> &candidates = getCandidateList();
+        findShapes(triggerShape.boundsMin, triggerShape.boundsMax, triggerShape.watchGroups, candidates);
+
+        for(unsigned i = 0; i < candidates.size(); i++)
+        {
+            unsigned other = candidates[i];
+            if(other == trigger || shapes[other].trigger)
+            {
+                continue;
+            }
+
+            TriggerPair pair;
+            pair.key = (std::uint64_t(trigger) << 32) | other;
+            pair.triggerPrimitive = triggerShape.primitive;
+            pair.otherPrimitive = shapes[other].primitive;
+
+            //If neither of them has moved the answer can't have changed, so it is whatever it was at the last update.
+            bool inside;
+            if(triggerShape.moved || shapes[other].moved)
+            {
+                inside = triggerOverlapsShape(trigger, other);
+            }
+            else
+            {
+                inside = std::binary_search(triggerPairs.begin(), triggerPairs.end(), pair,
+                                            [](const TriggerPair &a, const TriggerPair &b) { return a.key < b.key; });
+            }
+
+            if(inside)
+            {
+                nextTriggerPairs.push_back(pair);
+            }
+        }
+    }
+
+    std::sort(nextTriggerPairs.begin(), nextTriggerPairs.end(), [](const TriggerPair &a, const TriggerPair &b) { return a.key < b.key; });
+
+    //Both lists are sorted so one walk down them finds what started, what carried on and what ended.
+    unsigned last = 0;
+    unsigned next = 0;
+    while(last < triggerPairs.size() || next < nextTriggerPairs.size())
+    {
+        if(next == nextTriggerPairs.size() || (last < triggerPairs.size() && triggerPairs[last].key < nextTriggerPairs[next].key))
+        {
+            addTriggerEvent(TRIGGER_EXIT, triggerPairs[last++]);
+        }
+        else if(last == triggerPairs.size() || nextTriggerPairs[next].key < triggerPairs[last].key)
+        {
+            addTriggerEvent(TRIGGER_ENTER, nextTriggerPairs[next++]);
+        }
+        else
+        {
+            addTriggerEvent(TRIGGER_STAY, nextTriggerPairs[next++]);
+            last++;
+        }
+    }
+
+    triggerPairs.swap(nextTriggerPairs);
+}
+
+bool CollisionQuery::triggerOverlapsShape(unsigned trigger, unsigned shape) const
+{
+    const Shape &triggerShape = shapes[trigger];
+    if(triggerShape.type == SHAPE_SPHERE)
+    {
+        const Sphere* sphere = static_cast<const Sphere*>(triggerShape.primitive);
+        return sphereOverlapsShape(shape, sphere->getAxis(3), sphere->radius);
+    }
+
+    return boxOverlapsShape(shape, *static_cast<const Box*>(triggerShape.primitive));
+}
+
+void CollisionQuery::addTriggerEvent(TriggerEventType type, const TriggerPair &pair)
+{
+    TriggerEvent event;
+    event.type = type;
+    event.trigger = unsigned(pair.key >> 32);
+    event.other = unsigned(pair.key);
+    event.triggerPrimitive = pair.triggerPrimitive;
+    event.otherPrimitive = pair.otherPrimitive;
+    triggerEvents.push_back(event);
+}
+
+const std::vector<TriggerEvent>& CollisionQuery::getTriggerEvents() const
+{
+    return triggerEvents;
+}
+
+void CollisionQuery::clearTriggerEvents()
+{
+    triggerEvents.clear();
+}
+
+void CollisionQuery::buildNode(unsigned first, unsigned count)
+{
+    unsigned index = nodes.size();
+    nodes.push_back(Node());
+
+    float centreMin[3] = { 1e30f, 1e30f, 1e30f };
+    float centreMax[3] = { -1e30f, -1e30f, -1e30f };
+    for(unsigned axis = 0; axis < 3; axis++)
+    {
+        nodes[index].boundsMin[axis] = 1e30f;
+        nodes[index].boundsMax[axis] = -1e30f;
+    }
+
+    for(unsigned i = first; i < first + count; i++)
+    {
+        const Shape &shape = shapes[leafShapes[i]];
+        for(unsigned axis = 0; axis < 3; axis++)
+        {
+            float centre = (shape.boundsMin[axis] + shape.boundsMax[axis]) * 0.5f;
+            nodes[index].boundsMin[axis] = std::min(nodes[index].boundsMin[axis], shape.boundsMin[axis]);
+            nodes[index].boundsMax[axis] = std::max(nodes[index].boundsMax[axis], shape.boundsMax[axis]);
+            centreMin[axis] = std::min(centreMin[axis], centre);
+            centreMax[axis] = std::max(centreMax[axis], centre);
+        }
+    }
+
+    if(count <= QUERY_LEAF_SHAPES)
+    {
+        nodes[index].count = count;
+        nodes[index].data = first;
+        return;
+    }
+
+    //There are only ever a few hundred shapes and the tree is rebuilt every step, so it is just split in half along its longest side.
+    unsigned axis = 0;
+    for(unsigned i = 1; i < 3; i++)
+    {
+        if(centreMax[i] - centreMin[i] > centreMax[axis] - centreMin[axis])
+        {
+            axis = i;
+        }
+    }
+
+    unsigned half = count / 2;
+    std::vector<unsigned>::iterator begin = leafShapes.begin() + first;
+    std::nth_element(begin, begin + half, begin + count, [this, axis](unsigned a, unsigned b)
+    {
+        return shapes[a].boundsMin[axis] + shapes[a].boundsMax[axis] < shapes[b].boundsMin[axis] + shapes[b].boundsMax[axis];
+    });
+
+    buildNode(first, half);
+    unsigned right = nodes.size();
+    buildNode(first + half, count - half);
+    nodes[index].count = 0;
+    nodes[index].data = right;
+}
+
+void CollisionQuery::findShapes(const float boxMin[3], const float boxMax[3], unsigned groups, std::vector<unsigned> &found) const
+{
+    unsigned stack[MAX_STACK];
+    unsigned stackSize = 0;
+    if(!nodes.empty())
+    {
+        stack[stackSize++] = 0;
+    }
+
+    while(stackSize > 0)
+    {
+        const Node &node = nodes[stack[--stackSize]];
+        if(node.boundsMin[0] > boxMax[0] || node.boundsMax[0] < boxMin[0] ||
+           node.boundsMin[1] > boxMax[1] || node.boundsMax[1] < boxMin[1] ||
+           node.boundsMin[2] > boxMax[2] || node.boundsMax[2] < boxMin[2])
+        {
+            continue;
+        }
+
+        if(node.count == 0)
+        {
+            stack[stackSize++] = node.data;
+            stack[stackSize++] = &node - &nodes[0] + 1;
+            continue;
+        }
+
+        for(unsigned i = node.data; i < node.data + node.count; i++)
+        {
+            const Shape &shape = shapes[leafShapes[i]];
+            if((shape.groups & groups) != 0 &&
+               shape.boundsMin[0] <= boxMax[0] && shape.boundsMax[0] >= boxMin[0] &&
+               shape.boundsMin[1] <= boxMax[1] && shape.boundsMax[1] >= boxMin[1] &&
+               shape.boundsMin[2] <= boxMax[2] && shape.boundsMax[2] >= boxMin[2])
+            {
+                found.push_back(leafShapes[i]);
+            }
+        }
+    }
+
+    for(unsigned i = 0; i < halfSpaces.size(); i++)
+    {
+        if((shapes[halfSpaces[i]].groups & groups) != 0)
+        {
+            found.push_back(halfSpaces[i]);
+        }
+    }
+}
+
+bool CollisionQuery::raycast(const Vector3 &origin, const Vector3 &direction, real maxDistance, QueryHit &hit, unsigned groups) const
+{
+    return sphereCast(origin, 0, direction, maxDistance, hit, groups);
+}
+
+bool CollisionQuery::sphereCast(const Vector3 &origin, real radius, const Vector3 &direction, real maxDistance, QueryHit &hit, unsigned groups) const
+{
+    Vector3 unit = direction;
+    if(unit.squareMagnitude() <= 0)
+    {
+        return false;
+    }
+    unit.normalise();
+
+    return castSphere(origin, unit, radius, maxDistance, hit, groups, false);
+}
+
+bool CollisionQuery::castSphere(const Vector3 &origin, const Vector3 &direction, real radius, real maxDistance, QueryHit &hit, unsigned groups, bool stopAtFirst) const
+{
+    bool found = false;
+    real best = maxDistance;
+
+    float start[3];
+    float inverse[3];
+    setFloats(start, origin, 0.0f);
+    for(unsigned axis = 0; axis < 3; axis++)
+    {
+        inverse[axis] = getInverse(direction[axis]);
+    }
+    float grow = static_cast<float>(radius);
+
+    //The tree is walked nearest side first, and anything further in than the closest hit so far is skipped.
+    unsigned stack[MAX_STACK];
+    unsigned stackSize = 0;
+    if(!nodes.empty() && enterBox(start, inverse, grow, nodes[0].boundsMin, nodes[0].boundsMax, static_cast<float>(best)) >= 0.0f)
+    {
+        stack[stackSize++] = 0;
+    }
+
+    while(stackSize > 0)
+    {
+        unsigned index = stack[--stackSize];
+        const Node &node = nodes[index];
+        float furthest = static_cast<float>(best);
+
+        if(node.count == 0)
+        {
+            unsigned children[2] = { index + 1, node.data };
+            float enter[2] = { enterBox(start, inverse, grow, nodes[children[0]].boundsMin, nodes[children[0]].boundsMax, furthest),
+                               enterBox(start, inverse, grow, nodes[children[1]].boundsMin, nodes[children[1]].boundsMax, furthest) };
+            if(enter[0] >= 0.0f && enter[1] >= 0.0f && enter[0] < enter[1])
+            {
+                std::swap(children[0], children[1]);
+                std::swap(enter[0], enter[1]);
+            }
+
+            for(unsigned child = 0; child < 2; child++)
+            {
+                if(enter[child] >= 0.0f)
+                {
+                    stack[stackSize++] = children[child];
+                }
+            }
+            continue;
+        }
+
+        if(enterBox(start, inverse, grow, node.boundsMin, node.boundsMax, furthest) < 0.0f)
+        {
+            continue;
+        }
+
+        for(unsigned i = node.data; i < node.data + node.count; i++)
+        {
+            unsigned shape = leafShapes[i];
+            if((shapes[shape].groups & groups) == 0 || enterBox(start, inverse, grow, shapes[shape].boundsMin, shapes[shape].boundsMax, furthest) < 0.0f)
+            {
+                continue;
+            }
+
+            if(castSphereAtShape(shape, origin, direction, radius, best, hit, stopAtFirst))
+            {
+                found = true;
+                best = hit.distance;
+                if(stopAtFirst)
+                {
+                    return true;
+                }
+            }
+        }
+    }
+
+    for(unsigned i = 0; i < halfSpaces.size(); i++)
+    {
+        if((shapes[halfSpaces[i]].groups & groups) != 0 && castSphereAtShape(halfSpaces[i], origin, direction, radius, best, hit, stopAtFirst))
+        {
+            found = true;
+            best = hit.distance;
+            if(stopAtFirst)
+            {
+                return true;
+            }
+        }
+    }
+
+    return found;
+}
+
+bool CollisionQuery::castSphereAtShape(unsigned shape, const Vector3 &origin, const Vector3 &direction, real radius, real maxDistance, QueryHit &hit,
+                                       bool stopAtFirst) const
+{
+    const Shape &target = shapes[shape];
+    real distance = 0;
+    Vector3 normal;
+    unsigned triangle = 0;
+    bool found = false;
+
+    switch(target.type)
+    {
+        case SHAPE_SPHERE:
+        {
+            const Sphere* sphere = static_cast<const Sphere*>(target.primitive);
+            found = sweepSphere(origin, direction, sphere->getAxis(3), sphere->radius + radius, maxDistance, distance, normal);
+            break;
+        }
+        case SHAPE_BOX:
+        {
+            found = sweepBox(origin, direction, radius, *static_cast<const Box*>(target.primitive), maxDistance, distance, normal);
+            break;
+        }
+        case SHAPE_CAPSULE:
+        {
+            const Capsule* capsule = static_cast<const Capsule*>(target.primitive);
+            Vector3 top, bottom;
+            getCapsuleEnds(*capsule, top, bottom);
+            found = sweepCapsule(origin, direction, top, bottom, capsule->radius + radius, maxDistance, distance, normal);
+            break;
+        }
+        case SHAPE_HALF_SPACE:
+        {
+            found = sweepHalfSpace(origin, direction, radius, *static_cast<const Plane*>(target.primitive), maxDistance, distance, normal);
+            break;
+        }
+        case SHAPE_MESH:
+        {
+            //The mesh is only ever moved and turned, so the sweep can be done in its space without changing any distances.
+            const TriangleMesh* mesh = static_cast<const TriangleMesh*>(target.primitive);
+            SphereMeshSweep sweep(*mesh->mesh, mesh->getTransform().transformInverse(origin), mesh->getTransform().transformInverseDirection(direction), radius, stopAtFirst);
+            mesh->mesh->sweep(sweep.origin, sweep.direction, radius, maxDistance, sweep);
+
+            found = sweep.hit;
+            distance = sweep.distance;
+            normal = mesh->getTransform().transformDirection(sweep.normal);
+            triangle = sweep.triangle;
+            break;
+        }
+        default:
+            break;
+    }
+
+    if(!found)
+    {
+        return false;
+    }
+
+    hit.shape = shape;
+    hit.primitive = target.primitive;
+    hit.body = target.primitive->body;
+    hit.distance = distance;
+    hit.normal = normal;
+    hit.point = origin + direction * distance - normal * radius;
+    hit.triangle = triangle;
+    return true;
+}
+
+bool CollisionQuery::boxCast(const Vector3 &centre, const Vector3 &halfSize, const Quaternion &orientation, const Vector3 &direction, real maxDistance,
+                             QueryHit &hit, unsigned groups) const
+{
+    return boxCast(makeBox(centre, halfSize, orientation), direction, maxDistance, hit, groups);
+}
+
+bool CollisionQuery::boxCast(const Box &box, const Vector3 &direction, real maxDistance, QueryHit &hit, unsigned groups) const
+{
+    Vector3 unit = direction;
+    if(unit.squareMagnitude() <= 0)
+    {
+        return false;
+    }
+    unit.normalise();
+
+    //Everything the box's box touches on its way is a candidate.
+    Vector3 start = box.getAxis(3);
+    Vector3 end = start + unit * maxDistance;
+    Vector3 extent = getBoxExtent(box);
+    float sweptMin[3], sweptMax[3];
+    for(unsigned axis = 0; axis < 3; axis++)
+    {
+        sweptMin[axis] = static_cast<float>(std::min(start[axis], end[axis]) - extent[axis]);
+        sweptMax[axis] = static_cast<float>(std::max(start[axis], end[axis]) + extent[axis]);
+    }
+
+    std::vector<unsigned> &candidates = getCandidateList();
+    findShapes(sweptMin, sweptMax, groups, candidates);
+
+    bool found = false;
+    real best = maxDistance;
+    for(unsigned i = 0; i < candidates.size(); i++)
+    {
+        if(shapes[candidates[i]].primitive != &box && castBoxAtShape(candidates[i], box, unit, best, hit))
+        {
+            found = true;
+            best = hit.distance;
+        }
+    }
+
+    return found;
+}
+
+bool CollisionQuery::castBoxAtShape(unsigned shape, const Box &box, const Vector3 &direction, real maxDistance, QueryHit &hit) const
+{
+    const Shape &target = shapes[shape];
+    Vector3 centre = box.getAxis(3);
+
+    real distance = 0;
+    Vector3 normal;
+    Vector3 point;
+    unsigned triangle = 0;
+    switch(target.type)
+    {
+        case SHAPE_SPHERE:
+        {
+            //The sphere moving back along the line at the box touches it at the same place the box moving forward would.
+            const Sphere* sphere = static_cast<const Sphere*>(target.primitive);
+            Vector3 sphereCentre = sphere->getAxis(3);
+            if(!sweepBox(sphereCentre, direction * -1.0, sphere->radius, box, maxDistance, distance, normal))
+            {
+                return false;
+            }
+
+            normal = normal * -1.0;
+            point = sphereCentre + normal * sphere->radius;
+            break;
+        }
+        case SHAPE_BOX:
+        {
+            const Box* other = static_cast<const Box*>(target.primitive);
+            Vector3 corners[8];
+            Vector3 axes[15];
+            getBoxCorners(*other, corners);
+            for(unsigned i = 0; i < 3; i++)
+            {
+                axes[i] = box.getAxis(i);
+                axes[3 + i] = other->getAxis(i);
+                for(unsigned j = 0; j < 3; j++)
+                {
+                    axes[6 + i * 3 + j] = box.getAxis(i) % other->getAxis(j);
+                }
+            }
+
+            if(!sweepBoxAndPoints(box, direction, corners, 8, axes, 15, maxDistance, distance, normal))
+            {
+                return false;
+            }
+
+            //The contact goes on the other box's corner that reaches furthest towards this one.
+            point = corners[0];
+            for(unsigned i = 1; i < 8; i++)
+            {
+                if(corners[i] * normal > point * normal)
+                {
+                    point = corners[i];
+                }
+            }
+            break;
+        }
+        case SHAPE_CAPSULE:
+        {
+            //The box can't get closer to the capsule than it moves, so it is moved on by the gap until the gap closes.
+            const Capsule* capsule = static_cast<const Capsule*>(target.primitive);
+            Vector3 top, bottom, onSegment;
+            getCapsuleEnds(*capsule, top, bottom);
+
+            Box moved = box;
+            bool touching = false;
+            for(unsigned i = 0; i < MAX_ADVANCE_STEPS && distance <= maxDistance; i++)
+            {
+                moveBox(moved, centre + direction * distance);
+                real gap = closestPointsOnSegmentAndBox(moved, top, bottom, onSegment, point) - capsule->radius;
+                if(gap < ADVANCE_TOLERANCE)
+                {
+                    touching = true;
+                    break;
+                }
+                distance += gap;
+            }
+
+            if(!touching || distance > maxDistance)
+            {
+                return false;
+            }
+
+            normal = point - onSegment;
+            if(distance <= 0 || normal.squareMagnitude() <= real_epsilon)
+            {
+                normal = direction * -1.0;
+            }
+            normal.normalise();
+            break;
+        }
+        case SHAPE_HALF_SPACE:
+        {
+            //The box reaches as far towards the plane as its furthest corner.
+            const Plane* plane = static_cast<const Plane*>(target.primitive);
+            real radius = getBoxRadiusOnAxis(box, plane->direction);
+            if(!sweepHalfSpace(centre, direction, radius, *plane, maxDistance, distance, normal))
+            {
+                return false;
+            }
+
+            point = centre + direction * distance - plane->direction * radius;
+            break;
+        }
+        case SHAPE_MESH:
+        {
+            //The mesh's tree is walked with the sphere around the box, each triangle it finds is then tested against the box itself.
+            const TriangleMesh* mesh = static_cast<const TriangleMesh*>(target.primitive);
+            BoxMeshSweep sweep(*mesh, box, direction);
+            mesh->mesh->sweep(mesh->getTransform().transformInverse(centre), mesh->getTransform().transformInverseDirection(direction),
+                              box.halfSize.magnitude(), maxDistance, sweep);
+            if(!sweep.hit)
+            {
+                return false;
+            }
+
+            distance = sweep.distance;
+            normal = sweep.normal;
+            point = sweep.point;
+            triangle = sweep.triangle;
+            break;
+        }
+        default:
+            return false;
+    }
+
+    hit.shape = shape;
+    hit.primitive = target.primitive;
+    hit.body = target.primitive->body;
+    hit.distance = distance;
+    hit.normal = normal;
+    hit.point = point;
+    hit.triangle = triangle;
+    return true;
+}
+
+unsigned CollisionQuery::overlapSphere(const Vector3 &centre, real radius, std::vector<unsigned> &found, unsigned groups) const
+{
+    float boxMin[3], boxMax[3];
+    setFloats(boxMin, centre - Vector3(radius, radius, radius), 0.0f);
+    setFloats(boxMax, centre + Vector3(radius, radius, radius), 0.0f);
+
+    std::vector<unsigned> &candidates = getCandidateList();
+    findShapes(boxMin, boxMax, groups, candidates);
+
+    unsigned added = 0;
+    for(unsigned i = 0; i < candidates.size(); i++)
+    {
+        if(sphereOverlapsShape(candidates[i], centre, radius))
+        {
+            found.push_back(candidates[i]);
+            added++;
+        }
+    }
+
+    return added;
+}
+
+unsigned CollisionQuery::overlapBox(const Vector3 &centre, const Vector3 &halfSize, const Quaternion &orientation, std::vector<unsigned> &found, unsigned groups) const
+{
+    return overlapBox(makeBox(centre, halfSize, orientation), found, groups);
+}
+
+unsigned CollisionQuery::overlapBox(const Box &box, std::vector<unsigned> &found, unsigned groups) const
+{
+    Vector3 extent = getBoxExtent(box);
+    float boxMin[3], boxMax[3];
+    setFloats(boxMin, box.getAxis(3) - extent, 0.0f);
+    setFloats(boxMax, box.getAxis(3) + extent, 0.0f);
+
+    std::vector<unsigned> &candidates = getCandidateList();
+    findShapes(boxMin, boxMax, groups, candidates);
+
+    unsigned added = 0;
+    for(unsigned i = 0; i < candidates.size(); i++)
+    {
+        if(shapes[candidates[i]].primitive != &box && boxOverlapsShape(candidates[i], box))
+        {
+            found.push_back(candidates[i]);
+            added++;
+        }
+    }
+
+    return added;
+}
+
+bool CollisionQuery::sphereOverlapsShape(unsigned shape, const Vector3 &centre, real radius) const
+{
+    const Shape &target = shapes[shape];
+    switch(target.type)
+    {
+        case SHAPE_SPHERE:
+        {
+            const Sphere* sphere = static_cast<const Sphere*>(target.primitive);
+            real reach = sphere->radius + radius;
+            return (sphere->getAxis(3) - centre).squareMagnitude() <= reach * reach;
+        }
+        case SHAPE_BOX:
+        {
+            const Box* box = static_cast<const Box*>(target.primitive);
+            return (closestPointOnBox(*box, centre) - centre).squareMagnitude() <= radius * radius;
+        }
+        case SHAPE_CAPSULE:
+        {
+            const Capsule* capsule = static_cast<const Capsule*>(target.primitive);
+            Vector3 top, bottom;
+            getCapsuleEnds(*capsule, top, bottom);
+            real reach = capsule->radius + radius;
+            return (closestPointOnSegment(centre, top, bottom) - centre).squareMagnitude() <= reach * reach;
+        }
+        case SHAPE_HALF_SPACE:
+        {
+            const Plane* plane = static_cast<const Plane*>(target.primitive);
+            return plane->direction * centre - radius <= plane->offset;
+        }
+        case SHAPE_MESH:
+        {
+            const TriangleMesh* mesh = static_cast<const TriangleMesh*>(target.primitive);
+            std::vector<unsigned> &triangles = getMeshTriangleList();
+            findMeshTriangles(*mesh, centre, Vector3(radius, radius, radius), triangles);
+            for(unsigned i = 0; i < triangles.size(); i++)
+            {
+                Vector3 corners[3];
+                getWorldTriangle(*mesh, triangles[i], corners[0], corners[1], corners[2]);
+                if((closestPointOnTriangle(centre, corners[0], corners[1], corners[2]) - centre).squareMagnitude() <= radius * radius)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+        default:
+            return false;
+    }
+}
+
+bool CollisionQuery::boxOverlapsShape(unsigned shape, const Box &box) const
+{
+    const Shape &target = shapes[shape];
+    switch(target.type)
+    {
+        case SHAPE_SPHERE:
+        {
+            const Sphere* sphere = static_cast<const Sphere*>(target.primitive);
+            Vector3 centre = sphere->getAxis(3);
+            return (closestPointOnBox(box, centre) - centre).squareMagnitude() <= sphere->radius * sphere->radius;
+        }
+        case SHAPE_BOX:
+        {
+            return IntersectionTests::BoxAndBox(box, *static_cast<const Box*>(target.primitive));
+        }
+        case SHAPE_CAPSULE:
+        {
+            const Capsule* capsule = static_cast<const Capsule*>(target.primitive);
+            Vector3 top, bottom, onSegment, onBox;
+            getCapsuleEnds(*capsule, top, bottom);
+            return closestPointsOnSegmentAndBox(box, top, bottom, onSegment, onBox) <= capsule->radius;
+        }
+        case SHAPE_HALF_SPACE:
+        {
+            return IntersectionTests::BoxAndHalfSpace(box, *static_cast<const Plane*>(target.primitive));
+        }
+        case SHAPE_MESH:
+        {
+            const TriangleMesh* mesh = static_cast<const TriangleMesh*>(target.primitive);
+            std::vector<unsigned> &triangles = getMeshTriangleList();
+            findMeshTriangles(*mesh, box.getAxis(3), getBoxExtent(box), triangles);
+            for(unsigned i = 0; i < triangles.size(); i++)
+            {
+                Vector3 corners[3];
+                Vector3 axes[13];
+                Vector3 normal;
+                getWorldTriangle(*mesh, triangles[i], corners[0], corners[1], corners[2]);
+                getBoxTriangleAxes(box, corners, axes);
+                if(boxAndPointsOverlap(box, corners, 3, axes, 13, normal))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+        default:
+            return false;
+    }
+}
+
+unsigned CollisionQuery::raycastBatch(const QueryRay* rays, unsigned count, QueryHit* hits, unsigned groups) const
+{
+    unsigned packets = (count + PACKET_SIZE - 1) / PACKET_SIZE;
+    parallelFor(packets, MIN_PACKETS_PER_THREAD, [&](unsigned begin, unsigned end)
+    {
+        for(unsigned packet = begin; packet < end; packet++)
+        {
+            unsigned first = packet * PACKET_SIZE;
+            castPacket(rays + first, std::min(PACKET_SIZE, count - first), hits + first, groups, false);
+        }
+    });
+
+    unsigned hitCount = 0;
+    for(unsigned i = 0; i < count; i++)
+    {
+        if(hits[i].shape != QUERY_NO_SHAPE)
+        {
+            hitCount++;
+        }
+    }
+
+    return hitCount;
+}
+
+unsigned CollisionQuery::lineOfSightBatch(const QueryRay* rays, unsigned count, bool* clear, unsigned groups) const
+{
+    unsigned packets = (count + PACKET_SIZE - 1) / PACKET_SIZE;
+    parallelFor(packets, MIN_PACKETS_PER_THREAD, [&](unsigned begin, unsigned end)
+    {
+        for(unsigned packet = begin; packet < end; packet++)
+        {
+            unsigned first = packet * PACKET_SIZE;
+            unsigned packetCount = std::min(PACKET_SIZE, count - first);
+
+            QueryHit hits[PACKET_SIZE];
+            castPacket(rays + first, packetCount, hits, groups, true);
+            for(unsigned lane = 0; lane < packetCount; lane++)
+            {
+                clear[first + lane] = hits[lane].shape == QUERY_NO_SHAPE;
+            }
+        }
+    });
+
+    unsigned clearCount = 0;
+    for(unsigned i = 0; i < count; i++)
+    {
+        if(clear[i])
+        {
+            clearCount++;
+        }
+    }
+
+    return clearCount;
+}
+
+void CollisionQuery::castPacket(const QueryRay* rays, unsigned count, QueryHit* hits, unsigned groups, bool stopAtFirst) const
+{
+    //The lanes past the end of the batch are filled in with rays that can't hit anything.
+    RayPacket packet;
+    Vector3 directions[PACKET_SIZE];
+    real best[PACKET_SIZE];
+    unsigned active = 0;
+    for(unsigned lane = 0; lane < PACKET_SIZE; lane++)
+    {
+        bool used = lane < count && rays[lane].direction.squareMagnitude() > 0 && rays[lane].maxDistance >= 0;
+        if(lane < count)
+        {
+            hits[lane].shape = QUERY_NO_SHAPE;
+            hits[lane].primitive = nullptr;
+            hits[lane].body = nullptr;
+        }
+
+        Vector3 origin = used ? rays[lane].origin : Vector3();
+        directions[lane] = used ? rays[lane].direction : Vector3(1, 0, 0);
+        directions[lane].normalise();
+        best[lane] = used ? rays[lane].maxDistance : -1.0;
+
+        packet.originX[lane] = static_cast<float>(origin.x);
+        packet.originY[lane] = static_cast<float>(origin.y);
+        packet.originZ[lane] = static_cast<float>(origin.z);
+        packet.inverseX[lane] = getInverse(directions[lane].x);
+        packet.inverseY[lane] = getInverse(directions[lane].y);
+        packet.inverseZ[lane] = getInverse(directions[lane].z);
+        packet.furthest[lane] = static_cast<float>(best[lane]);
+        if(used)
+        {
+            active |= 1u << lane;
+        }
+    }
+
+    //Each ray only gets the shape tests for the leaves it goes through itself, the packet only shares the walk down the tree.
+    auto castLane = [&](unsigned lane, unsigned shape)
+    {
+        if(castSphereAtShape(shape, rays[lane].origin, directions[lane], 0, best[lane], hits[lane], stopAtFirst))
+        {
+            best[lane] = hits[lane].distance;
+            packet.furthest[lane] = static_cast<float>(best[lane]);
+            if(stopAtFirst)
+            {
+                active &= ~(1u << lane);
+                packet.furthest[lane] = -1.0f;
+            }
+        }
+    };
+
+    unsigned stack[MAX_STACK];
+    unsigned stackSize = 0;
+    if(!nodes.empty() && active != 0)
+    {
+        stack[stackSize++] = 0;
+    }
+
+    while(stackSize > 0 && active != 0)
+    {
+        unsigned index = stack[--stackSize];
+        const Node &node = nodes[index];
+        unsigned mask = packetEntersBox(packet, node.boundsMin, node.boundsMax) & active;
+        if(mask == 0)
+        {
+            continue;
+        }
+
+        if(node.count == 0)
+        {
+            stack[stackSize++] = node.data;
+            stack[stackSize++] = index + 1;
+            continue;
+        }
+
+        for(unsigned i = node.data; i < node.data + node.count; i++)
+        {
+            unsigned shape = leafShapes[i];
+            if((shapes[shape].groups & groups) == 0)
+            {
+                continue;
+            }
+
+            unsigned lanes = packetEntersBox(packet, shapes[shape].boundsMin, shapes[shape].boundsMax) & mask & active;
+            for(unsigned lane = 0; lane < PACKET_SIZE; lane++)
+            {
+                if(lanes & (1u << lane))
+                {
+                    castLane(lane, shape);
+                }
+            }
+        }
+    }
+
+    for(unsigned i = 0; i < halfSpaces.size(); i++)
+    {
+        if((shapes[halfSpaces[i]].groups & groups) == 0)
+        {
+            continue;
+        }
+
+        for(unsigned lane = 0; lane < PACKET_SIZE; lane++)
+        {
+            if(active & (1u << lane))
+            {
+                castLane(lane, halfSpaces[i]);
+            }
+        }
+    }
+}
+
+unsigned CollisionQuery::getShapeCount() const
+{
+    return shapes.size() - freeShapes.size();
+}
+
+unsigned CollisionQuery::getNodeCount() const
+{
+    return nodes.size();
+}
+
+Box CollisionQuery::makeBox(const Vector3 &centre, const Vector3 &halfSize, const Quaternion &orientation)
+{
+    //The matrix is built the same way a body builds its own, so a box made from a body's orientation lines up with it.
+    Box box;
+    box.body = nullptr;
+    box.halfSize = halfSize;
+
+    Matrix4 &transform = box.transform;
+    transform.data[0][0] = 1 - 2 * orientation.j * orientation.j - 2 * orientation.k * orientation.k;
+    transform.data[0][1] = 2 * orientation.i * orientation.j - 2 * orientation.r * orientation.k;
+    transform.data[0][2] = 2 * orientation.i * orientation.k + 2 * orientation.r * orientation.j;
+
+    transform.data[1][0] = 2 * orientation.i * orientation.j + 2 * orientation.r * orientation.k;
+    transform.data[1][1] = 1 - 2 * orientation.i * orientation.i - 2 * orientation.k * orientation.k;
+    transform.data[1][2] = 2 * orientation.j * orientation.k - 2 * orientation.r * orientation.i;
+
+    transform.data[2][0] = 2 * orientation.i * orientation.k - 2 * orientation.r * orientation.j;
+    transform.data[2][1] = 2 * orientation.j * orientation.k + 2 * orientation.r * orientation.i;
+    transform.data[2][2] = 1 - 2 * orientation.i * orientation.i - 2 * orientation.j * orientation.j;
+
+    moveBox(box, centre);
+    return box;
+}
+
+void CollisionQuery::moveBox(Box &box, const Vector3 &centre)
+{
+    box.transform.data[0][3] = centre.x;
+    box.transform.data[1][3] = centre.y;
+    box.transform.data[2][3] = centre.z;
+}
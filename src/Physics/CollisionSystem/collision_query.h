@@ -0,0 +1,248 @@
+#ifndef COLLISION_QUERY_H
+#define COLLISION_QUERY_H
+
+#include <vector>
+#include <cstdint>
+
+#include "collision_narrow.h"
+
+/**
+    The query lets game code ask the physics world questions without making contacts, like what a ray hits first,
+    where a sphere or box moving along a line would stop, or what is touching a given box.
+*/
+
+namespace wind
+{
+    //A shape added without its own groups is in all of them, and a query with this mask looks at everything.
+    const unsigned QUERY_ALL_GROUPS = 0xffffffff;
+
+    //This is returned for shapes that don't exist, and is the shape of a hit that didn't hit anything.
+    const unsigned QUERY_NO_SHAPE = 0xffffffff;
+
+    /**
+        This is one ray of a batch, the direction doesn't have to be normalised.
+    */
+    struct QueryRay
+    {
+        Vector3 origin;
+        Vector3 direction;
+        real maxDistance;
+    };
+
+    /**
+        This holds what a ray or a sweep hit first.
+    */
+    struct QueryHit
+    {
+        //The id the shape was added with.
+        unsigned shape;
+        const Primitive* primitive;
+        RigidBody* body;
+
+        //How far along the direction it got before it touched, in world units.
+        real distance;
+
+        //The point that was touched and the normal of the surface there, pointing back out towards the caster.
+        //If the cast started inside a shape the distance is zero and the normal points straight back along the direction.
+        Vector3 point;
+        Vector3 normal;
+
+        //The triangle that was hit on a mesh, it is zero for anything else.
+        unsigned triangle;
+    };
+
+    enum TriggerEventType
+    {
+        TRIGGER_ENTER,
+        TRIGGER_STAY,
+        TRIGGER_EXIT
+    };
+
+    /**
+        This says a shape came into, stayed in or left a trigger during an update.
+        The primitives are kept so an exit can still say what it was after one of the shapes has been removed.
+    */
+    struct TriggerEvent
+    {
+        TriggerEventType type;
+        unsigned trigger;
+        unsigned other;
+        const Primitive* triggerPrimitive;
+        const Primitive* otherPrimitive;
+    };
+
+    /**
+        This class keeps a list of the primitives in the world and a bounding volume tree over them.
+        The primitives aren't owned and are read where they are, so update has to be called once they have moved
+        for the step, after calculateInternals, and before anything is asked. Half spaces are infinite so they
+        are kept out of the tree and every query checks them.
+
+        Each shape is put in groups with a bit mask and every query takes a mask of the groups it looks at,
+        so a query can skip the player or only look for pickups.
+    */
+    class CollisionQuery
+    {
+        public:
+            CollisionQuery();
+
+            //These add a shape and return the id the queries give back for it.
+            unsigned addSphere(const Sphere* sphere, unsigned groups = QUERY_ALL_GROUPS);
+            unsigned addBox(const Box* box, unsigned groups = QUERY_ALL_GROUPS);
+            unsigned addCapsule(const Capsule* capsule, unsigned groups = QUERY_ALL_GROUPS);
+            unsigned addHalfSpace(const Plane* plane, unsigned groups = QUERY_ALL_GROUPS);
+            unsigned addMesh(const TriangleMesh* mesh, unsigned groups = QUERY_ALL_GROUPS);
+
+            /**
+                These add a box or sphere as a trigger. A trigger never makes contacts, it only reports the shapes in the groups
+                it watches coming into it, staying in it and leaving it. It is in no groups unless it is given some,
+                so the casts and overlaps go straight through it, and triggers never report each other.
+                The pairs come from the tree when update is called, and a pair is only tested exactly if one of the two
+                has moved since the last update, so a trigger that nothing is moving through costs nothing.
+            */
+            unsigned addTrigger(const Box* box, unsigned watchGroups, unsigned groups = 0);
+            unsigned addTrigger(const Sphere* sphere, unsigned watchGroups, unsigned groups = 0);
+
+            //The id of a removed shape is used again by the next shape that is added.
+            //Removing a shape that is in a trigger gives an exit straight away.
+            void remove(unsigned shape);
+            void clear();
+
+            const Primitive* getPrimitive(unsigned shape) const;
+            unsigned getGroups(unsigned shape) const;
+
+            //This reads where every shape is now, rebuilds the tree and finds what is in each trigger.
+            void update();
+
+            /**
+                These are the trigger events from every update since they were last cleared, in the order they happened.
+                A shape gives an enter on the first update it is in a trigger, a stay on every update after that,
+                and an exit on the first update it is out again.
+            */
+            const std::vector<TriggerEvent>& getTriggerEvents() const;
+            void clearTriggerEvents();
+
+            /**
+                These find the first thing along a line, the direction doesn't have to be normalised.
+                A sphere cast is a ray that is the radius thick, a box cast moves the box along the line without turning it.
+                A box that is itself in the query is never hit by its own cast.
+            */
+            bool raycast(const Vector3 &origin, const Vector3 &direction, real maxDistance, QueryHit &hit, unsigned groups = QUERY_ALL_GROUPS) const;
+            bool sphereCast(const Vector3 &origin, real radius, const Vector3 &direction, real maxDistance, QueryHit &hit, unsigned groups = QUERY_ALL_GROUPS) const;
+            bool boxCast(const Box &box, const Vector3 &direction, real maxDistance, QueryHit &hit, unsigned groups = QUERY_ALL_GROUPS) const;
+            bool boxCast(const Vector3 &centre, const Vector3 &halfSize, const Quaternion &orientation, const Vector3 &direction, real maxDistance,
+                         QueryHit &hit, unsigned groups = QUERY_ALL_GROUPS) const;
+
+            /**
+                These add the id of every shape touching the sphere or box to the list, the list isn't cleared first.
+                They return how many were added. Like the casts, a box that is in the query doesn't find itself.
+            */
+            unsigned overlapSphere(const Vector3 &centre, real radius, std::vector<unsigned> &found, unsigned groups = QUERY_ALL_GROUPS) const;
+            unsigned overlapBox(const Box &box, std::vector<unsigned> &found, unsigned groups = QUERY_ALL_GROUPS) const;
+            unsigned overlapBox(const Vector3 &centre, const Vector3 &halfSize, const Quaternion &orientation, std::vector<unsigned> &found,
+                                unsigned groups = QUERY_ALL_GROUPS) const;
+
+            /**
+                These cast a whole batch of rays in one go, like the line of sight checks for every AI in a frame.
+                The rays walk the tree four at a time with SIMD and big batches are split across the cores.
+                The first writes a hit for every ray and the shape of a miss is QUERY_NO_SHAPE, it returns how many hit.
+                The second only asks if anything is in the way, so each ray stops at the first thing it finds.
+                It writes true for every ray that is clear and returns how many were.
+            */
+            unsigned raycastBatch(const QueryRay* rays, unsigned count, QueryHit* hits, unsigned groups = QUERY_ALL_GROUPS) const;
+            unsigned lineOfSightBatch(const QueryRay* rays, unsigned count, bool* clear, unsigned groups = QUERY_ALL_GROUPS) const;
+
+            unsigned getShapeCount() const;
+            unsigned getNodeCount() const;
+
+        private:
+            enum ShapeType
+            {
+                SHAPE_NONE,
+                SHAPE_SPHERE,
+                SHAPE_BOX,
+                SHAPE_CAPSULE,
+                SHAPE_HALF_SPACE,
+                SHAPE_MESH
+            };
+
+            struct Shape
+            {
+                ShapeType type;
+                const Primitive* primitive;
+                unsigned groups;
+                float boundsMin[3];
+                float boundsMax[3];
+
+                //A trigger reports the shapes in its watch groups instead of being hit.
+                bool trigger;
+                unsigned watchGroups;
+
+                //Where the shape was at the last update, so the triggers can tell if it has moved since.
+                Matrix4 lastTransform;
+                bool moved;
+            };
+
+            //A trigger and a shape that were in it at the last update, the key is the trigger's id over the shape's.
+            struct TriggerPair
+            {
+                std::uint64_t key;
+                const Primitive* triggerPrimitive;
+                const Primitive* otherPrimitive;
+            };
+
+            struct Node
+            {
+                float boundsMin[3];
+                float boundsMax[3];
+                //A leaf has how many shapes it holds and where they start in the leaf list.
+                //Any other node has a count of zero and the index of its right child, the left child is always the next node.
+                unsigned count;
+                unsigned data;
+            };
+
+            unsigned addShape(ShapeType type, const Primitive* primitive, unsigned groups);
+            void buildNode(unsigned first, unsigned count);
+
+            //This finds the pairs in each trigger and adds the events for how they changed since the last update.
+            void updateTriggers();
+            bool triggerOverlapsShape(unsigned trigger, unsigned shape) const;
+            void addTriggerEvent(TriggerEventType type, const TriggerPair &pair);
+
+            //These add the shapes whose boxes touch the given box, and every half space, to the list.
+            void findShapes(const float boxMin[3], const float boxMax[3], unsigned groups, std::vector<unsigned> &found) const;
+
+            //This casts a sphere, or a ray if the radius is zero, with a normalised direction.
+            //If stopAtFirst is set it stops at the first hit it finds rather than the closest one.
+            bool castSphere(const Vector3 &origin, const Vector3 &direction, real radius, real maxDistance, QueryHit &hit, unsigned groups, bool stopAtFirst) const;
+            //A mesh stops at the first triangle it hits if stopAtFirst is set, rather than looking for the closest one.
+            bool castSphereAtShape(unsigned shape, const Vector3 &origin, const Vector3 &direction, real radius, real maxDistance, QueryHit &hit,
+                                   bool stopAtFirst) const;
+            bool castBoxAtShape(unsigned shape, const Box &box, const Vector3 &direction, real maxDistance, QueryHit &hit) const;
+
+            bool sphereOverlapsShape(unsigned shape, const Vector3 &centre, real radius) const;
+            bool boxOverlapsShape(unsigned shape, const Box &box) const;
+
+            //This walks the tree with four rays at once, the rays are already normalised.
+            void castPacket(const QueryRay* rays, unsigned count, QueryHit* hits, unsigned groups, bool stopAtFirst) const;
+
+            //This is how a box is made from a centre and orientation, the primitive's transform can only be set by a friend.
+            static Box makeBox(const Vector3 &centre, const Vector3 &halfSize, const Quaternion &orientation);
+            static void moveBox(Box &box, const Vector3 &centre);
+
+            std::vector<Shape> shapes;
+            std::vector<unsigned> freeShapes;
+            std::vector<unsigned> halfSpaces;
+
+            //The shapes in the order the leaves of the tree cover them.
+            std::vector<unsigned> leafShapes;
+            std::vector<Node> nodes;
+
+            std::vector<unsigned> triggers;
+            //The pairs in a trigger now sorted by key, and the list the next update builds before they are swapped.
+            std::vector<TriggerPair> triggerPairs;
+            std::vector<TriggerPair> nextTriggerPairs;
+            std::vector<TriggerEvent> triggerEvents;
+    };
+};
+
+#endif // COLLISION_QUERY_H
@@ -444,7 +444,8 @@ ContactResolver::ContactResolver(unsigned interations, real velocityEpsilon, rea
     positionIterations(interations),
     velocityIterations(interations),
     velocityEpsilon(velocityEpsilon),
-    positionEpsilon(positionEpsilon)
+    positionEpsilon(positionEpsilon),
+    jointIterations(10)
 {
 }
 
@@ -452,7 +453,8 @@ ContactResolver::ContactResolver(unsigned positionIterations, unsigned velocityI
     positionIterations(positionIterations),
     velocityIterations(velocityIterations),
     velocityEpsilon(velocityEpsilon),
-    positionEpsilon(positionEpsilon)
+    positionEpsilon(positionEpsilon),
+    jointIterations(10)
 {
 }
 
@@ -462,6 +464,11 @@ void ContactResolver::setEpsilon(const real &velocityEpsilon, const real &positi
 	 ContactResolver::positionEpsilon = positionEpsilon;
 }
 
+void ContactResolver::setJointIterations(unsigned jointIterations)
+{
+	ContactResolver::jointIterations = jointIterations;
+}
+
 void ContactResolver::prepareContacts(Contact* contactArray, unsigned int numContacts, real duration)
 {
     for(Contact* contact = contactArray; contact < contactArray + numContacts; contact++)
@@ -472,62 +479,92 @@ void ContactResolver::prepareContacts(Contact* contactArray, unsigned int numCon
 }
 
 void ContactResolver::adjustVelocities(Contact* contactArray, unsigned int numContacts, real duration)
+{
+	adjustVelocities(contactArray, numContacts, nullptr, 0, duration);
+}
+
+void ContactResolver::adjustVelocities(Contact* contactArray, unsigned int numContacts, Joint** jointArray, unsigned int numJoints, real duration)
 {
 	Vector3 velocityChange[2], rotationChange[2];
-	Vector3 deltaVelocity;
 	unsigned index;
 
+	//If there are joints we split the velocity iterations into blocks, each block starts by solving every joint once.
+	unsigned blocks = (numJoints > 0 && jointIterations > 0) ? jointIterations : 1;
+
 	//Like all these algorithms we start with the most severe.
 	velocityIterationsUsed = 0;
-	while(velocityIterationsUsed < velocityIterations)
-    {
-        //Here we find the biggest penetration.
-        real max = velocityEpsilon;
-        index = numContacts;
-        for(unsigned i = 0; i < numContacts; i++)
-        {
-            if(contactArray[i].desiredChangedVelocity > max)
-            {
-                max = contactArray[i].desiredChangedVelocity;
-                index = i;
-            }
-        }
+	for(unsigned block = 0; block < blocks; block++)
+	{
+		for(unsigned j = 0; j < numJoints; j++)
+		{
+			if(!jointArray[j]->active)
+			{
+				continue;
+			}
 
-        if(index == numContacts)
-        {
-           break;
-        }
+			jointArray[j]->applyVelocityChange(velocityChange, rotationChange);
+			updateContactVelocities(contactArray, numContacts, jointArray[j]->body, velocityChange, rotationChange, duration);
+		}
 
-        contactArray[index].matchAwakeState();
+		unsigned blockIterations = velocityIterations * (block + 1) / blocks;
+		while(velocityIterationsUsed < blockIterations)
+		{
+			//Here we find the biggest penetration.
+			real max = velocityEpsilon;
+			index = numContacts;
+			for(unsigned i = 0; i < numContacts; i++)
+			{
+				if(contactArray[i].desiredChangedVelocity > max)
+				{
+					max = contactArray[i].desiredChangedVelocity;
+					index = i;
+				}
+			}
 
-		//Here we do all the hard stuff resolve a collision.
-		contactArray[index].applyVelocityChange(velocityChange, rotationChange);
+			if(index == numContacts)
+			{
+			   break;
+			}
 
-		//Here we updated the ctacts when the penereation has changed run again
-		for(unsigned i = 0; i < numContacts; i++)
+			contactArray[index].matchAwakeState();
+
+			//Here we do all the hard stuff resolve a collision.
+			contactArray[index].applyVelocityChange(velocityChange, rotationChange);
+
+			//Here we updated the ctacts when the penereation has changed run again
+			updateContactVelocities(contactArray, numContacts, contactArray[index].body, velocityChange, rotationChange, duration);
+
+			velocityIterationsUsed++;
+		}
+	}
+}
+
+void ContactResolver::updateContactVelocities(Contact* contactArray, unsigned int numContacts, RigidBody* const changedBody[2], Vector3 velocityChange[2], Vector3 rotationChange[2], real duration)
+{
+	Vector3 deltaVelocity;
+
+	for(unsigned i = 0; i < numContacts; i++)
+	{
+		//check each body in the contact
+		for(unsigned j = 0; j < 2; j++)
 		{
-			//check each body in the contact
-			for(unsigned j = 0; j < 2; j++)
+			//Check to see if the the other body is live and to see with which body needs to be resolved.
+			if(contactArray[i].body[j])
 			{
-				//Check to see if the the other body is live and to see with which body needs to be resolved.
-				if(contactArray[i].body[j])
+				for(unsigned b = 0; b < 2; b++)
 				{
-					for(unsigned b = 0; b < 2; b++)
+					if(contactArray[i].body[j] == changedBody[b])
 					{
-						if(contactArray[i].body[j] == contactArray[index].body[b])
-						{
-							deltaVelocity = velocityChange[b] + rotationChange[b].vectorProduct(contactArray[i].relativeContactPosition[j]);
+						deltaVelocity = velocityChange[b] + rotationChange[b].vectorProduct(contactArray[i].relativeContactPosition[j]);
 
-							// The sign of the change is negative if we're dealing with the second body in a contact.
-							contactArray[i].contactVelocity += contactArray[i].contactToWorld.transformTranspose(deltaVelocity) * (j ? -1 : 1);
+						// The sign of the change is negative if we're dealing with the second body in a contact.
+						contactArray[i].contactVelocity += contactArray[i].contactToWorld.transformTranspose(deltaVelocity) * (j ? -1 : 1);
 
-							contactArray[i].calculateDesiredDeltaVelocity(duration);
-						}
+						contactArray[i].calculateDesiredDeltaVelocity(duration);
 					}
 				}
 			}
 		}
-		velocityIterationsUsed++;
 	}
 }
 
@@ -612,3 +649,42 @@ void ContactResolver::resolveContact(Contact* contactArray, unsigned int numCont
     //Finally we resolve the velocity problems with the contacts.
     adjustVelocities(contactArray, numContacts, duration);
 }
+
+void ContactResolver::prepareJoints(Joint** jointArray, unsigned int numJoints, Contact* contactArray, unsigned int numContacts, real duration)
+{
+	Vector3 velocityChange[2], rotationChange[2];
+
+	for(unsigned j = 0; j < numJoints; j++)
+	{
+		//The warm start changes the velocity of the bodies so the contacts need to know about it.
+		jointArray[j]->prepare(duration, velocityChange, rotationChange);
+		if(jointArray[j]->active)
+		{
+			updateContactVelocities(contactArray, numContacts, jointArray[j]->body, velocityChange, rotationChange, duration);
+		}
+	}
+}
+
+void ContactResolver::resolveContact(Contact* contactArray, unsigned int numContacts, Joint** jointArray, unsigned int numJoints, real duration)
+{
+	if(numJoints == 0)
+	{
+		resolveContact(contactArray, numContacts, duration);
+		return;
+	}
+
+	if(!isValid())
+	{
+		return;
+	}
+
+	//The contacts are prepared and moved apart first, the joints are prepared after so their errors are worked out from where the bodies ended up.
+	prepareContacts(contactArray, numContacts, duration);
+
+	adjustPositions(contactArray, numContacts, duration);
+
+	prepareJoints(jointArray, numJoints, contactArray, numContacts, duration);
+
+	//Finally the joints and contacts velocities are solved together.
+	adjustVelocities(contactArray, numContacts, jointArray, numJoints, duration);
+}
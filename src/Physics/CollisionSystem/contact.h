@@ -9,6 +9,7 @@
 #include "../include/precision.h"
 #include "../include/Core.h"
 #include "../include/Body.h"
+#include "joint.h"
 
 namespace wind
 {
@@ -144,6 +145,9 @@ namespace wind
 
 			void setIteration(const real &velocityIteration, const real &positionIteration);
 
+			//This function sets how many times the joints are solved each frame. The velocity iterations are shared out between the joint iterations.
+			void setJointIterations(unsigned jointIterations);
+
 			//Checks to see if the values are valid for the calculations.
 			bool isValid()
 			{
@@ -164,6 +168,9 @@ namespace wind
             //To avoid instability velocities we use this value to change very low numbers like 0.000001 to 0.01
             real positionEpsilon;
 
+            //This holds how many times each joint is solved in the velocity pass.
+            unsigned jointIterations;
+
             /**
                 This function sets up the contacts to be processed. Which includes the awakening the body and configuring.
             */
@@ -175,11 +182,27 @@ namespace wind
             */
             void resolveContact(Contact* contactArray, unsigned int numContacts, real duration);
 
+            /**
+                This function resolves the contacts and the joints together.
+                The joints are solved in between the contacts in the velocity pass, so the contacts always see what the joints did and the joints see what the contacts did.
+            */
+            void resolveContact(Contact* contactArray, unsigned int numContacts, Joint** jointArray, unsigned int numJoints, real duration);
+
+            /**
+                This function works out the effective masses for each joint and applies the impulse from last frame again.
+            */
+            void prepareJoints(Joint** jointArray, unsigned int numJoints, Contact* contactArray, unsigned int numContacts, real duration);
+
 			/**
                 This function works through each collision and contact point and adjust the linear and angular velocity of the rigid body
             */
 			void adjustVelocities(Contact* contactArray, unsigned int numContacts, real duration);
 
+			/**
+                This function does the same as above but it solves the joints as well, each joint iteration is followed by a share of the contact iterations.
+            */
+			void adjustVelocities(Contact* contactArray, unsigned int numContacts, Joint** jointArray, unsigned int numJoints, real duration);
+
             /**
                 This function works through each collision and contact point and adjust the linear and angular position of the rigid body
             */
@@ -189,6 +212,12 @@ namespace wind
 
             //Keeps track of the internal setting is valid
             bool valid;
+
+            /**
+                When the velocity of a body changes every contact on that body needs to know about it.
+                This function updates the contacts that touch either of the changed bodies.
+            */
+            void updateContactVelocities(Contact* contactArray, unsigned int numContacts, RigidBody* const changedBody[2], Vector3 velocityChange[2], Vector3 rotationChange[2], real duration);
     };
 
     /**
@@ -0,0 +1,530 @@
+#include "joint.h"
+
+using namespace wind;
+
+namespace
+{
+    //This function finds two directions at right angles to the axis and each other.
+    //It's the same idea as the contact basis, we build off which ever world axis is furthest from the given axis.
+    void calculatePerpendicular(const Vector3 &axis, Vector3 *one, Vector3 *two)
+    {
+        if(std::abs(axis.x) > std::abs(axis.y))
+        {
+            const real s = (real)1.0 / std::sqrt(axis.z * axis.z + axis.x * axis.x);
+            *one = Vector3(axis.z * s, 0, -axis.x * s);
+        }
+        else
+        {
+            const real s = (real)1.0 / std::sqrt(axis.z * axis.z + axis.y * axis.y);
+            *one = Vector3(0, -axis.z * s, axis.y * s);
+        }
+
+        *two = axis % (*one);
+    }
+
+    //This function inverts a 2 by 2 matrix, if it can't be inverted the result is zero so no impulse is applied.
+    void invert2(real matrix[2][2])
+    {
+        real det = matrix[0][0] * matrix[1][1] - matrix[0][1] * matrix[1][0];
+        if(std::abs(det) <= real_epsilon)
+        {
+            matrix[0][0] = matrix[0][1] = matrix[1][0] = matrix[1][1] = 0;
+            return;
+        }
+
+        real invd = (real)1.0 / det;
+        real t = matrix[0][0];
+        matrix[0][0] = matrix[1][1] * invd;
+        matrix[1][1] = t * invd;
+        matrix[0][1] = -matrix[0][1] * invd;
+        matrix[1][0] = -matrix[1][0] * invd;
+    }
+}
+
+Joint::Joint() : errorReduction((real)0.2), warmStartFactor((real)0.85), biasFactor(0), lastDuration(0), active(false)
+{
+    body[0] = body[1] = nullptr;
+    inverseMass[0] = inverseMass[1] = 0;
+}
+
+void Joint::resetWarmStart()
+{
+    clearImpulse();
+    lastDuration = 0;
+}
+
+Quaternion Joint::getOrientation(unsigned index) const
+{
+    if(body[index])
+    {
+        return body[index]->getOrientation();
+    }
+
+    return Quaternion();
+}
+
+void Joint::prepare(real duration, Vector3 velocityChange[2], Vector3 rotationChange[2])
+{
+    velocityChange[0].Clear();
+    velocityChange[1].Clear();
+    rotationChange[0].Clear();
+    rotationChange[1].Clear();
+
+    assert(body[0]);
+
+    //If one body is awake the joint will pull on the other so we need it awake as well.
+    if(body[1] && (body[0]->getAwake() ^ body[1]->getAwake()))
+    {
+        body[0]->setAwake(true);
+        body[1]->setAwake(true);
+    }
+
+    active = body[0]->getAwake();
+    if(!active)
+    {
+        return;
+    }
+
+    //Firstly we need all the body data in world space, this stays the same for the whole frame.
+    for(unsigned i = 0; i < 2; i++)
+    {
+        if(body[i] && !body[i]->hasInfiniteMass())
+        {
+            inverseMass[i] = body[i]->getInverseMass();
+            body[i]->getInverseInertiaTensorWorld(&inverseInertiaTensor[i]);
+        }
+        else
+        {
+            //Bodies that can't move are treated the same as the world, nothing we do changes their velocity.
+            inverseMass[i] = 0;
+            inverseInertiaTensor[i] = Matrix3();
+        }
+
+        if(body[i])
+        {
+            worldPosition[i] = body[i]->getPointInWorld(position[i]);
+            relativePosition[i] = worldPosition[i] - body[i]->getPosition();
+        }
+        else
+        {
+            worldPosition[i] = position[i];
+            relativePosition[i].Clear();
+        }
+    }
+
+    biasFactor = errorReduction / duration;
+
+    calculateInternals(duration);
+
+    //The impulse from last frame is a good guess for this frame, but impulses grow with time so we scale it if the frame length has changed.
+    real scale = (lastDuration > 0) ? warmStartFactor * duration / lastDuration : 0;
+    lastDuration = duration;
+
+    Vector3 velocity[2], rotation[2];
+    velocity[0] = body[0]->getVelocity();
+    rotation[0] = body[0]->getRotation();
+    if(body[1])
+    {
+        velocity[1] = body[1]->getVelocity();
+        rotation[1] = body[1]->getRotation();
+    }
+
+    warmStart(scale);
+
+    velocityChange[0] = body[0]->getVelocity() - velocity[0];
+    rotationChange[0] = body[0]->getRotation() - rotation[0];
+    if(body[1])
+    {
+        velocityChange[1] = body[1]->getVelocity() - velocity[1];
+        rotationChange[1] = body[1]->getRotation() - rotation[1];
+    }
+}
+
+void Joint::applyVelocityChange(Vector3 velocityChange[2], Vector3 rotationChange[2])
+{
+    //We keep the old velocities so we can tell the resolver how much they changed, each joint can apply more than one impulse.
+    Vector3 velocity[2], rotation[2];
+    velocity[0] = body[0]->getVelocity();
+    rotation[0] = body[0]->getRotation();
+    if(body[1])
+    {
+        velocity[1] = body[1]->getVelocity();
+        rotation[1] = body[1]->getRotation();
+    }
+
+    solveVelocity();
+
+    velocityChange[0] = body[0]->getVelocity() - velocity[0];
+    rotationChange[0] = body[0]->getRotation() - rotation[0];
+    if(body[1])
+    {
+        velocityChange[1] = body[1]->getVelocity() - velocity[1];
+        rotationChange[1] = body[1]->getRotation() - rotation[1];
+    }
+    else
+    {
+        velocityChange[1].Clear();
+        rotationChange[1].Clear();
+    }
+}
+
+void Joint::applyImpulse(const Vector3 &linear, const Vector3 &angularOne, const Vector3 &angularTwo)
+{
+    body[0]->addVelocity(linear * -inverseMass[0]);
+    body[0]->addRotation(inverseInertiaTensor[0].transform(angularOne) * -1);
+
+    if(body[1])
+    {
+        body[1]->addVelocity(linear * inverseMass[1]);
+        body[1]->addRotation(inverseInertiaTensor[1].transform(angularTwo));
+    }
+}
+
+Vector3 Joint::calculateRelativeVelocity(const Vector3 &armOne, const Vector3 &armTwo)
+{
+    Vector3 velocity;
+    if(body[1])
+    {
+        velocity = body[1]->getVelocity() + body[1]->getRotation() % armTwo;
+    }
+
+    velocity -= body[0]->getVelocity() + body[0]->getRotation() % armOne;
+    return velocity;
+}
+
+Vector3 Joint::calculateRelativeRotation()
+{
+    Vector3 rotation;
+    if(body[1])
+    {
+        rotation = body[1]->getRotation();
+    }
+
+    rotation -= body[0]->getRotation();
+    return rotation;
+}
+
+Matrix3 Joint::calculatePointMass(const Vector3 &armOne, const Vector3 &armTwo) const
+{
+    //This is the same matrix the contact friction uses, the linear part is on the diagonal and the angular part comes from the skew symmetric matrix of the arm.
+    Matrix3 pointMass;
+    pointMass.setDiagonal(inverseMass[0] + inverseMass[1], inverseMass[0] + inverseMass[1], inverseMass[0] + inverseMass[1]);
+
+    const Vector3* arm[2] = { &armOne, &armTwo };
+    for(unsigned i = 0; i < 2; i++)
+    {
+        Matrix3 impulseToTorque;
+        impulseToTorque.setSkewSymmetric(*arm[i]);
+
+        Matrix3 deltaVelWorld = impulseToTorque;
+        deltaVelWorld *= inverseInertiaTensor[i];
+        deltaVelWorld *= impulseToTorque;
+        deltaVelWorld *= -1;
+
+        pointMass += deltaVelWorld;
+    }
+
+    return pointMass;
+}
+
+Quaternion Joint::calculateRelativeOrientation()
+{
+    return getOrientation(0).conjugate() * getOrientation(1);
+}
+
+Vector3 Joint::calculateRotationError(const Quaternion &relativeOrientation)
+{
+    //This is where the second body should be if the joint was perfect.
+    Quaternion target = getOrientation(0) * relativeOrientation;
+
+    //The error is the rotation from where the second body should be to where it is.
+    Quaternion error = getOrientation(1) * target.conjugate();
+
+    //A quaternion and its negative are the same rotation, we want the short way round.
+    if(error.r < 0)
+    {
+        error.i = -error.i;
+        error.j = -error.j;
+        error.k = -error.k;
+    }
+
+    //For small angles the vector part of the quaternion is half the rotation.
+    return Vector3(error.i, error.j, error.k) * 2;
+}
+
+void BallJoint::set(RigidBody* a, const Vector3& a_pos, RigidBody* b, const Vector3& b_pos)
+{
+    body[0] = a;
+    body[1] = b;
+
+    position[0] = a_pos;
+    position[1] = b_pos;
+
+    resetWarmStart();
+}
+
+void BallJoint::calculateInternals(real duration)
+{
+    effectiveMass = calculatePointMass(relativePosition[0], relativePosition[1]).inverse();
+    bias = (worldPosition[1] - worldPosition[0]) * biasFactor;
+}
+
+void BallJoint::warmStart(real scale)
+{
+    accumulatedImpulse *= scale;
+    applyImpulse(accumulatedImpulse, relativePosition[0] % accumulatedImpulse, relativePosition[1] % accumulatedImpulse);
+}
+
+void BallJoint::solveVelocity()
+{
+    //We want the two points to move together, plus a little extra to pull them back together if they have drifted.
+    Vector3 velocity = calculateRelativeVelocity(relativePosition[0], relativePosition[1]) + bias;
+    Vector3 impulse = effectiveMass.transform(velocity) * -1;
+
+    accumulatedImpulse += impulse;
+    applyImpulse(impulse, relativePosition[0] % impulse, relativePosition[1] % impulse);
+}
+
+void BallJoint::clearImpulse()
+{
+    accumulatedImpulse.Clear();
+}
+
+void HingeJoint::set(RigidBody* a, const Vector3& a_pos, const Vector3& a_axis, RigidBody* b, const Vector3& b_pos, const Vector3& b_axis)
+{
+    body[0] = a;
+    body[1] = b;
+
+    position[0] = a_pos;
+    position[1] = b_pos;
+
+    axis[0] = a_axis;
+    axis[1] = b_axis;
+    axis[0].normalise();
+    axis[1].normalise();
+
+    resetWarmStart();
+}
+
+void HingeJoint::calculateInternals(real duration)
+{
+    //The point part is exactly the same as the ball joint.
+    pointEffectiveMass = calculatePointMass(relativePosition[0], relativePosition[1]).inverse();
+    pointBias = (worldPosition[1] - worldPosition[0]) * biasFactor;
+
+    //Next we need the hinge axis in world space for both bodies.
+    Vector3 worldAxis[2];
+    worldAxis[0] = body[0]->getDirectionInWorldSpace(axis[0]);
+    worldAxis[1] = body[1] ? body[1]->getDirectionInWorldSpace(axis[1]) : axis[1];
+    worldAxis[0].normalise();
+    worldAxis[1].normalise();
+
+    //The bodies can spin around the hinge axis but not the two directions at right angles to it.
+    calculatePerpendicular(worldAxis[0], &lockAxis[0], &lockAxis[1]);
+
+    //The angular mass in the locked directions, the cross terms are needed when the inertia tensor isn't lined up with the hinge.
+    Matrix3 inverseInertia = inverseInertiaTensor[0];
+    inverseInertia += inverseInertiaTensor[1];
+    for(unsigned i = 0; i < 2; i++)
+    {
+        for(unsigned j = 0; j < 2; j++)
+        {
+            angularEffectiveMass[i][j] = lockAxis[i] * inverseInertia.transform(lockAxis[j]);
+        }
+    }
+    invert2(angularEffectiveMass);
+
+    //The cross product of the two axes is how far the second axis has been turned away from the first.
+    Vector3 error = worldAxis[0] % worldAxis[1];
+    angularBias[0] = (error * lockAxis[0]) * biasFactor;
+    angularBias[1] = (error * lockAxis[1]) * biasFactor;
+}
+
+void HingeJoint::warmStart(real scale)
+{
+    pointImpulse *= scale;
+    angularImpulse[0] *= scale;
+    angularImpulse[1] *= scale;
+
+    Vector3 angular = lockAxis[0] * angularImpulse[0] + lockAxis[1] * angularImpulse[1];
+    applyImpulse(pointImpulse, relativePosition[0] % pointImpulse + angular, relativePosition[1] % pointImpulse + angular);
+}
+
+void HingeJoint::solveVelocity()
+{
+    //We do the angular part first because it's the part that is most likely to be wrong, the point part then gets the last word.
+    Vector3 rotation = calculateRelativeRotation();
+    real velocity[2];
+    velocity[0] = rotation * lockAxis[0] + angularBias[0];
+    velocity[1] = rotation * lockAxis[1] + angularBias[1];
+
+    real impulse[2];
+    impulse[0] = -(angularEffectiveMass[0][0] * velocity[0] + angularEffectiveMass[0][1] * velocity[1]);
+    impulse[1] = -(angularEffectiveMass[1][0] * velocity[0] + angularEffectiveMass[1][1] * velocity[1]);
+    angularImpulse[0] += impulse[0];
+    angularImpulse[1] += impulse[1];
+
+    Vector3 angular = lockAxis[0] * impulse[0] + lockAxis[1] * impulse[1];
+    applyImpulse(Vector3(), angular, angular);
+
+    Vector3 pointVelocity = calculateRelativeVelocity(relativePosition[0], relativePosition[1]) + pointBias;
+    Vector3 linear = pointEffectiveMass.transform(pointVelocity) * -1;
+
+    pointImpulse += linear;
+    applyImpulse(linear, relativePosition[0] % linear, relativePosition[1] % linear);
+}
+
+void HingeJoint::clearImpulse()
+{
+    pointImpulse.Clear();
+    angularImpulse[0] = angularImpulse[1] = 0;
+}
+
+void SliderJoint::set(RigidBody* a, const Vector3& a_pos, RigidBody* b, const Vector3& b_pos, const Vector3& a_axis)
+{
+    body[0] = a;
+    body[1] = b;
+
+    position[0] = a_pos;
+    position[1] = b_pos;
+
+    axis = a_axis;
+    axis.normalise();
+
+    relativeOrientation = calculateRelativeOrientation();
+
+    resetWarmStart();
+}
+
+void SliderJoint::calculateInternals(real duration)
+{
+    //The angular part locks all three rotations so the mass is the two inverse inertia tensors added together.
+    Matrix3 inverseInertia = inverseInertiaTensor[0];
+    inverseInertia += inverseInertiaTensor[1];
+    angularEffectiveMass = inverseInertia.inverse();
+    angularBias = calculateRotationError(relativeOrientation) * biasFactor;
+
+    //The slide axis goes with the first body.
+    Vector3 worldAxis = body[0]->getDirectionInWorldSpace(axis);
+    worldAxis.normalise();
+    calculatePerpendicular(worldAxis, &lockAxis[0], &lockAxis[1]);
+
+    //The gap between the points is allowed along the axis so the first body's arm has to reach to the second body's point.
+    Vector3 gap = worldPosition[1] - worldPosition[0];
+    slideArm = relativePosition[0] + gap;
+
+    Vector3 armOne[2], armTwo[2];
+    for(unsigned i = 0; i < 2; i++)
+    {
+        armOne[i] = slideArm % lockAxis[i];
+        armTwo[i] = relativePosition[1] % lockAxis[i];
+    }
+
+    for(unsigned i = 0; i < 2; i++)
+    {
+        for(unsigned j = 0; j < 2; j++)
+        {
+            linearEffectiveMass[i][j] = armOne[i] * inverseInertiaTensor[0].transform(armOne[j]) +
+                                        armTwo[i] * inverseInertiaTensor[1].transform(armTwo[j]);
+        }
+        linearEffectiveMass[i][i] += inverseMass[0] + inverseMass[1];
+    }
+    invert2(linearEffectiveMass);
+
+    linearBias[0] = (gap * lockAxis[0]) * biasFactor;
+    linearBias[1] = (gap * lockAxis[1]) * biasFactor;
+}
+
+void SliderJoint::warmStart(real scale)
+{
+    angularImpulse *= scale;
+    linearImpulse[0] *= scale;
+    linearImpulse[1] *= scale;
+
+    Vector3 linear = lockAxis[0] * linearImpulse[0] + lockAxis[1] * linearImpulse[1];
+    applyImpulse(linear, slideArm % linear + angularImpulse, relativePosition[1] % linear + angularImpulse);
+}
+
+void SliderJoint::solveVelocity()
+{
+    //Firstly we stop the bodies spinning against each other.
+    Vector3 rotation = calculateRelativeRotation() + angularBias;
+    Vector3 angular = angularEffectiveMass.transform(rotation) * -1;
+
+    angularImpulse += angular;
+    applyImpulse(Vector3(), angular, angular);
+
+    //Then we stop them moving apart in any direction but the axis.
+    Vector3 pointVelocity = calculateRelativeVelocity(slideArm, relativePosition[1]);
+    real velocity[2];
+    velocity[0] = pointVelocity * lockAxis[0] + linearBias[0];
+    velocity[1] = pointVelocity * lockAxis[1] + linearBias[1];
+
+    real impulse[2];
+    impulse[0] = -(linearEffectiveMass[0][0] * velocity[0] + linearEffectiveMass[0][1] * velocity[1]);
+    impulse[1] = -(linearEffectiveMass[1][0] * velocity[0] + linearEffectiveMass[1][1] * velocity[1]);
+    linearImpulse[0] += impulse[0];
+    linearImpulse[1] += impulse[1];
+
+    Vector3 linear = lockAxis[0] * impulse[0] + lockAxis[1] * impulse[1];
+    applyImpulse(linear, slideArm % linear, relativePosition[1] % linear);
+}
+
+void SliderJoint::clearImpulse()
+{
+    angularImpulse.Clear();
+    linearImpulse[0] = linearImpulse[1] = 0;
+}
+
+void FixedJoint::set(RigidBody* a, const Vector3& a_pos, RigidBody* b, const Vector3& b_pos)
+{
+    body[0] = a;
+    body[1] = b;
+
+    position[0] = a_pos;
+    position[1] = b_pos;
+
+    relativeOrientation = calculateRelativeOrientation();
+
+    resetWarmStart();
+}
+
+void FixedJoint::calculateInternals(real duration)
+{
+    pointEffectiveMass = calculatePointMass(relativePosition[0], relativePosition[1]).inverse();
+    pointBias = (worldPosition[1] - worldPosition[0]) * biasFactor;
+
+    Matrix3 inverseInertia = inverseInertiaTensor[0];
+    inverseInertia += inverseInertiaTensor[1];
+    angularEffectiveMass = inverseInertia.inverse();
+    angularBias = calculateRotationError(relativeOrientation) * biasFactor;
+}
+
+void FixedJoint::warmStart(real scale)
+{
+    pointImpulse *= scale;
+    angularImpulse *= scale;
+
+    applyImpulse(pointImpulse, relativePosition[0] % pointImpulse + angularImpulse, relativePosition[1] % pointImpulse + angularImpulse);
+}
+
+void FixedJoint::solveVelocity()
+{
+    Vector3 rotation = calculateRelativeRotation() + angularBias;
+    Vector3 angular = angularEffectiveMass.transform(rotation) * -1;
+
+    angularImpulse += angular;
+    applyImpulse(Vector3(), angular, angular);
+
+    Vector3 pointVelocity = calculateRelativeVelocity(relativePosition[0], relativePosition[1]) + pointBias;
+    Vector3 linear = pointEffectiveMass.transform(pointVelocity) * -1;
+
+    pointImpulse += linear;
+    applyImpulse(linear, relativePosition[0] % linear, relativePosition[1] % linear);
+}
+
+void FixedJoint::clearImpulse()
+{
+    pointImpulse.Clear();
+    angularImpulse.Clear();
+}
@@ -0,0 +1,239 @@
+#ifndef JOINT_H
+#define JOINT_H
+
+#include "../include/precision.h"
+#include "../include/Core.h"
+#include "../include/Body.h"
+
+/**
+    This file holds the joints that keep rigid bodies stuck together.
+    Unlike the Joints contact generator in Links.h these are proper constraints, they are solved with impulses by the contact resolver in the same pass as the contacts.
+
+    Each frame the resolver asks every joint to work out its effective masses once, these don't change during the iterations so the solve step is cheap.
+    The joints keep the impulse they used last frame and apply it again at the start of the next one (warm starting).
+    This means an articulated rig only needs a few iterations a frame to stay together.
+
+    The second body can be null, in that case the joint is attached to the world and the second anchor is given in world space.
+*/
+namespace wind
+{
+    class Joint
+    {
+        friend class ContactResolver;
+
+        public:
+            //The 2 rigid bodies that are joined, the second one can be null to join the first body to the world.
+            RigidBody* body[2];
+
+            //The position of the joint on each body in the body's local space.
+            //If the second body is null the second position is in world space.
+            Vector3 position[2];
+
+            //How much of the joint error is removed each frame, 0 leaves the error alone and 1 tries to remove it all in one frame.
+            //Around 0.2 is stable, higher values can start to jitter.
+            real errorReduction;
+
+            //How much of last frame's impulse is used to start this frame. Using all of it can overshoot on long stiff chains.
+            real warmStartFactor;
+
+            Joint();
+            virtual ~Joint(){}
+
+            //This function clears the impulse kept for warm starting, call it if you teleport one of the bodies.
+            void resetWarmStart();
+
+        protected:
+            //The inverse mass of each body, zero if the body has infinite mass or there is no body.
+            real inverseMass[2];
+
+            //The inverse inertia tensor of each body in world space.
+            Matrix3 inverseInertiaTensor[2];
+
+            //The joint position on each body in world space.
+            Vector3 worldPosition[2];
+
+            //The joint position relative to the centre of each body in world space.
+            Vector3 relativePosition[2];
+
+            //This is how fast the joint error is removed, it's errorReduction over the duration.
+            real biasFactor;
+
+            //The duration of the last frame, the warm start impulse is scaled if the frame length changes.
+            real lastDuration;
+
+            //If both bodies are asleep the joint is skipped for this frame.
+            bool active;
+
+            /**
+                This function works out the data shared by every joint and then calls calculateInternals.
+                After that the impulse from last frame is applied again, the change in velocity this causes is returned like applyVelocityChange.
+                This function should never be called manually.
+            */
+            void prepare(real duration, Vector3 velocityChange[2], Vector3 rotationChange[2]);
+
+            /**
+                This function runs one iteration of the joint and returns how much the velocity of each body changed.
+                The resolver uses the change to update the contacts that share a body with this joint.
+            */
+            void applyVelocityChange(Vector3 velocityChange[2], Vector3 rotationChange[2]);
+
+            //This function is for each joint to work out and keep its effective masses and errors.
+            virtual void calculateInternals(real duration) = 0;
+
+            //This function scales the impulse kept from last frame and applies it to the bodies.
+            virtual void warmStart(real scale) = 0;
+
+            //This function is one iteration of the joint, it applies what ever impulse is needed to the bodies.
+            virtual void solveVelocity() = 0;
+
+            //This function clears the impulse kept from last frame for each joint.
+            virtual void clearImpulse() = 0;
+
+            /**
+                This function applies an impulse to both bodies, the linear impulse and the angular impulses are added to the second body and taken away from the first.
+                The angular impulses are already crossed with the lever arm so the slider can use a different arm on each body.
+            */
+            void applyImpulse(const Vector3 &linear, const Vector3 &angularOne, const Vector3 &angularTwo);
+
+            //This function returns the velocity of the second body's point minus the first body's point.
+            Vector3 calculateRelativeVelocity(const Vector3 &armOne, const Vector3 &armTwo);
+
+            //This function returns the angular velocity of the second body minus the first body.
+            Vector3 calculateRelativeRotation();
+
+            //This function returns the matrix that turns a linear impulse at the two arms into a change in relative velocity.
+            Matrix3 calculatePointMass(const Vector3 &armOne, const Vector3 &armTwo) const;
+
+            //This function returns the world space rotation that is needed to take the first body's target orientation onto the second body.
+            Vector3 calculateRotationError(const Quaternion &relativeOrientation);
+
+            //This function works out the relative orientation of the bodies so the current orientation becomes the rest orientation.
+            Quaternion calculateRelativeOrientation();
+
+            //Returns the orientation of a body, or no rotation for the world.
+            Quaternion getOrientation(unsigned index) const;
+    };
+
+    /**
+        The ball joint keeps the two points together but lets the bodies spin freely around it.
+    */
+    class BallJoint : public Joint
+    {
+        public:
+            void set(RigidBody* a, const Vector3& a_pos, RigidBody* b, const Vector3& b_pos);
+
+        protected:
+            virtual void calculateInternals(real duration);
+            virtual void warmStart(real scale);
+            virtual void solveVelocity();
+            virtual void clearImpulse();
+
+            //The inverse of the point mass, turns a change in velocity into an impulse.
+            Matrix3 effectiveMass;
+
+            //The velocity we want to remove the error.
+            Vector3 bias;
+
+            //The impulse added up over this frame, it's used to warm start the next frame.
+            Vector3 accumulatedImpulse;
+    };
+
+    /**
+        The hinge joint is a ball joint that can only spin around one axis, like a door or a wheel.
+    */
+    class HingeJoint : public Joint
+    {
+        public:
+            //Each axis is given in the local space of its body and the axes should line up at the start.
+            void set(RigidBody* a, const Vector3& a_pos, const Vector3& a_axis, RigidBody* b, const Vector3& b_pos, const Vector3& b_axis);
+
+            //The hinge axis in the local space of each body.
+            Vector3 axis[2];
+
+        protected:
+            virtual void calculateInternals(real duration);
+            virtual void warmStart(real scale);
+            virtual void solveVelocity();
+            virtual void clearImpulse();
+
+            //The point part of the joint.
+            Matrix3 pointEffectiveMass;
+            Vector3 pointBias;
+            Vector3 pointImpulse;
+
+            //The two world directions that the bodies are not allowed to spin around.
+            Vector3 lockAxis[2];
+
+            //The 2 by 2 inverse angular mass for the locked directions.
+            real angularEffectiveMass[2][2];
+            real angularBias[2];
+            real angularImpulse[2];
+    };
+
+    /**
+        The slider joint only lets the bodies move along one axis and doesn't let them spin at all, like a piston.
+    */
+    class SliderJoint : public Joint
+    {
+        public:
+            //The axis is given in the local space of the first body, the current orientation becomes the rest orientation.
+            void set(RigidBody* a, const Vector3& a_pos, RigidBody* b, const Vector3& b_pos, const Vector3& a_axis);
+
+            //The axis the bodies can slide along in the local space of the first body.
+            Vector3 axis;
+
+        protected:
+            virtual void calculateInternals(real duration);
+            virtual void warmStart(real scale);
+            virtual void solveVelocity();
+            virtual void clearImpulse();
+
+            //The orientation of the second body relative to the first when the joint was set.
+            Quaternion relativeOrientation;
+
+            //The angular part of the joint, which locks all three rotations.
+            Matrix3 angularEffectiveMass;
+            Vector3 angularBias;
+            Vector3 angularImpulse;
+
+            //The two world directions the bodies can't slide in.
+            Vector3 lockAxis[2];
+
+            //The lever arm on the first body, the first body's point to the second body's point is included so the bodies turn the right way.
+            Vector3 slideArm;
+
+            //The 2 by 2 inverse mass for the locked directions.
+            real linearEffectiveMass[2][2];
+            real linearBias[2];
+            real linearImpulse[2];
+    };
+
+    /**
+        The fixed joint welds two bodies together, nothing can move.
+    */
+    class FixedJoint : public Joint
+    {
+        public:
+            //The current orientation of the bodies becomes the rest orientation.
+            void set(RigidBody* a, const Vector3& a_pos, RigidBody* b, const Vector3& b_pos);
+
+        protected:
+            virtual void calculateInternals(real duration);
+            virtual void warmStart(real scale);
+            virtual void solveVelocity();
+            virtual void clearImpulse();
+
+            //The orientation of the second body relative to the first when the joint was set.
+            Quaternion relativeOrientation;
+
+            Matrix3 pointEffectiveMass;
+            Vector3 pointBias;
+            Vector3 pointImpulse;
+
+            Matrix3 angularEffectiveMass;
+            Vector3 angularBias;
+            Vector3 angularImpulse;
+    };
+};
+
+#endif // JOINT_H
@@ -0,0 +1,368 @@
+#include "FluidField.h"
+#include "parallel.h"
+
+using namespace wind;
+
+namespace
+{
+    //Clamps a grid coordinate to the grid and splits it into the lower cell and how far we are towards the next cell.
+    void gridCoord(real value, unsigned size, unsigned* low, unsigned* high, real* blend)
+    {
+        real maxValue = static_cast<real>(size - 1);
+        value = value < 0 ? 0 : (value > maxValue ? maxValue : value);
+
+        *low = static_cast<unsigned>(value);
+        *high = (*low + 1 < size) ? *low + 1 : *low;
+        *blend = value - static_cast<real>(*low);
+    }
+
+    //This is the same blend as AeroControl, the control picks between the min, base and max tensor.
+    Matrix3 controlTensor(const Matrix3 &min, const Matrix3 &base, const Matrix3 &max, real control)
+    {
+        if(control <= -1)
+        {
+            return min;
+        }
+        else if(control >= 1)
+        {
+            return max;
+        }
+        else if(control < 0)
+        {
+            return Matrix3::linearInterpolate(min, base, control + 1);
+        }
+        else if(control > 0)
+        {
+            return Matrix3::linearInterpolate(base, max, control);
+        }
+
+        return base;
+    }
+}
+
+WindField::WindField(const Vector3 &origin, real cellSize, unsigned width, unsigned height, unsigned depth)
+{
+    setSize(origin, cellSize, width, height, depth);
+}
+
+void WindField::setSize(const Vector3 &origin, real cellSize, unsigned width, unsigned height, unsigned depth)
+{
+    assert(cellSize > 0.0);
+    assert(width > 0 && height > 0 && depth > 0);
+
+    WindField::origin = origin;
+    inverseCellSize = static_cast<real>(1.0) / cellSize;
+    WindField::width = width;
+    WindField::height = height;
+    WindField::depth = depth;
+
+    cells.assign(width * height * depth, Vector3());
+}
+
+unsigned WindField::index(unsigned x, unsigned y, unsigned z) const
+{
+    return (z * height + y) * width + x;
+}
+
+void WindField::setWind(unsigned x, unsigned y, unsigned z, const Vector3 &wind)
+{
+    assert(x < width && y < height && z < depth);
+    cells[index(x, y, z)] = wind;
+}
+
+void WindField::fill(const Vector3 &wind)
+{
+    cells.assign(cells.size(), wind);
+}
+
+Vector3 WindField::sample(const Vector3 &point) const
+{
+    //The wind of a cell is at the centre of the cell, so we move back half a cell before we blend.
+    unsigned x[2], y[2], z[2];
+    real tx, ty, tz;
+    gridCoord((point.x - origin.x) * inverseCellSize - 0.5, width, &x[0], &x[1], &tx);
+    gridCoord((point.y - origin.y) * inverseCellSize - 0.5, height, &y[0], &y[1], &ty);
+    gridCoord((point.z - origin.z) * inverseCellSize - 0.5, depth, &z[0], &z[1], &tz);
+
+    //We blend along x first, then y and then z.
+    Vector3 wind;
+    for(unsigned k = 0; k < 2; k++)
+    {
+        Vector3 plane;
+        for(unsigned j = 0; j < 2; j++)
+        {
+            Vector3 row = cells[index(x[0], y[j], z[k])] * (1 - tx) + cells[index(x[1], y[j], z[k])] * tx;
+            plane += row * (j ? ty : 1 - ty);
+        }
+        wind += plane * (k ? tz : 1 - tz);
+    }
+
+    return wind;
+}
+
+unsigned WindField::getWidth() const
+{
+    return width;
+}
+
+unsigned WindField::getHeight() const
+{
+    return height;
+}
+
+unsigned WindField::getDepth() const
+{
+    return depth;
+}
+
+FluidField::FluidField(real waterHeight, real liquidDensity) :
+    waterHeight(waterHeight),
+    liquidDensity(liquidDensity),
+    maxThreads(0)
+{
+}
+
+void FluidField::setWaterHeight(real waterHeight)
+{
+    FluidField::waterHeight = waterHeight;
+}
+
+real FluidField::getWaterHeight() const
+{
+    return waterHeight;
+}
+
+void FluidField::setLiquidDensity(real liquidDensity)
+{
+    FluidField::liquidDensity = liquidDensity;
+}
+
+real FluidField::getLiquidDensity() const
+{
+    return liquidDensity;
+}
+
+WindField& FluidField::getWind()
+{
+    return windField;
+}
+
+void FluidField::setMaxThreads(unsigned threads)
+{
+    maxThreads = threads;
+}
+
+unsigned FluidField::findBody(RigidBody* body)
+{
+    for(unsigned i = 0; i < bodies.size(); i++)
+    {
+        if(bodies[i] == body)
+        {
+            return i;
+        }
+    }
+
+    bodies.push_back(body);
+    return bodies.size() - 1;
+}
+
+void FluidField::addBuoyancy(RigidBody* body, const Vector3 &centreOfBuoyancy, real maxDepth, real volume)
+{
+    assert(body);
+    assert(maxDepth > 0.0);
+
+    buoyancyBody.push_back(findBody(body));
+    buoyancyCentre.push_back(centreOfBuoyancy);
+    buoyancyMaxDepth.push_back(maxDepth);
+    buoyancyVolume.push_back(volume);
+}
+
+unsigned FluidField::addAero(RigidBody* body, const Matrix3 &tensor, const Vector3 &position)
+{
+    return addAeroControl(body, tensor, tensor, tensor, position);
+}
+
+unsigned FluidField::addAeroControl(RigidBody* body, const Matrix3 &base, const Matrix3 &min, const Matrix3 &max, const Vector3 &position)
+{
+    assert(body);
+
+    aeroBody.push_back(findBody(body));
+    aeroPosition.push_back(position);
+    aeroTensor.push_back(base);
+    aeroMinTensor.push_back(min);
+    aeroMaxTensor.push_back(max);
+    aeroControl.push_back(0);
+
+    return aeroBody.size() - 1;
+}
+
+void FluidField::setControl(unsigned aero, real value)
+{
+    assert(aero < aeroControl.size());
+    aeroControl[aero] = value;
+}
+
+void FluidField::remove(RigidBody* body)
+{
+    unsigned index = bodies.size();
+    for(unsigned i = 0; i < bodies.size(); i++)
+    {
+        if(bodies[i] == body)
+        {
+            index = i;
+            break;
+        }
+    }
+
+    //If the body was never added this has no affect.
+    if(index == bodies.size())
+    {
+        return;
+    }
+
+    //We remove the entries in place so the aero surfaces keep their order.
+    unsigned kept = 0;
+    for(unsigned i = 0; i < buoyancyBody.size(); i++)
+    {
+        if(buoyancyBody[i] == index)
+        {
+            continue;
+        }
+
+        buoyancyBody[kept] = buoyancyBody[i] > index ? buoyancyBody[i] - 1 : buoyancyBody[i];
+        buoyancyCentre[kept] = buoyancyCentre[i];
+        buoyancyMaxDepth[kept] = buoyancyMaxDepth[i];
+        buoyancyVolume[kept] = buoyancyVolume[i];
+        kept++;
+    }
+    buoyancyBody.resize(kept);
+    buoyancyCentre.resize(kept);
+    buoyancyMaxDepth.resize(kept);
+    buoyancyVolume.resize(kept);
+
+    kept = 0;
+    for(unsigned i = 0; i < aeroBody.size(); i++)
+    {
+        if(aeroBody[i] == index)
+        {
+            continue;
+        }
+
+        aeroBody[kept] = aeroBody[i] > index ? aeroBody[i] - 1 : aeroBody[i];
+        aeroPosition[kept] = aeroPosition[i];
+        aeroTensor[kept] = aeroTensor[i];
+        aeroMinTensor[kept] = aeroMinTensor[i];
+        aeroMaxTensor[kept] = aeroMaxTensor[i];
+        aeroControl[kept] = aeroControl[i];
+        kept++;
+    }
+    aeroBody.resize(kept);
+    aeroPosition.resize(kept);
+    aeroTensor.resize(kept);
+    aeroMinTensor.resize(kept);
+    aeroMaxTensor.resize(kept);
+    aeroControl.resize(kept);
+
+    bodies.erase(bodies.begin() + index);
+}
+
+void FluidField::clear()
+{
+    bodies.clear();
+
+    buoyancyBody.clear();
+    buoyancyCentre.clear();
+    buoyancyMaxDepth.clear();
+    buoyancyVolume.clear();
+
+    aeroBody.clear();
+    aeroPosition.clear();
+    aeroTensor.clear();
+    aeroMinTensor.clear();
+    aeroMaxTensor.clear();
+    aeroControl.clear();
+}
+
+void FluidField::calculateBuoyancy(unsigned begin, unsigned end)
+{
+    for(unsigned i = begin; i < end; i++)
+    {
+        const Matrix4 &transform = bodyTransform[buoyancyBody[i]];
+        Vector3 point = transform.transform(buoyancyCentre[i]);
+
+        //How much of the volume is under water, it goes in a straight line from none at max depth above the water to all of it at max depth below.
+        //Unlike the Buoyancy force generator this is never negative part way in.
+        real submerged = (waterHeight + buoyancyMaxDepth[i] - point.y) / (2 * buoyancyMaxDepth[i]);
+        submerged = submerged < 0 ? 0 : (submerged > 1 ? 1 : submerged);
+
+        buoyancyForce[i] = liquidDensity * buoyancyVolume[i] * submerged;
+        buoyancyPoint[i] = point;
+    }
+}
+
+void FluidField::calculateAero(unsigned begin, unsigned end)
+{
+    for(unsigned i = begin; i < end; i++)
+    {
+        const Matrix4 &transform = bodyTransform[aeroBody[i]];
+        Vector3 point = transform.transform(aeroPosition[i]);
+
+        //Like Aero we add the wind to the body's velocity, but the wind is sampled where the surface is.
+        Vector3 velocity = bodyVelocity[aeroBody[i]] + windField.sample(point);
+
+        //The tensor works in the body's local space, so we turn the velocity into local space and the force back out.
+        Vector3 bodyVel = transform.transformInverseDirection(velocity);
+        Matrix3 tensor = controlTensor(aeroMinTensor[i], aeroTensor[i], aeroMaxTensor[i], aeroControl[i]);
+        Vector3 bodyForce = tensor.transform(bodyVel);
+
+        aeroForce[i] = transform.transformDirection(bodyForce);
+        aeroPoint[i] = point;
+    }
+}
+
+void FluidField::updateForces(real duration)
+{
+    //Firstly we read each body once, no matter how many points or surfaces it has.
+    bodyTransform.resize(bodies.size());
+    bodyVelocity.resize(bodies.size());
+    for(unsigned i = 0; i < bodies.size(); i++)
+    {
+        bodyTransform[i] = bodies[i]->getTransform();
+        bodyVelocity[i] = bodies[i]->getVelocity();
+    }
+
+    //Next we work out all the forces, each entry only writes its own slot so this can be split over the cores.
+    buoyancyForce.resize(buoyancyBody.size());
+    buoyancyPoint.resize(buoyancyBody.size());
+    parallelFor(buoyancyBody.size(), 2048, [this](unsigned begin, unsigned end)
+    {
+        calculateBuoyancy(begin, end);
+    }, maxThreads);
+
+    aeroForce.resize(aeroBody.size());
+    aeroPoint.resize(aeroBody.size());
+    parallelFor(aeroBody.size(), 1024, [this](unsigned begin, unsigned end)
+    {
+        calculateAero(begin, end);
+    }, maxThreads);
+
+    //Finally we add the forces to the bodies, many entries can share a body so this part is done on one thread.
+    //Adding a force wakes a body up so we skip the forces that are zero.
+    for(unsigned i = 0; i < buoyancyBody.size(); i++)
+    {
+        RigidBody* body = bodies[buoyancyBody[i]];
+        if(buoyancyForce[i] > 0 && !body->hasInfiniteMass())
+        {
+            body->addForceAtPoint(Vector3(0, buoyancyForce[i], 0), buoyancyPoint[i]);
+        }
+    }
+
+    for(unsigned i = 0; i < aeroBody.size(); i++)
+    {
+        RigidBody* body = bodies[aeroBody[i]];
+        if(aeroForce[i].squareMagnitude() > 0 && !body->hasInfiniteMass())
+        {
+            body->addForceAtPoint(aeroForce[i], aeroPoint[i]);
+        }
+    }
+}
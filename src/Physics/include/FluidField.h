@@ -0,0 +1,142 @@
+#ifndef FLUIDFIELD_H_INCLUDED
+#define FLUIDFIELD_H_INCLUDED
+#include <vector>
+
+#include "Core.h"
+#include "Body.h"
+
+/**
+    This file holds the world level water and air for the rigid bodies.
+    The Buoyancy and Aero force generators each work on one body at a time, they ask for the body's transform every call and each Aero has its own wind pointer.
+    Here every buoyancy point and aero surface in the world is kept in one place and done in a single pass.
+    Each body's transform is read once a frame, the forces are worked out in flat arrays and then added to the bodies at the end.
+
+    The wind comes from a WindField, which is a 3D grid of wind speeds like a texture.
+    Every aero surface samples the grid at its own position so the whole world shares one wind.
+*/
+namespace wind
+{
+    class WindField
+    {
+        public:
+            //The grid starts at the origin and each cell is cellSize wide. Outside the grid the nearest edge cell is used.
+            //A 1 by 1 by 1 grid is the same as a single wind speed everywhere.
+            WindField(const Vector3 &origin = Vector3(), real cellSize = 1.0, unsigned width = 1, unsigned height = 1, unsigned depth = 1);
+
+            //This function resizes the grid, all the cells are set back to no wind.
+            void setSize(const Vector3 &origin, real cellSize, unsigned width, unsigned height, unsigned depth);
+
+            //Sets the wind in one cell of the grid.
+            void setWind(unsigned x, unsigned y, unsigned z, const Vector3 &wind);
+
+            //Sets every cell of the grid to the same wind.
+            void fill(const Vector3 &wind);
+
+            //Returns the wind at a point in world space, it blends between the 8 cells around the point.
+            Vector3 sample(const Vector3 &point) const;
+
+            unsigned getWidth() const;
+            unsigned getHeight() const;
+            unsigned getDepth() const;
+
+        protected:
+            //Returns where in the grid the wind of a cell is.
+            unsigned index(unsigned x, unsigned y, unsigned z) const;
+
+            Vector3 origin;
+            real inverseCellSize;
+            unsigned width;
+            unsigned height;
+            unsigned depth;
+
+            //The wind of each cell, x runs fastest then y then z.
+            std::vector<Vector3> cells;
+    };
+
+    class FluidField
+    {
+        public:
+            //The water is a flat plane at the water height. The liquid density has the default value of the liquid density of water.
+            FluidField(real waterHeight = 0.0, real liquidDensity = 1000.0);
+
+            void setWaterHeight(real waterHeight);
+            real getWaterHeight() const;
+
+            void setLiquidDensity(real liquidDensity);
+            real getLiquidDensity() const;
+
+            //Returns the wind grid shared by all the aero surfaces.
+            WindField& getWind();
+
+            /**
+                Adds a point of buoyancy to a body, the same as the Buoyancy force generator.
+                The centre of buoyancy is in the body's local space.
+                The body is fully under water when the point is max depth below the water and out of the water when it's max depth above.
+            */
+            void addBuoyancy(RigidBody* body, const Vector3 &centreOfBuoyancy, real maxDepth, real volume);
+
+            /**
+                Adds an aerodynamic surface to a body, the same as the Aero force generator but the wind comes from the wind field.
+                Returns the index of the surface which is used to set its control.
+            */
+            unsigned addAero(RigidBody* body, const Matrix3 &tensor, const Vector3 &position);
+
+            //This is the same as addAero but with the min and max tensors of AeroControl.
+            unsigned addAeroControl(RigidBody* body, const Matrix3 &base, const Matrix3 &min, const Matrix3 &max, const Vector3 &position);
+
+            //This function sets the control of an aero surface, -1 uses the min tensor, 0 the base tensor and 1 the max tensor.
+            void setControl(unsigned aero, real value);
+
+            //Removes everything that was added for a body.
+            //Note: This moves the index of any aero surface added after the body's surfaces.
+            void remove(RigidBody* body);
+
+            //Removes everything, this will not delete the rigid bodies.
+            void clear();
+
+            //Sets the max number of threads used to work out the forces, 0 means use every core.
+            void setMaxThreads(unsigned threads);
+
+            //This function works out the buoyancy and aero forces for every body and adds them.
+            void updateForces(real duration);
+
+        protected:
+            //This finds the body in the body list or adds it.
+            unsigned findBody(RigidBody* body);
+
+            //These work out the forces for a range of entries, each entry only writes its own force.
+            void calculateBuoyancy(unsigned begin, unsigned end);
+            void calculateAero(unsigned begin, unsigned end);
+
+            real waterHeight;
+            real liquidDensity;
+            unsigned maxThreads;
+
+            WindField windField;
+
+            //Every body used by the field, each body's transform and velocity is read into these once a frame.
+            std::vector<RigidBody*> bodies;
+            std::vector<Matrix4> bodyTransform;
+            std::vector<Vector3> bodyVelocity;
+
+            //The buoyancy points, each array has one value per point.
+            std::vector<unsigned> buoyancyBody;
+            std::vector<Vector3> buoyancyCentre;
+            std::vector<real> buoyancyMaxDepth;
+            std::vector<real> buoyancyVolume;
+            std::vector<real> buoyancyForce;
+            std::vector<Vector3> buoyancyPoint;
+
+            //The aero surfaces, each array has one value per surface.
+            std::vector<unsigned> aeroBody;
+            std::vector<Vector3> aeroPosition;
+            std::vector<Matrix3> aeroTensor;
+            std::vector<Matrix3> aeroMinTensor;
+            std::vector<Matrix3> aeroMaxTensor;
+            std::vector<real> aeroControl;
+            std::vector<Vector3> aeroForce;
+            std::vector<Vector3> aeroPoint;
+    };
+};
+
+#endif // FLUIDFIELD_H_INCLUDED
@@ -6,6 +6,7 @@
 /**
 	This class is an extension to the rigid body class.
 	It allows rigid bodys to remain suck together. 
+	Note: This only works like a ball joint and it fights the penetration resolver, use the joints in joint.h for anything else.
 */
 namespace wind
 {
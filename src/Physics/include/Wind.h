@@ -12,6 +12,9 @@
 //Force generators.
 #include "pfgen.h"
 #include "ForceGen.h"
+#include "FluidField.h"
+#include "pgravity.h"
+#include "pfluid.h"
 //Mass aggregate files.
 #include "pcontact.h"
 #include "plinks.h"
@@ -22,5 +25,6 @@
 #include "../CollisionSystem/collision_broad.h"
 #include "../CollisionSystem/collision_narrow.h"
 #include "../CollisionSystem/contact.h"
+#include "../CollisionSystem/joint.h"
 
 #endif // CYCLONE_H_INCLUDED
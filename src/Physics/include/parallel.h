@@ -0,0 +1,82 @@
+#ifndef PARALLEL_H_INCLUDED
+#define PARALLEL_H_INCLUDED
+
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+/**
+    This file holds a very small helper for splitting a loop across the CPU cores.
+    Each thread gets one contiguous chunk of the range so there is no shared work queue or locking.
+    The function passed in must only write to data owned by its own chunk.
+*/
+
+namespace wind
+{
+    //Returns how many threads we should use for a loop of a given size.
+    //We never go wider than the number of cores and we never give a thread less than the minimum chunk.
+    inline unsigned parallelThreadCount(unsigned count, unsigned minPerThread, unsigned maxThreads = 0)
+    {
+        unsigned cores = std::thread::hardware_concurrency();
+        if(cores == 0)
+        {
+            cores = 1;
+        }
+
+        if(maxThreads != 0)
+        {
+            cores = std::min(cores, maxThreads);
+        }
+
+        if(minPerThread == 0)
+        {
+            minPerThread = 1;
+        }
+
+        unsigned threads = count / minPerThread;
+        return std::max(1u, std::min(cores, threads));
+    }
+
+    //Runs func(begin, end) across the range [0, count).
+    //The calling thread always takes the first chunk, so small loops never spawn a thread.
+    template<typename Func>
+    void parallelFor(unsigned count, unsigned minPerThread, Func func, unsigned maxThreads = 0)
+    {
+        if(count == 0)
+        {
+            return;
+        }
+
+        unsigned threads = parallelThreadCount(count, minPerThread, maxThreads);
+        if(threads == 1)
+        {
+            func(0u, count);
+            return;
+        }
+
+        unsigned chunk = (count + threads - 1) / threads;
+
+        std::vector<std::thread> workers;
+        workers.reserve(threads - 1);
+        for(unsigned t = 1; t < threads; t++)
+        {
+            unsigned begin = t * chunk;
+            unsigned end = std::min(count, begin + chunk);
+            if(begin >= end)
+            {
+                break;
+            }
+
+            workers.emplace_back(func, begin, end);
+        }
+
+        func(0u, std::min(count, chunk));
+
+        for(unsigned t = 0; t < workers.size(); t++)
+        {
+            workers[t].join();
+        }
+    }
+}
+
+#endif // PARALLEL_H_INCLUDED
@@ -199,3 +199,121 @@ void ParticleContactResolver::ResolveContact(ParticleContact *contactArray, unsi
 
     }
 }
+
+ParticleContactPool::ParticleContactPool(unsigned size) :
+    mContacts(nullptr),
+    mSize(size),
+    mUsed(0),
+    mRequested(0),
+    mDropped(0),
+    mTotalDropped(0),
+    mPeakUsed(0),
+    mPeakRequested(0),
+    mGrowCount(0),
+    mCanGrow(true)
+{
+    if(mSize > 0)
+    {
+        mContacts = new ParticleContact[mSize];
+    }
+}
+
+ParticleContactPool::~ParticleContactPool()
+{
+    delete [] mContacts;
+}
+
+void ParticleContactPool::beginFrame()
+{
+    //If last frame wanted more than we have we grow now, before any contacts are handed out.
+    //We add half again on top so a scene that is slowly getting bigger doesn't grow every frame.
+    if(mCanGrow && mRequested > mSize)
+    {
+        delete [] mContacts;
+        mSize = mRequested + mRequested / 2;
+        mContacts = new ParticleContact[mSize];
+        mGrowCount++;
+    }
+
+    mUsed = 0;
+    mRequested = 0;
+    mDropped = 0;
+}
+
+ParticleContact* ParticleContactPool::reserve(unsigned requested, unsigned* granted)
+{
+    unsigned left = mSize - mUsed;
+    *granted = requested < left ? requested : left;
+    return mContacts + mUsed;
+}
+
+void ParticleContactPool::commit(unsigned requested, unsigned granted, unsigned used)
+{
+    //A generator should never write more than it was given, if it does it has written over the next slice.
+    assert(used <= granted);
+
+    mUsed += used;
+    mRequested += requested;
+
+    //If the generator was cut short and filled all it was given we might have lost contacts.
+    if(granted < requested && used == granted)
+    {
+        mDropped += requested - granted;
+        mTotalDropped += requested - granted;
+    }
+
+    if(mUsed > mPeakUsed)
+    {
+        mPeakUsed = mUsed;
+    }
+
+    if(mRequested > mPeakRequested)
+    {
+        mPeakRequested = mRequested;
+    }
+}
+
+ParticleContact* ParticleContactPool::getContacts()
+{
+    return mContacts;
+}
+
+unsigned ParticleContactPool::getUsed() const
+{
+    return mUsed;
+}
+
+unsigned ParticleContactPool::getSize() const
+{
+    return mSize;
+}
+
+unsigned ParticleContactPool::getDroppedContacts() const
+{
+    return mDropped;
+}
+
+unsigned long long ParticleContactPool::getTotalDroppedContacts() const
+{
+    return mTotalDropped;
+}
+
+unsigned ParticleContactPool::getPeakUsed() const
+{
+    return mPeakUsed;
+}
+
+unsigned ParticleContactPool::getPeakRequested() const
+{
+    return mPeakRequested;
+}
+
+unsigned ParticleContactPool::getGrowCount() const
+{
+    return mGrowCount;
+}
+
+void ParticleContactPool::setCanGrow(bool canGrow)
+{
+    mCanGrow = canGrow;
+}
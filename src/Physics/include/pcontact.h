@@ -89,6 +89,78 @@ namespace wind
         public:
             //This function means that the store the total of particles that being used in contacts.
             virtual unsigned addContact(ParticleContact* contact, unsigned limit) const = 0;
+
+            //This returns the most contacts this generator can make in one frame, the world will keep that many contacts free for it.
+            //Links and constraints only ever make one contact so that is the default.
+            virtual unsigned getMaxContacts() const { return 1; }
+    };
+
+    /**
+        This class holds all the contacts for a frame in one block of memory.
+        Each contact generator asks for the most contacts it can make and is given its own slice of the block.
+        Slices are handed out back to back and each one starts where the last generator finished, so the used contacts are always next to each other.
+
+        Nothing is allocated while contacts are being made. If a frame asks for more than the pool holds
+        the pool grows at the start of the next frame, and the missing contacts are counted so you can see it happened.
+    */
+    class ParticleContactPool
+    {
+        public:
+            ParticleContactPool(unsigned size);
+            ~ParticleContactPool();
+
+            ParticleContactPool(const ParticleContactPool&) = delete;
+            ParticleContactPool& operator=(const ParticleContactPool&) = delete;
+
+            //This starts a new frame. If the last frame ran out of room this is where we grow.
+            void beginFrame();
+
+            //Hands out the next slice. requested is the most the generator could make, granted is set to what we could give it.
+            ParticleContact* reserve(unsigned requested, unsigned* granted);
+
+            //Tells the pool how many contacts of the last slice were used.
+            void commit(unsigned requested, unsigned granted, unsigned used);
+
+            //Returns the start of this frame's contacts and how many were used.
+            ParticleContact* getContacts();
+            unsigned getUsed() const;
+
+            //Returns the number of contacts the pool holds at the moment.
+            unsigned getSize() const;
+
+            //Returns the most contacts that could have been lost this frame because a slice was smaller than the generator asked for.
+            //A generator that ran out of room might not have needed all of it, so this is an upper bound.
+            unsigned getDroppedContacts() const;
+
+            //The same as above but added up over every frame.
+            unsigned long long getTotalDroppedContacts() const;
+
+            //Returns the most contacts ever used and ever asked for in one frame.
+            unsigned getPeakUsed() const;
+            unsigned getPeakRequested() const;
+
+            //Returns how many times the pool has had to grow.
+            unsigned getGrowCount() const;
+
+            //Lets you turn off growing, so the pool stays the size it was made with like the old fixed array.
+            void setCanGrow(bool canGrow);
+
+        private:
+            ParticleContact* mContacts;
+            unsigned mSize;
+
+            //This frame's numbers.
+            unsigned mUsed;
+            unsigned mRequested;
+            unsigned mDropped;
+
+            //Numbers kept over all the frames.
+            unsigned long long mTotalDropped;
+            unsigned mPeakUsed;
+            unsigned mPeakRequested;
+            unsigned mGrowCount;
+
+            bool mCanGrow;
     };
 
 };
@@ -19,6 +19,16 @@ namespace wind
             //What this function does it is takes a particle and calculates and updates the force on the particle. This is a pure virtual function so every class that inherance this class they will have to use this function
             virtual void UpdateForce(Particle* particle, real Duration) = 0;
     };
+
+    //Some forces can't be worked out one particle at a time because they depend on every other particle, like N-body gravity or fluids.
+    //Registering these per particle would be O(n^2) virtual calls so instead they are given the whole particle list once per frame.
+    class ParticleGroupForceGenerator
+    {
+        public:
+            //This function works out and adds the force to every particle in the list.
+            virtual void UpdateForces(std::vector<Particle*>& particles, real Duration) = 0;
+    };
+
     /**Currently I don't know enough about the graviation pull to different objects
     //Rather than having a Vector3 object to define gravity that will accelerate at a constant rate.
     //We can implement as part of the force generator.
@@ -0,0 +1,202 @@
+#include "pfluid.h"
+#include "parallel.h"
+
+using namespace wind;
+
+ParticleFluid::ParticleFluid(real smoothingRadius, real restDensity, real stiffness, real viscosity) :
+    mSmoothingRadius(smoothingRadius),
+    mRestDensity(restDensity),
+    mStiffness(stiffness),
+    mViscosity(viscosity),
+    mMaxThreads(0),
+    mGrid(smoothingRadius)
+{
+    calculateKernels();
+}
+
+void ParticleFluid::calculateKernels()
+{
+    real h = mSmoothingRadius;
+    real h3 = h * h * h;
+    real h6 = h3 * h3;
+    real h9 = h6 * h3;
+
+    mPoly6 = static_cast<real>(315.0) / (static_cast<real>(64.0) * R_PI * h9);
+    mSpikyGradient = static_cast<real>(45.0) / (R_PI * h6);
+    mViscosityLaplacian = static_cast<real>(45.0) / (R_PI * h6);
+}
+
+void ParticleFluid::SetSmoothingRadius(real smoothingRadius)
+{
+    assert(smoothingRadius > 0.0);
+    mSmoothingRadius = smoothingRadius;
+    mGrid.SetCellSize(smoothingRadius);
+    calculateKernels();
+}
+
+real ParticleFluid::GetSmoothingRadius() const
+{
+    return mSmoothingRadius;
+}
+
+void ParticleFluid::SetRestDensity(real restDensity)
+{
+    mRestDensity = restDensity;
+}
+
+real ParticleFluid::GetRestDensity() const
+{
+    return mRestDensity;
+}
+
+void ParticleFluid::SetStiffness(real stiffness)
+{
+    mStiffness = stiffness;
+}
+
+real ParticleFluid::GetStiffness() const
+{
+    return mStiffness;
+}
+
+void ParticleFluid::SetViscosity(real viscosity)
+{
+    mViscosity = viscosity;
+}
+
+real ParticleFluid::GetViscosity() const
+{
+    return mViscosity;
+}
+
+void ParticleFluid::SetMaxThreads(unsigned threads)
+{
+    mMaxThreads = threads;
+}
+
+const ParticleGrid& ParticleFluid::GetGrid() const
+{
+    return mGrid;
+}
+
+void ParticleFluid::calculateDensity(unsigned begin, unsigned end)
+{
+    const real* px = mGrid.GetPositionX();
+    const real* py = mGrid.GetPositionY();
+    const real* pz = mGrid.GetPositionZ();
+    const real* mass = mGrid.GetMass();
+    const real h2 = mSmoothingRadius * mSmoothingRadius;
+
+    unsigned ranges[27][2];
+
+    for(unsigned i = begin; i < end; i++)
+    {
+        unsigned rangeCount = mGrid.GetNeighbourRanges(Vector3(px[i], py[i], pz[i]), ranges);
+        real density = 0.0;
+
+        for(unsigned r = 0; r < rangeCount; r++)
+        {
+            //This loop has no branches and runs over straight arrays so the compiler can vectorise it.
+            //Particles outside the radius just add zero.
+            for(unsigned j = ranges[r][0]; j < ranges[r][1]; j++)
+            {
+                real dx = px[i] - px[j];
+                real dy = py[i] - py[j];
+                real dz = pz[i] - pz[j];
+                real w = h2 - (dx * dx + dy * dy + dz * dz);
+                w = w > 0.0 ? w : 0.0;
+                density += mass[j] * w * w * w;
+            }
+        }
+
+        density *= mPoly6;
+        mDensity[i] = density;
+
+        //We don't let the pressure go below zero, pulling particles together makes them clump.
+        real pressure = mStiffness * (density - mRestDensity);
+        mPressure[i] = pressure > 0.0 ? pressure : 0.0;
+    }
+}
+
+void ParticleFluid::calculateForces(std::vector<Particle*>& particles, unsigned begin, unsigned end)
+{
+    const real* px = mGrid.GetPositionX();
+    const real* py = mGrid.GetPositionY();
+    const real* pz = mGrid.GetPositionZ();
+    const real* vx = mGrid.GetVelocityX();
+    const real* vy = mGrid.GetVelocityY();
+    const real* vz = mGrid.GetVelocityZ();
+    const real* mass = mGrid.GetMass();
+    const real* density = mDensity.data();
+    const real* pressure = mPressure.data();
+    const real h = mSmoothingRadius;
+    const real h2 = h * h;
+
+    unsigned ranges[27][2];
+
+    for(unsigned i = begin; i < end; i++)
+    {
+        if(density[i] <= 0.0)
+        {
+            continue;
+        }
+
+        unsigned rangeCount = mGrid.GetNeighbourRanges(Vector3(px[i], py[i], pz[i]), ranges);
+        real fx = 0.0;
+        real fy = 0.0;
+        real fz = 0.0;
+
+        for(unsigned r = 0; r < rangeCount; r++)
+        {
+            for(unsigned j = ranges[r][0]; j < ranges[r][1]; j++)
+            {
+                real dx = px[i] - px[j];
+                real dy = py[i] - py[j];
+                real dz = pz[i] - pz[j];
+                real distance2 = dx * dx + dy * dy + dz * dz;
+
+                //Adding epsilon stops a divide by zero for the particle itself, its direction is zero so it adds nothing anyway.
+                real distance = std::sqrt(distance2) + real_epsilon;
+                real hr = h - distance;
+                bool inside = distance2 < h2;
+
+                //Pressure pushes the particles apart along the line between them.
+                real pressureScale = mass[j] * (pressure[i] + pressure[j]) / (2.0 * density[j]) * mSpikyGradient * hr * hr / distance;
+                pressureScale = inside ? pressureScale : 0.0;
+
+                //Viscosity pulls the velocities together.
+                real viscosityScale = mViscosity * mass[j] / density[j] * mViscosityLaplacian * hr;
+                viscosityScale = inside ? viscosityScale : 0.0;
+
+                fx += pressureScale * dx + viscosityScale * (vx[j] - vx[i]);
+                fy += pressureScale * dy + viscosityScale * (vy[j] - vy[i]);
+                fz += pressureScale * dz + viscosityScale * (vz[j] - vz[i]);
+            }
+        }
+
+        //The sums are force per unit volume, multiplying by the particle's volume (mass / density) gives the force.
+        real volume = mass[i] / density[i];
+        particles[mGrid.GetParticleIndex(i)]->AddForce(Vector3(fx, fy, fz) * volume);
+    }
+}
+
+void ParticleFluid::UpdateForces(std::vector<Particle*>& particles, real Duration)
+{
+    mGrid.Build(particles);
+
+    unsigned count = mGrid.GetCount();
+    mDensity.resize(count);
+    mPressure.resize(count);
+
+    //The density pass has to finish before the force pass, because each force reads the neighbours' pressure.
+    //Inside each pass every particle only writes its own data so the threads never touch the same memory.
+    parallelFor(count, 512, [this](unsigned begin, unsigned end)
+    {
+        calculateDensity(begin, end);
+    }, mMaxThreads);
+
+    parallelFor(count, 512, [this, &particles](unsigned begin, unsigned end)
+    {
+        calculateForces(particles, begin, end);
+    }, mMaxThreads);
+}
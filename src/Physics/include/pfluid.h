@@ -0,0 +1,77 @@
+#ifndef PFLUID_H_INCLUDED
+#define PFLUID_H_INCLUDED
+#include <vector>
+
+#include "particle.h"
+#include "pfgen.h"
+#include "pgrid.h"
+
+/**
+    This file handles fluids made out of particles using smoothed particle hydrodynamics (SPH).
+    Unlike ParticleBuoyancy there is no flat water plane, each particle is a little blob of fluid.
+    Each frame we work out the density around every particle from its neighbours, turn the density into a pressure and push the particles apart.
+    Viscosity is added by pulling the velocity of each particle towards its neighbours.
+
+    The kernels are the ones from Muller et al. Poly6 for the density, Spiky for the pressure and the viscosity kernel for viscosity.
+*/
+
+namespace wind
+{
+    class ParticleFluid : public ParticleGroupForceGenerator
+    {
+        public:
+            //The smoothing radius is how far each particle can feel its neighbours, it should be about twice the gap between particles.
+            //The stiffness is how hard the fluid pushes back when it's squashed.
+            ParticleFluid(real smoothingRadius, real restDensity = 1000.0, real stiffness = 3.0, real viscosity = 0.1);
+
+            void SetSmoothingRadius(real smoothingRadius);
+            real GetSmoothingRadius() const;
+
+            void SetRestDensity(real restDensity);
+            real GetRestDensity() const;
+
+            void SetStiffness(real stiffness);
+            real GetStiffness() const;
+
+            void SetViscosity(real viscosity);
+            real GetViscosity() const;
+
+            //Sets the max number of threads used for the fluid passes, 0 means use every core.
+            void SetMaxThreads(unsigned threads);
+
+            //Every particle with a finite mass in the list is treated as part of the fluid.
+            virtual void UpdateForces(std::vector<Particle*>& particles, real Duration);
+
+            //Returns the neighbour grid so other systems can reuse this frame's search.
+            const ParticleGrid& GetGrid() const;
+
+        private:
+            //Works out the kernel constants whenever the smoothing radius changes.
+            void calculateKernels();
+
+            //The first pass, works out the density and pressure for the sorted particles in the range.
+            void calculateDensity(unsigned begin, unsigned end);
+
+            //The second pass, works out the pressure and viscosity forces and adds them to the particles.
+            void calculateForces(std::vector<Particle*>& particles, unsigned begin, unsigned end);
+
+            real mSmoothingRadius;
+            real mRestDensity;
+            real mStiffness;
+            real mViscosity;
+            unsigned mMaxThreads;
+
+            //The kernels constant parts, these only depend on the smoothing radius.
+            real mPoly6;
+            real mSpikyGradient;
+            real mViscosityLaplacian;
+
+            ParticleGrid mGrid;
+
+            //The density and pressure of each particle in the grid's sorted order.
+            std::vector<real> mDensity;
+            std::vector<real> mPressure;
+    };
+}
+
+#endif // PFLUID_H_INCLUDED
@@ -0,0 +1,342 @@
+#include "pgravity.h"
+#include "parallel.h"
+
+using namespace wind;
+
+ParticleGravityTree::ParticleGravityTree(real gravitationalConstant, real theta, real softening) :
+    mGravitationalConstant(gravitationalConstant),
+    mTheta(theta),
+    mSoftening(softening),
+    mMaxThreads(0)
+{
+}
+
+void ParticleGravityTree::SetGravitationalConstant(real gravitationalConstant)
+{
+    mGravitationalConstant = gravitationalConstant;
+}
+
+real ParticleGravityTree::GetGravitationalConstant() const
+{
+    return mGravitationalConstant;
+}
+
+void ParticleGravityTree::SetTheta(real theta)
+{
+    assert(theta >= 0.0);
+    mTheta = theta;
+}
+
+real ParticleGravityTree::GetTheta() const
+{
+    return mTheta;
+}
+
+void ParticleGravityTree::SetSoftening(real softening)
+{
+    mSoftening = softening;
+}
+
+real ParticleGravityTree::GetSoftening() const
+{
+    return mSoftening;
+}
+
+void ParticleGravityTree::SetMaxThreads(unsigned threads)
+{
+    mMaxThreads = threads;
+}
+
+unsigned ParticleGravityTree::GetNodeCount() const
+{
+    return mNodes.size();
+}
+
+void ParticleGravityTree::Build(const std::vector<Particle*>& particles)
+{
+    unsigned count = particles.size();
+
+    //We keep the memory from last frame, clear only resets the sizes.
+    mNodes.clear();
+    mPositions.resize(count);
+    mMasses.resize(count);
+    mNext.assign(count, -1);
+
+    //First we copy out the positions and masses and work out the box that holds all of them.
+    Vector3 minBound;
+    Vector3 maxBound;
+    bool first = true;
+    for(unsigned i = 0; i < count; i++)
+    {
+        mPositions[i] = particles[i]->GetPosition();
+
+        //Infinite mass particles don't take part, they would swallow the whole cloud.
+        if(particles[i]->GetInverseMass() <= 0.0)
+        {
+            mMasses[i] = 0.0;
+            continue;
+        }
+        mMasses[i] = particles[i]->GetMass();
+
+        if(first)
+        {
+            minBound = maxBound = mPositions[i];
+            first = false;
+            continue;
+        }
+
+        for(unsigned axis = 0; axis < 3; axis++)
+        {
+            minBound[axis] = std::min(minBound[axis], mPositions[i][axis]);
+            maxBound[axis] = std::max(maxBound[axis], mPositions[i][axis]);
+        }
+    }
+
+    if(first)
+    {
+        return;
+    }
+
+    //The root node is a cube so the children are cubes too, we pad it a little so nothing sits on the edge.
+    Node root;
+    root.centre = (minBound + maxBound) * 0.5;
+    root.halfSize = 0.0;
+    for(unsigned axis = 0; axis < 3; axis++)
+    {
+        root.halfSize = std::max(root.halfSize, (maxBound[axis] - minBound[axis]) * 0.5);
+    }
+    root.halfSize = root.halfSize * 1.001 + real_epsilon;
+    root.mass = 0.0;
+    root.firstChild = -1;
+    root.particle = -1;
+    root.depth = 0;
+    mNodes.push_back(root);
+
+    for(unsigned i = 0; i < count; i++)
+    {
+        if(mMasses[i] > 0.0)
+        {
+            insert(i);
+        }
+    }
+
+    calculateMass();
+}
+
+int ParticleGravityTree::childIndex(const Node& node, const Vector3& position) const
+{
+    int index = 0;
+    if(position.x > node.centre.x)
+    {
+        index |= 1;
+    }
+    if(position.y > node.centre.y)
+    {
+        index |= 2;
+    }
+    if(position.z > node.centre.z)
+    {
+        index |= 4;
+    }
+
+    return index;
+}
+
+void ParticleGravityTree::subdivide(int node)
+{
+    int first = mNodes.size();
+    real quarter = mNodes[node].halfSize * 0.5;
+
+    for(int i = 0; i < 8; i++)
+    {
+        Node child;
+        child.centre = mNodes[node].centre;
+        child.centre.x += (i & 1) ? quarter : -quarter;
+        child.centre.y += (i & 2) ? quarter : -quarter;
+        child.centre.z += (i & 4) ? quarter : -quarter;
+        child.halfSize = quarter;
+        child.mass = 0.0;
+        child.firstChild = -1;
+        child.particle = -1;
+        child.depth = mNodes[node].depth + 1;
+
+        //Note: Don't hold a reference to a node over this push_back, the vector might move.
+        mNodes.push_back(child);
+    }
+
+    mNodes[node].firstChild = first;
+}
+
+void ParticleGravityTree::insert(int index)
+{
+    int node = 0;
+
+    while(true)
+    {
+        //If we are at a branch we just walk down into the right child.
+        if(mNodes[node].firstChild != -1)
+        {
+            node = mNodes[node].firstChild + childIndex(mNodes[node], mPositions[index]);
+            continue;
+        }
+
+        //An empty leaf simply takes the particle.
+        if(mNodes[node].particle == -1)
+        {
+            mNodes[node].particle = index;
+            return;
+        }
+
+        //If the leaf is full and we are too deep we chain the particle onto the leaf.
+        if(mNodes[node].depth >= MAX_DEPTH)
+        {
+            mNext[index] = mNodes[node].particle;
+            mNodes[node].particle = index;
+            return;
+        }
+
+        //Otherwise we split the leaf and push the old particle down a level, then try again.
+        int old = mNodes[node].particle;
+        mNodes[node].particle = -1;
+        subdivide(node);
+
+        int child = mNodes[node].firstChild + childIndex(mNodes[node], mPositions[old]);
+        mNodes[child].particle = old;
+    }
+}
+
+void ParticleGravityTree::calculateMass()
+{
+    //Children are always added after their parent, so going backwards means the children are done first.
+    for(int n = static_cast<int>(mNodes.size()) - 1; n >= 0; n--)
+    {
+        Node& node = mNodes[n];
+        Vector3 weighted;
+        real mass = 0.0;
+
+        if(node.firstChild == -1)
+        {
+            for(int p = node.particle; p != -1; p = mNext[p])
+            {
+                weighted.addScaledVector(mPositions[p], mMasses[p]);
+                mass += mMasses[p];
+            }
+        }
+        else
+        {
+            for(int c = node.firstChild; c < node.firstChild + 8; c++)
+            {
+                weighted.addScaledVector(mNodes[c].centreOfMass, mNodes[c].mass);
+                mass += mNodes[c].mass;
+            }
+        }
+
+        node.mass = mass;
+        if(mass > 0.0)
+        {
+            node.centreOfMass = weighted * (static_cast<real>(1.0) / mass);
+        }
+        else
+        {
+            node.centreOfMass = node.centre;
+        }
+    }
+}
+
+Vector3 ParticleGravityTree::CalculateForce(unsigned index) const
+{
+    Vector3 force;
+    if(mNodes.empty() || mMasses[index] <= 0.0)
+    {
+        return force;
+    }
+
+    const Vector3& position = mPositions[index];
+    const real softening2 = mSoftening * mSoftening;
+    const real theta2 = mTheta * mTheta;
+
+    //We walk the tree with our own stack rather than recursion, each level can add at most eight nodes.
+    int stack[8 * (MAX_DEPTH + 1)];
+    int top = 0;
+    stack[top++] = 0;
+
+    while(top > 0)
+    {
+        const Node& node = mNodes[stack[--top]];
+        if(node.mass <= 0.0)
+        {
+            continue;
+        }
+
+        if(node.firstChild == -1)
+        {
+            //At a leaf we add each particle one by one, skipping ourselves.
+            for(int p = node.particle; p != -1; p = mNext[p])
+            {
+                if(p == static_cast<int>(index))
+                {
+                    continue;
+                }
+
+                Vector3 direction = mPositions[p] - position;
+                real distance2 = direction.squareMagnitude() + softening2;
+                if(distance2 <= 0.0)
+                {
+                    continue;
+                }
+
+                real inverseDistance = static_cast<real>(1.0) / std::sqrt(distance2);
+                force.addScaledVector(direction, mMasses[p] * inverseDistance * inverseDistance * inverseDistance);
+            }
+            continue;
+        }
+
+        Vector3 direction = node.centreOfMass - position;
+        real distance2 = direction.squareMagnitude();
+        real size = node.halfSize * 2.0;
+
+        //This is the opening test, s / d < theta. We square both sides so we don't need a square root.
+        if(size * size < theta2 * distance2)
+        {
+            distance2 += softening2;
+            real inverseDistance = static_cast<real>(1.0) / std::sqrt(distance2);
+            force.addScaledVector(direction, node.mass * inverseDistance * inverseDistance * inverseDistance);
+            continue;
+        }
+
+        for(int c = node.firstChild; c < node.firstChild + 8; c++)
+        {
+            if(mNodes[c].mass > 0.0)
+            {
+                stack[top++] = c;
+            }
+        }
+    }
+
+    //F = G * m1 * m2 / r^2, we have summed m2 * r / |r|^3 so we just need to scale by G * m1.
+    force *= mGravitationalConstant * mMasses[index];
+    return force;
+}
+
+void ParticleGravityTree::UpdateForces(std::vector<Particle*>& particles, real Duration)
+{
+    Build(particles);
+
+    if(mNodes.empty())
+    {
+        return;
+    }
+
+    //Building the tree is serial but the walk only reads the tree, so each thread can take a chunk of particles.
+    //Each particle is only touched by one thread so adding the force straight away is safe.
+    parallelFor(particles.size(), 256, [this, &particles](unsigned begin, unsigned end)
+    {
+        for(unsigned i = begin; i < end; i++)
+        {
+            if(mMasses[i] > 0.0)
+            {
+                particles[i]->AddForce(CalculateForce(i));
+            }
+        }
+    }, mMaxThreads);
+}
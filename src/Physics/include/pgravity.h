@@ -0,0 +1,105 @@
+#ifndef PGRAVITY_H_INCLUDED
+#define PGRAVITY_H_INCLUDED
+#include <vector>
+
+#include "particle.h"
+#include "pfgen.h"
+
+/**
+    This file handles N-body gravity between all the particles in the world.
+    Working out the pull of every particle on every other particle is O(n^2) so we use the Barnes-Hut method.
+    The particles are put into an octree each frame and each node remembers the total mass and centre of mass of everything inside it.
+    When a node is far enough away compared to its size we treat the whole node as one big particle, this makes the cost O(n log n).
+*/
+
+namespace wind
+{
+    class ParticleGravityTree : public ParticleGroupForceGenerator
+    {
+        public:
+            //Sets up the gravity tree.
+            //theta is the opening angle, if a node's size divided by its distance is less than theta we use the whole node.
+            //0 gives the exact O(n^2) answer and 0.5 to 1.0 is the normal range.
+            //The softening length stops the force blowing up when two particles get really close to each other.
+            ParticleGravityTree(real gravitationalConstant = 6.674e-11, real theta = 0.5, real softening = 0.01);
+
+            void SetGravitationalConstant(real gravitationalConstant);
+            real GetGravitationalConstant() const;
+
+            void SetTheta(real theta);
+            real GetTheta() const;
+
+            void SetSoftening(real softening);
+            real GetSoftening() const;
+
+            //Sets the max number of threads used for the tree walk, 0 means use every core.
+            void SetMaxThreads(unsigned threads);
+
+            //This function rebuilds the octree from the current particle positions.
+            //Particles with infinite mass are left out of the tree.
+            void Build(const std::vector<Particle*>& particles);
+
+            //This works out the gravity force on one of the particles that was passed into the last Build call.
+            Vector3 CalculateForce(unsigned index) const;
+
+            //Rebuilds the tree and then walks it in parallel, adding the gravity force to each particle.
+            virtual void UpdateForces(std::vector<Particle*>& particles, real Duration);
+
+            //Returns how many nodes the tree used last frame, useful for checking the tree is not getting out of hand.
+            unsigned GetNodeCount() const;
+
+        private:
+            //Once we get this deep we stop splitting nodes and keep the particles in a list instead.
+            //This stops particles that sit on top of each other from splitting forever.
+            static const unsigned MAX_DEPTH = 32;
+
+            struct Node
+            {
+                //The centre and half the width of the node's cube.
+                Vector3 centre;
+                real halfSize;
+
+                //The total mass and the centre of mass of everything inside the node.
+                Vector3 centreOfMass;
+                real mass;
+
+                //The index of the first of the eight children, they are always next to each other. -1 for a leaf.
+                int firstChild;
+
+                //The first particle in the leaf, the rest are linked through mNext. -1 if the leaf is empty.
+                int particle;
+
+                //How far down the tree the node is.
+                unsigned depth;
+            };
+
+            //Adds a particle into the tree starting from the root.
+            void insert(int index);
+
+            //Splits a leaf into eight children.
+            void subdivide(int node);
+
+            //Works out which child a position goes into.
+            int childIndex(const Node& node, const Vector3& position) const;
+
+            //Fills in the mass and centre of mass of every node from the bottom up.
+            void calculateMass();
+
+            real mGravitationalConstant;
+            real mTheta;
+            real mSoftening;
+            unsigned mMaxThreads;
+
+            //All the nodes are stored in one vector which is reused every frame so we don't keep allocating.
+            std::vector<Node> mNodes;
+
+            //A copy of the positions and masses made in Build, so the tree walk only reads from these.
+            std::vector<Vector3> mPositions;
+            std::vector<real> mMasses;
+
+            //This links particles that share a leaf.
+            std::vector<int> mNext;
+    };
+}
+
+#endif // PGRAVITY_H_INCLUDED
@@ -0,0 +1,227 @@
+#include "pgrid.h"
+#include "parallel.h"
+
+using namespace wind;
+
+namespace
+{
+    //Large primes used to spread the cell coordinates over the hash table.
+    const unsigned HASH_PRIME_X = 73856093u;
+    const unsigned HASH_PRIME_Y = 19349663u;
+    const unsigned HASH_PRIME_Z = 83492791u;
+
+    //Used to mark particles that are not in the grid.
+    const unsigned NOT_IN_GRID = 0xffffffffu;
+}
+
+ParticleGrid::ParticleGrid(real cellSize) : mTableMask(0)
+{
+    SetCellSize(cellSize);
+}
+
+void ParticleGrid::SetCellSize(real cellSize)
+{
+    assert(cellSize > 0.0);
+    mCellSize = cellSize;
+    mInverseCellSize = static_cast<real>(1.0) / cellSize;
+}
+
+real ParticleGrid::GetCellSize() const
+{
+    return mCellSize;
+}
+
+unsigned ParticleGrid::GetCount() const
+{
+    return mSortedIndex.size();
+}
+
+unsigned ParticleGrid::GetParticleIndex(unsigned sorted) const
+{
+    return mSortedIndex[sorted];
+}
+
+int ParticleGrid::cellCoord(real value) const
+{
+    return static_cast<int>(std::floor(value * mInverseCellSize));
+}
+
+unsigned ParticleGrid::hashCell(int x, int y, int z) const
+{
+    return ((static_cast<unsigned>(x) * HASH_PRIME_X) ^
+            (static_cast<unsigned>(y) * HASH_PRIME_Y) ^
+            (static_cast<unsigned>(z) * HASH_PRIME_Z)) & mTableMask;
+}
+
+void ParticleGrid::Build(const std::vector<Particle*>& particles)
+{
+    unsigned count = particles.size();
+
+    //We want about two buckets per particle so most buckets only hold one cell.
+    unsigned tableSize = 64;
+    while(tableSize < count * 2)
+    {
+        tableSize <<= 1;
+    }
+    mTableMask = tableSize - 1;
+
+    mParticleCell.resize(count);
+
+    //Working out the cell is the expensive part of the build and every particle is separate, so we can split it up.
+    parallelFor(count, 4096, [this, &particles](unsigned begin, unsigned end)
+    {
+        for(unsigned i = begin; i < end; i++)
+        {
+            if(particles[i]->GetInverseMass() <= 0.0)
+            {
+                mParticleCell[i] = NOT_IN_GRID;
+                continue;
+            }
+
+            Vector3 position = particles[i]->GetPosition();
+            mParticleCell[i] = hashCell(cellCoord(position.x), cellCoord(position.y), cellCoord(position.z));
+        }
+    });
+
+    //This is the counting sort. First count how many particles are in each bucket.
+    mCellStart.assign(tableSize + 1, 0);
+    unsigned inGrid = 0;
+    for(unsigned i = 0; i < count; i++)
+    {
+        if(mParticleCell[i] != NOT_IN_GRID)
+        {
+            mCellStart[mParticleCell[i]]++;
+            inGrid++;
+        }
+    }
+
+    //Next turn the counts into the starting position of each bucket.
+    unsigned total = 0;
+    for(unsigned c = 0; c < tableSize; c++)
+    {
+        unsigned cellCount = mCellStart[c];
+        mCellStart[c] = total;
+        total += cellCount;
+    }
+    mCellStart[tableSize] = total;
+
+    //Then drop each particle into its bucket. This moves each start along to the end of its bucket.
+    mSortedIndex.resize(inGrid);
+    for(unsigned i = 0; i < count; i++)
+    {
+        if(mParticleCell[i] != NOT_IN_GRID)
+        {
+            mSortedIndex[mCellStart[mParticleCell[i]]++] = i;
+        }
+    }
+
+    //The end of each bucket is the start of the next one, so shifting everything up by one gives us back the starts.
+    for(unsigned c = tableSize; c > 0; c--)
+    {
+        mCellStart[c] = mCellStart[c - 1];
+    }
+    mCellStart[0] = 0;
+
+    //Finally we copy the particle data out in the sorted order.
+    mPositionX.resize(inGrid);
+    mPositionY.resize(inGrid);
+    mPositionZ.resize(inGrid);
+    mVelocityX.resize(inGrid);
+    mVelocityY.resize(inGrid);
+    mVelocityZ.resize(inGrid);
+    mMass.resize(inGrid);
+
+    parallelFor(inGrid, 4096, [this, &particles](unsigned begin, unsigned end)
+    {
+        for(unsigned s = begin; s < end; s++)
+        {
+            const Particle* particle = particles[mSortedIndex[s]];
+            Vector3 position = particle->GetPosition();
+            Vector3 velocity = particle->GetVelocity();
+
+            mPositionX[s] = position.x;
+            mPositionY[s] = position.y;
+            mPositionZ[s] = position.z;
+            mVelocityX[s] = velocity.x;
+            mVelocityY[s] = velocity.y;
+            mVelocityZ[s] = velocity.z;
+            mMass[s] = particle->GetMass();
+        }
+    });
+}
+
+unsigned ParticleGrid::GetNeighbourRanges(const Vector3& position, unsigned ranges[27][2]) const
+{
+    if(mSortedIndex.empty())
+    {
+        return 0;
+    }
+
+    int cx = cellCoord(position.x);
+    int cy = cellCoord(position.y);
+    int cz = cellCoord(position.z);
+
+    unsigned buckets[27];
+    unsigned found = 0;
+    unsigned used = 0;
+
+    for(int x = -1; x <= 1; x++)
+    {
+        for(int y = -1; y <= 1; y++)
+        {
+            for(int z = -1; z <= 1; z++)
+            {
+                unsigned bucket = hashCell(cx + x, cy + y, cz + z);
+
+                //Two cells can hash into the same bucket, if so we only want to visit it once or we would count particles twice.
+                bool seen = false;
+                for(unsigned b = 0; b < used; b++)
+                {
+                    if(buckets[b] == bucket)
+                    {
+                        seen = true;
+                        break;
+                    }
+                }
+                if(seen)
+                {
+                    continue;
+                }
+                buckets[used++] = bucket;
+
+                if(mCellStart[bucket] < mCellStart[bucket + 1])
+                {
+                    ranges[found][0] = mCellStart[bucket];
+                    ranges[found][1] = mCellStart[bucket + 1];
+                    found++;
+                }
+            }
+        }
+    }
+
+    return found;
+}
+
+void ParticleGrid::FindNeighbours(const Vector3& position, real radius, std::vector<unsigned>& neighbours) const
+{
+    neighbours.clear();
+
+    unsigned ranges[27][2];
+    unsigned rangeCount = GetNeighbourRanges(position, ranges);
+    real radius2 = radius * radius;
+
+    for(unsigned r = 0; r < rangeCount; r++)
+    {
+        for(unsigned s = ranges[r][0]; s < ranges[r][1]; s++)
+        {
+            real dx = mPositionX[s] - position.x;
+            real dy = mPositionY[s] - position.y;
+            real dz = mPositionZ[s] - position.z;
+
+            if(dx * dx + dy * dy + dz * dz <= radius2)
+            {
+                neighbours.push_back(mSortedIndex[s]);
+            }
+        }
+    }
+}
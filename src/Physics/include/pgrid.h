@@ -0,0 +1,88 @@
+#ifndef PGRID_H_INCLUDED
+#define PGRID_H_INCLUDED
+#include <vector>
+
+#include "particle.h"
+
+/**
+    This file handles finding the particles that are near each other.
+    The world is split up into cubes the size of the search radius, so a particle's neighbours can only be in its own cell or the 26 around it.
+    The cells are hashed into a table so the world doesn't need any bounds.
+
+    The grid is rebuilt every frame with a counting sort. Particles in the same cell end up next to each other in memory
+    and their positions and velocities are copied out into flat arrays, so the neighbour loops run over straight runs of doubles.
+*/
+
+namespace wind
+{
+    class ParticleGrid
+    {
+        public:
+            //The cell size should be the same as the largest radius you want to search with.
+            ParticleGrid(real cellSize = 1.0);
+
+            void SetCellSize(real cellSize);
+            real GetCellSize() const;
+
+            //Rebuilds the grid from the positions of the particles passed in.
+            //Particles with infinite mass are left out.
+            void Build(const std::vector<Particle*>& particles);
+
+            //Returns the number of particles that went into the grid.
+            unsigned GetCount() const;
+
+            //This returns the index in the original particle list for a particle in sorted order.
+            unsigned GetParticleIndex(unsigned sorted) const;
+
+            //These return the particle data in sorted order.
+            const real* GetPositionX() const { return mPositionX.data(); }
+            const real* GetPositionY() const { return mPositionY.data(); }
+            const real* GetPositionZ() const { return mPositionZ.data(); }
+            const real* GetVelocityX() const { return mVelocityX.data(); }
+            const real* GetVelocityY() const { return mVelocityY.data(); }
+            const real* GetVelocityZ() const { return mVelocityZ.data(); }
+            const real* GetMass() const { return mMass.data(); }
+
+            //This fills the ranges array with the runs of sorted particles that could be near the position.
+            //Each range is a begin and end pair, we can have at most 27 of them, one per cell.
+            //Note: The ranges can hold particles that are further away than the cell size, you still need to check the distance.
+            unsigned GetNeighbourRanges(const Vector3& position, unsigned ranges[27][2]) const;
+
+            //This is the simple version of the neighbour search.
+            //It fills the list with the original particle index of every particle within the radius, the radius should not be more than the cell size.
+            void FindNeighbours(const Vector3& position, real radius, std::vector<unsigned>& neighbours) const;
+
+        private:
+            //Works out which bucket a cell goes into.
+            unsigned hashCell(int x, int y, int z) const;
+
+            //Works out which cell a position sits in.
+            int cellCoord(real value) const;
+
+            real mCellSize;
+            real mInverseCellSize;
+
+            //The number of buckets is always a power of two so we can mask the hash.
+            unsigned mTableMask;
+
+            //For each bucket the first sorted particle, the bucket's particles run up to the next bucket's start.
+            std::vector<unsigned> mCellStart;
+
+            //The bucket of each particle before sorting.
+            std::vector<unsigned> mParticleCell;
+
+            //Maps the sorted order back to the original particle list.
+            std::vector<unsigned> mSortedIndex;
+
+            //The particle data copied out in sorted order.
+            std::vector<real> mPositionX;
+            std::vector<real> mPositionY;
+            std::vector<real> mPositionZ;
+            std::vector<real> mVelocityX;
+            std::vector<real> mVelocityY;
+            std::vector<real> mVelocityZ;
+            std::vector<real> mMass;
+    };
+}
+
+#endif // PGRID_H_INCLUDED
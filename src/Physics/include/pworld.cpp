@@ -2,9 +2,8 @@
 
 using namespace wind;
 
-ParticleWorld::ParticleWorld(unsigned maxContacts, unsigned iteration) : mMaxContact(maxContacts), mResolver(iteration)
+ParticleWorld::ParticleWorld(unsigned maxContacts, unsigned iteration) : mResolver(iteration), mContactPool(maxContacts)
 {
-    mContact = new ParticleContact[maxContacts];
     if(iteration == 0)
     {
         mCalculateIterations = true;
@@ -17,7 +16,6 @@ ParticleWorld::ParticleWorld(unsigned maxContacts, unsigned iteration) : mMaxCon
 
 ParticleWorld::~ParticleWorld()
 {
-    delete [] mContact;
 }
 
 void ParticleWorld::startFrame()
@@ -31,25 +29,29 @@ void ParticleWorld::startFrame()
 
 unsigned ParticleWorld::generateContacts()
 {
-    unsigned limit = mMaxContact;
-    ParticleContact* nextContact = mContact;
+    //If the pool ran out last frame it grows here, before any contacts are handed out.
+    mContactPool.beginFrame();
 
     for(ContactGenerator::iterator g = mConGenerator.begin(); g != mConGenerator.end(); g++)
     {
-        unsigned used = (*g)->addContact(nextContact, limit);
-
-        limit -= used;
-        nextContact += used;
-
-        //We have ran out of contacts :O that means we are miss contacts.
-        if(limit <= 0)
+        //Each generator gets a slice as big as the most contacts it can make.
+        unsigned requested = (*g)->getMaxContacts();
+        unsigned granted = 0;
+        ParticleContact* slice = mContactPool.reserve(requested, &granted);
+
+        //If there is no room left at all we don't call the generator, a limit of zero still lets some generators write a contact.
+        //We keep going through the rest so the pool knows how many contacts were wanted this frame.
+        unsigned used = 0;
+        if(granted > 0)
         {
-            break;
+            used = (*g)->addContact(slice, granted);
         }
+
+        mContactPool.commit(requested, granted, used);
     }
 
     //Return the number of contacts used.
-    return mMaxContact - limit;
+    return mContactPool.getUsed();
 }
 
 void ParticleWorld::integrate(real Duration)
@@ -65,6 +67,11 @@ void ParticleWorld::runPhysics(real Duration)
 {
     mRegistry.UpdateForce(Duration);
 
+    for(GroupForceGenerators::iterator g = mGroupForces.begin(); g != mGroupForces.end(); g++)
+    {
+        (*g)->UpdateForces(mParticle, Duration);
+    }
+
     integrate(Duration);
 
     unsigned usedContacts = generateContacts();
@@ -76,7 +83,7 @@ void ParticleWorld::runPhysics(real Duration)
             mResolver.SetIteration(usedContacts * 2);
         }
 
-        mResolver.ResolveContact(mContact, usedContacts, Duration);
+        mResolver.ResolveContact(mContactPool.getContacts(), usedContacts, Duration);
     }
 }
 
@@ -95,16 +102,37 @@ ParticleForceRegistry& ParticleWorld::getRegistry()
     return mRegistry;
 }
 
+const ParticleContactPool& ParticleWorld::getContactPool() const
+{
+    return mContactPool;
+}
+
+ParticleWorld::GroupForceGenerators& ParticleWorld::getGroupForces()
+{
+    return mGroupForces;
+}
+
 void GroundContacts::Init(ParticleWorld::Particles* particles)
 {
     GroundContacts::particles = particles;
 }
 
+unsigned GroundContacts::getMaxContacts() const
+{
+    return particles->size();
+}
+
 unsigned GroundContacts::addContact(ParticleContact* contact, unsigned limit) const
 {
     unsigned Count = 0;
     for(ParticleWorld::Particles::iterator p = particles->begin(); p != particles->end(); p++)
     {
+        //The contact pool counts anything we miss, so we just stop when our slice is full.
+        if(Count >= limit)
+        {
+            return Count;
+        }
+
         real y = (*p)->GetPosition().y;
 
         //Here we have set up collisions
@@ -119,12 +147,6 @@ unsigned GroundContacts::addContact(ParticleContact* contact, unsigned limit) co
             contact++;
             Count++;
         }
-
-        if(Count >= limit)
-        {
-            std::cout << "Do we leave?" << std::endl;
-            return Count;
-        }
     }
 
     return Count;
@@ -15,11 +15,14 @@ namespace wind
             typedef std::vector<Particle*> Particles;
             //This vector will hold all the particle contacts register.
             typedef std::vector<ParticleContactGenerator*> ContactGenerator;
+            //This vector will hold the force generators that work on every particle at once.
+            typedef std::vector<ParticleGroupForceGenerator*> GroupForceGenerators;
 
             /**
                 This will create a new particle simulator given the number of contacts per frame.
                 You can optionally give a number of contact resolution.
                 We will us twice the number contacts will be used.
+                Note: The number of contacts is only where the pool starts, it grows if the contact generators ask for more.
             */
             ParticleWorld(unsigned maxContacts, unsigned iteration = 0);
             ~ParticleWorld();
@@ -37,6 +40,9 @@ namespace wind
             //Calls each of the registered contact generators their contacts. Returns the number of contacts generated.
             unsigned generateContacts();
 
+            //Returns the contact pool, so you can read how many contacts were used and dropped.
+            const ParticleContactPool& getContactPool() const;
+
             //This function integrate all the particles forward given by a duration.
             void integrate(real Duration);
 
@@ -52,13 +58,16 @@ namespace wind
             //Returns a list of force registry.
             ParticleForceRegistry& getRegistry();
 
+            //Returns the list of force generators that are ran over all the particles each frame.
+            GroupForceGenerators& getGroupForces();
+
         protected:
 
             //This is the particle force register for all the particles in the demo.
             ParticleForceRegistry mRegistry;
 
-            //This unsigned int hold the max number of contacts that are allowed per frame.
-            unsigned mMaxContact;
+            //These force generators are given the whole particle list each frame after the registry has ran.
+            GroupForceGenerators mGroupForces;
 
             //The particle contact generator for resolving collisions with impulse.
             ParticleContactResolver mResolver;
@@ -66,8 +75,8 @@ namespace wind
             //This is the contactGenerator for all the particles.
             ContactGenerator mConGenerator;
 
-            //This will hold a list of contacts.
-            ParticleContact* mContact;
+            //This holds the contacts, each contact generator gets its own slice of it.
+            ParticleContactPool mContactPool;
 
             //This is true if the world should calculate the number of iterations to give the contact resolver at each frame.
             bool mCalculateIterations;
@@ -80,6 +89,8 @@ namespace wind
             void Init(ParticleWorld::Particles* particles);
             //This function handles particle contacts with the floor.
             virtual unsigned addContact(ParticleContact* contact, unsigned limit) const;
+            //Every particle could be under the ground at once.
+            virtual unsigned getMaxContacts() const;
         private:
             ParticleWorld::Particles* particles;
     };
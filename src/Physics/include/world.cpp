@@ -16,6 +16,11 @@ World::RigidBodies &World::getBodies()
     return bodies;
 }
 
+FluidField &World::getFluidField()
+{
+    return fluidField;
+}
+
 ForceRegistry &World::getRegistry()
 {
     return registry;
@@ -33,5 +38,7 @@ void World::runPhysics(real duration, RigidBody* body)
 {
     registry.updateForce(duration, body);
 
+    fluidField.updateForces(duration);
+
     integrate(duration);
 }
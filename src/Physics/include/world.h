@@ -3,6 +3,7 @@
 #include <vector>
 #include "ForceGen.h"
 #include "Body.h"
+#include "FluidField.h"
 
 /**
     This file will support the simulation of each individual rigid body.
@@ -20,6 +21,9 @@ namespace wind
 
             RigidBodies bodies;
 
+            //The water and wind shared by every body in the world, its forces are added each frame after the registry.
+            FluidField fluidField;
+
             //Restarts the forces for each frame
             void startFrame();
 
@@ -28,6 +32,9 @@ namespace wind
 
             RigidBodies &getBodies();
 
+            //This function returns the water and wind for the world.
+            FluidField& getFluidField();
+
             //Runs the integrator for each rigid body.
             void integrate(real duration);
 
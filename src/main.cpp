@@ -1,9 +1,38 @@
 #include "Game.h"
+#include "Graphics/CullBenchmark.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+    /**
+        Running with --cull-benchmark and an optional box count skips the window and compares the tree cull
+        against the brute force one, it fails if they kept different boxes.
+    */
+    int runCullBenchmark(int count)
+    {
+        wind::CullBenchmarkResult result = wind::runCullBenchmark(count > 0 ? count : 1000000);
+        std::cout << "Cull benchmark: " << result.count << " boxes, " << result.visible << " visible, "
+                  << result.mismatches << " mismatches" << std::endl;
+        std::cout << "Build " << result.buildMilliseconds << " ms, tree " << result.treeMilliseconds
+                  << " ms, brute force " << result.bruteForceMilliseconds << " ms" << std::endl;
+
+        return result.mismatches == 0 ? 0 : 1;
+    }
+}
+
 /**
     Update the player so the player has a camera.
 */
 int main(int argv, char** argc)
 {
+    if (argv > 1 && std::strcmp(argc[1], "--cull-benchmark") == 0)
+    {
+        return runCullBenchmark(argv > 2 ? std::atoi(argc[2]) : 0);
+    }
+
     wind::Game game;
     game.mainLoop();
 